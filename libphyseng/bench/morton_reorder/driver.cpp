@@ -0,0 +1,189 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+#include <libphyseng/kernels/smoothing_kernel.hpp>
+#include <libphyseng/main.hpp>
+#include <libphyseng/neighbor/uniform_grid.hpp>
+#include <libphyseng/neighbor/verlet_list.hpp>
+#include <libphyseng/particles/morton_order.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+#include <libphyseng/profiling/hardware_counters.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Measures the cost of the neighbor loops of a step before and after the particles are sorted
+// along a Morton curve. The particles start from a lattice stored in a random order, the worst
+// case of the drift that builds up over a long run
+//
+// usage: driver [lattice side] [steps]
+
+namespace
+{
+	constexpr float spacing = 0.02F;
+	constexpr float rest_density = 1000.0F;
+
+	auto parse_or(std::span<std::string_view const> args, std::size_t index, std::uint32_t fallback)
+		-> std::uint32_t
+	{
+		if (index >= args.size())
+		{
+			return fallback;
+		}
+
+		auto value = fallback;
+		std::from_chars(args[index].data(), args[index].data() + args[index].size(), value);
+
+		return value;
+	}
+
+	auto make_shuffled_lattice(std::uint32_t side) -> physeng::particle_set
+	{
+		auto particles = physeng::particle_set{std::size_t{side} * side * side};
+
+		auto i = std::size_t{0};
+		for (std::uint32_t z = 0; z < side; ++z)
+		{
+			for (std::uint32_t y = 0; y < side; ++y)
+			{
+				for (std::uint32_t x = 0; x < side; ++x, ++i)
+				{
+					particles.position(0)[i] = static_cast<float>(x) * spacing;
+					particles.position(1)[i] = static_cast<float>(y) * spacing;
+					particles.position(2)[i] = static_cast<float>(z) * spacing;
+				}
+			}
+		}
+		std::ranges::fill(particles.mass(), rest_density * spacing * spacing * spacing);
+
+		auto permutation = std::vector<physeng::particle_index>(particles.size());
+		std::iota(std::begin(permutation), std::end(permutation), 0U);
+		std::ranges::shuffle(permutation, std::mt19937{42}); // NOLINT
+		particles.reorder(permutation);
+
+		return particles;
+	}
+
+	/**
+	 * @brief The density summation of an SPH step, the typical access pattern of a neighbor loop
+	 */
+	void compute_density(physeng::particle_set& particles, physeng::verlet_list const& neighbors,
+						 physeng::smoothing_kernel const& kernel)
+	{
+		auto const x = particles.position(0);
+		auto const y = particles.position(1);
+		auto const z = particles.position(2);
+		auto const mass = particles.mass();
+		auto density = particles.density();
+
+		physeng::parallel_for(particles.size(), 1024, [&](std::size_t first, std::size_t last) {
+			for (auto i = first; i < last; ++i)
+			{
+				auto sum = 0.0F;
+				for (auto const j : neighbors.candidates(static_cast<physeng::particle_index>(i)))
+				{
+					auto const dx = x[i] - x[j];
+					auto const dy = y[i] - y[j];
+					auto const dz = z[i] - z[j];
+
+					sum += mass[j] * kernel.evaluate(dx * dx + dy * dy + dz * dz);
+				}
+
+				density[i] = sum;
+			}
+		});
+	}
+
+	void run(std::string_view label, physeng::particle_set& particles,
+			 physeng::smoothing_kernel const& kernel, float locality, std::uint32_t steps)
+	{
+		auto grid = physeng::uniform_grid{kernel.get_support_radius()};
+		auto neighbors = physeng::verlet_list{kernel.get_support_radius(), 0.0F};
+		neighbors.update(grid, particles);
+
+		auto counters = physeng::hardware_counters{};
+
+		auto const start = std::chrono::steady_clock::now();
+		counters.start();
+		for (std::uint32_t step = 0; step < steps; ++step)
+		{
+			compute_density(particles, neighbors, kernel);
+		}
+		auto const sample = counters.stop();
+		auto const elapsed =
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+		auto const per_step = [&](std::uint64_t count) {
+			return static_cast<double>(count) / static_cast<double>(steps);
+		};
+
+		if (counters.is_available())
+		{
+			fmt::print("{:<10} {:>10.2f} {:>12.3f} {:>16.3e} {:>12.2f}%\n", label, locality,
+					   elapsed.count() / steps, per_step(sample.cache_misses),
+					   sample.cache_references == 0
+						   ? 0.0
+						   : 100.0 * static_cast<double>(sample.cache_misses)
+								 / static_cast<double>(sample.cache_references));
+		}
+		else
+		{
+			fmt::print("{:<10} {:>10.2f} {:>12.3f} {:>16} {:>13}\n", label, locality,
+					   elapsed.count() / steps, "n/a", "n/a");
+		}
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> args) -> int
+{
+	auto const side = parse_or(args, 1, 64);  // NOLINT
+	auto const steps = parse_or(args, 2, 10); // NOLINT
+
+	auto particles = make_shuffled_lattice(side);
+	auto const kernel = physeng::smoothing_kernel{physeng::kernel_type::cubic_spline,
+												  physeng::smoothing_length{1.2F * spacing}};
+	auto reorder = physeng::morton_reorder{kernel.get_support_radius().get(), 0, 0.0F};
+
+	fmt::print("{} particles, {} steps\n", particles.size(), steps);
+	if (!physeng::hardware_counters{}.is_available())
+	{
+		fmt::print("hardware counters are unavailable, only timings are reported\n");
+	}
+	fmt::print("{:<10} {:>10} {:>12} {:>16} {:>13}\n", "order", "locality", "ms/step",
+			   "misses/step", "miss rate");
+
+	run("shuffled", particles, kernel, reorder.measure_locality(particles), steps);
+
+	auto const start = std::chrono::steady_clock::now();
+	reorder.reorder(particles);
+	auto const elapsed =
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+	run("morton", particles, kernel, reorder.measure_locality(particles), steps);
+	fmt::print("reordering took {:.3f} ms\n", elapsed.count());
+
+	return EXIT_SUCCESS;
+}
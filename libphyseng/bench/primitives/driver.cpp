@@ -0,0 +1,543 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "harness.hpp"
+
+#include <libphyseng/concurrency/parallel_reduce.hpp>
+#include <libphyseng/concurrency/parallel_scan.hpp>
+#include <libphyseng/concurrency/parallel_sort.hpp>
+#include <libphyseng/concurrency/thread_pool.hpp>
+#include <libphyseng/kernels/smoothing_kernel.hpp>
+#include <libphyseng/main.hpp>
+#include <libphyseng/math/units.hpp>
+#include <libphyseng/math/vec.hpp>
+#include <libphyseng/neighbor/spatial_hash.hpp>
+#include <libphyseng/neighbor/uniform_grid.hpp>
+#include <libphyseng/neighbor/verlet_list.hpp>
+#include <libphyseng/particles/morton_order.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+#include <libphyseng/util/strong_ops/arithmetic.hpp>
+#include <libphyseng/util/strong_type.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+// Times the primitives the solvers are built from and compares them against a baseline
+//
+// usage: driver [--filter=<substring>] [--samples=<count>] [--output=<results.json>]
+//               [--baseline=<results.json>] [--threshold=<ratio>]
+//
+// The results are written as JSON. Given a baseline, a previous output of the driver, the run
+// fails when the median of a benchmark got slower by more than the threshold, 10% by default
+
+namespace
+{
+	using namespace std::literals;
+
+	constexpr std::size_t array_size = std::size_t{1} << 20U;
+	constexpr std::size_t batch_size = 4096;
+	constexpr std::uint32_t lattice_side = 32;
+	constexpr float spacing = 0.02F;
+	constexpr float rest_density = 1000.0F;
+
+	struct arguments
+	{
+		bench::settings settings = {};
+		std::string output_path = {};
+		std::string baseline_path = {};
+		double threshold = 0.1;
+	};
+
+	template<typename Type>
+	auto parse_number(std::string_view value) -> std::optional<Type>
+	{
+		auto result = Type{};
+		auto const [end, error] =
+			std::from_chars(value.data(), value.data() + value.size(), result);
+		if (error != std::errc{} || end != value.data() + value.size())
+		{
+			return std::nullopt;
+		}
+
+		return result;
+	}
+
+	auto parse_arguments(std::span<std::string_view const> args) -> std::optional<arguments>
+	{
+		auto result = arguments{};
+
+		for (auto const arg : args.subspan(std::min<std::size_t>(1, args.size())))
+		{
+			auto const separator = arg.find('=');
+			auto const name = arg.substr(0, separator);
+			auto const value =
+				separator == std::string_view::npos ? ""sv : arg.substr(separator + 1);
+
+			if (name == "--filter"sv)
+			{
+				result.settings.filter = value;
+			}
+			else if (name == "--samples"sv)
+			{
+				auto const count = parse_number<std::size_t>(value);
+				if (!count || *count == 0)
+				{
+					return std::nullopt;
+				}
+				result.settings.sample_count = *count;
+			}
+			else if (name == "--output"sv && !value.empty())
+			{
+				result.output_path = value;
+			}
+			else if (name == "--baseline"sv && !value.empty())
+			{
+				result.baseline_path = value;
+			}
+			else if (name == "--threshold"sv)
+			{
+				auto const ratio = parse_number<double>(value);
+				if (!ratio || *ratio < 0.0)
+				{
+					return std::nullopt;
+				}
+				result.threshold = *ratio;
+			}
+			else
+			{
+				return std::nullopt;
+			}
+		}
+
+		return result;
+	}
+
+	/**
+	 * @brief A lattice with a little jitter, stored in a random order like the particles of a
+	 * long run
+	 */
+	auto make_particles() -> physeng::particle_set
+	{
+		auto particles = physeng::particle_set{std::size_t{lattice_side} * lattice_side
+											   * lattice_side};
+
+		auto engine = std::mt19937{42}; // NOLINT
+		auto jitter = std::uniform_real_distribution<float>{-0.1F * spacing, 0.1F * spacing};
+
+		auto i = std::size_t{0};
+		for (std::uint32_t z = 0; z < lattice_side; ++z)
+		{
+			for (std::uint32_t y = 0; y < lattice_side; ++y)
+			{
+				for (std::uint32_t x = 0; x < lattice_side; ++x, ++i)
+				{
+					particles.position(0)[i] = static_cast<float>(x) * spacing + jitter(engine);
+					particles.position(1)[i] = static_cast<float>(y) * spacing + jitter(engine);
+					particles.position(2)[i] = static_cast<float>(z) * spacing + jitter(engine);
+				}
+			}
+		}
+		std::ranges::fill(particles.mass(), rest_density * spacing * spacing * spacing);
+
+		auto permutation = std::vector<physeng::particle_index>(particles.size());
+		std::iota(std::begin(permutation), std::end(permutation), 0U);
+		std::ranges::shuffle(permutation, engine);
+		particles.reorder(permutation);
+
+		return particles;
+	}
+
+	auto make_kernel(physeng::simd_level level = physeng::detect_simd_level())
+		-> physeng::smoothing_kernel
+	{
+		return physeng::smoothing_kernel{physeng::kernel_type::cubic_spline,
+										 physeng::smoothing_length{1.2F * spacing},
+										 physeng::particle_set::dimension, level};
+	}
+
+	/**
+	 * @brief The strong types of the library are meant to cost nothing over the raw scalars
+	 */
+	void run_strong_type(bench::suite& suite)
+	{
+		using strong_float =
+			physeng::strong_type<float, struct strong_float_tag, physeng::strong::arithmetic>;
+
+		auto engine = std::mt19937{7}; // NOLINT
+		auto distribution = std::uniform_real_distribution<float>{0.0F, 1.0F};
+
+		auto raw = std::vector<float>(batch_size);
+		std::ranges::generate(raw, [&] { return distribution(engine); });
+
+		auto strong = std::vector<strong_float>{};
+		std::ranges::transform(raw, std::back_inserter(strong),
+							   [](float value) { return strong_float{value}; });
+
+		suite.run("strong_type/dot/raw", batch_size, [&] {
+			auto sum = 0.0F;
+			for (std::size_t i = 0; i < batch_size; ++i)
+			{
+				sum += raw[i] * raw[batch_size - 1 - i];
+			}
+			bench::do_not_optimize(sum);
+		});
+		suite.run("strong_type/dot/strong", batch_size, [&] {
+			auto sum = strong_float{0.0F};
+			for (std::size_t i = 0; i < batch_size; ++i)
+			{
+				sum += strong[i] * strong[batch_size - 1 - i];
+			}
+			bench::do_not_optimize(sum.get());
+		});
+
+		suite.run("strong_type/scale/raw", batch_size, [&] {
+			for (auto& value : raw)
+			{
+				value = value * 0.5F + 0.25F;
+			}
+			bench::do_not_optimize(raw.data());
+		});
+		suite.run("strong_type/scale/strong", batch_size, [&] {
+			auto const half = strong_float{0.5F};
+			auto const quarter = strong_float{0.25F};
+			for (auto& value : strong)
+			{
+				value = value * half + quarter;
+			}
+			bench::do_not_optimize(strong.data());
+		});
+	}
+
+	/**
+	 * @brief The vectors of quantities against the same code written on raw floats: the unit
+	 * checks happen at compile time and both should compile to the same packed instructions
+	 */
+	void run_vector_math(bench::suite& suite)
+	{
+		using raw_vec3 = std::array<float, 3>;
+		using raw_batch = std::array<std::array<float, 8>, 3>;
+		using typed_batch = physeng::vec3_batch<physeng::length, 8>;
+
+		auto engine = std::mt19937{23}; // NOLINT
+		auto distribution = std::uniform_real_distribution<float>{-1.0F, 1.0F};
+		auto const random_vec3 = [&] {
+			return raw_vec3{distribution(engine), distribution(engine), distribution(engine)};
+		};
+
+		auto raw_positions = std::vector<raw_vec3>(batch_size);
+		auto raw_velocities = std::vector<raw_vec3>(batch_size);
+		std::ranges::generate(raw_positions, random_vec3);
+		std::ranges::generate(raw_velocities, random_vec3);
+
+		auto positions = std::vector<physeng::vec3<physeng::length>>{};
+		auto velocities = std::vector<physeng::vec3<physeng::velocity>>{};
+		for (std::size_t i = 0; i < batch_size; ++i)
+		{
+			auto& position = positions.emplace_back();
+			auto& velocity = velocities.emplace_back();
+			for (std::size_t axis = 0; axis < 3; ++axis)
+			{
+				position[axis] = physeng::length{raw_positions[i][axis]};
+				velocity[axis] = physeng::velocity{raw_velocities[i][axis]};
+			}
+		}
+
+		auto const raw_dt = 1.0e-3F;
+		auto const dt = physeng::time_interval{raw_dt};
+
+		suite.run("vec/advect/raw", batch_size, [&] {
+			for (std::size_t i = 0; i < batch_size; ++i)
+			{
+				for (std::size_t axis = 0; axis < 3; ++axis)
+				{
+					raw_positions[i][axis] += raw_velocities[i][axis] * raw_dt;
+				}
+			}
+			bench::do_not_optimize(raw_positions.data());
+		});
+		suite.run("vec/advect/typed", batch_size, [&] {
+			for (std::size_t i = 0; i < batch_size; ++i)
+			{
+				positions[i] += velocities[i] * dt;
+			}
+			bench::do_not_optimize(positions.data());
+		});
+
+		// Distances from one particle to batches of others, the inner loop of a neighbor search
+		auto raw_batches = std::vector<raw_batch>(batch_size / 8);
+		auto batches = std::vector<typed_batch>(batch_size / 8);
+		for (std::size_t i = 0; i < batch_size; ++i)
+		{
+			for (std::size_t axis = 0; axis < 3; ++axis)
+			{
+				raw_batches[i / 8][axis][i % 8] = raw_positions[i][axis];
+				batches[i / 8].lanes[axis][i % 8] = physeng::length{raw_positions[i][axis]};
+			}
+		}
+
+		auto const raw_origin = random_vec3();
+		auto const origin = physeng::vec3<physeng::length>{
+			{physeng::length{raw_origin[0]}, physeng::length{raw_origin[1]},
+			 physeng::length{raw_origin[2]}}};
+		auto raw_distances = std::vector<float>(batch_size);
+		auto distances = std::vector<physeng::area>(batch_size);
+
+		suite.run("vec/distance_squared/raw", batch_size, [&] {
+			for (std::size_t b = 0; b < raw_batches.size(); ++b)
+			{
+				for (std::size_t lane = 0; lane < 8; ++lane)
+				{
+					auto sum = 0.0F;
+					for (std::size_t axis = 0; axis < 3; ++axis)
+					{
+						auto const delta = raw_batches[b][axis][lane] - raw_origin[axis];
+						sum += delta * delta;
+					}
+					raw_distances[8 * b + lane] = sum;
+				}
+			}
+			bench::do_not_optimize(raw_distances.data());
+		});
+		suite.run("vec/distance_squared/typed", batch_size, [&] {
+			for (std::size_t b = 0; b < batches.size(); ++b)
+			{
+				auto const batch = physeng::length_squared(batches[b] - origin);
+				std::ranges::copy(batch, std::next(std::begin(distances),
+												   static_cast<std::ptrdiff_t>(8 * b)));
+			}
+			bench::do_not_optimize(distances.data());
+		});
+	}
+
+	void run_kernels(bench::suite& suite)
+	{
+		auto const radius = make_kernel().get_support_radius().get();
+
+		auto engine = std::mt19937{11}; // NOLINT
+		auto distribution = std::uniform_real_distribution<float>{0.0F, radius * radius};
+
+		auto distances = std::vector<float>(batch_size);
+		std::ranges::generate(distances, [&] { return distribution(engine); });
+		auto values = std::vector<float>(batch_size);
+
+		for (auto const level :
+			 {physeng::simd_level::scalar, physeng::simd_level::avx2, physeng::simd_level::avx512})
+		{
+			if (level > physeng::detect_simd_level())
+			{
+				continue;
+			}
+
+			auto const kernel = make_kernel(level);
+			auto const prefix = fmt::format("kernel/cubic_spline/{}", physeng::to_string(level));
+
+			suite.run(prefix + "/value", batch_size, [&] {
+				kernel.evaluate(distances, values);
+				bench::do_not_optimize(values.data());
+			});
+			suite.run(prefix + "/gradient", batch_size, [&] {
+				kernel.evaluate_gradient(distances, values);
+				bench::do_not_optimize(values.data());
+			});
+		}
+	}
+
+	void run_neighbor_search(bench::suite& suite)
+	{
+		auto const particles = make_particles();
+		auto const count = particles.size();
+		auto const radius = make_kernel().get_support_radius();
+
+		auto grid = physeng::uniform_grid{radius};
+		suite.run("neighbor/uniform_grid/rebuild", count, [&] { grid.rebuild(particles); });
+
+		auto hash = physeng::spatial_hash{radius};
+		suite.run("neighbor/spatial_hash/rebuild", count, [&] { hash.rebuild(particles); });
+
+		auto neighbors = physeng::verlet_list{radius, 0.0F};
+		suite.run("neighbor/verlet_list/build", count, [&] {
+			neighbors.invalidate();
+			neighbors.update(grid, particles);
+		});
+
+		suite.run("neighbor/verlet_list/query", count, [&] {
+			auto total = 0.0F;
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				neighbors.for_each_neighbor(particles, static_cast<physeng::particle_index>(i),
+											[&](physeng::particle_index /*j*/,
+												float distance_squared) {
+												total += distance_squared;
+											});
+			}
+			bench::do_not_optimize(total);
+		});
+	}
+
+	void run_sorting(bench::suite& suite)
+	{
+		auto engine = std::mt19937_64{13}; // NOLINT
+		auto keys = std::vector<std::uint64_t>(array_size);
+		std::ranges::generate(keys, engine);
+
+		// Every operation sorts a fresh copy of the keys, the copy is part of the timing
+		auto sorted = keys;
+		suite.run("sort/std_sort", array_size, [&] {
+			std::ranges::copy(keys, std::begin(sorted));
+			std::ranges::sort(sorted);
+		});
+		suite.run("sort/parallel_sort", array_size, [&] {
+			std::ranges::copy(keys, std::begin(sorted));
+			physeng::parallel_sort(std::span{sorted});
+		});
+
+		auto const shuffled = make_particles();
+		auto particles = shuffled;
+		auto reorder =
+			physeng::morton_reorder{make_kernel().get_support_radius().get(), 0, 0.0F};
+		suite.run("sort/morton_reorder", shuffled.size(), [&] {
+			particles = shuffled;
+			reorder.reorder(particles);
+		});
+	}
+
+	void run_reductions(bench::suite& suite)
+	{
+		auto engine = std::mt19937{17}; // NOLINT
+		auto distribution = std::uniform_real_distribution<float>{0.0F, 1.0F};
+
+		auto values = std::vector<float>(array_size);
+		std::ranges::generate(values, [&] { return distribution(engine); });
+
+		suite.run("reduce/std_accumulate", array_size, [&] {
+			bench::do_not_optimize(std::accumulate(std::begin(values), std::end(values), 0.0F));
+		});
+		suite.run("reduce/parallel_reduce", array_size, [&] {
+			auto const sum = physeng::parallel_reduce(
+				values.size(), 0.0F,
+				[&](std::size_t begin, std::size_t end) {
+					auto partial = 0.0F;
+					for (auto i = begin; i < end; ++i)
+					{
+						partial += values[i];
+					}
+					return partial;
+				},
+				std::plus<>{});
+			bench::do_not_optimize(sum);
+		});
+
+		// The counts wrap around after a few scans, which does not change the work done
+		auto counts = std::vector<std::uint32_t>(array_size, 1U);
+		suite.run("scan/parallel_exclusive_scan", array_size, [&] {
+			bench::do_not_optimize(physeng::parallel_exclusive_scan(std::span{counts}));
+		});
+	}
+
+	auto write_file(std::string const& path, std::string_view content) -> bool
+	{
+		auto file = std::ofstream{path};
+		file << content;
+
+		return static_cast<bool>(file);
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> args) -> int
+{
+	auto const parsed = parse_arguments(args);
+	if (!parsed)
+	{
+		fmt::print(stderr, "usage: {} [--filter=<substring>] [--samples=<count>] "
+						   "[--output=<path>] [--baseline=<path>] [--threshold=<ratio>]\n",
+				   args.empty() ? "driver"sv : args[0]);
+		return EXIT_FAILURE;
+	}
+
+	auto const* const pool = physeng::get_default_thread_pool();
+	auto const thread_count = pool == nullptr ? std::size_t{1} : pool->get_worker_count();
+
+	fmt::print("{} threads, {} simd\n", thread_count,
+			   physeng::to_string(physeng::detect_simd_level()));
+	fmt::print("{:<40} {:>14} {:>14} {:>9} {:>14}\n", "benchmark", "median ns/op", "min ns/op",
+			   "deviation", "items/s");
+
+	auto suite = bench::suite{parsed->settings};
+	run_strong_type(suite);
+	run_vector_math(suite);
+	run_kernels(suite);
+	run_neighbor_search(suite);
+	run_sorting(suite);
+	run_reductions(suite);
+
+	// Informative only, the baseline is what fails a run
+	for (auto const& parity : bench::compare_to_raw(suite.get_results()))
+	{
+		fmt::print("{:<40} {:>6.2f}x {}\n", parity.name, parity.ratio, parity.reference);
+	}
+
+	if (!parsed->output_path.empty()
+		&& !write_file(parsed->output_path, bench::to_json(suite.get_results(), thread_count)))
+	{
+		fmt::print(stderr, "failed to write the results to '{}'\n", parsed->output_path);
+		return EXIT_FAILURE;
+	}
+
+	if (parsed->baseline_path.empty())
+	{
+		return EXIT_SUCCESS;
+	}
+
+	auto const baseline = bench::read_baseline(parsed->baseline_path);
+	if (!baseline)
+	{
+		fmt::print(stderr, "{}: '{}'\n", bench::to_string(baseline.error()),
+				   parsed->baseline_path);
+		return EXIT_FAILURE;
+	}
+
+	auto const regressions =
+		bench::find_regressions(suite.get_results(), *baseline, parsed->threshold);
+	for (auto const& regression : regressions)
+	{
+		fmt::print(stderr, "regression: {} went from {:.1f} to {:.1f} ns/op (+{:.1f}%)\n",
+				   regression.name, regression.baseline, regression.current,
+				   100.0 * (regression.current / regression.baseline - 1.0));
+	}
+
+	if (!regressions.empty())
+	{
+		return EXIT_FAILURE;
+	}
+
+	fmt::print("no regression beyond {:.1f}% against '{}'\n", 100.0 * parsed->threshold,
+			   parsed->baseline_path);
+
+	return EXIT_SUCCESS;
+}
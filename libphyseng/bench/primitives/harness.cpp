@@ -0,0 +1,272 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "harness.hpp"
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <optional>
+
+namespace
+{
+	using namespace std::literals;
+
+	constexpr int format_version = 1;
+
+	void append_json_string(std::string& out, std::string_view value)
+	{
+		out.push_back('"');
+		for (auto const character : value)
+		{
+			if (character == '"' || character == '\\')
+			{
+				out.push_back('\\');
+			}
+			out.push_back(character);
+		}
+		out.push_back('"');
+	}
+
+	/**
+	 * @brief Read the JSON string starting at `text[offset]`, the escapes written by
+	 * `append_json_string` only
+	 */
+	auto read_json_string(std::string_view text, std::size_t& offset) -> std::optional<std::string>
+	{
+		if (offset >= text.size() || text[offset] != '"')
+		{
+			return std::nullopt;
+		}
+
+		auto value = std::string{};
+		for (++offset; offset < text.size(); ++offset)
+		{
+			if (text[offset] == '"')
+			{
+				++offset;
+				return value;
+			}
+
+			if (text[offset] == '\\')
+			{
+				++offset;
+			}
+			if (offset < text.size())
+			{
+				value.push_back(text[offset]);
+			}
+		}
+
+		return std::nullopt;
+	}
+} // namespace
+
+namespace bench
+{
+	auto result::get_throughput() const noexcept -> double
+	{
+		return median > 0.0 ? static_cast<double>(items_per_op) * 1.0e9 / median : 0.0;
+	}
+	auto result::get_relative_deviation() const noexcept -> double
+	{
+		return mean > 0.0 ? std::sqrt(variance) / mean : 0.0;
+	}
+
+	suite::suite(settings config) : m_settings(std::move(config))
+	{
+		m_settings.sample_count = std::max<std::size_t>(m_settings.sample_count, 1);
+	}
+
+	auto suite::get_results() const noexcept -> std::span<result const>
+	{
+		return m_results;
+	}
+
+	auto suite::is_selected(std::string_view name) const noexcept -> bool
+	{
+		return name.find(m_settings.filter) != std::string_view::npos;
+	}
+
+	void suite::add_result(std::string_view name, std::uint64_t iterations,
+						   std::size_t items_per_op, std::vector<double> samples)
+	{
+		std::ranges::sort(samples);
+
+		auto const count = static_cast<double>(samples.size());
+		auto const middle = samples.size() / 2;
+		auto const median = samples.size() % 2 == 0
+							  ? (samples[middle - 1] + samples[middle]) / 2.0
+							  : samples[middle];
+		auto const mean = std::accumulate(std::begin(samples), std::end(samples), 0.0) / count;
+		auto const squares = std::accumulate(std::begin(samples), std::end(samples), 0.0,
+											 [&](double sum, double sample) {
+												 return sum + (sample - mean) * (sample - mean);
+											 });
+
+		auto& entry = m_results.emplace_back(result{.name = std::string{name},
+													.iterations = iterations,
+													.items_per_op = items_per_op,
+													.mean = mean,
+													.median = median,
+													.min = samples.front(),
+													.variance = squares / count});
+
+		fmt::print("{:<40} {:>14.1f} {:>14.1f} {:>8.2f}% {:>14.4g}\n", entry.name, entry.median,
+				   entry.min, 100.0 * entry.get_relative_deviation(), entry.get_throughput());
+	}
+
+	auto to_json(std::span<result const> results, std::size_t thread_count) -> std::string
+	{
+		auto out = fmt::format("{{\n  \"version\": {},\n  \"threads\": {},\n"
+							   "  \"unit\": \"ns/op\",\n  \"benchmarks\": [",
+							   format_version, thread_count);
+
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			auto const& entry = results[i];
+
+			out += i == 0 ? "\n    {\"name\": "sv : ",\n    {\"name\": "sv;
+			append_json_string(out, entry.name);
+			fmt::format_to(std::back_inserter(out),
+						   ", \"iterations\": {}, \"items_per_op\": {}, \"median\": {}, "
+						   "\"mean\": {}, \"min\": {}, \"variance\": {}, "
+						   "\"items_per_second\": {}}}",
+						   entry.iterations, entry.items_per_op, entry.median, entry.mean,
+						   entry.min, entry.variance, entry.get_throughput());
+		}
+
+		out += "\n  ]\n}\n";
+
+		return out;
+	}
+
+	auto to_string(baseline_error error) -> std::string_view
+	{
+		switch (error)
+		{
+			case baseline_error::io_error:
+				return "the baseline could not be read"sv;
+			case baseline_error::invalid_file:
+				return "the baseline is not a benchmark result"sv;
+		}
+
+		return {};
+	}
+
+	auto read_baseline(std::string const& path)
+		-> tl::expected<std::vector<std::pair<std::string, double>>, baseline_error>
+	{
+		auto file = std::ifstream{path};
+		if (!file)
+		{
+			return tl::unexpected(baseline_error::io_error);
+		}
+
+		auto const text = std::string{std::istreambuf_iterator<char>{file},
+									  std::istreambuf_iterator<char>{}};
+
+		if (text.find(fmt::format("\"version\": {}", format_version)) == std::string::npos)
+		{
+			return tl::unexpected(baseline_error::invalid_file);
+		}
+
+		// The files are written by `to_json`: every benchmark is a flat object starting with its
+		// name, the median follows within the same object
+		auto baseline = std::vector<std::pair<std::string, double>>{};
+		for (auto offset = text.find("{\"name\": "); offset != std::string::npos;
+			 offset = text.find("{\"name\": ", offset))
+		{
+			offset += "{\"name\": "sv.size();
+
+			auto name = read_json_string(text, offset);
+			auto const end = text.find('}', offset);
+			auto const key = text.find("\"median\": ", offset);
+			if (!name || end == std::string::npos || key == std::string::npos || key > end)
+			{
+				return tl::unexpected(baseline_error::invalid_file);
+			}
+
+			auto const* const first = text.data() + key + "\"median\": "sv.size();
+			auto median = 0.0;
+			if (std::from_chars(first, text.data() + end, median).ec != std::errc{})
+			{
+				return tl::unexpected(baseline_error::invalid_file);
+			}
+
+			baseline.emplace_back(std::move(*name), median);
+		}
+
+		return baseline;
+	}
+
+	auto find_regressions(std::span<result const> results,
+						  std::span<std::pair<std::string, double> const> baseline,
+						  double threshold) -> std::vector<regression>
+	{
+		auto regressions = std::vector<regression>{};
+
+		for (auto const& entry : results)
+		{
+			auto const it = std::ranges::find(baseline, entry.name, [](auto const& reference) {
+				return reference.first;
+			});
+			if (it != std::end(baseline) && entry.median > it->second * (1.0 + threshold))
+			{
+				regressions.push_back(
+					{.name = entry.name, .baseline = it->second, .current = entry.median});
+			}
+		}
+
+		return regressions;
+	}
+
+	auto compare_to_raw(std::span<result const> results) -> std::vector<parity>
+	{
+		auto parities = std::vector<parity>{};
+
+		for (auto const& reference : results)
+		{
+			auto const group = std::string_view{reference.name}.substr(
+				0, reference.name.rfind('/') + 1);
+			if (group.empty() || reference.name.substr(group.size()) != "raw"sv
+				|| reference.median <= 0.0)
+			{
+				continue;
+			}
+
+			for (auto const& entry : results)
+			{
+				if (&entry != &reference && entry.name.starts_with(group)
+					&& entry.name.find('/', group.size()) == std::string::npos)
+				{
+					parities.push_back({.name = entry.name,
+										.reference = reference.name,
+										.ratio = entry.median / reference.median});
+				}
+			}
+		}
+
+		return parities;
+	}
+} // namespace bench
@@ -0,0 +1,195 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <tl/expected.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace bench
+{
+	/**
+	 * @brief The timings of one benchmark, in nanoseconds per operation
+	 */
+	struct result
+	{
+		std::string name;
+		std::uint64_t iterations = 0; //< Operations timed by every sample
+		std::size_t items_per_op = 1; //< Elements processed by one operation
+		double mean = 0.0;
+		double median = 0.0;
+		double min = 0.0;
+		double variance = 0.0;
+
+		/**
+		 * @brief Elements processed per second, from the median
+		 */
+		[[nodiscard]] auto get_throughput() const noexcept -> double;
+		/**
+		 * @brief Standard deviation relative to the mean
+		 */
+		[[nodiscard]] auto get_relative_deviation() const noexcept -> double;
+	};
+
+	struct settings
+	{
+		std::size_t sample_count = 15;
+		std::chrono::nanoseconds min_sample_time = std::chrono::milliseconds{20};
+		std::string filter = {}; //< Only the benchmarks whose name contains it are run
+	};
+
+	/**
+	 * @brief Keep the compiler from discarding the computation of `value`
+	 */
+	template<typename Type>
+	inline void do_not_optimize(Type const& value)
+	{
+		asm volatile("" : : "r,m"(value) : "memory"); // NOLINT
+	}
+
+	/**
+	 * @brief Runs benchmarks and collects their timings
+	 *
+	 * Every benchmark is first run until a batch of operations takes at least
+	 * `min_sample_time`, then timed over `sample_count` batches of that size. The median of the
+	 * samples is the figure compared against the baseline, it is the least sensitive to the
+	 * occasional preemption
+	 */
+	class suite
+	{
+	public:
+		explicit suite(settings config);
+
+		/**
+		 * @brief Time `operation`, which processes `items_per_op` elements per call
+		 */
+		template<typename Operation>
+		void run(std::string_view name, std::size_t items_per_op, Operation&& operation)
+		{
+			if (!is_selected(name))
+			{
+				return;
+			}
+
+			operation();
+
+			auto iterations = std::uint64_t{1};
+			while (time_batch(operation, iterations) < m_settings.min_sample_time
+				   && iterations < max_iterations)
+			{
+				iterations *= 2;
+			}
+
+			auto samples = std::vector<double>(m_settings.sample_count);
+			for (auto& sample : samples)
+			{
+				auto const elapsed = std::chrono::duration<double, std::nano>(
+					time_batch(operation, iterations));
+				sample = elapsed.count() / static_cast<double>(iterations);
+			}
+
+			add_result(name, iterations, items_per_op, std::move(samples));
+		}
+
+		[[nodiscard]] auto get_results() const noexcept -> std::span<result const>;
+
+	private:
+		static constexpr std::uint64_t max_iterations = std::uint64_t{1} << 30U;
+
+		template<typename Operation>
+		static auto time_batch(Operation& operation, std::uint64_t iterations)
+			-> std::chrono::nanoseconds
+		{
+			auto const start = std::chrono::steady_clock::now();
+			for (std::uint64_t i = 0; i < iterations; ++i)
+			{
+				operation();
+			}
+
+			return std::chrono::steady_clock::now() - start;
+		}
+
+		[[nodiscard]] auto is_selected(std::string_view name) const noexcept -> bool;
+		void add_result(std::string_view name, std::uint64_t iterations, std::size_t items_per_op,
+						std::vector<double> samples);
+
+	private:
+		settings m_settings;
+		std::vector<result> m_results;
+	};
+
+	/**
+	 * @brief The results as JSON, one object per benchmark
+	 */
+	auto to_json(std::span<result const> results, std::size_t thread_count) -> std::string;
+
+	enum struct baseline_error
+	{
+		io_error,    //< The file could not be read
+		invalid_file //< The file was not written by `to_json`
+	};
+
+	auto to_string(baseline_error error) -> std::string_view;
+
+	/**
+	 * @brief The median of every benchmark of a file written by `to_json`
+	 */
+	auto read_baseline(std::string const& path)
+		-> tl::expected<std::vector<std::pair<std::string, double>>, baseline_error>;
+
+	/**
+	 * @brief A benchmark whose median is slower than its baseline
+	 */
+	struct regression
+	{
+		std::string name;
+		double baseline = 0.0;
+		double current = 0.0;
+	};
+
+	/**
+	 * @brief The benchmarks that got slower than their baseline by more than `threshold`, a ratio.
+	 * Benchmarks missing from the baseline are new, they never regress
+	 */
+	auto find_regressions(std::span<result const> results,
+						  std::span<std::pair<std::string, double> const> baseline,
+						  double threshold) -> std::vector<regression>;
+
+	/**
+	 * @brief A benchmark timed against the version of the same group written with raw floats
+	 */
+	struct parity
+	{
+		std::string name;
+		std::string reference; //< The raw version, `<group>/raw`
+		double ratio = 0.0;    //< Median of the benchmark over the median of the reference
+	};
+
+	/**
+	 * @brief Every benchmark of a group that has a `raw` version, relative to it. The group of a
+	 * benchmark is its name up to the last `/`
+	 */
+	auto compare_to_raw(std::span<result const> results) -> std::vector<parity>;
+} // namespace bench
@@ -0,0 +1,90 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <libphyseng/concurrency/thread_pool.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+namespace physeng
+{
+	/**
+	 * @brief Split [0, count) into contiguous ranges of at least `grain` elements and call
+	 * `fn(begin, end)` on each of them from the workers of `pool`
+	 *
+	 * A few ranges are created per worker so that idle workers can steal from the busy ones. The
+	 * call returns once every range has been processed and rethrows the first exception thrown by
+	 * `fn`
+	 */
+	template<typename Fn>
+	void parallel_for(thread_pool& pool, std::size_t count, std::size_t grain, Fn&& fn)
+	{
+		static constexpr std::size_t chunks_per_worker = 4;
+
+		if (count == 0)
+		{
+			return;
+		}
+
+		auto const max_chunks = (count + grain - 1) / grain;
+		auto const chunk_count =
+			std::min<std::size_t>(max_chunks, chunks_per_worker * pool.get_worker_count());
+		auto const chunk_size = (count + chunk_count - 1) / chunk_count;
+
+		if (chunk_count == 1)
+		{
+			fn(std::size_t{0}, count);
+			return;
+		}
+
+		auto group = task_group{pool};
+
+		for (std::size_t chunk = 1; chunk < chunk_count; ++chunk)
+		{
+			auto const begin = chunk * chunk_size;
+			auto const end = std::min(count, begin + chunk_size);
+
+			if (begin < end)
+			{
+				group.run([&fn, begin, end] { fn(begin, end); });
+			}
+		}
+
+		fn(std::size_t{0}, std::min(count, chunk_size));
+		group.wait();
+	}
+
+	/**
+	 * @brief Run `parallel_for` on the default thread pool, or on the calling thread if there is
+	 * none
+	 */
+	template<typename Fn>
+	void parallel_for(std::size_t count, std::size_t grain, Fn&& fn)
+	{
+		if (auto* pool = get_default_thread_pool())
+		{
+			parallel_for(*pool, count, grain, std::forward<Fn>(fn));
+		}
+		else if (count != 0)
+		{
+			fn(std::size_t{0}, count);
+		}
+	}
+} // namespace physeng
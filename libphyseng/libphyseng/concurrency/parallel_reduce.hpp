@@ -0,0 +1,149 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+#include <libphyseng/concurrency/thread_pool.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace physeng
+{
+	/**
+	 * @brief The number of elements reduced serially by a single task of `parallel_reduce`
+	 */
+	inline constexpr std::size_t reduction_block_size = 4096;
+
+	namespace detail
+	{
+		/**
+		 * @brief Combine the partial results of the blocks pairwise, one level at a time:
+		 * `((p0 p1) (p2 p3)) ((p4 p5) p6)`. The shape of the tree only depends on the number of
+		 * blocks
+		 */
+		template<typename Type, typename Combine>
+		auto combine_tree(std::span<Type> partials, Combine& combine) -> Type
+		{
+			for (std::size_t stride = 1; stride < partials.size(); stride *= 2)
+			{
+				for (std::size_t i = 0; i + stride < partials.size(); i += 2 * stride)
+				{
+					partials[i] = combine(partials[i], partials[i + stride]);
+				}
+			}
+
+			return partials.front();
+		}
+
+		template<typename Type, typename ReduceBlock, typename Combine, typename ForBlocks>
+		auto block_reduce(std::size_t count, Type identity, ReduceBlock& reduce_block,
+						  Combine& combine, ForBlocks&& for_blocks,
+						  std::pmr::memory_resource* resource) -> Type
+		{
+			if (count == 0)
+			{
+				return identity;
+			}
+
+			auto const block_count = (count + reduction_block_size - 1) / reduction_block_size;
+			auto partials = std::pmr::vector<Type>(block_count, identity, resource);
+
+			for_blocks(block_count, [&](std::size_t first, std::size_t last) {
+				for (auto block = first; block < last; ++block)
+				{
+					auto const begin = block * reduction_block_size;
+					auto const end = std::min(count, begin + reduction_block_size);
+
+					partials[block] = reduce_block(begin, end);
+				}
+			});
+
+			return combine_tree(std::span{partials}, combine);
+		}
+	} // namespace detail
+
+	/**
+	 * @brief Reduce [0, count) in parallel with a result that does not depend on the number of
+	 * workers
+	 *
+	 * The range is split into blocks of `reduction_block_size` elements, each reduced serially by
+	 * `reduce_block(begin, end) -> Type`. The partial results are then merged by `combine` in a
+	 * fixed tree. Floating point sums are therefore bit identical from one run to the next, no
+	 * matter how many threads took part
+	 *
+	 * @param resource Where the partial results of the blocks are allocated. Solvers pass
+	 * `get_frame_resource()` when they reduce within a frame
+	 *
+	 * @return `identity` if the range is empty
+	 */
+	template<typename Type, typename ReduceBlock, typename Combine>
+	auto parallel_reduce(thread_pool& pool, std::size_t count, Type identity,
+						 ReduceBlock&& reduce_block, Combine&& combine,
+						 std::pmr::memory_resource* resource = std::pmr::new_delete_resource())
+		-> Type
+	{
+		return detail::block_reduce(
+			count, std::move(identity), reduce_block, combine,
+			[&](std::size_t block_count, auto&& fn) { parallel_for(pool, block_count, 1, fn); },
+			resource);
+	}
+
+	/**
+	 * @brief Run `parallel_reduce` on the default thread pool, or on the calling thread if there
+	 * is none. The result is the same either way
+	 */
+	template<typename Type, typename ReduceBlock, typename Combine>
+	auto parallel_reduce(std::size_t count, Type identity, ReduceBlock&& reduce_block,
+						 Combine&& combine,
+						 std::pmr::memory_resource* resource = std::pmr::new_delete_resource())
+		-> Type
+	{
+		return detail::block_reduce(
+			count, std::move(identity), reduce_block, combine,
+			[](std::size_t block_count, auto&& fn) { parallel_for(block_count, 1, fn); },
+			resource);
+	}
+
+	/**
+	 * @brief Reduce `transform(i)` for every `i` in [0, count) with `combine`, in the same fixed
+	 * order as `parallel_reduce`
+	 */
+	template<typename Type, typename Transform, typename Combine>
+	auto parallel_transform_reduce(
+		std::size_t count, Type identity, Transform&& transform, Combine&& combine,
+		std::pmr::memory_resource* resource = std::pmr::new_delete_resource()) -> Type
+	{
+		return parallel_reduce(
+			count, identity,
+			[&](std::size_t begin, std::size_t end) {
+				auto result = identity;
+				for (auto i = begin; i < end; ++i)
+				{
+					result = combine(result, transform(i));
+				}
+
+				return result;
+			},
+			combine, resource);
+	}
+} // namespace physeng
@@ -0,0 +1,88 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace physeng
+{
+	/**
+	 * @brief Replace every value of `values` by the sum of the values that precede it. The scan is
+	 * done in parallel over fixed size blocks
+	 *
+	 * @param resource Where the totals of the blocks are allocated. Solvers pass
+	 * `get_frame_resource()` when they scan within a frame
+	 *
+	 * @return The sum of every value of the range
+	 */
+	template<typename Type>
+	auto parallel_exclusive_scan(
+		std::span<Type> values,
+		std::pmr::memory_resource* resource = std::pmr::new_delete_resource()) -> Type
+	{
+		static constexpr std::size_t block_size = std::size_t{1} << 16U;
+
+		auto const block_count = (values.size() + block_size - 1) / block_size;
+		auto block_offsets = std::pmr::vector<Type>(block_count, Type{}, resource);
+
+		auto const block_of = [&](std::size_t block) {
+			auto const first = block * block_size;
+			return values.subspan(first, std::min(block_size, values.size() - first));
+		};
+
+		// Scan every block independently, remembering the total of each of them
+		parallel_for(block_count, 1, [&](std::size_t first, std::size_t last) {
+			for (auto block = first; block < last; ++block)
+			{
+				auto const chunk = block_of(block);
+				auto const back = chunk.back();
+
+				std::exclusive_scan(std::begin(chunk), std::end(chunk), std::begin(chunk), Type{});
+				block_offsets[block] = chunk.back() + back;
+			}
+		});
+
+		if (block_count == 0)
+		{
+			return Type{};
+		}
+
+		auto const last_block_total = block_offsets.back();
+		std::exclusive_scan(std::begin(block_offsets), std::end(block_offsets),
+							std::begin(block_offsets), Type{});
+
+		// Offset every block by the total of the blocks preceding it
+		parallel_for(block_count, 1, [&](std::size_t first, std::size_t last) {
+			for (auto block = std::max<std::size_t>(first, 1); block < last; ++block)
+			{
+				for (auto& value : block_of(block))
+				{
+					value += block_offsets[block];
+				}
+			}
+		});
+
+		return block_offsets.back() + last_block_total;
+	}
+} // namespace physeng
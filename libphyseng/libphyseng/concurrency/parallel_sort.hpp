@@ -0,0 +1,75 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <span>
+
+namespace physeng
+{
+	/**
+	 * @brief Sort a range in parallel. The range is split into runs that are sorted independently
+	 * before being merged pairwise, one level at a time
+	 *
+	 * The number of runs depends on the size of the range and on the number of workers of the
+	 * default pool. When `compare` defines a total order the sorted range is unique, and the
+	 * result is the same as the one of `std::sort` for any number of workers. The relative order
+	 * of equivalent elements may change with the number of workers
+	 */
+	template<typename Type, typename Compare = std::less<>>
+	void parallel_sort(std::span<Type> values, Compare compare = {})
+	{
+		static constexpr std::size_t grain = std::size_t{1} << 15U;
+
+		auto const max_runs = std::max<std::size_t>(1, values.size() / grain);
+		auto const* pool = get_default_thread_pool();
+		auto const max_threads = pool == nullptr ? std::size_t{1} : pool->get_worker_count();
+		auto const run_count = std::bit_floor(std::min(max_runs, 2 * max_threads));
+		auto const run_size = (values.size() + run_count - 1) / run_count;
+
+		auto const at = [&](std::size_t offset) {
+			auto const clamped = std::min(offset, values.size());
+			return std::begin(values) + static_cast<std::ptrdiff_t>(clamped);
+		};
+
+		parallel_for(run_count, 1, [&](std::size_t first, std::size_t last) {
+			for (auto run = first; run < last; ++run)
+			{
+				std::sort(at(run * run_size), at((run + 1) * run_size), compare);
+			}
+		});
+
+		for (auto width = run_size; width < values.size(); width *= 2)
+		{
+			auto const merge_count = (values.size() + 2 * width - 1) / (2 * width);
+
+			parallel_for(merge_count, 1, [&](std::size_t first, std::size_t last) {
+				for (auto merge = first; merge < last; ++merge)
+				{
+					auto const begin = merge * 2 * width;
+					std::inplace_merge(at(begin), at(begin + width), at(begin + 2 * width),
+									   compare);
+				}
+			});
+		}
+	}
+} // namespace physeng
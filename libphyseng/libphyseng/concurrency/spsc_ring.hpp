@@ -0,0 +1,133 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/util/aligned_allocator.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace physeng
+{
+	/**
+	 * @brief A bounded lock-free queue between exactly one producer thread and one consumer
+	 * thread
+	 *
+	 * Each side owns one index and keeps a cached copy of the other one. The shared index is only
+	 * read again when the cached copy says the ring is full, or empty, so in the steady state the
+	 * two threads do not touch each other's cache lines
+	 */
+	template<typename Type>
+	class spsc_ring
+	{
+		static_assert(std::is_default_constructible_v<Type> && std::is_move_assignable_v<Type>,
+					  "the slots of the ring are default constructed and moved into");
+
+	public:
+		/**
+		 * @brief Create a ring holding up to `capacity` items, rounded up to a power of two
+		 */
+		explicit spsc_ring(std::size_t capacity) :
+			m_slots(std::bit_ceil(std::max<std::size_t>(capacity, 1))), m_mask(m_slots.size() - 1)
+		{}
+
+		spsc_ring(spsc_ring const&) = delete;
+		spsc_ring(spsc_ring&&) = delete;
+		~spsc_ring() = default;
+
+		auto operator=(spsc_ring const&) -> spsc_ring& = delete;
+		auto operator=(spsc_ring&&) -> spsc_ring& = delete;
+
+		[[nodiscard]] auto capacity() const noexcept -> std::size_t
+		{
+			return m_slots.size();
+		}
+
+		/**
+		 * @brief The number of queued items. Exact when called from either side while the other
+		 * one is idle, a snapshot otherwise
+		 */
+		[[nodiscard]] auto size() const noexcept -> std::size_t
+		{
+			// The head never passes the tail, reading it first keeps the difference positive
+			auto const head = m_head.load(std::memory_order_acquire);
+			return m_tail.load(std::memory_order_acquire) - head;
+		}
+
+		/**
+		 * @brief Queue `value` if the ring is not full. Producer side only
+		 *
+		 * @return Whether `value` was moved into the ring
+		 */
+		auto try_push(Type&& value) -> bool
+		{
+			auto const tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_cached_head == capacity())
+			{
+				m_cached_head = m_head.load(std::memory_order_acquire);
+				if (tail - m_cached_head == capacity())
+				{
+					return false;
+				}
+			}
+
+			m_slots[tail & m_mask] = std::move(value);
+			m_tail.store(tail + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		/**
+		 * @brief Take the oldest item of the ring, if any. Consumer side only
+		 */
+		auto try_pop() -> std::optional<Type>
+		{
+			auto const head = m_head.load(std::memory_order_relaxed);
+			if (head == m_cached_tail)
+			{
+				m_cached_tail = m_tail.load(std::memory_order_acquire);
+				if (head == m_cached_tail)
+				{
+					return std::nullopt;
+				}
+			}
+
+			auto value = std::optional<Type>{std::move(m_slots[head & m_mask])};
+			m_head.store(head + 1, std::memory_order_release);
+
+			return value;
+		}
+
+	private:
+		std::vector<Type> m_slots;
+		std::size_t m_mask;
+
+		// Written by the consumer
+		alignas(cache_line_size) std::atomic<std::size_t> m_head = 0;
+		std::size_t m_cached_tail = 0;
+
+		// Written by the producer
+		alignas(cache_line_size) std::atomic<std::size_t> m_tail = 0;
+		std::size_t m_cached_head = 0;
+	};
+} // namespace physeng
@@ -0,0 +1,417 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <libphyseng/concurrency/thread_pool.hpp>
+#include <libphyseng/profiling/profiler.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <string_view>
+
+#if defined(__linux__)
+#	include <pthread.h>
+#	include <sched.h>
+#endif
+
+namespace
+{
+	struct worker_context
+	{
+		physeng::thread_pool const* pool = nullptr;
+		std::size_t index = 0;
+	};
+
+	// Set on the threads spawned by a pool so that `submit` can find their deque
+	constinit thread_local worker_context t_context = {};
+	// Victim selection of the threads helping a pool they are not part of
+	constinit thread_local std::uint64_t t_random_state = 0x9E3779B97F4A7C15ULL;
+
+	constinit std::atomic<physeng::thread_pool*> g_default_pool = nullptr;
+
+	auto next_random(std::uint64_t& state) noexcept -> std::uint64_t
+	{
+		// xorshift64
+		state ^= state << 13U;
+		state ^= state >> 7U;
+		state ^= state << 17U;
+
+		return state;
+	}
+
+	/**
+	 * @brief The cores the process is allowed to run on
+	 */
+	auto get_available_cores() -> std::vector<int>
+	{
+		auto cores = std::vector<int>{};
+
+#if defined(__linux__)
+		auto set = cpu_set_t{};
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) == 0)
+		{
+			for (int core = 0; core < CPU_SETSIZE; ++core)
+			{
+				if (CPU_ISSET(core, &set))
+				{
+					cores.push_back(core);
+				}
+			}
+		}
+#endif
+
+		if (cores.empty())
+		{
+			auto const count = std::max(1U, std::thread::hardware_concurrency());
+			for (unsigned core = 0; core < count; ++core)
+			{
+				cores.push_back(static_cast<int>(core));
+			}
+		}
+
+		return cores;
+	}
+
+	void pin_current_thread(int core)
+	{
+#if defined(__linux__)
+		auto set = cpu_set_t{};
+		CPU_ZERO(&set);
+		CPU_SET(core, &set);
+		if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+		{
+			fmt::print(stderr, "physeng: failed to pin a worker thread to core {}\n", core);
+		}
+#else
+		static_cast<void>(core);
+#endif
+	}
+
+	void execute(physeng::task* work)
+	{
+		auto const owned = std::unique_ptr<physeng::task>{work};
+		owned->execute();
+	}
+} // namespace
+
+namespace physeng
+{
+	thread_pool::thread_pool(options const& config)
+	{
+		auto const cores = get_available_cores();
+		auto const worker_count = config.worker_count == 0 ? cores.size() : config.worker_count;
+
+		m_workers.reserve(worker_count - 1);
+		for (std::size_t index = 0; index + 1 < worker_count; ++index)
+		{
+			m_workers.push_back(std::make_unique<worker>());
+			m_workers.back()->random_state = 0x9E3779B97F4A7C15ULL * (index + 1); // NOLINT
+		}
+
+		if (config.pin_workers)
+		{
+			pin_current_thread(cores.front());
+		}
+
+		m_threads.reserve(m_workers.size());
+		for (std::size_t index = 0; index < m_workers.size(); ++index)
+		{
+			auto const core = config.pin_workers ? cores[(index + 1) % cores.size()] : -1;
+			m_threads.emplace_back([this, index, core](std::stop_token const& stop) {
+				if (core >= 0)
+				{
+					pin_current_thread(core);
+				}
+
+				run_worker(index, stop);
+			});
+		}
+	}
+
+	thread_pool::~thread_pool()
+	{
+		for (auto& thread : m_threads)
+		{
+			thread.request_stop();
+		}
+
+		m_work_epoch.fetch_add(1);
+		m_work_epoch.notify_all();
+		m_threads.clear();
+
+		// Tasks nobody waited on
+		for (auto* work : m_injection_queue)
+		{
+			delete work; // NOLINT
+		}
+		for (auto& state : m_workers)
+		{
+			while (auto* work = state->deque.pop())
+			{
+				delete work; // NOLINT
+			}
+		}
+	}
+
+	auto thread_pool::options_from_environment() -> options
+	{
+		auto config = options{};
+
+		auto const read = [](char const* name) -> std::string_view {
+			auto const* value = std::getenv(name); // NOLINT
+			return value == nullptr ? std::string_view{} : std::string_view{value};
+		};
+
+		if (auto const count = read("PHYSENG_NUM_THREADS"); !count.empty())
+		{
+			auto value = std::size_t{0};
+			auto const [ptr, error] =
+				std::from_chars(count.data(), count.data() + count.size(), value);
+
+			if (error == std::errc{} && ptr == count.data() + count.size())
+			{
+				config.worker_count = value;
+			}
+			else
+			{
+				fmt::print(stderr, "physeng: ignoring invalid PHYSENG_NUM_THREADS '{}'\n", count);
+			}
+		}
+
+		config.pin_workers = read("PHYSENG_PIN_THREADS") == "1";
+
+		return config;
+	}
+
+	auto thread_pool::get_worker_count() const noexcept -> std::size_t
+	{
+		return m_workers.size() + 1;
+	}
+
+	void thread_pool::submit(std::unique_ptr<task> work)
+	{
+		if (t_context.pool == this)
+		{
+			m_workers[t_context.index]->deque.push(work.release());
+		}
+		else
+		{
+			auto const lock = std::scoped_lock{m_injection_mutex};
+			m_injection_queue.push_back(work.release());
+			m_injected_count.fetch_add(1, std::memory_order_release);
+		}
+
+		wake_one();
+	}
+
+	auto thread_pool::try_run_one() -> bool
+	{
+		task* work = nullptr;
+
+		if (t_context.pool == this)
+		{
+			work = find_task(t_context.index);
+		}
+		else
+		{
+			work = take_injected();
+			if (work == nullptr && !m_workers.empty())
+			{
+				work = steal_from_workers(next_random(t_random_state) % m_workers.size(),
+										  m_workers.size());
+			}
+		}
+
+		if (work == nullptr)
+		{
+			return false;
+		}
+
+		execute(work);
+
+		return true;
+	}
+
+	void thread_pool::notify_completion() noexcept
+	{
+		m_completion_epoch.fetch_add(1);
+		if (m_blocked_count.load() > 0)
+		{
+			m_completion_epoch.notify_all();
+		}
+	}
+
+	void thread_pool::run_worker(std::size_t index, std::stop_token const& stop)
+	{
+		static constexpr int spin_count = 64;
+
+		t_context = {.pool = this, .index = index};
+
+		if (auto* const profiler = get_default_profiler())
+		{
+			profiler->set_thread_name(fmt::format("worker {}", index + 1));
+		}
+
+		while (!stop.stop_requested())
+		{
+			auto* work = find_task(index);
+			for (int spin = 0; work == nullptr && spin < spin_count; ++spin)
+			{
+				std::this_thread::yield();
+				work = find_task(index);
+			}
+
+			if (work != nullptr)
+			{
+				execute(work);
+				continue;
+			}
+
+			// Any submission made after this load bumps the epoch and cancels the wait
+			auto const epoch = m_work_epoch.load();
+			if (work = find_task(index); work != nullptr)
+			{
+				execute(work);
+				continue;
+			}
+
+			m_sleeping_count.fetch_add(1);
+			if (!stop.stop_requested())
+			{
+				m_work_epoch.wait(epoch);
+			}
+			m_sleeping_count.fetch_sub(1);
+		}
+
+		t_context = {};
+	}
+
+	auto thread_pool::find_task(std::size_t index) -> task*
+	{
+		auto& self = *m_workers[index];
+
+		if (auto* work = self.deque.pop())
+		{
+			return work;
+		}
+		if (auto* work = take_injected())
+		{
+			return work;
+		}
+
+		return steal_from_workers(next_random(self.random_state) % m_workers.size(), index);
+	}
+
+	auto thread_pool::steal_from_workers(std::size_t first_victim, std::size_t thief) -> task*
+	{
+		for (std::size_t offset = 0; offset < m_workers.size(); ++offset)
+		{
+			auto const victim = (first_victim + offset) % m_workers.size();
+			if (victim == thief)
+			{
+				continue;
+			}
+
+			if (auto* work = m_workers[victim]->deque.steal())
+			{
+				return work;
+			}
+		}
+
+		return nullptr;
+	}
+
+	auto thread_pool::take_injected() -> task*
+	{
+		if (m_injected_count.load(std::memory_order_acquire) == 0)
+		{
+			return nullptr;
+		}
+
+		auto const lock = std::scoped_lock{m_injection_mutex};
+		if (m_injection_queue.empty())
+		{
+			return nullptr;
+		}
+
+		auto* work = m_injection_queue.front();
+		m_injection_queue.pop_front();
+		m_injected_count.fetch_sub(1, std::memory_order_relaxed);
+
+		return work;
+	}
+
+	void thread_pool::wake_one() noexcept
+	{
+		m_work_epoch.fetch_add(1);
+		if (m_sleeping_count.load() > 0)
+		{
+			m_work_epoch.notify_one();
+		}
+	}
+
+	auto get_default_thread_pool() noexcept -> thread_pool*
+	{
+		return g_default_pool.load(std::memory_order_acquire);
+	}
+
+	void set_default_thread_pool(thread_pool* pool) noexcept
+	{
+		g_default_pool.store(pool, std::memory_order_release);
+	}
+
+	task_group::task_group(thread_pool& pool) noexcept : m_pool(&pool) {}
+
+	task_group::~task_group()
+	{
+		m_pool->help_until([this] { return m_pending.load(std::memory_order_acquire) == 0; });
+	}
+
+	void task_group::wait()
+	{
+		m_pool->help_until([this] { return m_pending.load(std::memory_order_acquire) == 0; });
+
+		auto const lock = std::scoped_lock{m_error_mutex};
+		if (auto error = std::exchange(m_error, nullptr))
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+	void task_group::complete() noexcept
+	{
+		// The group may be destroyed as soon as the count reaches zero, so the pool has to be
+		// fetched beforehand
+		auto* pool = m_pool;
+		if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			pool->notify_completion();
+		}
+	}
+
+	void task_group::store_exception(std::exception_ptr error) noexcept
+	{
+		auto const lock = std::scoped_lock{m_error_mutex};
+		if (!m_error)
+		{
+			m_error = std::move(error);
+		}
+	}
+} // namespace physeng
@@ -0,0 +1,253 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <libphyseng/concurrency/work_stealing_deque.hpp>
+#include <libphyseng/export.hpp>
+#include <libphyseng/util/aligned_allocator.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace physeng
+{
+	/**
+	 * @brief A unit of work scheduled on a thread pool. Tasks are owned by the pool once submitted
+	 * and destroyed right after they are executed
+	 */
+	class task
+	{
+	public:
+		task() = default;
+		task(task const&) = delete;
+		task(task&&) = delete;
+		virtual ~task() = default;
+
+		auto operator=(task const&) -> task& = delete;
+		auto operator=(task&&) -> task& = delete;
+
+		virtual void execute() = 0;
+	};
+
+	/**
+	 * @brief A work stealing thread pool. Every worker owns a Chase-Lev deque: tasks submitted from
+	 * a worker go to the bottom of its own deque, idle workers steal from the top of the others.
+	 * Tasks submitted from a thread outside of the pool go through a shared injection queue
+	 *
+	 * The thread creating the pool counts as one of its workers: it runs tasks whenever it waits
+	 * on a `task_group`, so a pool of `n` workers only spawns `n - 1` threads. Any other thread
+	 * waiting on a group helps the same way
+	 */
+	class LIBPHYSENG_SYMEXPORT thread_pool
+	{
+	public:
+		struct options
+		{
+			std::size_t worker_count = 0; //< 0 selects one worker per available core
+			bool pin_workers = false;     //< Bind every worker, creating thread included, to a core
+		};
+
+	public:
+		explicit thread_pool(options const& config);
+		thread_pool(thread_pool const&) = delete;
+		thread_pool(thread_pool&&) = delete;
+		~thread_pool();
+
+		auto operator=(thread_pool const&) -> thread_pool& = delete;
+		auto operator=(thread_pool&&) -> thread_pool& = delete;
+
+		/**
+		 * @brief Read the options of the pool from the environment. `PHYSENG_NUM_THREADS` sets the
+		 * number of workers and `PHYSENG_PIN_THREADS=1` enables core pinning
+		 */
+		[[nodiscard]] static auto options_from_environment() -> options;
+
+		[[nodiscard]] auto get_worker_count() const noexcept -> std::size_t;
+
+		/**
+		 * @brief Schedule a task, the pool takes ownership of it
+		 */
+		void submit(std::unique_ptr<task> work);
+
+		/**
+		 * @brief Run one pending task on the calling thread, if any can be found
+		 *
+		 * @return Whether a task was run
+		 */
+		auto try_run_one() -> bool;
+
+		/**
+		 * @brief Block the calling thread until `is_done()` holds, running pending tasks meanwhile.
+		 * Whatever makes `is_done` true has to call `notify_completion` afterwards
+		 */
+		template<typename Predicate>
+		void help_until(Predicate&& is_done)
+		{
+			static constexpr int spin_count = 64;
+
+			auto failed_attempts = 0;
+			while (!is_done())
+			{
+				if (try_run_one())
+				{
+					failed_attempts = 0;
+					continue;
+				}
+
+				if (++failed_attempts < spin_count)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				// Nothing left to steal: what we wait on is running on other workers
+				auto const epoch = m_completion_epoch.load();
+				m_blocked_count.fetch_add(1);
+				if (!is_done())
+				{
+					m_completion_epoch.wait(epoch);
+				}
+				m_blocked_count.fetch_sub(1);
+				failed_attempts = 0;
+			}
+		}
+
+		/**
+		 * @brief Wake up the threads blocked in `help_until`
+		 */
+		void notify_completion() noexcept;
+
+	private:
+		struct alignas(cache_line_size) worker
+		{
+			work_stealing_deque<task> deque;
+			std::uint64_t random_state;
+		};
+
+		void run_worker(std::size_t index, std::stop_token const& stop);
+		auto find_task(std::size_t index) -> task*;
+		auto steal_from_workers(std::size_t first_victim, std::size_t thief) -> task*;
+		auto take_injected() -> task*;
+		void wake_one() noexcept;
+
+	private:
+		std::vector<std::unique_ptr<worker>> m_workers;
+		std::vector<std::jthread> m_threads;
+
+		std::mutex m_injection_mutex;
+		std::deque<task*> m_injection_queue;
+		std::atomic<std::size_t> m_injected_count = 0;
+
+		// Idle workers sleep on the epoch, which is bumped every time work is submitted
+		alignas(cache_line_size) std::atomic<std::uint64_t> m_work_epoch = 0;
+		std::atomic<std::size_t> m_sleeping_count = 0;
+		// Threads waiting on a task group sleep on the completion epoch
+		alignas(cache_line_size) std::atomic<std::uint64_t> m_completion_epoch = 0;
+		std::atomic<std::size_t> m_blocked_count = 0;
+	};
+
+	/**
+	 * @brief The pool used by the parallel algorithms of the library. It is created by `main`
+	 * before `physeng_main` is called. Returns a null pointer if no pool is installed, in which
+	 * case the algorithms run on the calling thread
+	 */
+	LIBPHYSENG_SYMEXPORT auto get_default_thread_pool() noexcept -> thread_pool*;
+	LIBPHYSENG_SYMEXPORT void set_default_thread_pool(thread_pool* pool) noexcept;
+
+	/**
+	 * @brief A set of tasks that can be waited on together. Tasks may add more tasks to the group
+	 * they belong to, `wait` returns once all of them have run
+	 */
+	class LIBPHYSENG_SYMEXPORT task_group
+	{
+	public:
+		explicit task_group(thread_pool& pool) noexcept;
+		task_group(task_group const&) = delete;
+		task_group(task_group&&) = delete;
+		/**
+		 * @brief Waits for the pending tasks, any exception they threw is dropped
+		 */
+		~task_group();
+
+		auto operator=(task_group const&) -> task_group& = delete;
+		auto operator=(task_group&&) -> task_group& = delete;
+
+		template<typename Fn>
+		void run(Fn&& fn)
+		{
+			m_pending.fetch_add(1, std::memory_order_relaxed);
+			m_pool->submit(std::make_unique<function_task<std::decay_t<Fn>>>(
+				*this, std::forward<Fn>(fn)));
+		}
+
+		/**
+		 * @brief Run tasks on the calling thread until every task of the group is done
+		 *
+		 * @throw The first exception thrown by one of the tasks
+		 */
+		void wait();
+
+	private:
+		template<typename Fn>
+		class function_task final : public task
+		{
+		public:
+			template<typename Arg>
+			function_task(task_group& group, Arg&& fn) :
+				m_group(&group), m_fn(std::forward<Arg>(fn))
+			{}
+
+			void execute() override
+			{
+				try
+				{
+					m_fn();
+				}
+				catch (...)
+				{
+					m_group->store_exception(std::current_exception());
+				}
+
+				m_group->complete();
+			}
+
+		private:
+			task_group* m_group;
+			Fn m_fn;
+		};
+
+		void complete() noexcept;
+		void store_exception(std::exception_ptr error) noexcept;
+
+	private:
+		thread_pool* m_pool;
+		std::atomic<std::size_t> m_pending = 0;
+
+		std::mutex m_error_mutex;
+		std::exception_ptr m_error;
+	};
+} // namespace physeng
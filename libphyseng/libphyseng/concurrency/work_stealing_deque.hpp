@@ -0,0 +1,206 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <libphyseng/util/aligned_allocator.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace physeng
+{
+	/**
+	 * @brief A Chase-Lev work stealing deque of pointers. The thread owning the deque pushes and
+	 * pops at the bottom while any other thread may steal from the top
+	 *
+	 * The memory orderings follow "Correct and Efficient Work-Stealing for Weak Memory Models"
+	 * (Lê et al., 2013). The storage grows when full; the previous buffers are kept alive until
+	 * the deque is destroyed since a thief may still be reading from them
+	 */
+	template<typename Type>
+	class work_stealing_deque
+	{
+		class buffer
+		{
+		public:
+			explicit buffer(std::int64_t capacity) :
+				m_mask(capacity - 1), m_slots(static_cast<std::size_t>(capacity))
+			{
+				assert((capacity & (capacity - 1)) == 0); // NOLINT
+			}
+
+			[[nodiscard]] auto capacity() const noexcept -> std::int64_t
+			{
+				return m_mask + 1;
+			}
+
+			[[nodiscard]] auto load(std::int64_t index) const noexcept -> Type*
+			{
+				return m_slots[static_cast<std::size_t>(index & m_mask)].load(
+					std::memory_order_relaxed);
+			}
+
+			void store(std::int64_t index, Type* value) noexcept
+			{
+				m_slots[static_cast<std::size_t>(index & m_mask)].store(value,
+																		std::memory_order_relaxed);
+			}
+
+		private:
+			std::int64_t m_mask;
+			std::vector<std::atomic<Type*>> m_slots;
+		};
+
+	public:
+		explicit work_stealing_deque(std::int64_t capacity = 256) // NOLINT
+		{
+			m_buffers.push_back(std::make_unique<buffer>(capacity));
+			m_buffer.store(m_buffers.back().get(), std::memory_order_relaxed);
+		}
+
+		work_stealing_deque(work_stealing_deque const&) = delete;
+		work_stealing_deque(work_stealing_deque&&) = delete;
+		~work_stealing_deque() = default;
+
+		auto operator=(work_stealing_deque const&) -> work_stealing_deque& = delete;
+		auto operator=(work_stealing_deque&&) -> work_stealing_deque& = delete;
+
+		/**
+		 * @brief An estimate of the number of items in the deque
+		 */
+		[[nodiscard]] auto size() const noexcept -> std::size_t
+		{
+			auto const bottom = m_bottom.load(std::memory_order_relaxed);
+			auto const top = m_top.load(std::memory_order_relaxed);
+
+			return bottom > top ? static_cast<std::size_t>(bottom - top) : 0;
+		}
+		[[nodiscard]] auto empty() const noexcept -> bool
+		{
+			return size() == 0;
+		}
+
+		/**
+		 * @brief Add an item at the bottom of the deque. May only be called by the owner
+		 */
+		void push(Type* item)
+		{
+			auto const bottom = m_bottom.load(std::memory_order_relaxed);
+			auto const top = m_top.load(std::memory_order_acquire);
+			auto* storage = m_buffer.load(std::memory_order_relaxed);
+
+			if (bottom - top > storage->capacity() - 1)
+			{
+				storage = grow(storage, top, bottom);
+			}
+
+			storage->store(bottom, item);
+			std::atomic_thread_fence(std::memory_order_release);
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief Take the most recently pushed item. May only be called by the owner
+		 *
+		 * @return The item, or a null pointer if the deque is empty
+		 */
+		auto pop() noexcept -> Type*
+		{
+			auto const bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+			auto* storage = m_buffer.load(std::memory_order_relaxed);
+			m_bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			auto top = m_top.load(std::memory_order_relaxed);
+
+			if (top > bottom)
+			{
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			auto* item = storage->load(bottom);
+			if (top == bottom)
+			{
+				// Last item, race against the thieves for it
+				if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+												   std::memory_order_relaxed))
+				{
+					item = nullptr;
+				}
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+
+			return item;
+		}
+
+		/**
+		 * @brief Take the oldest item of the deque. May be called from any thread
+		 *
+		 * @return The item, or a null pointer if the deque is empty or another thread won the race
+		 * for the item
+		 */
+		auto steal() noexcept -> Type*
+		{
+			auto top = m_top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			auto const bottom = m_bottom.load(std::memory_order_acquire);
+
+			if (top >= bottom)
+			{
+				return nullptr;
+			}
+
+			auto* item = m_buffer.load(std::memory_order_acquire)->load(top);
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+											   std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+
+			return item;
+		}
+
+	private:
+		auto grow(buffer* current, std::int64_t top, std::int64_t bottom) -> buffer*
+		{
+			auto next = std::make_unique<buffer>(2 * current->capacity());
+			for (auto i = top; i < bottom; ++i)
+			{
+				next->store(i, current->load(i));
+			}
+
+			m_buffers.push_back(std::move(next));
+			m_buffer.store(m_buffers.back().get(), std::memory_order_release);
+
+			return m_buffers.back().get();
+		}
+
+	private:
+		// The indices are on their own cache line to avoid false sharing between the owner and
+		// the thieves
+		alignas(cache_line_size) std::atomic<std::int64_t> m_top = 0;
+		alignas(cache_line_size) std::atomic<std::int64_t> m_bottom = 0;
+		alignas(cache_line_size) std::atomic<buffer*> m_buffer = nullptr;
+
+		std::vector<std::unique_ptr<buffer>> m_buffers;
+	};
+} // namespace physeng
@@ -0,0 +1,515 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <libphyseng/io/checkpoint.hpp>
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+#include <libphyseng/physeng-info.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+	using namespace std::literals;
+
+	// Part of the file format, independent of the page size of the machine
+	constexpr std::size_t page_size = 4096;
+	constexpr std::size_t stored_column_count = 9;
+	constexpr std::size_t restore_grain = std::size_t{1} << 16U;
+
+	constexpr std::array<char, 8> magic = {'P', 'H', 'Y', 'S', 'C', 'K', 'P', 'T'};
+	// Reads back swapped on a machine of the other endianness
+	constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+	constexpr auto column_names = std::array<std::string_view, stored_column_count>{
+		"position_x"sv, "position_y"sv, "position_z"sv, "velocity_x"sv, "velocity_y"sv,
+		"velocity_z"sv, "density"sv,	"pressure"sv,	"mass"sv};
+
+	struct column_entry
+	{
+		std::array<char, 16> name;
+		std::uint64_t offset; //< From the start of the file, in bytes
+		std::uint64_t size;   //< In bytes
+	};
+
+	struct file_header
+	{
+		std::array<char, 8> magic;
+		std::uint32_t format_version;
+		std::uint32_t byte_order;
+		physeng::semantic_version engine_version;
+		physeng::semantic_version application_version;
+		std::uint32_t column_count;
+		std::uint32_t reserved;
+		std::uint64_t particle_count;
+		std::uint64_t step;
+		double time;
+		std::array<column_entry, stored_column_count> columns;
+	};
+
+	// The header is read and written as raw bytes, its layout must not depend on the compiler
+	static_assert(std::is_trivially_copyable_v<file_header>);
+	static_assert(sizeof(column_entry) == 32);
+	static_assert(sizeof(file_header) == 72 + stored_column_count * sizeof(column_entry));
+	static_assert(sizeof(file_header) <= page_size);
+	static_assert(std::endian::native == std::endian::little, "checkpoints are little endian");
+
+	constexpr auto round_up(std::size_t value, std::size_t alignment) noexcept -> std::size_t
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	using velocity_columns =
+		std::array<physeng::aligned_vector<float>, physeng::particle_set::dimension>;
+
+	/**
+	 * @brief The columns of `particles` in the order they are stored. The file always holds
+	 * floats, velocities stored with a narrower type are first widened into `widened`
+	 */
+	template<physeng::precision_policy Precision>
+	auto get_columns(physeng::basic_particle_set<Precision> const& particles,
+					 velocity_columns& widened)
+		-> std::array<std::span<float const>, stored_column_count>
+	{
+		auto velocity = std::array<std::span<float const>, physeng::particle_set::dimension>{};
+		for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+		{
+			if constexpr (std::is_same_v<typename Precision::velocity_type, float>)
+			{
+				velocity[axis] = particles.velocity(axis);
+			}
+			else
+			{
+				auto const column = particles.velocity(axis);
+				widened[axis].assign(std::begin(column), std::end(column));
+				velocity[axis] = widened[axis];
+			}
+		}
+
+		return {particles.position(0), particles.position(1), particles.position(2),
+				velocity[0],           velocity[1],           velocity[2],
+				particles.density(),   particles.pressure(),  particles.mass()};
+	}
+
+	/**
+	 * @brief Closes a POSIX file descriptor when going out of scope
+	 */
+	class file_descriptor
+	{
+	public:
+		explicit file_descriptor(int fd) noexcept : m_fd(fd) {}
+		file_descriptor(file_descriptor const&) = delete;
+		file_descriptor(file_descriptor&&) = delete;
+		~file_descriptor()
+		{
+			if (m_fd >= 0)
+			{
+				::close(m_fd);
+			}
+		}
+
+		auto operator=(file_descriptor const&) -> file_descriptor& = delete;
+		auto operator=(file_descriptor&&) -> file_descriptor& = delete;
+
+		[[nodiscard]] auto get() const noexcept -> int
+		{
+			return m_fd;
+		}
+		[[nodiscard]] auto is_valid() const noexcept -> bool
+		{
+			return m_fd >= 0;
+		}
+
+	private:
+		int m_fd;
+	};
+
+	/**
+	 * @brief Write all of `bytes` at `offset`, a single call to `pwrite` may write less
+	 */
+	auto write_at(int fd, std::span<std::byte const> bytes, std::size_t offset) -> bool
+	{
+		while (!bytes.empty())
+		{
+			auto const written = ::pwrite(fd, bytes.data(), bytes.size(),
+										  static_cast<off_t>(offset));
+			if (written < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+
+				return false;
+			}
+
+			bytes = bytes.subspan(static_cast<std::size_t>(written));
+			offset += static_cast<std::size_t>(written);
+		}
+
+		return true;
+	}
+
+	auto write_file(std::filesystem::path const& path, file_header const& header,
+					std::span<std::span<float const> const> columns) -> bool
+	{
+		auto const file =
+			file_descriptor{::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+		if (!file.is_valid())
+		{
+			return false;
+		}
+
+		// Only the data is written, the padding between the columns is left as holes
+		for (std::size_t i = 0; i < columns.size(); ++i)
+		{
+			if (!write_at(file.get(), std::as_bytes(columns[i]), header.columns[i].offset))
+			{
+				return false;
+			}
+		}
+
+		auto const& last = header.columns.back();
+		auto const file_size = round_up(last.offset + last.size, page_size);
+
+		// The header goes last: a file cut short by a crash never looks complete
+		return ::ftruncate(file.get(), static_cast<off_t>(file_size)) == 0
+			&& write_at(file.get(), std::as_bytes(std::span{&header, 1}), 0)
+			&& ::fsync(file.get()) == 0;
+	}
+
+	auto validate(file_header const& header, std::size_t file_size,
+				  physeng::semantic_version application_version)
+		-> tl::expected<void, physeng::checkpoint_error>
+	{
+		using physeng::checkpoint_error;
+
+		if (header.magic != magic)
+		{
+			return tl::unexpected(checkpoint_error::not_a_checkpoint);
+		}
+
+		if (header.byte_order != byte_order_mark
+			|| header.format_version != physeng::checkpoint_format_version)
+		{
+			return tl::unexpected(checkpoint_error::unsupported_format);
+		}
+
+		if (!physeng::is_compatible(header.engine_version, physeng::get_engine_version()))
+		{
+			return tl::unexpected(checkpoint_error::incompatible_engine);
+		}
+
+		if (!physeng::is_compatible(header.application_version, application_version))
+		{
+			return tl::unexpected(checkpoint_error::incompatible_application);
+		}
+
+		if (header.column_count != stored_column_count)
+		{
+			return tl::unexpected(checkpoint_error::corrupted);
+		}
+
+		if (header.particle_count > file_size / sizeof(float))
+		{
+			return tl::unexpected(checkpoint_error::corrupted);
+		}
+
+		auto const column_size = header.particle_count * sizeof(float);
+		for (std::size_t i = 0; i < stored_column_count; ++i)
+		{
+			auto const& entry = header.columns[i];
+			auto const length = ::strnlen(entry.name.data(), entry.name.size());
+			auto const name = std::string_view{entry.name.data(), length};
+
+			// Written so that a corrupted header cannot overflow
+			auto const is_aligned = entry.offset >= page_size && entry.offset % page_size == 0;
+			auto const is_in_file = entry.size <= file_size
+								 && entry.offset <= file_size - entry.size;
+
+			if (name != column_names[i] || entry.size != column_size || !is_aligned
+				|| !is_in_file)
+			{
+				return tl::unexpected(checkpoint_error::corrupted);
+			}
+		}
+
+		return {};
+	}
+} // namespace
+
+namespace physeng
+{
+	auto to_string(checkpoint_error error) -> std::string_view
+	{
+		switch (error)
+		{
+			case checkpoint_error::io_error:
+				return "io_error"sv;
+			case checkpoint_error::not_a_checkpoint:
+				return "not_a_checkpoint"sv;
+			case checkpoint_error::unsupported_format:
+				return "unsupported_format"sv;
+			case checkpoint_error::corrupted:
+				return "corrupted"sv;
+			case checkpoint_error::incompatible_engine:
+				return "incompatible_engine"sv;
+			case checkpoint_error::incompatible_application:
+				return "incompatible_application"sv;
+		}
+
+		return {};
+	}
+
+	template<precision_policy Precision>
+	auto write_checkpoint(std::filesystem::path const& path,
+						  basic_particle_set<Precision> const& particles,
+						  checkpoint_metadata const& metadata)
+		-> tl::expected<void, checkpoint_error>
+	{
+		auto header = file_header{.magic = magic,
+								  .format_version = checkpoint_format_version,
+								  .byte_order = byte_order_mark,
+								  .engine_version = get_engine_version(),
+								  .application_version = metadata.application_version,
+								  .column_count = stored_column_count,
+								  .reserved = 0,
+								  .particle_count = particles.size(),
+								  .step = metadata.step,
+								  .time = metadata.time,
+								  .columns = {}};
+
+		auto widened = velocity_columns{};
+		auto const columns = get_columns(particles, widened);
+
+		auto offset = page_size;
+		for (std::size_t i = 0; i < stored_column_count; ++i)
+		{
+			auto& entry = header.columns[i];
+			std::ranges::copy(column_names[i], std::begin(entry.name));
+			entry.offset = offset;
+			entry.size = columns[i].size_bytes();
+
+			offset = round_up(offset + entry.size, page_size);
+		}
+
+		auto temporary = path;
+		temporary += ".partial";
+
+		auto error = std::error_code{};
+		if (!write_file(temporary, header, columns))
+		{
+			std::filesystem::remove(temporary, error);
+			return tl::unexpected(checkpoint_error::io_error);
+		}
+
+		std::filesystem::rename(temporary, path, error);
+		if (error)
+		{
+			return tl::unexpected(checkpoint_error::io_error);
+		}
+
+		return {};
+	}
+
+	auto mapped_checkpoint::open(std::filesystem::path const& path,
+								 semantic_version application_version)
+		-> tl::expected<mapped_checkpoint, checkpoint_error>
+	{
+		auto const file = file_descriptor{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+		if (!file.is_valid())
+		{
+			return tl::unexpected(checkpoint_error::io_error);
+		}
+
+		struct stat status = {};
+		if (::fstat(file.get(), &status) != 0)
+		{
+			return tl::unexpected(checkpoint_error::io_error);
+		}
+
+		auto const file_size = static_cast<std::size_t>(status.st_size);
+		if (file_size < sizeof(file_header))
+		{
+			return tl::unexpected(checkpoint_error::not_a_checkpoint);
+		}
+
+		// Reject incompatible files before mapping anything
+		auto header = file_header{};
+		if (::pread(file.get(), &header, sizeof(header), 0)
+			!= static_cast<ssize_t>(sizeof(header)))
+		{
+			return tl::unexpected(checkpoint_error::io_error);
+		}
+
+		if (auto const valid = validate(header, file_size, application_version); !valid)
+		{
+			return tl::unexpected(valid.error());
+		}
+
+		auto* const data = ::mmap(nullptr, file_size, PROT_READ, MAP_SHARED, file.get(), 0);
+		if (data == MAP_FAILED) // NOLINT
+		{
+			return tl::unexpected(checkpoint_error::io_error);
+		}
+
+		auto offsets = column_offsets{};
+		for (std::size_t i = 0; i < stored_column_count; ++i)
+		{
+			offsets[i] = header.columns[i].offset;
+		}
+
+		return mapped_checkpoint{static_cast<std::byte const*>(data),
+								 file_size,
+								 {.application_version = header.application_version,
+								  .step = header.step,
+								  .time = header.time},
+								 header.engine_version,
+								 header.particle_count,
+								 offsets};
+	}
+
+	mapped_checkpoint::mapped_checkpoint(std::byte const* data, std::size_t size,
+										 checkpoint_metadata metadata,
+										 semantic_version engine_version,
+										 std::size_t particle_count,
+										 column_offsets const& offsets) noexcept :
+		m_data(data), m_size(size), m_metadata(metadata), m_engine_version(engine_version),
+		m_particle_count(particle_count), m_offsets(offsets)
+	{}
+
+	mapped_checkpoint::mapped_checkpoint(mapped_checkpoint&& other) noexcept :
+		m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)),
+		m_metadata(other.m_metadata), m_engine_version(other.m_engine_version),
+		m_particle_count(other.m_particle_count), m_offsets(other.m_offsets)
+	{}
+
+	mapped_checkpoint::~mapped_checkpoint()
+	{
+		if (m_data != nullptr)
+		{
+			::munmap(const_cast<std::byte*>(m_data), m_size); // NOLINT
+		}
+	}
+
+	auto mapped_checkpoint::operator=(mapped_checkpoint&& other) noexcept -> mapped_checkpoint&
+	{
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		m_metadata = other.m_metadata;
+		m_engine_version = other.m_engine_version;
+		m_particle_count = other.m_particle_count;
+		m_offsets = other.m_offsets;
+
+		return *this;
+	}
+
+	auto mapped_checkpoint::get_metadata() const noexcept -> checkpoint_metadata const&
+	{
+		return m_metadata;
+	}
+	auto mapped_checkpoint::get_engine_version() const noexcept -> semantic_version
+	{
+		return m_engine_version;
+	}
+	auto mapped_checkpoint::size() const noexcept -> std::size_t
+	{
+		return m_particle_count;
+	}
+
+	auto mapped_checkpoint::position(std::size_t axis) const noexcept -> std::span<float const>
+	{
+		assert(axis < particle_set::dimension); // NOLINT
+		return get_column(axis);
+	}
+	auto mapped_checkpoint::velocity(std::size_t axis) const noexcept -> std::span<float const>
+	{
+		assert(axis < particle_set::dimension); // NOLINT
+		return get_column(particle_set::dimension + axis);
+	}
+	auto mapped_checkpoint::density() const noexcept -> std::span<float const>
+	{
+		return get_column(6);
+	}
+	auto mapped_checkpoint::pressure() const noexcept -> std::span<float const>
+	{
+		return get_column(7);
+	}
+	auto mapped_checkpoint::mass() const noexcept -> std::span<float const>
+	{
+		return get_column(8);
+	}
+
+	template<precision_policy Precision>
+	void mapped_checkpoint::restore(basic_particle_set<Precision>& particles) const
+	{
+		// Every page is read exactly once, front to back
+		::madvise(const_cast<std::byte*>(m_data), m_size, MADV_SEQUENTIAL); // NOLINT
+
+		particles.resize(m_particle_count);
+
+		parallel_for(m_particle_count, restore_grain, [&](std::size_t first, std::size_t last) {
+			auto const copy = [&](std::span<float const> source, auto target) {
+				std::ranges::copy(source.subspan(first, last - first),
+								  std::begin(target) + static_cast<std::ptrdiff_t>(first));
+			};
+
+			for (std::size_t axis = 0; axis < particle_set::dimension; ++axis)
+			{
+				copy(position(axis), particles.position(axis));
+			}
+			for (std::size_t axis = 0; axis < particle_set::dimension; ++axis)
+			{
+				copy(velocity(axis), particles.velocity(axis));
+			}
+			copy(density(), particles.density());
+			copy(pressure(), particles.pressure());
+			copy(mass(), particles.mass());
+		});
+	}
+
+	auto mapped_checkpoint::get_column(std::size_t index) const noexcept -> std::span<float const>
+	{
+		// Columns start on a page boundary of a page aligned mapping
+		auto const* const column = m_data + m_offsets[index];
+		return {reinterpret_cast<float const*>(column), m_particle_count}; // NOLINT
+	}
+
+	template auto write_checkpoint(std::filesystem::path const& path,
+								   particle_set const& particles,
+								   checkpoint_metadata const& metadata)
+		-> tl::expected<void, checkpoint_error>;
+	template auto write_checkpoint(std::filesystem::path const& path,
+								   compact_particle_set const& particles,
+								   checkpoint_metadata const& metadata)
+		-> tl::expected<void, checkpoint_error>;
+
+	template void mapped_checkpoint::restore(particle_set& particles) const;
+	template void mapped_checkpoint::restore(compact_particle_set& particles) const;
+} // namespace physeng
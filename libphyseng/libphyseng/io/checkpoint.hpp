@@ -0,0 +1,137 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/export.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+#include <libphyseng/util/semantic_version.hpp>
+
+#include <tl/expected.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+namespace physeng
+{
+	/**
+	 * @brief The version of the layout of checkpoint files. Bumped whenever the layout changes,
+	 * files of any other version are rejected
+	 */
+	inline constexpr std::uint32_t checkpoint_format_version = 1;
+
+	enum struct checkpoint_error
+	{
+		io_error,                //< The file could not be created, read or mapped
+		not_a_checkpoint,        //< The file does not start with the checkpoint magic
+		unsupported_format,      //< Another format version or byte order
+		corrupted,               //< The header does not describe the content of the file
+		incompatible_engine,     //< Written by an incompatible version of the engine
+		incompatible_application //< Written by an incompatible version of the application
+	};
+
+	LIBPHYSENG_SYMEXPORT auto to_string(checkpoint_error error) -> std::string_view;
+
+	/**
+	 * @brief What a checkpoint records besides the particles
+	 */
+	struct checkpoint_metadata
+	{
+		semantic_version application_version = {}; //< Version of the program writing the file
+		std::uint64_t step = 0;                     //< Number of steps run so far
+		double time = 0.0;                          //< Simulated time so far, in seconds
+	};
+
+	/**
+	 * @brief Write the state of `particles` to `path`
+	 *
+	 * The file starts with a header page holding the versions of the engine and of the
+	 * application, followed by every column of the set, each starting on a page boundary. The file
+	 * is first written next to `path` and then renamed, an interrupted write never destroys the
+	 * previous checkpoint
+	 */
+	template<precision_policy Precision>
+	LIBPHYSENG_SYMEXPORT auto write_checkpoint(std::filesystem::path const& path,
+											   basic_particle_set<Precision> const& particles,
+											   checkpoint_metadata const& metadata)
+		-> tl::expected<void, checkpoint_error>;
+
+	/**
+	 * @brief A checkpoint file mapped in memory. The columns are read straight from the mapping,
+	 * so opening a checkpoint costs the same whatever its size and pages are only read from disk
+	 * once they are touched
+	 */
+	class LIBPHYSENG_SYMEXPORT mapped_checkpoint
+	{
+	public:
+		/**
+		 * @brief Map the checkpoint at `path`. Only the header is validated: the engine that wrote
+		 * the file has to be compatible with this one, and the application that wrote it with
+		 * `application_version`
+		 */
+		static auto open(std::filesystem::path const& path, semantic_version application_version)
+			-> tl::expected<mapped_checkpoint, checkpoint_error>;
+
+		mapped_checkpoint(mapped_checkpoint const&) = delete;
+		mapped_checkpoint(mapped_checkpoint&& other) noexcept;
+		~mapped_checkpoint();
+
+		auto operator=(mapped_checkpoint const&) -> mapped_checkpoint& = delete;
+		auto operator=(mapped_checkpoint&& other) noexcept -> mapped_checkpoint&;
+
+		[[nodiscard]] auto get_metadata() const noexcept -> checkpoint_metadata const&;
+		[[nodiscard]] auto get_engine_version() const noexcept -> semantic_version;
+		[[nodiscard]] auto size() const noexcept -> std::size_t;
+
+		[[nodiscard]] auto position(std::size_t axis) const noexcept -> std::span<float const>;
+		[[nodiscard]] auto velocity(std::size_t axis) const noexcept -> std::span<float const>;
+		[[nodiscard]] auto density() const noexcept -> std::span<float const>;
+		[[nodiscard]] auto pressure() const noexcept -> std::span<float const>;
+		[[nodiscard]] auto mass() const noexcept -> std::span<float const>;
+
+		/**
+		 * @brief Replace the content of `particles` by the one of the checkpoint. The columns are
+		 * copied in parallel, and converted to the velocity type of `particles`
+		 */
+		template<precision_policy Precision>
+		void restore(basic_particle_set<Precision>& particles) const;
+
+	private:
+		// Three position and velocity axes, the density, the pressure and the mass
+		static constexpr std::size_t column_count = 9;
+
+		using column_offsets = std::array<std::size_t, column_count>;
+
+		mapped_checkpoint(std::byte const* data, std::size_t size, checkpoint_metadata metadata,
+						  semantic_version engine_version, std::size_t particle_count,
+						  column_offsets const& offsets) noexcept;
+
+		[[nodiscard]] auto get_column(std::size_t index) const noexcept -> std::span<float const>;
+
+	private:
+		std::byte const* m_data = nullptr;
+		std::size_t m_size = 0;
+
+		checkpoint_metadata m_metadata;
+		semantic_version m_engine_version;
+		std::size_t m_particle_count;
+		column_offsets m_offsets;
+	};
+} // namespace physeng
@@ -0,0 +1,147 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Batched evaluation loops of the smoothing kernels. This file is included once per instruction
+// set by smoothing_kernel.cpp, inside of a namespace that provides:
+//  - `real`: a pack of `width` floats supporting +, - and *
+//  - `load`, `store` and `splat` to move data in and out of a pack
+//  - `max`, `sqrt` and `select_less(a, b, x, y)`, the latter picking `x` where `a < b` and `y`
+//    elsewhere
+
+template<physeng::kernel_type Type>
+inline auto shape(real q) -> real
+{
+	auto const one = splat(1.0F);
+	auto const zero = splat(0.0F);
+
+	if constexpr (Type == physeng::kernel_type::cubic_spline)
+	{
+		auto const two_minus_q = max(splat(2.0F) - q, zero);
+		auto const outer = splat(0.25F) * two_minus_q * two_minus_q * two_minus_q;
+		auto const inner = one - splat(1.5F) * q * q + splat(0.75F) * q * q * q;
+
+		return select_less(q, one, inner, outer);
+	}
+	else if constexpr (Type == physeng::kernel_type::wendland_c2)
+	{
+		auto const t = max(one - splat(0.5F) * q, zero);
+		auto const t2 = t * t;
+
+		return t2 * t2 * (splat(2.0F) * q + one);
+	}
+	else
+	{
+		auto const t = max(one - splat(0.5F) * q, zero);
+		auto const t2 = t * t;
+
+		return t2 * t2 * t2 * (splat(35.0F / 12.0F) * q * q + splat(3.0F) * q + one);
+	}
+}
+
+// Derivative of the shape with respect to q, divided by q
+template<physeng::kernel_type Type>
+inline auto shape_gradient(real q) -> real
+{
+	auto const one = splat(1.0F);
+	auto const zero = splat(0.0F);
+
+	if constexpr (Type == physeng::kernel_type::cubic_spline)
+	{
+		auto const two_minus_q = max(splat(2.0F) - q, zero);
+		auto const outer = splat(-0.75F) * two_minus_q * two_minus_q / max(q, one);
+		auto const inner = splat(-3.0F) + splat(2.25F) * q;
+
+		return select_less(q, one, inner, outer);
+	}
+	else if constexpr (Type == physeng::kernel_type::wendland_c2)
+	{
+		auto const t = max(one - splat(0.5F) * q, zero);
+
+		return splat(-5.0F) * t * t * t;
+	}
+	else
+	{
+		auto const t = max(one - splat(0.5F) * q, zero);
+		auto const t2 = t * t;
+
+		return splat(-14.0F / 3.0F) * t2 * t2 * t * (splat(2.5F) * q + one);
+	}
+}
+
+template<physeng::kernel_type Type, bool IsGradient>
+inline auto evaluate_pack(real distance_squared, real inv_h, real normalization) -> real
+{
+	auto const q = sqrt(distance_squared) * inv_h;
+
+	if constexpr (IsGradient)
+	{
+		return normalization * shape_gradient<Type>(q);
+	}
+	else
+	{
+		return normalization * shape<Type>(q);
+	}
+}
+
+template<physeng::kernel_type Type, bool IsGradient>
+void evaluate_batch(physeng::smoothing_kernel::parameters const& params,
+					std::span<float const> distances_squared, std::span<float> results)
+{
+	auto const inv_h = splat(params.inv_smoothing_length);
+	auto const normalization =
+		splat(IsGradient ? params.gradient_normalization : params.value_normalization);
+
+	std::size_t i = 0;
+	for (; i + width <= distances_squared.size(); i += width)
+	{
+		auto const pack = load(distances_squared.data() + i);
+		store(results.data() + i, evaluate_pack<Type, IsGradient>(pack, inv_h, normalization));
+	}
+
+	// The tail goes through a full pack padded with zeros
+	if (i < distances_squared.size())
+	{
+		auto const remainder = distances_squared.size() - i;
+
+		alignas(64) std::array<float, width> buffer = {}; // NOLINT
+		std::copy_n(distances_squared.data() + i, remainder, buffer.data());
+
+		auto const pack = load(buffer.data());
+		store(buffer.data(), evaluate_pack<Type, IsGradient>(pack, inv_h, normalization));
+
+		std::copy_n(buffer.data(), remainder, results.data() + i);
+	}
+}
+
+using batch_function = void (*)(physeng::smoothing_kernel::parameters const&,
+								 std::span<float const>, std::span<float>);
+
+// The type of the kernel is picked once here, when the kernel is created, and never again
+template<bool IsGradient>
+auto select_batch(physeng::kernel_type type) -> batch_function
+{
+	switch (type)
+	{
+		case physeng::kernel_type::cubic_spline:
+			return evaluate_batch<physeng::kernel_type::cubic_spline, IsGradient>;
+		case physeng::kernel_type::wendland_c2:
+			return evaluate_batch<physeng::kernel_type::wendland_c2, IsGradient>;
+		case physeng::kernel_type::wendland_c4:
+			return evaluate_batch<physeng::kernel_type::wendland_c4, IsGradient>;
+	}
+
+	return evaluate_batch<physeng::kernel_type::cubic_spline, IsGradient>;
+}
@@ -0,0 +1,374 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <libphyseng/kernels/smoothing_kernel.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+
+#if defined(__x86_64__) || defined(__i386__)
+#	define PHYSENG_HAS_X86_SIMD 1
+#	include <immintrin.h>
+#endif
+
+// Every backend lives in its own namespace within the anonymous one: the functions they define
+// have internal linkage, so code compiled for a wider instruction set can never be picked by the
+// linker in place of the scalar one
+namespace
+{
+	using namespace std::literals;
+
+	namespace scalar_backend
+	{
+		using real = float;
+		constexpr std::size_t width = 1;
+
+		inline auto load(float const* ptr) -> real
+		{
+			return *ptr;
+		}
+		inline void store(float* ptr, real value)
+		{
+			*ptr = value;
+		}
+		inline auto splat(float value) -> real
+		{
+			return value;
+		}
+		inline auto max(real lhs, real rhs) -> real
+		{
+			return std::max(lhs, rhs);
+		}
+		inline auto sqrt(real value) -> real
+		{
+			return std::sqrt(value);
+		}
+		inline auto select_less(real lhs, real rhs, real if_less, real otherwise) -> real
+		{
+			return lhs < rhs ? if_less : otherwise;
+		}
+
+#include <libphyseng/kernels/detail/kernel_batch.ipp>
+	} // namespace scalar_backend
+
+#if defined(PHYSENG_HAS_X86_SIMD)
+#	if defined(__clang__)
+#		pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#	else
+#		pragma GCC push_options
+#		pragma GCC target("avx2,fma")
+#	endif
+
+	namespace avx2_backend
+	{
+		struct real
+		{
+			__m256 value;
+		};
+		constexpr std::size_t width = 8;
+
+		inline auto operator+(real lhs, real rhs) -> real
+		{
+			return {_mm256_add_ps(lhs.value, rhs.value)};
+		}
+		inline auto operator-(real lhs, real rhs) -> real
+		{
+			return {_mm256_sub_ps(lhs.value, rhs.value)};
+		}
+		inline auto operator*(real lhs, real rhs) -> real
+		{
+			return {_mm256_mul_ps(lhs.value, rhs.value)};
+		}
+		inline auto operator/(real lhs, real rhs) -> real
+		{
+			return {_mm256_div_ps(lhs.value, rhs.value)};
+		}
+		inline auto load(float const* ptr) -> real
+		{
+			return {_mm256_loadu_ps(ptr)};
+		}
+		inline void store(float* ptr, real value)
+		{
+			_mm256_storeu_ps(ptr, value.value);
+		}
+		inline auto splat(float value) -> real
+		{
+			return {_mm256_set1_ps(value)};
+		}
+		inline auto max(real lhs, real rhs) -> real
+		{
+			return {_mm256_max_ps(lhs.value, rhs.value)};
+		}
+		inline auto sqrt(real value) -> real
+		{
+			return {_mm256_sqrt_ps(value.value)};
+		}
+		inline auto select_less(real lhs, real rhs, real if_less, real otherwise) -> real
+		{
+			auto const mask = _mm256_cmp_ps(lhs.value, rhs.value, _CMP_LT_OQ);
+			return {_mm256_blendv_ps(otherwise.value, if_less.value, mask)};
+		}
+
+#	include <libphyseng/kernels/detail/kernel_batch.ipp>
+	} // namespace avx2_backend
+
+#	if defined(__clang__)
+#		pragma clang attribute pop
+#		pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#	else
+#		pragma GCC pop_options
+#		pragma GCC push_options
+#		pragma GCC target("avx512f")
+// The AVX-512 intrinsics of GCC build their undefined registers out of self initialized values
+#		pragma GCC diagnostic push
+#		pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#	endif
+
+	namespace avx512_backend
+	{
+		struct real
+		{
+			__m512 value;
+		};
+		constexpr std::size_t width = 16;
+
+		inline auto operator+(real lhs, real rhs) -> real
+		{
+			return {_mm512_add_ps(lhs.value, rhs.value)};
+		}
+		inline auto operator-(real lhs, real rhs) -> real
+		{
+			return {_mm512_sub_ps(lhs.value, rhs.value)};
+		}
+		inline auto operator*(real lhs, real rhs) -> real
+		{
+			return {_mm512_mul_ps(lhs.value, rhs.value)};
+		}
+		inline auto operator/(real lhs, real rhs) -> real
+		{
+			return {_mm512_div_ps(lhs.value, rhs.value)};
+		}
+		inline auto load(float const* ptr) -> real
+		{
+			return {_mm512_loadu_ps(ptr)};
+		}
+		inline void store(float* ptr, real value)
+		{
+			_mm512_storeu_ps(ptr, value.value);
+		}
+		inline auto splat(float value) -> real
+		{
+			return {_mm512_set1_ps(value)};
+		}
+		inline auto max(real lhs, real rhs) -> real
+		{
+			return {_mm512_max_ps(lhs.value, rhs.value)};
+		}
+		inline auto sqrt(real value) -> real
+		{
+			return {_mm512_sqrt_ps(value.value)};
+		}
+		inline auto select_less(real lhs, real rhs, real if_less, real otherwise) -> real
+		{
+			auto const mask = _mm512_cmp_ps_mask(lhs.value, rhs.value, _CMP_LT_OQ);
+			return {_mm512_mask_blend_ps(mask, otherwise.value, if_less.value)};
+		}
+
+#	include <libphyseng/kernels/detail/kernel_batch.ipp>
+	} // namespace avx512_backend
+
+#	if defined(__clang__)
+#		pragma clang attribute pop
+#	else
+#		pragma GCC diagnostic pop
+#		pragma GCC pop_options
+#	endif
+#endif // defined(PHYSENG_HAS_X86_SIMD)
+
+	auto probe_simd_level() noexcept -> physeng::simd_level
+	{
+#if defined(PHYSENG_HAS_X86_SIMD)
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx512f"))
+		{
+			return physeng::simd_level::avx512;
+		}
+
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		{
+			return physeng::simd_level::avx2;
+		}
+#endif
+
+		return physeng::simd_level::scalar;
+	}
+
+	// The normalization constants of the kernels, in two and in three dimensions
+	auto get_sigma(physeng::kernel_type type, std::size_t dimension) noexcept -> float
+	{
+		auto const is_planar = dimension == 2;
+
+		switch (type)
+		{
+			case physeng::kernel_type::cubic_spline:
+				return (is_planar ? 10.0F / 7.0F : 1.0F) * std::numbers::inv_pi_v<float>;
+			case physeng::kernel_type::wendland_c2:
+				return (is_planar ? 7.0F / 4.0F : 21.0F / 16.0F) * std::numbers::inv_pi_v<float>;
+			case physeng::kernel_type::wendland_c4:
+				return (is_planar ? 9.0F / 4.0F : 495.0F / 256.0F)
+					 * std::numbers::inv_pi_v<float>;
+		}
+
+		return 0.0F;
+	}
+} // namespace
+
+namespace physeng
+{
+	auto detect_simd_level() noexcept -> simd_level
+	{
+		static auto const level = probe_simd_level();
+		return level;
+	}
+
+	auto to_string(kernel_type type) noexcept -> std::string_view
+	{
+		switch (type)
+		{
+			case kernel_type::cubic_spline:
+				return "cubic_spline"sv;
+			case kernel_type::wendland_c2:
+				return "wendland_c2"sv;
+			case kernel_type::wendland_c4:
+				return "wendland_c4"sv;
+		}
+
+		return {};
+	}
+
+	auto to_string(simd_level level) noexcept -> std::string_view
+	{
+		switch (level)
+		{
+			case simd_level::scalar:
+				return "scalar"sv;
+			case simd_level::avx2:
+				return "avx2"sv;
+			case simd_level::avx512:
+				return "avx512"sv;
+		}
+
+		return {};
+	}
+
+	smoothing_kernel::smoothing_kernel(kernel_type type, smoothing_length h,
+									   std::size_t dimension, simd_level level) :
+		m_type(type), m_dimension(dimension), m_level(std::min(level, detect_simd_level())),
+		m_smoothing_length(h), m_evaluate_pair(scalar_backend::select_batch<false>(type)),
+		m_evaluate_gradient_pair(scalar_backend::select_batch<true>(type))
+	{
+		assert(h.get() > 0.0F);                   // NOLINT
+		assert(dimension == 2 || dimension == 3); // NOLINT
+
+		auto const inv_h = 1.0F / h.get();
+		auto const area_normalization = get_sigma(type, dimension) * inv_h * inv_h;
+		auto const value_normalization =
+			dimension == 2 ? area_normalization : area_normalization * inv_h;
+
+		m_parameters = {.inv_smoothing_length = inv_h,
+						.value_normalization = value_normalization,
+						.gradient_normalization = value_normalization * inv_h * inv_h};
+
+		m_evaluate = m_evaluate_pair;
+		m_evaluate_gradient = m_evaluate_gradient_pair;
+
+#if defined(PHYSENG_HAS_X86_SIMD)
+		if (m_level == simd_level::avx512)
+		{
+			m_evaluate = avx512_backend::select_batch<false>(type);
+			m_evaluate_gradient = avx512_backend::select_batch<true>(type);
+		}
+		else if (m_level == simd_level::avx2)
+		{
+			m_evaluate = avx2_backend::select_batch<false>(type);
+			m_evaluate_gradient = avx2_backend::select_batch<true>(type);
+		}
+#endif
+	}
+
+	auto smoothing_kernel::get_type() const noexcept -> kernel_type
+	{
+		return m_type;
+	}
+	auto smoothing_kernel::get_dimension() const noexcept -> std::size_t
+	{
+		return m_dimension;
+	}
+	auto smoothing_kernel::get_simd_level() const noexcept -> simd_level
+	{
+		return m_level;
+	}
+	auto smoothing_kernel::get_smoothing_length() const noexcept -> smoothing_length
+	{
+		return m_smoothing_length;
+	}
+	auto smoothing_kernel::get_support_radius() const noexcept -> support_radius
+	{
+		return to_support_radius(m_type, m_smoothing_length);
+	}
+	auto smoothing_kernel::get_parameters() const noexcept -> parameters const&
+	{
+		return m_parameters;
+	}
+
+	void smoothing_kernel::evaluate(std::span<float const> distances_squared,
+									std::span<float> values) const
+	{
+		assert(values.size() >= distances_squared.size()); // NOLINT
+
+		m_evaluate(m_parameters, distances_squared, values);
+	}
+
+	void smoothing_kernel::evaluate_gradient(std::span<float const> distances_squared,
+											 std::span<float> factors) const
+	{
+		assert(factors.size() >= distances_squared.size()); // NOLINT
+
+		m_evaluate_gradient(m_parameters, distances_squared, factors);
+	}
+
+	auto smoothing_kernel::evaluate(float distance_squared) const -> float
+	{
+		auto result = 0.0F;
+		m_evaluate_pair(m_parameters, std::span{&distance_squared, 1}, std::span{&result, 1});
+
+		return result;
+	}
+
+	auto smoothing_kernel::evaluate_gradient(float distance_squared) const -> float
+	{
+		auto result = 0.0F;
+		m_evaluate_gradient_pair(m_parameters, std::span{&distance_squared, 1},
+								   std::span{&result, 1});
+
+		return result;
+	}
+} // namespace physeng
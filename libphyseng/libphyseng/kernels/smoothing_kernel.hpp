@@ -0,0 +1,150 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/export.hpp>
+#include <libphyseng/kernels/smoothing_length.hpp>
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+namespace physeng
+{
+	enum struct kernel_type
+	{
+		cubic_spline, //< Monaghan's M4 cubic B-spline
+		wendland_c2,  //< Wendland's C2 function
+		wendland_c4   //< Wendland's C4 function
+	};
+
+	/**
+	 * @brief The instruction sets the batched kernel evaluation can run on
+	 */
+	enum struct simd_level
+	{
+		scalar,
+		avx2,
+		avx512
+	};
+
+	/**
+	 * @brief The widest instruction set supported by the processor running the program, as
+	 * reported by CPUID. Detected once on the first call
+	 */
+	LIBPHYSENG_SYMEXPORT auto detect_simd_level() noexcept -> simd_level;
+
+	LIBPHYSENG_SYMEXPORT auto to_string(kernel_type type) noexcept -> std::string_view;
+	LIBPHYSENG_SYMEXPORT auto to_string(simd_level level) noexcept -> std::string_view;
+
+	/**
+	 * @brief The support radius of a kernel with the given smoothing length. Every kernel we
+	 * provide vanishes at twice the smoothing length
+	 */
+	constexpr auto to_support_radius(kernel_type /*type*/, smoothing_length h) noexcept
+		-> support_radius
+	{
+		return support_radius{2.0F * h.get()};
+	}
+
+	/**
+	 * @brief A two or three dimensional SPH smoothing kernel, evaluated over whole batches of
+	 * neighbor distances at once
+	 *
+	 * The batches run on the widest instruction set available. It is selected along with the type
+	 * of the kernel when the kernel is created, the batches never branch on either of them
+	 */
+	class LIBPHYSENG_SYMEXPORT smoothing_kernel
+	{
+	public:
+		/**
+		 * @brief Precomputed factors shared by every evaluation of a kernel
+		 */
+		struct parameters
+		{
+			float inv_smoothing_length;
+			float value_normalization;    //< sigma / h^d
+			float gradient_normalization; //< sigma / h^(d + 2)
+		};
+
+	public:
+		/**
+		 * @param[in] type The shape of the kernel
+		 * @param[in] h The smoothing length
+		 * @param[in] dimension The number of dimensions the kernel is normalized over, 2 or 3
+		 * @param[in] level The widest instruction set the batches may use
+		 */
+		smoothing_kernel(kernel_type type, smoothing_length h, std::size_t dimension = 3,
+						 simd_level level = detect_simd_level());
+
+		[[nodiscard]] auto get_type() const noexcept -> kernel_type;
+		[[nodiscard]] auto get_dimension() const noexcept -> std::size_t;
+		[[nodiscard]] auto get_simd_level() const noexcept -> simd_level;
+		[[nodiscard]] auto get_smoothing_length() const noexcept -> smoothing_length;
+		[[nodiscard]] auto get_support_radius() const noexcept -> support_radius;
+		/**
+		 * @brief The factors the kernel is evaluated with, for backends evaluating it themselves
+		 */
+		[[nodiscard]] auto get_parameters() const noexcept -> parameters const&;
+
+		/**
+		 * @brief Evaluate W for a batch of neighbors
+		 *
+		 * @param[in] distances_squared The squared distance to every neighbor
+		 * @param[out] values The value of the kernel for every neighbor. Must be at least as large
+		 * as `distances_squared`
+		 */
+		void evaluate(std::span<float const> distances_squared, std::span<float> values) const;
+
+		/**
+		 * @brief Evaluate the gradient of W for a batch of neighbors. The gradient of a radial
+		 * kernel is colinear with the vector between the particles, the factors returned here are
+		 * such that `grad W(x_i - x_j) = factor * (x_i - x_j)`
+		 *
+		 * @param[in] distances_squared The squared distance to every neighbor
+		 * @param[out] factors The gradient factor for every neighbor. Must be at least as large as
+		 * `distances_squared`
+		 */
+		void evaluate_gradient(std::span<float const> distances_squared,
+							   std::span<float> factors) const;
+
+		/**
+		 * @brief Evaluate W for a single pair of particles
+		 */
+		[[nodiscard]] auto evaluate(float distance_squared) const -> float;
+		/**
+		 * @brief Evaluate the gradient factor of a single pair of particles
+		 */
+		[[nodiscard]] auto evaluate_gradient(float distance_squared) const -> float;
+
+	private:
+		using batch_function = void (*)(parameters const&, std::span<float const>,
+										std::span<float>);
+
+		kernel_type m_type;
+		std::size_t m_dimension;
+		simd_level m_level;
+		smoothing_length m_smoothing_length;
+		parameters m_parameters;
+
+		// Specialized for the type of the kernel, the last two run the single pair evaluations
+		batch_function m_evaluate;
+		batch_function m_evaluate_gradient;
+		batch_function m_evaluate_pair;
+		batch_function m_evaluate_gradient_pair;
+	};
+} // namespace physeng
@@ -0,0 +1,33 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/util/strong_type.hpp>
+
+namespace physeng
+{
+	/**
+	 * @brief The smoothing length `h` of an SPH kernel, the scale its shape is expressed in
+	 */
+	using smoothing_length = strong_type<float, struct smoothing_length_tag>;
+
+	/**
+	 * @brief The distance beyond which an SPH kernel vanishes. It is a multiple of the smoothing
+	 * length that depends on the kernel, which is why the two cannot be used interchangeably
+	 */
+	using support_radius = strong_type<float, struct support_radius_tag>;
+} // namespace physeng
@@ -15,7 +15,12 @@
  */
 
 
+#include <libphyseng/concurrency/thread_pool.hpp>
 #include <libphyseng/main.hpp>
+#include <libphyseng/memory/frame_arena.hpp>
+#include <libphyseng/profiling/profiler.hpp>
+
+#include <fmt/core.h>
 
 #include <range/v3/range/conversion.hpp>
 #include <range/v3/view/span.hpp>
@@ -35,7 +40,37 @@ auto main(int argc, char *argv[]) -> int
 		return -1;
 	}
 
-	physeng_main(args);
+	// Created first so that the workers of the pool find it when they start
+	auto profiler = physeng::profiler{physeng::profiler::options_from_environment()};
+	if (physeng::is_profiling_enabled && !profiler.get_trace_path().empty())
+	{
+		physeng::set_default_profiler(&profiler);
+		profiler.set_thread_name("main");
+	}
+
+	// The pool has to outlive everything `physeng_main` runs on it
+	auto pool = physeng::thread_pool{physeng::thread_pool::options_from_environment()};
+	physeng::set_default_thread_pool(&pool);
+
+	auto frames = physeng::frame_allocator{physeng::frame_allocator::options_from_environment()};
+	physeng::set_default_frame_allocator(&frames);
+
+	auto const status = physeng_main(args);
+
+	physeng::set_default_frame_allocator(nullptr);
+	physeng::set_default_thread_pool(nullptr);
+
+	// The workers are idle, their events can be read
+	if (physeng::get_default_profiler() != nullptr)
+	{
+		physeng::set_default_profiler(nullptr);
+
+		if (auto const result = profiler.write_chrome_trace(profiler.get_trace_path()); !result)
+		{
+			fmt::print(stderr, "physeng: {} '{}'\n", physeng::to_string(result.error()),
+					   profiler.get_trace_path().string());
+		}
+	}
 
-	return 0;
+	return status;
 }
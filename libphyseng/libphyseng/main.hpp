@@ -24,5 +24,7 @@
  * of the engine
  *
  * @param[in] args The command line argument passed when launching the application
+ *
+ * @return The exit status of the application, `EXIT_SUCCESS` or `EXIT_FAILURE`
  */
-extern void physeng_main(std::span<std::string_view const> args);
+extern auto physeng_main(std::span<std::string_view const> args) -> int;
@@ -0,0 +1,113 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/util/strong_ops/addable.hpp>
+#include <libphyseng/util/strong_ops/comparable.hpp>
+#include <libphyseng/util/strong_ops/subtractable.hpp>
+#include <libphyseng/util/strong_type.hpp>
+
+namespace physeng
+{
+	/**
+	 * @brief The exponents of the base units of a physical quantity, in the SI system
+	 */
+	template<int Length, int Mass, int Time>
+	struct dimension
+	{
+		static constexpr int length = Length;
+		static constexpr int mass = Mass;
+		static constexpr int time = Time;
+	};
+
+	template<typename Lhs, typename Rhs>
+	using dimension_product = dimension<Lhs::length + Rhs::length, Lhs::mass + Rhs::mass,
+										Lhs::time + Rhs::time>;
+	template<typename Lhs, typename Rhs>
+	using dimension_quotient = dimension<Lhs::length - Rhs::length, Lhs::mass - Rhs::mass,
+										 Lhs::time - Rhs::time>;
+
+	/**
+	 * @brief A physical quantity stored as a float in SI units. Only quantities of the same
+	 * dimension can be added, subtracted or compared, products and quotients get the dimension
+	 * they should, so a mistake in a formula is a compilation error
+	 */
+	template<typename Dimension>
+	using quantity = strong_type<float, Dimension, strong::addable, strong::subtractable,
+								 strong::equatable, strong::comparable>;
+
+	using dimensionless = quantity<dimension<0, 0, 0>>;
+	using length = quantity<dimension<1, 0, 0>>;
+	using area = quantity<dimension<2, 0, 0>>;
+	using volume = quantity<dimension<3, 0, 0>>;
+	using mass = quantity<dimension<0, 1, 0>>;
+	using time_interval = quantity<dimension<0, 0, 1>>;
+	using velocity = quantity<dimension<1, 0, -1>>;
+	using acceleration = quantity<dimension<1, 0, -2>>;
+	using density = quantity<dimension<-3, 1, 0>>;
+	using pressure = quantity<dimension<-1, 1, -2>>;
+
+	template<typename Lhs, typename Rhs>
+	constexpr auto operator*(quantity<Lhs> const& lhs, quantity<Rhs> const& rhs) noexcept
+		-> quantity<dimension_product<Lhs, Rhs>>
+	{
+		return quantity<dimension_product<Lhs, Rhs>>{lhs.get() * rhs.get()};
+	}
+
+	template<typename Lhs, typename Rhs>
+	constexpr auto operator/(quantity<Lhs> const& lhs, quantity<Rhs> const& rhs) noexcept
+		-> quantity<dimension_quotient<Lhs, Rhs>>
+	{
+		return quantity<dimension_quotient<Lhs, Rhs>>{lhs.get() / rhs.get()};
+	}
+
+	template<typename Dimension>
+	constexpr auto operator*(quantity<Dimension> const& lhs, float rhs) noexcept
+		-> quantity<Dimension>
+	{
+		return quantity<Dimension>{lhs.get() * rhs};
+	}
+
+	template<typename Dimension>
+	constexpr auto operator*(float lhs, quantity<Dimension> const& rhs) noexcept
+		-> quantity<Dimension>
+	{
+		return quantity<Dimension>{lhs * rhs.get()};
+	}
+
+	template<typename Dimension>
+	constexpr auto operator/(quantity<Dimension> const& lhs, float rhs) noexcept
+		-> quantity<Dimension>
+	{
+		return quantity<Dimension>{lhs.get() / rhs};
+	}
+
+	/**
+	 * @brief The float a value is stored as, for code that works on raw floats and quantities
+	 * alike
+	 */
+	constexpr auto get_value(float value) noexcept -> float
+	{
+		return value;
+	}
+
+	template<typename Dimension>
+	constexpr auto get_value(quantity<Dimension> const& value) noexcept -> float
+	{
+		return value.get();
+	}
+} // namespace physeng
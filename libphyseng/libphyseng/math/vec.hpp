@@ -0,0 +1,369 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/math/units.hpp>
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace physeng
+{
+	template<typename Type, std::size_t Size>
+	struct vec;
+	template<typename Type, std::size_t Size, std::size_t Width>
+	struct vec_batch;
+
+	namespace detail
+	{
+		template<typename Type>
+		inline constexpr bool is_vector = false;
+		template<typename Type, std::size_t Size>
+		inline constexpr bool is_vector<vec<Type, Size>> = true;
+		template<typename Type, std::size_t Size, std::size_t Width>
+		inline constexpr bool is_vector<vec_batch<Type, Size, Width>> = true;
+	} // namespace detail
+
+	/**
+	 * @brief What vectors can be scaled by: floats and quantities
+	 */
+	template<typename Type>
+	concept scalar = !detail::is_vector<Type>;
+
+	/**
+	 * @brief A fixed size vector of floats or of quantities. The components are stored inline and
+	 * every operation is a plain loop over them, which the compiler unrolls into the same code it
+	 * would generate for raw floats
+	 */
+	template<typename Type, std::size_t Size>
+	struct vec
+	{
+		using value_type = Type;
+		static constexpr std::size_t dimension = Size;
+
+		std::array<Type, Size> components;
+
+		constexpr auto operator[](std::size_t index) noexcept -> Type& { return components[index]; }
+		constexpr auto operator[](std::size_t index) const noexcept -> Type const&
+		{
+			return components[index];
+		}
+
+		constexpr auto operator+=(vec const& other) noexcept -> vec&
+		{
+			for (std::size_t i = 0; i < Size; ++i)
+			{
+				components[i] += other.components[i];
+			}
+			return *this;
+		}
+		constexpr auto operator-=(vec const& other) noexcept -> vec&
+		{
+			for (std::size_t i = 0; i < Size; ++i)
+			{
+				components[i] -= other.components[i];
+			}
+			return *this;
+		}
+
+		constexpr auto operator==(vec const& other) const noexcept -> bool = default;
+	};
+
+	template<typename Type>
+	using vec2 = vec<Type, 2>;
+	template<typename Type>
+	using vec3 = vec<Type, 3>;
+	template<typename Type>
+	using vec4 = vec<Type, 4>;
+
+	template<typename Type, std::size_t Size>
+	constexpr auto operator+(vec<Type, Size> lhs, vec<Type, Size> const& rhs) noexcept
+		-> vec<Type, Size>
+	{
+		return lhs += rhs;
+	}
+
+	template<typename Type, std::size_t Size>
+	constexpr auto operator-(vec<Type, Size> lhs, vec<Type, Size> const& rhs) noexcept
+		-> vec<Type, Size>
+	{
+		return lhs -= rhs;
+	}
+
+	template<typename Type, std::size_t Size>
+	constexpr auto operator-(vec<Type, Size> const& value) noexcept -> vec<Type, Size>
+	{
+		auto result = vec<Type, Size>{};
+		for (std::size_t i = 0; i < Size; ++i)
+		{
+			result[i] = -value[i];
+		}
+		return result;
+	}
+
+	/**
+	 * @brief Scale every component, by a float or by a quantity which then changes the unit of
+	 * the vector, as in `velocity * time_interval`
+	 */
+	template<typename Type, std::size_t Size, scalar Scalar>
+	constexpr auto operator*(vec<Type, Size> const& lhs, Scalar const& rhs) noexcept
+		-> vec<decltype(std::declval<Type>() * rhs), Size>
+	{
+		auto result = vec<decltype(std::declval<Type>() * rhs), Size>{};
+		for (std::size_t i = 0; i < Size; ++i)
+		{
+			result[i] = lhs[i] * rhs;
+		}
+		return result;
+	}
+
+	template<typename Type, std::size_t Size, scalar Scalar>
+	constexpr auto operator*(Scalar const& lhs, vec<Type, Size> const& rhs) noexcept
+		-> vec<decltype(lhs * std::declval<Type>()), Size>
+	{
+		auto result = vec<decltype(lhs * std::declval<Type>()), Size>{};
+		for (std::size_t i = 0; i < Size; ++i)
+		{
+			result[i] = lhs * rhs[i];
+		}
+		return result;
+	}
+
+	template<typename Type, std::size_t Size, scalar Scalar>
+	constexpr auto operator/(vec<Type, Size> const& lhs, Scalar const& rhs) noexcept
+		-> vec<decltype(std::declval<Type>() / rhs), Size>
+	{
+		auto result = vec<decltype(std::declval<Type>() / rhs), Size>{};
+		for (std::size_t i = 0; i < Size; ++i)
+		{
+			result[i] = lhs[i] / rhs;
+		}
+		return result;
+	}
+
+	/**
+	 * @brief The dot product, in the product of the units of both vectors
+	 */
+	template<typename Lhs, typename Rhs, std::size_t Size>
+		requires(Size > 0)
+	constexpr auto dot(vec<Lhs, Size> const& lhs, vec<Rhs, Size> const& rhs) noexcept
+		-> decltype(std::declval<Lhs>() * std::declval<Rhs>())
+	{
+		auto result = lhs[0] * rhs[0];
+		for (std::size_t i = 1; i < Size; ++i)
+		{
+			result += lhs[i] * rhs[i];
+		}
+		return result;
+	}
+
+	/**
+	 * @brief The squared norm. The norm itself is left to the callers, `std::sqrt` is not
+	 * constexpr and most of the engine compares squared distances anyway
+	 */
+	template<typename Type, std::size_t Size>
+	constexpr auto length_squared(vec<Type, Size> const& value) noexcept
+	{
+		return dot(value, value);
+	}
+
+	template<typename Lhs, typename Rhs>
+	constexpr auto cross(vec3<Lhs> const& lhs, vec3<Rhs> const& rhs) noexcept
+		-> vec3<decltype(std::declval<Lhs>() * std::declval<Rhs>())>
+	{
+		return {{lhs[1] * rhs[2] - lhs[2] * rhs[1], lhs[2] * rhs[0] - lhs[0] * rhs[2],
+				 lhs[0] * rhs[1] - lhs[1] * rhs[0]}};
+	}
+
+	/**
+	 * @brief `Width` vectors packed component by component, the layout of a SIMD register: the
+	 * operations work on all the lanes at once and compile to packed instructions. Batches are
+	 * loaded from and stored to the columns of a structure of arrays, such as a particle set
+	 */
+	template<typename Type, std::size_t Size, std::size_t Width>
+	struct vec_batch
+	{
+		using value_type = Type;
+		static constexpr std::size_t dimension = Size;
+		static constexpr std::size_t width = Width;
+
+		std::array<std::array<Type, Width>, Size> lanes; //< `lanes[axis][lane]`
+
+		/**
+		 * @brief Read the `Width` vectors starting at index `first` of the columns
+		 */
+		static constexpr auto load(std::array<std::span<float const>, Size> columns,
+								   std::size_t first) noexcept -> vec_batch
+		{
+			auto result = vec_batch{};
+			for (std::size_t axis = 0; axis < Size; ++axis)
+			{
+				for (std::size_t lane = 0; lane < Width; ++lane)
+				{
+					result.lanes[axis][lane] = Type{columns[axis][first + lane]};
+				}
+			}
+			return result;
+		}
+
+		/**
+		 * @brief Write the vectors to the columns, starting at index `first`
+		 */
+		constexpr void store(std::array<std::span<float>, Size> columns,
+							 std::size_t first) const noexcept
+		{
+			for (std::size_t axis = 0; axis < Size; ++axis)
+			{
+				for (std::size_t lane = 0; lane < Width; ++lane)
+				{
+					columns[axis][first + lane] = get_value(lanes[axis][lane]);
+				}
+			}
+		}
+
+		[[nodiscard]] constexpr auto get(std::size_t lane) const noexcept -> vec<Type, Size>
+		{
+			auto result = vec<Type, Size>{};
+			for (std::size_t axis = 0; axis < Size; ++axis)
+			{
+				result[axis] = lanes[axis][lane];
+			}
+			return result;
+		}
+		constexpr void set(std::size_t lane, vec<Type, Size> const& value) noexcept
+		{
+			for (std::size_t axis = 0; axis < Size; ++axis)
+			{
+				lanes[axis][lane] = value[axis];
+			}
+		}
+
+		constexpr auto operator+=(vec_batch const& other) noexcept -> vec_batch&
+		{
+			for (std::size_t axis = 0; axis < Size; ++axis)
+			{
+				for (std::size_t lane = 0; lane < Width; ++lane)
+				{
+					lanes[axis][lane] += other.lanes[axis][lane];
+				}
+			}
+			return *this;
+		}
+		constexpr auto operator-=(vec_batch const& other) noexcept -> vec_batch&
+		{
+			for (std::size_t axis = 0; axis < Size; ++axis)
+			{
+				for (std::size_t lane = 0; lane < Width; ++lane)
+				{
+					lanes[axis][lane] -= other.lanes[axis][lane];
+				}
+			}
+			return *this;
+		}
+	};
+
+	/**
+	 * @brief A batch of eight three dimensional vectors, an AVX2 register of floats per axis
+	 */
+	template<typename Type, std::size_t Width = 8>
+	using vec3_batch = vec_batch<Type, 3, Width>;
+
+	template<typename Type, std::size_t Size, std::size_t Width>
+	constexpr auto operator+(vec_batch<Type, Size, Width> lhs,
+							 vec_batch<Type, Size, Width> const& rhs) noexcept
+		-> vec_batch<Type, Size, Width>
+	{
+		return lhs += rhs;
+	}
+
+	template<typename Type, std::size_t Size, std::size_t Width>
+	constexpr auto operator-(vec_batch<Type, Size, Width> lhs,
+							 vec_batch<Type, Size, Width> const& rhs) noexcept
+		-> vec_batch<Type, Size, Width>
+	{
+		return lhs -= rhs;
+	}
+
+	/**
+	 * @brief Subtract the same vector from every lane, as when measuring the distances from one
+	 * particle to a batch of its neighbors
+	 */
+	template<typename Type, std::size_t Size, std::size_t Width>
+	constexpr auto operator-(vec_batch<Type, Size, Width> lhs, vec<Type, Size> const& rhs) noexcept
+		-> vec_batch<Type, Size, Width>
+	{
+		for (std::size_t axis = 0; axis < Size; ++axis)
+		{
+			for (std::size_t lane = 0; lane < Width; ++lane)
+			{
+				lhs.lanes[axis][lane] -= rhs[axis];
+			}
+		}
+		return lhs;
+	}
+
+	/**
+	 * @brief Scale every lane by the same float or quantity
+	 */
+	template<typename Type, std::size_t Size, std::size_t Width, scalar Scalar>
+	constexpr auto operator*(vec_batch<Type, Size, Width> const& lhs, Scalar const& rhs) noexcept
+		-> vec_batch<decltype(std::declval<Type>() * rhs), Size, Width>
+	{
+		auto result = vec_batch<decltype(std::declval<Type>() * rhs), Size, Width>{};
+		for (std::size_t axis = 0; axis < Size; ++axis)
+		{
+			for (std::size_t lane = 0; lane < Width; ++lane)
+			{
+				result.lanes[axis][lane] = lhs.lanes[axis][lane] * rhs;
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * @brief The dot products of the lanes of two batches
+	 */
+	template<typename Lhs, typename Rhs, std::size_t Size, std::size_t Width>
+		requires(Size > 0)
+	constexpr auto dot(vec_batch<Lhs, Size, Width> const& lhs,
+					   vec_batch<Rhs, Size, Width> const& rhs) noexcept
+		-> std::array<decltype(std::declval<Lhs>() * std::declval<Rhs>()), Width>
+	{
+		auto result = std::array<decltype(std::declval<Lhs>() * std::declval<Rhs>()), Width>{};
+		for (std::size_t lane = 0; lane < Width; ++lane)
+		{
+			result[lane] = lhs.lanes[0][lane] * rhs.lanes[0][lane];
+		}
+		for (std::size_t axis = 1; axis < Size; ++axis)
+		{
+			for (std::size_t lane = 0; lane < Width; ++lane)
+			{
+				result[lane] += lhs.lanes[axis][lane] * rhs.lanes[axis][lane];
+			}
+		}
+		return result;
+	}
+
+	template<typename Type, std::size_t Size, std::size_t Width>
+	constexpr auto length_squared(vec_batch<Type, Size, Width> const& value) noexcept
+	{
+		return dot(value, value);
+	}
+} // namespace physeng
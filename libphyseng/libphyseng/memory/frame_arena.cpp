@@ -0,0 +1,293 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <libphyseng/memory/frame_arena.hpp>
+#include <libphyseng/util/aligned_allocator.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <charconv>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+
+namespace
+{
+	// Blocks are page aligned, any alignment up to a page is then a matter of rounding offsets
+	constexpr std::size_t block_alignment = 4096;
+
+	struct cached_arena
+	{
+		std::uint64_t owner = 0;
+		physeng::frame_arena* arena = nullptr;
+	};
+
+	// The arena the calling thread used last, saves a lookup in the common case
+	constinit thread_local cached_arena t_cached = {};
+
+	constinit std::atomic<std::uint64_t> g_next_allocator_id = 1;
+	constinit std::atomic<physeng::frame_allocator*> g_default_allocator = nullptr;
+
+	constexpr auto round_up(std::size_t value, std::size_t alignment) noexcept -> std::size_t
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	auto allocate_block(std::size_t size) -> std::byte*
+	{
+		return static_cast<std::byte*>(::operator new(size, std::align_val_t{block_alignment}));
+	}
+
+	void free_block(std::byte* data) noexcept
+	{
+		::operator delete(data, std::align_val_t{block_alignment});
+	}
+} // namespace
+
+namespace physeng
+{
+	frame_arena::frame_arena(std::size_t capacity)
+	{
+		reserve(capacity);
+	}
+
+	frame_arena::~frame_arena()
+	{
+		release_overflow();
+		if (m_block.data != nullptr)
+		{
+			free_block(m_block.data);
+		}
+	}
+
+	auto frame_arena::get_statistics() const noexcept -> statistics const&
+	{
+		return m_statistics;
+	}
+
+	void frame_arena::reserve(std::size_t capacity)
+	{
+		if (capacity <= m_block.size)
+		{
+			return;
+		}
+
+		auto const size = round_up(capacity, block_alignment);
+		auto* const data = allocate_block(size);
+		if (m_block.data != nullptr)
+		{
+			free_block(m_block.data);
+		}
+
+		m_block = {.data = data, .size = size};
+		m_statistics.capacity = size;
+	}
+
+	void frame_arena::reset()
+	{
+		auto const overflowed = !m_overflow.empty();
+
+		release_overflow();
+		m_statistics.used = 0;
+
+		// Whatever the last frames needed fits in a single block from now on
+		if (overflowed)
+		{
+			reserve(m_statistics.high_water_mark);
+		}
+	}
+
+	auto frame_arena::do_allocate(std::size_t bytes, std::size_t alignment) -> void*
+	{
+		assert(alignment <= block_alignment); // NOLINT
+
+		alignment = std::max(alignment, physeng::cache_line_size);
+
+		// `used` is the offset the allocation would have in a block large enough for the whole
+		// frame, which makes the high-water mark the exact size of that block
+		auto const offset = round_up(m_statistics.used, alignment);
+		auto* const ptr = (m_overflow.empty() && offset + bytes <= m_block.size)
+							? static_cast<void*>(m_block.data + offset)
+							: allocate_overflow(bytes, alignment);
+
+		m_statistics.used = offset + bytes;
+		m_statistics.high_water_mark = std::max(m_statistics.high_water_mark, m_statistics.used);
+
+		return ptr;
+	}
+
+	void frame_arena::do_deallocate(void* /*ptr*/, std::size_t /*bytes*/,
+									std::size_t /*alignment*/)
+	{}
+
+	auto frame_arena::do_is_equal(std::pmr::memory_resource const& other) const noexcept -> bool
+	{
+		return this == &other;
+	}
+
+	auto frame_arena::allocate_overflow(std::size_t bytes, std::size_t alignment) -> void*
+	{
+		++m_statistics.overflow_count;
+
+		if (!m_overflow.empty())
+		{
+			auto const& current = m_overflow.back();
+			auto const offset = round_up(m_overflow_offset, alignment);
+			if (offset + bytes <= current.size)
+			{
+				m_overflow_offset = offset + bytes;
+				return current.data + offset;
+			}
+		}
+
+		// Grow geometrically so that a frame much larger than the arena does not end up in
+		// hundreds of blocks
+		auto const previous = m_overflow.empty() ? m_block.size : m_overflow.back().size;
+		auto const size = round_up(std::max(bytes, 2 * previous), block_alignment);
+
+		// Make room first, the block would leak if `push_back` threw
+		m_overflow.reserve(m_overflow.size() + 1);
+		m_overflow.push_back({.data = allocate_block(size), .size = size});
+		m_overflow_offset = bytes;
+
+		return m_overflow.back().data;
+	}
+
+	void frame_arena::release_overflow() noexcept
+	{
+		for (auto const& overflow : m_overflow)
+		{
+			free_block(overflow.data);
+		}
+
+		m_overflow.clear();
+		m_overflow_offset = 0;
+	}
+
+	frame_allocator::frame_allocator(options const& config) :
+		m_id(g_next_allocator_id.fetch_add(1, std::memory_order_relaxed)),
+		m_capacity(config.arena_capacity)
+	{}
+
+	auto frame_allocator::options_from_environment() -> options
+	{
+		auto config = options{};
+
+		auto const* const variable = std::getenv("PHYSENG_FRAME_ARENA_SIZE"); // NOLINT
+		if (variable == nullptr)
+		{
+			return config;
+		}
+
+		auto const size = std::string_view{variable};
+		auto value = std::size_t{0};
+		auto const [ptr, error] = std::from_chars(size.data(), size.data() + size.size(), value);
+
+		if (error == std::errc{} && ptr == size.data() + size.size())
+		{
+			config.arena_capacity = value;
+		}
+		else
+		{
+			fmt::print(stderr, "physeng: ignoring invalid PHYSENG_FRAME_ARENA_SIZE '{}'\n", size);
+		}
+
+		return config;
+	}
+
+	auto frame_allocator::local() -> frame_arena&
+	{
+		if (t_cached.owner == m_id)
+		{
+			return *t_cached.arena;
+		}
+
+		auto const lock = std::scoped_lock{m_mutex};
+
+		auto const id = std::this_thread::get_id();
+		auto it = std::ranges::find(m_arenas, id, [](auto const& entry) { return entry.first; });
+		if (it == std::end(m_arenas))
+		{
+			m_arenas.emplace_back(id, std::make_unique<frame_arena>(m_capacity));
+			it = std::prev(std::end(m_arenas));
+		}
+
+		t_cached = {.owner = m_id, .arena = it->second.get()};
+
+		return *it->second;
+	}
+
+	void frame_allocator::reset()
+	{
+		auto const lock = std::scoped_lock{m_mutex};
+		for (auto& [id, arena] : m_arenas)
+		{
+			arena->reset();
+		}
+	}
+
+	void frame_allocator::reserve(std::size_t capacity)
+	{
+		auto const lock = std::scoped_lock{m_mutex};
+
+		m_capacity = std::max(m_capacity, capacity);
+		for (auto& [id, arena] : m_arenas)
+		{
+			arena->reserve(capacity);
+		}
+	}
+
+	auto frame_allocator::get_statistics() const -> statistics
+	{
+		auto const lock = std::scoped_lock{m_mutex};
+
+		auto result = statistics{.arena_count = m_arenas.size()};
+		for (auto const& [id, arena] : m_arenas)
+		{
+			auto const& stats = arena->get_statistics();
+
+			result.max_high_water_mark = std::max(result.max_high_water_mark,
+												  stats.high_water_mark);
+			result.total_high_water_mark += stats.high_water_mark;
+			result.overflow_count += stats.overflow_count;
+		}
+
+		return result;
+	}
+
+	auto get_default_frame_allocator() noexcept -> frame_allocator*
+	{
+		return g_default_allocator.load(std::memory_order_acquire);
+	}
+
+	void set_default_frame_allocator(frame_allocator* allocator) noexcept
+	{
+		g_default_allocator.store(allocator, std::memory_order_release);
+	}
+
+	auto get_frame_resource() -> std::pmr::memory_resource*
+	{
+		if (auto* const allocator = get_default_frame_allocator())
+		{
+			return &allocator->local();
+		}
+
+		return std::pmr::new_delete_resource();
+	}
+} // namespace physeng
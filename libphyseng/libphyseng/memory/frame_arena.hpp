@@ -0,0 +1,175 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/export.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace physeng
+{
+	/**
+	 * @brief A monotonic memory resource for the scratch memory of a single frame, or solver
+	 * step. Allocating is a pointer bump within one block, deallocating does nothing and `reset`
+	 * hands the whole block back at once
+	 *
+	 * Allocations that do not fit in the block are served by overflow blocks. The next `reset`
+	 * releases them and grows the block to the high-water mark, so that the arena settles on a
+	 * single allocation after the first few frames. Every allocation starts on a cache line
+	 *
+	 * An arena is not thread safe, every thread is meant to use its own through `frame_allocator`
+	 */
+	class LIBPHYSENG_SYMEXPORT frame_arena final : public std::pmr::memory_resource
+	{
+	public:
+		struct statistics
+		{
+			std::size_t capacity = 0;         //< Size of the main block
+			std::size_t used = 0;             //< Bytes handed out since the last reset
+			std::size_t high_water_mark = 0;  //< Most bytes handed out between two resets
+			std::uint64_t overflow_count = 0; //< Allocations that did not fit in the main block
+		};
+
+	public:
+		explicit frame_arena(std::size_t capacity);
+		frame_arena(frame_arena const&) = delete;
+		frame_arena(frame_arena&&) = delete;
+		~frame_arena() override;
+
+		auto operator=(frame_arena const&) -> frame_arena& = delete;
+		auto operator=(frame_arena&&) -> frame_arena& = delete;
+
+		[[nodiscard]] auto get_statistics() const noexcept -> statistics const&;
+
+		/**
+		 * @brief Make sure the main block holds at least `capacity` bytes. Must not be called
+		 * while memory of the arena is in use
+		 */
+		void reserve(std::size_t capacity);
+
+		/**
+		 * @brief End the frame: every allocation made so far becomes invalid
+		 */
+		void reset();
+
+	private:
+		struct block
+		{
+			std::byte* data;
+			std::size_t size;
+		};
+
+		auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override;
+		void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+		[[nodiscard]] auto do_is_equal(std::pmr::memory_resource const& other) const noexcept
+			-> bool override;
+
+		auto allocate_overflow(std::size_t bytes, std::size_t alignment) -> void*;
+		void release_overflow() noexcept;
+
+	private:
+		block m_block = {.data = nullptr, .size = 0};
+		std::size_t m_offset = 0;
+
+		std::vector<block> m_overflow;
+		std::size_t m_overflow_offset = 0;
+
+		statistics m_statistics = {};
+	};
+
+	/**
+	 * @brief One `frame_arena` per thread, created the first time a thread asks for it. The
+	 * arenas are reset together at the end of every frame
+	 */
+	class LIBPHYSENG_SYMEXPORT frame_allocator
+	{
+	public:
+		struct options
+		{
+			std::size_t arena_capacity = std::size_t{1} << 20U; //< Initial size of every arena
+		};
+
+		struct statistics
+		{
+			std::size_t arena_count = 0;
+			std::size_t max_high_water_mark = 0;   //< Largest high-water mark of a single arena
+			std::size_t total_high_water_mark = 0; //< Sum of the high-water marks of the arenas
+			std::uint64_t overflow_count = 0;
+		};
+
+	public:
+		explicit frame_allocator(options const& config);
+		frame_allocator(frame_allocator const&) = delete;
+		frame_allocator(frame_allocator&&) = delete;
+		~frame_allocator() = default;
+
+		auto operator=(frame_allocator const&) -> frame_allocator& = delete;
+		auto operator=(frame_allocator&&) -> frame_allocator& = delete;
+
+		/**
+		 * @brief Read the options from the environment. `PHYSENG_FRAME_ARENA_SIZE` sets the
+		 * initial size of the arenas, in bytes
+		 */
+		[[nodiscard]] static auto options_from_environment() -> options;
+
+		/**
+		 * @brief The arena of the calling thread
+		 */
+		[[nodiscard]] auto local() -> frame_arena&;
+
+		/**
+		 * @brief Reset every arena. No thread may be using memory of the arenas, so this has to be
+		 * called between frames, once the tasks of the frame are done
+		 */
+		void reset();
+
+		/**
+		 * @brief Grow every arena, current and future, to `capacity` bytes. Typically called
+		 * with the high-water mark of a first run
+		 */
+		void reserve(std::size_t capacity);
+
+		[[nodiscard]] auto get_statistics() const -> statistics;
+
+	private:
+		std::uint64_t m_id;
+		std::size_t m_capacity;
+
+		mutable std::mutex m_mutex;
+		std::vector<std::pair<std::thread::id, std::unique_ptr<frame_arena>>> m_arenas;
+	};
+
+	/**
+	 * @brief The frame allocator used for the scratch memory of the library. Like the default
+	 * thread pool it is created by `main`, and may be null
+	 */
+	LIBPHYSENG_SYMEXPORT auto get_default_frame_allocator() noexcept -> frame_allocator*;
+	LIBPHYSENG_SYMEXPORT void set_default_frame_allocator(frame_allocator* allocator) noexcept;
+
+	/**
+	 * @brief The arena of the calling thread in the default frame allocator, or the global heap if
+	 * there is none. Memory obtained here must not be kept past the end of the current frame
+	 */
+	LIBPHYSENG_SYMEXPORT auto get_frame_resource() -> std::pmr::memory_resource*;
+} // namespace physeng
@@ -0,0 +1,73 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/neighbor/spatial_hash.hpp>
+#include <libphyseng/neighbor/uniform_grid.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+
+#include <concepts>
+#include <variant>
+
+namespace physeng
+{
+	/**
+	 * @brief The interface shared by every neighbor search backend
+	 */
+	template<typename Search>
+	concept neighbor_search =
+		requires(Search& search, Search const& const_search, particle_set const& particles,
+				 particle_index i) {
+			search.rebuild(particles);
+			const_search.for_each_neighbor(particles, i, [](particle_index, float) {});
+			{
+				const_search.get_support_radius()
+			} -> std::same_as<support_radius>;
+			{
+				const_search.cell_count()
+			} -> std::convertible_to<std::size_t>;
+		};
+
+	static_assert(neighbor_search<uniform_grid>);
+	static_assert(neighbor_search<spatial_hash>);
+
+	/**
+	 * @brief The neighbor search backends that can be selected at runtime
+	 */
+	enum struct neighbor_backend
+	{
+		uniform_grid, //< Dense grid, fastest when the particles fill their bounding box
+		spatial_hash  //< Compact hashing, memory proportional to the number of particles
+	};
+
+	/**
+	 * @brief Holds one of the neighbor search backends. Hot loops are expected to `std::visit`
+	 * it once and run on the concrete backend rather than dispatching for every particle
+	 */
+	using any_neighbor_search = std::variant<uniform_grid, spatial_hash>;
+
+	inline auto make_neighbor_search(neighbor_backend backend, support_radius radius)
+		-> any_neighbor_search
+	{
+		if (backend == neighbor_backend::spatial_hash)
+		{
+			return any_neighbor_search{std::in_place_type<spatial_hash>, radius};
+		}
+
+		return any_neighbor_search{std::in_place_type<uniform_grid>, radius};
+	}
+} // namespace physeng
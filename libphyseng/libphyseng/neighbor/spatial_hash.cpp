@@ -0,0 +1,124 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <libphyseng/neighbor/spatial_hash.hpp>
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+#include <libphyseng/concurrency/parallel_scan.hpp>
+#include <libphyseng/concurrency/parallel_sort.hpp>
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+
+namespace
+{
+	constexpr std::size_t particle_grain = 4096;
+} // namespace
+
+namespace physeng
+{
+	spatial_hash::spatial_hash(support_radius radius) :
+		m_support_radius(radius.get()), m_inv_cell_size(1.0F / radius.get())
+	{
+		assert(radius.get() > 0.0F); // NOLINT
+	}
+
+	template<precision_policy Precision>
+	void spatial_hash::rebuild(basic_particle_set<Precision> const& particles)
+	{
+		auto const particle_count = particles.size();
+
+		assert(particle_count < std::numeric_limits<std::uint32_t>::max()); // NOLINT
+
+		auto const x = particles.position(0);
+		auto const y = particles.position(1);
+		auto const z = particles.position(2);
+
+		m_entries.resize(particle_count);
+		m_sorted.resize(particle_count);
+		m_scratch.resize(particle_count);
+
+		parallel_for(particle_count, particle_grain, [&](std::size_t first, std::size_t last) {
+			for (auto i = first; i < last; ++i)
+			{
+				m_entries[i] = {.key = make_key(to_cell(x[i]), to_cell(y[i]), to_cell(z[i])),
+								.handle = static_cast<particle_index>(i)};
+			}
+		});
+
+		parallel_sort(std::span{m_entries});
+
+		// Flag the first particle of every occupied cell, the scan then gives the index of each
+		// cell in the compact list
+		parallel_for(particle_count, particle_grain, [&](std::size_t first, std::size_t last) {
+			for (auto k = first; k < last; ++k)
+			{
+				m_sorted[k] = m_entries[k].handle;
+				m_scratch[k] = (k == 0 || m_entries[k].key != m_entries[k - 1].key) ? 1U : 0U;
+			}
+		});
+
+		auto const cell_count = parallel_exclusive_scan(std::span{m_scratch});
+
+		m_cell_key.resize(cell_count);
+		m_cell_start.resize(cell_count + 1);
+		m_cell_start.back() = static_cast<std::uint32_t>(particle_count);
+
+		parallel_for(particle_count, particle_grain, [&](std::size_t first, std::size_t last) {
+			for (auto k = first; k < last; ++k)
+			{
+				if (k == 0 || m_entries[k].key != m_entries[k - 1].key)
+				{
+					m_cell_key[m_scratch[k]] = m_entries[k].key;
+					m_cell_start[m_scratch[k]] = static_cast<std::uint32_t>(k);
+				}
+			}
+		});
+
+		// Keep the load factor of the table at or below one half
+		m_table.assign(std::bit_ceil(std::max<std::size_t>(2 * cell_count, 2)), empty_slot);
+
+		auto const mask = m_table.size() - 1;
+		parallel_for(cell_count, particle_grain, [&](std::size_t first, std::size_t last) {
+			for (auto cell = first; cell < last; ++cell)
+			{
+				for (auto slot = hash(m_cell_key[cell]) & mask;; slot = (slot + 1) & mask)
+				{
+					auto expected = empty_slot;
+					if (std::atomic_ref{m_table[slot]}.compare_exchange_strong(
+							expected, static_cast<std::uint32_t>(cell), std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+			}
+		});
+	}
+
+	template void spatial_hash::rebuild(particle_set const& particles);
+	template void spatial_hash::rebuild(compact_particle_set const& particles);
+
+	auto spatial_hash::get_support_radius() const noexcept -> support_radius
+	{
+		return support_radius{m_support_radius};
+	}
+
+	auto spatial_hash::cell_count() const noexcept -> std::size_t
+	{
+		return m_cell_key.size();
+	}
+} // namespace physeng
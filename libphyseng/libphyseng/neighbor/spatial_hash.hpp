@@ -0,0 +1,195 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/export.hpp>
+#include <libphyseng/kernels/smoothing_length.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+#include <libphyseng/util/aligned_allocator.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace physeng
+{
+	/**
+	 * @brief A neighbor search for unbounded and sparse domains. Only the cells that contain at
+	 * least one particle are stored, so memory grows with the number of particles rather than with
+	 * the volume of the domain
+	 *
+	 * The occupied cells are kept in a compact list sorted by cell key, each of them referring to a
+	 * range of particle handles sorted the same way. An open addressing hash table maps a cell key
+	 * to its index in that list.
+	 *
+	 * Cell coordinates are limited to 21 bits per axis, which means particles must stay within
+	 * about a million cells of the origin
+	 */
+	class LIBPHYSENG_SYMEXPORT spatial_hash
+	{
+	public:
+		using cell_key = std::uint64_t;
+
+	public:
+		explicit spatial_hash(support_radius radius);
+
+		/**
+		 * @brief Bin every particle of `particles` into the hash table. Must be called every time
+		 * the particles move before iterating over neighbors
+		 */
+		template<precision_policy Precision>
+		void rebuild(basic_particle_set<Precision> const& particles);
+
+		/**
+		 * @brief Call `fn(j, distance_squared)` for every particle `j` closer than the support
+		 * radius to the particle `i`, including `i` itself
+		 *
+		 * @tparam Dimension The dimension of the simulation: 27 cells are looked up in three
+		 * dimensions, the 9 of the layer of the particle in two
+		 *
+		 * @param[in] particles The particle set the table was last rebuilt with
+		 * @param[in] i The particle for which the neighbors are looked up
+		 */
+		template<std::size_t Dimension = particle_set::dimension, precision_policy Precision,
+				 typename Fn>
+			requires spatial_dimension<Dimension>
+		void for_each_neighbor(basic_particle_set<Precision> const& particles, particle_index i,
+							   Fn&& fn) const
+		{
+			auto const x = particles.position(0);
+			auto const y = particles.position(1);
+			auto const z = particles.position(2);
+
+			auto const radius_squared = m_support_radius * m_support_radius;
+			auto const cx = to_cell(x[i]);
+			auto const cy = to_cell(y[i]);
+			auto const cz = to_cell(z[i]);
+
+			constexpr std::int32_t z_reach = Dimension == 3 ? 1 : 0;
+
+			for (std::int32_t dz = -z_reach; dz <= z_reach; ++dz)
+			{
+				for (std::int32_t dy = -1; dy <= 1; ++dy)
+				{
+					for (std::int32_t dx = -1; dx <= 1; ++dx)
+					{
+						auto const cell = find_cell(make_key(cx + dx, cy + dy, cz + dz));
+						if (cell == empty_slot)
+						{
+							continue;
+						}
+
+						for (auto k = m_cell_start[cell]; k < m_cell_start[cell + 1]; ++k)
+						{
+							auto const j = m_sorted[k];
+
+							auto const rx = x[i] - x[j];
+							auto const ry = y[i] - y[j];
+							auto distance_squared = rx * rx + ry * ry;
+							if constexpr (Dimension == 3)
+							{
+								auto const rz = z[i] - z[j];
+								distance_squared += rz * rz;
+							}
+
+							if (distance_squared < radius_squared)
+							{
+								fn(j, distance_squared);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		[[nodiscard]] auto get_support_radius() const noexcept -> support_radius;
+		/**
+		 * @brief The number of cells holding at least one particle
+		 */
+		[[nodiscard]] auto cell_count() const noexcept -> std::size_t;
+
+	private:
+		static constexpr std::uint32_t empty_slot = std::numeric_limits<std::uint32_t>::max();
+		static constexpr std::int32_t coordinate_bias = 1 << 20;
+		static constexpr std::uint64_t coordinate_mask = (std::uint64_t{1} << 21U) - 1;
+
+		[[nodiscard]] auto to_cell(float value) const noexcept -> std::int32_t
+		{
+			return static_cast<std::int32_t>(std::floor(value * m_inv_cell_size));
+		}
+
+		[[nodiscard]] static constexpr auto make_key(std::int32_t x, std::int32_t y,
+													 std::int32_t z) noexcept -> cell_key
+		{
+			auto const pack = [](std::int32_t value) {
+				return static_cast<std::uint64_t>(value + coordinate_bias) & coordinate_mask;
+			};
+
+			return (pack(z) << 42U) | (pack(y) << 21U) | pack(x);
+		}
+
+		[[nodiscard]] static constexpr auto hash(cell_key key) noexcept -> std::uint64_t
+		{
+			// Finalizer of splitmix64, spreads neighboring keys over the whole table
+			key = (key ^ (key >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+			key = (key ^ (key >> 27U)) * 0x94d049bb133111ebULL;
+			return key ^ (key >> 31U);
+		}
+
+		[[nodiscard]] auto find_cell(cell_key key) const noexcept -> std::uint32_t
+		{
+			auto const mask = m_table.size() - 1;
+
+			for (auto slot = hash(key) & mask;; slot = (slot + 1) & mask)
+			{
+				auto const cell = m_table[slot];
+				if (cell == empty_slot || m_cell_key[cell] == key)
+				{
+					return cell;
+				}
+			}
+		}
+
+	private:
+		struct entry
+		{
+			cell_key key;
+			particle_index handle;
+
+			constexpr auto operator<=>(entry const& other) const noexcept = default;
+		};
+
+	private:
+		float m_support_radius;
+		float m_inv_cell_size;
+
+		// (cell key, handle) pair of every particle, sorted during a rebuild
+		aligned_vector<entry> m_entries = {};
+		aligned_vector<std::uint32_t> m_scratch = {};
+		// Particle handles sorted by cell key
+		aligned_vector<particle_index> m_sorted = {};
+
+		// Compact list of the occupied cells, sorted by key. m_cell_start has one past the end
+		// entry
+		aligned_vector<cell_key> m_cell_key = {};
+		aligned_vector<std::uint32_t> m_cell_start = {};
+
+		// Open addressing table with linear probing mapping a cell key to its index in the list
+		aligned_vector<std::uint32_t> m_table = {};
+	};
+} // namespace physeng
@@ -0,0 +1,212 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <libphyseng/neighbor/uniform_grid.hpp>
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+#include <libphyseng/concurrency/parallel_reduce.hpp>
+#include <libphyseng/concurrency/parallel_scan.hpp>
+
+#include <fmt/core.h>
+
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+	constexpr std::size_t particle_grain = 4096;
+	constexpr std::size_t cell_grain = 16384;
+
+	// The start and the cursor of every cell
+	constexpr std::size_t bytes_per_cell = 2 * sizeof(std::uint32_t);
+
+	struct bounds
+	{
+		std::array<float, physeng::particle_set::dimension> min;
+		std::array<float, physeng::particle_set::dimension> max;
+		bool is_finite = true;
+	};
+
+	template<physeng::precision_policy Precision>
+	auto compute_bounds(physeng::basic_particle_set<Precision> const& particles) -> bounds
+	{
+		auto const reduce_block = [&](std::size_t begin, std::size_t end) {
+			auto result = bounds{};
+			for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+			{
+				auto const values = particles.position(axis).subspan(begin, end - begin);
+				auto const [min, max] = std::ranges::minmax_element(values);
+
+				result.min[axis] = *min;
+				result.max[axis] = *max;
+
+				// A NaN compares false with everything and would not show up in the bounds
+				result.is_finite = result.is_finite
+								&& std::ranges::all_of(values, [](float value) {
+									   return std::isfinite(value);
+								   });
+			}
+
+			return result;
+		};
+
+		auto const combine = [](bounds const& lhs, bounds const& rhs) {
+			auto result = lhs;
+			for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+			{
+				result.min[axis] = std::min(lhs.min[axis], rhs.min[axis]);
+				result.max[axis] = std::max(lhs.max[axis], rhs.max[axis]);
+			}
+
+			result.is_finite = lhs.is_finite && rhs.is_finite;
+
+			return result;
+		};
+
+		return physeng::parallel_reduce(particles.size(), bounds{}, reduce_block, combine);
+	}
+} // namespace
+
+namespace physeng
+{
+	uniform_grid::uniform_grid(support_radius radius, std::size_t max_cell_memory) :
+		m_support_radius(radius.get()), m_inv_cell_size(1.0F / radius.get()),
+		m_max_cell_count(std::min<std::size_t>(max_cell_memory / bytes_per_cell,
+											   std::numeric_limits<std::int32_t>::max()))
+	{
+		assert(radius.get() > 0.0F); // NOLINT
+	}
+
+	template<precision_policy Precision>
+	void uniform_grid::rebuild(basic_particle_set<Precision> const& particles)
+	{
+		auto const particle_count = particles.size();
+
+		m_sorted.resize(particle_count);
+		m_particle_cell.resize(particle_count);
+
+		if (particle_count == 0)
+		{
+			m_extent = {1, 1, 1};
+			m_cell_start.assign(2, 0);
+			return;
+		}
+
+		assert(particle_count <= std::numeric_limits<std::uint32_t>::max()); // NOLINT
+
+		auto const box = compute_bounds(particles);
+		if (!box.is_finite)
+		{
+			throw std::domain_error("uniform_grid: the positions of the particles are not finite");
+		}
+
+		// In double precision, the extents of a stray particle overflow the 32 bit cell indices
+		auto extent = std::array<double, particle_set::dimension>{};
+		auto total = 1.0;
+		for (std::size_t axis = 0; axis < particle_set::dimension; ++axis)
+		{
+			auto const width = double{box.max[axis]} - double{box.min[axis]};
+			extent[axis] = std::floor(width * double{m_inv_cell_size}) + 1.0;
+			total *= extent[axis];
+		}
+
+		if (total > static_cast<double>(m_max_cell_count))
+		{
+			throw std::length_error(fmt::format(
+				"uniform_grid: the particles span {:.0f} x {:.0f} x {:.0f} cells, more than the "
+				"limit of {}. Use a spatial_hash for sparse domains",
+				extent[0], extent[1], extent[2], m_max_cell_count));
+		}
+
+		for (std::size_t axis = 0; axis < particle_set::dimension; ++axis)
+		{
+			m_origin[axis] = box.min[axis];
+			m_extent[axis] = static_cast<std::int32_t>(extent[axis]);
+		}
+
+		auto const cells = cell_count();
+
+		// Counting pass: m_cell_start holds the number of particles of every cell
+		m_cell_start.assign(cells + 1, 0);
+
+		auto const x = particles.position(0);
+		auto const y = particles.position(1);
+		auto const z = particles.position(2);
+
+		parallel_for(particle_count, particle_grain, [&](std::size_t first, std::size_t last) {
+			for (auto i = first; i < last; ++i)
+			{
+				auto const cell =
+					static_cast<std::uint32_t>(linear_index(to_cell(x[i], y[i], z[i])));
+
+				m_particle_cell[i] = cell;
+				std::atomic_ref{m_cell_start[cell]}.fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+
+		parallel_exclusive_scan(std::span{m_cell_start});
+
+		// Scatter pass: every particle claims a slot within the range of its cell
+		m_cursor.assign(std::begin(m_cell_start), std::end(m_cell_start));
+
+		parallel_for(particle_count, particle_grain, [&](std::size_t first, std::size_t last) {
+			for (auto i = first; i < last; ++i)
+			{
+				auto const slot = std::atomic_ref{m_cursor[m_particle_cell[i]]}.fetch_add(
+					1, std::memory_order_relaxed);
+
+				m_sorted[slot] = static_cast<particle_index>(i);
+			}
+		});
+
+		// The slots are claimed in an arbitrary order, sort the (small) cells to get rid of it
+		parallel_for(cells, cell_grain, [&](std::size_t first, std::size_t last) {
+			for (auto cell = first; cell < last; ++cell)
+			{
+				auto const begin = std::begin(m_sorted) + m_cell_start[cell];
+				auto const end = std::begin(m_sorted) + m_cell_start[cell + 1];
+
+				if (end - begin > 1)
+				{
+					std::sort(begin, end);
+				}
+			}
+		});
+	}
+
+	template void uniform_grid::rebuild(particle_set const& particles);
+	template void uniform_grid::rebuild(compact_particle_set const& particles);
+
+	auto uniform_grid::get_support_radius() const noexcept -> support_radius
+	{
+		return support_radius{m_support_radius};
+	}
+
+	auto uniform_grid::get_max_cell_count() const noexcept -> std::size_t
+	{
+		return m_max_cell_count;
+	}
+
+	auto uniform_grid::cell_count() const noexcept -> std::size_t
+	{
+		return static_cast<std::size_t>(m_extent[0]) * static_cast<std::size_t>(m_extent[1])
+			 * static_cast<std::size_t>(m_extent[2]);
+	}
+} // namespace physeng
@@ -0,0 +1,182 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/export.hpp>
+#include <libphyseng/kernels/smoothing_length.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+#include <libphyseng/util/aligned_allocator.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace physeng
+{
+	/**
+	 * @brief A neighbor search based on a dense uniform grid covering the bounding box of the
+	 * particles (a cell linked list). The cells are as wide as the support radius so that every
+	 * neighbor of a particle is found in the 27 cells surrounding it, or the 9 of its layer in two
+	 * dimensions
+	 *
+	 * The particles are binned into the cells through a parallel counting sort. Within a cell,
+	 * particles are kept in increasing index order so that the neighbor iteration order does not
+	 * depend on thread scheduling
+	 *
+	 * The memory of the grid grows with the volume of the bounding box, not with the number of
+	 * particles. A box too large for the memory limit of the grid is rejected, `spatial_hash`
+	 * is the backend for such sparse domains
+	 */
+	class LIBPHYSENG_SYMEXPORT uniform_grid
+	{
+	public:
+		using cell_coordinates = std::array<std::int32_t, particle_set::dimension>;
+
+		/**
+		 * @brief The default limit on the memory of the cells, 8 bytes per cell
+		 */
+		static constexpr std::size_t default_max_cell_memory = std::size_t{1} << 30U;
+
+	public:
+		/**
+		 * @param[in] radius The support radius, which is also the width of the cells
+		 * @param[in] max_cell_memory The most memory the cells of the grid may take, in bytes
+		 */
+		explicit uniform_grid(support_radius radius,
+							  std::size_t max_cell_memory = default_max_cell_memory);
+
+		/**
+		 * @brief Bin every particle of `particles` into the grid. Must be called every time the
+		 * particles move before iterating over neighbors
+		 *
+		 * @throw std::domain_error If a position is not finite
+		 * @throw std::length_error If the bounding box of the particles needs more cells than
+		 * `get_max_cell_count()`
+		 */
+		template<precision_policy Precision>
+		void rebuild(basic_particle_set<Precision> const& particles);
+
+		/**
+		 * @brief Call `fn(j, distance_squared)` for every particle `j` closer than the support
+		 * radius to the particle `i`, including `i` itself
+		 *
+		 * @tparam Dimension The dimension of the simulation. In two dimensions only the layer of
+		 * cells of the particle is visited and the z axis is left out of the distances
+		 *
+		 * @param[in] particles The particle set the grid was last rebuilt with
+		 * @param[in] i The particle for which the neighbors are looked up
+		 */
+		template<std::size_t Dimension = particle_set::dimension, precision_policy Precision,
+				 typename Fn>
+			requires spatial_dimension<Dimension>
+		void for_each_neighbor(basic_particle_set<Precision> const& particles, particle_index i,
+							   Fn&& fn) const
+		{
+			auto const x = particles.position(0);
+			auto const y = particles.position(1);
+			auto const z = particles.position(2);
+
+			auto const radius_squared = m_support_radius * m_support_radius;
+			auto const cell = to_cell(x[i], y[i], z[i]);
+
+			// The three cells along the x axis are contiguous in memory which means the particles
+			// they contain form a single range of the sorted indices
+			auto const x_first = std::max(cell[0] - 1, 0);
+			auto const x_last = std::min(cell[0] + 1, m_extent[0] - 1);
+
+			constexpr std::int32_t z_reach = Dimension == 3 ? 1 : 0;
+			auto const z_first = std::max(cell[2] - z_reach, 0);
+			auto const z_last = std::min(cell[2] + z_reach, m_extent[2] - 1);
+
+			for (auto cz = z_first; cz <= z_last; ++cz)
+			{
+				for (auto cy = std::max(cell[1] - 1, 0);
+					 cy <= std::min(cell[1] + 1, m_extent[1] - 1); ++cy)
+				{
+					auto const begin = m_cell_start[linear_index({x_first, cy, cz})];
+					auto const end = m_cell_start[linear_index({x_last, cy, cz}) + 1];
+
+					for (auto k = begin; k < end; ++k)
+					{
+						auto const j = m_sorted[k];
+
+						auto const dx = x[i] - x[j];
+						auto const dy = y[i] - y[j];
+						auto distance_squared = dx * dx + dy * dy;
+						if constexpr (Dimension == 3)
+						{
+							auto const dz = z[i] - z[j];
+							distance_squared += dz * dz;
+						}
+
+						if (distance_squared < radius_squared)
+						{
+							fn(j, distance_squared);
+						}
+					}
+				}
+			}
+		}
+
+		[[nodiscard]] auto get_support_radius() const noexcept -> support_radius;
+		[[nodiscard]] auto cell_count() const noexcept -> std::size_t;
+		/**
+		 * @brief The most cells a rebuild may use, from the memory limit and the 32 bit cell
+		 * indices
+		 */
+		[[nodiscard]] auto get_max_cell_count() const noexcept -> std::size_t;
+
+	private:
+		[[nodiscard]] auto to_cell(float x, float y, float z) const noexcept -> cell_coordinates
+		{
+			// Clamped before the conversion, which is undefined for values out of range. The
+			// order of the arguments sends a NaN to the last cell
+			auto const clamp_axis = [&](float value, std::size_t axis) {
+				auto const offset = std::floor((value - m_origin[axis]) * m_inv_cell_size);
+				auto const last = static_cast<float>(m_extent[axis] - 1);
+				return static_cast<std::int32_t>(std::max(0.0F, std::min(last, offset)));
+			};
+
+			return {clamp_axis(x, 0), clamp_axis(y, 1), clamp_axis(z, 2)};
+		}
+
+		[[nodiscard]] auto linear_index(cell_coordinates cell) const noexcept -> std::size_t
+		{
+			return (static_cast<std::size_t>(cell[2]) * static_cast<std::size_t>(m_extent[1])
+					+ static_cast<std::size_t>(cell[1]))
+					 * static_cast<std::size_t>(m_extent[0])
+				 + static_cast<std::size_t>(cell[0]);
+		}
+
+	private:
+		float m_support_radius;
+		float m_inv_cell_size;
+		std::size_t m_max_cell_count;
+
+		std::array<float, particle_set::dimension> m_origin = {};
+		cell_coordinates m_extent = {};
+
+		// Index of the first sorted particle of every cell, with one past the end entry
+		aligned_vector<std::uint32_t> m_cell_start = {};
+		// Particle indices sorted by cell
+		aligned_vector<particle_index> m_sorted = {};
+
+		aligned_vector<std::uint32_t> m_particle_cell = {};
+		aligned_vector<std::uint32_t> m_cursor = {};
+	};
+} // namespace physeng
@@ -0,0 +1,130 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <libphyseng/neighbor/verlet_list.hpp>
+
+#include <libphyseng/concurrency/parallel_reduce.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	using reference_positions =
+		std::array<physeng::aligned_vector<float>, physeng::particle_set::dimension>;
+
+	template<physeng::precision_policy Precision>
+	auto max_displacement_squared(physeng::basic_particle_set<Precision> const& particles,
+								  reference_positions const& reference) -> float
+	{
+		auto const displacement_squared = [&](std::size_t i) {
+			auto result = 0.0F;
+			for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+			{
+				auto const delta = particles.position(axis)[i] - reference[axis][i];
+				result += delta * delta;
+			}
+
+			return result;
+		};
+
+		return physeng::parallel_transform_reduce(particles.size(), 0.0F, displacement_squared,
+												  [](float lhs, float rhs) {
+													  return std::max(lhs, rhs);
+												  });
+	}
+} // namespace
+
+namespace physeng
+{
+	verlet_list::verlet_list(support_radius radius, float skin) :
+		m_support_radius(radius.get()), m_skin(skin)
+	{
+		assert(radius.get() > 0.0F); // NOLINT
+		assert(skin >= 0.0F);          // NOLINT
+	}
+
+	auto verlet_list::get_search_radius() const noexcept -> support_radius
+	{
+		return support_radius{m_support_radius + m_skin};
+	}
+	auto verlet_list::get_support_radius() const noexcept -> support_radius
+	{
+		return support_radius{m_support_radius};
+	}
+	auto verlet_list::get_skin() const noexcept -> float
+	{
+		return m_skin;
+	}
+	auto verlet_list::get_statistics() const noexcept -> statistics const&
+	{
+		return m_statistics;
+	}
+
+	auto verlet_list::get_memory_usage() const noexcept -> std::size_t
+	{
+		auto bytes = m_offsets.capacity() * sizeof(std::uint64_t)
+				   + m_neighbors.capacity() * sizeof(particle_index);
+		for (auto const& column : m_reference)
+		{
+			bytes += column.capacity() * sizeof(float);
+		}
+
+		return bytes;
+	}
+
+	void verlet_list::invalidate() noexcept
+	{
+		m_is_valid = false;
+	}
+
+	template<precision_policy Precision>
+	auto verlet_list::needs_rebuild(basic_particle_set<Precision> const& particles) -> bool
+	{
+		if (!m_is_valid || particles.size() != m_particle_count)
+		{
+			m_statistics.max_displacement = 0.0F;
+			return true;
+		}
+
+		if (particles.empty())
+		{
+			return false;
+		}
+
+		m_statistics.max_displacement = std::sqrt(max_displacement_squared(particles, m_reference));
+
+		// Two particles moving towards each other close the gap by twice the displacement
+		return 2.0F * m_statistics.max_displacement > m_skin;
+	}
+
+	template<precision_policy Precision>
+	void verlet_list::store_reference_positions(basic_particle_set<Precision> const& particles)
+	{
+		for (std::size_t axis = 0; axis < particle_set::dimension; ++axis)
+		{
+			auto const position = particles.position(axis);
+			m_reference[axis].assign(std::begin(position), std::end(position));
+		}
+
+		m_is_valid = true;
+	}
+
+	template auto verlet_list::needs_rebuild(particle_set const& particles) -> bool;
+	template auto verlet_list::needs_rebuild(compact_particle_set const& particles) -> bool;
+	template void verlet_list::store_reference_positions(particle_set const& particles);
+	template void verlet_list::store_reference_positions(compact_particle_set const& particles);
+} // namespace physeng
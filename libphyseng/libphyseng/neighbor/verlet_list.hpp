@@ -0,0 +1,214 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+#include <libphyseng/concurrency/parallel_scan.hpp>
+#include <libphyseng/export.hpp>
+#include <libphyseng/neighbor/neighbor_search.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+#include <libphyseng/util/aligned_allocator.hpp>
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <span>
+
+namespace physeng
+{
+	/**
+	 * @brief Caches the neighbors of every particle within the support radius enlarged by a skin
+	 * distance. As long as no particle moved by more than half of the skin since the last build,
+	 * every pair closer than the support radius is guaranteed to be in the list and the neighbor
+	 * search does not need to run again
+	 *
+	 * The lists are stored in compressed sparse row form: the offsets of every particle into one
+	 * array of neighbor indices. The offsets are 64 bits wide, large sets hold more than 2^32
+	 * candidate pairs
+	 */
+	class LIBPHYSENG_SYMEXPORT verlet_list
+	{
+	public:
+		struct statistics
+		{
+			std::uint64_t update_count = 0;  //< Number of calls to `update`
+			std::uint64_t rebuild_count = 0; //< Number of updates that rebuilt the lists
+			float max_displacement = 0.0F;   //< Largest displacement found by the last update
+		};
+
+	public:
+		verlet_list(support_radius radius, float skin);
+
+		/**
+		 * @brief The radius the neighbor search given to `update` has to be built with
+		 */
+		[[nodiscard]] auto get_search_radius() const noexcept -> support_radius;
+		[[nodiscard]] auto get_support_radius() const noexcept -> support_radius;
+		[[nodiscard]] auto get_skin() const noexcept -> float;
+		[[nodiscard]] auto get_statistics() const noexcept -> statistics const&;
+		/**
+		 * @brief The bytes reserved by the lists and the reference positions
+		 */
+		[[nodiscard]] auto get_memory_usage() const noexcept -> std::size_t;
+
+		/**
+		 * @brief Force the next call to `update` to rebuild the lists, for instance after the
+		 * particles have been reordered
+		 */
+		void invalidate() noexcept;
+
+		/**
+		 * @brief Rebuild the lists from `search` if a particle moved by more than half of the skin
+		 * since the last build
+		 *
+		 * @tparam Dimension The dimension of the simulation, see `uniform_grid::for_each_neighbor`
+		 *
+		 * @param[in] search A neighbor search built with a radius of at least
+		 * `get_search_radius()`. It is only rebuilt when the lists are
+		 * @param[in] particles The current state of the particles
+		 *
+		 * @return Whether the lists were rebuilt
+		 */
+		template<std::size_t Dimension = particle_set::dimension, neighbor_search Search,
+				 precision_policy Precision>
+			requires spatial_dimension<Dimension>
+		auto update(Search& search, basic_particle_set<Precision> const& particles) -> bool
+		{
+			assert(search.get_support_radius().get() >= get_search_radius().get()); // NOLINT
+
+			++m_statistics.update_count;
+
+			if (!needs_rebuild(particles))
+			{
+				return false;
+			}
+
+			search.rebuild(particles);
+			build(particles.size(), [&](particle_index i, auto&& emit) {
+				search.template for_each_neighbor<Dimension>(
+					particles, i, [&](particle_index j, float /*r2*/) { emit(j); });
+			});
+			store_reference_positions(particles);
+
+			++m_statistics.rebuild_count;
+
+			return true;
+		}
+
+		/**
+		 * @brief The cached neighbor candidates of the particle `i`
+		 */
+		[[nodiscard]] auto candidates(particle_index i) const noexcept
+			-> std::span<particle_index const>
+		{
+			auto const first = m_offsets[i];
+			auto const last = m_offsets[i + 1];
+
+			return std::span{m_neighbors}.subspan(first, last - first);
+		}
+
+		/**
+		 * @brief Call `fn(j, distance_squared)` for every particle `j` currently closer than the
+		 * support radius to the particle `i`, including `i` itself
+		 */
+		template<std::size_t Dimension = particle_set::dimension, precision_policy Precision,
+				 typename Fn>
+			requires spatial_dimension<Dimension>
+		void for_each_neighbor(basic_particle_set<Precision> const& particles, particle_index i,
+							   Fn&& fn) const
+		{
+			auto const x = particles.position(0);
+			auto const y = particles.position(1);
+			auto const z = particles.position(2);
+
+			auto const radius_squared = m_support_radius * m_support_radius;
+
+			for (auto const j : candidates(i))
+			{
+				auto const dx = x[i] - x[j];
+				auto const dy = y[i] - y[j];
+				auto distance_squared = dx * dx + dy * dy;
+				if constexpr (Dimension == 3)
+				{
+					auto const dz = z[i] - z[j];
+					distance_squared += dz * dz;
+				}
+
+				if (distance_squared < radius_squared)
+				{
+					fn(j, distance_squared);
+				}
+			}
+		}
+
+	private:
+		template<precision_policy Precision>
+		auto needs_rebuild(basic_particle_set<Precision> const& particles) -> bool;
+		template<precision_policy Precision>
+		void store_reference_positions(basic_particle_set<Precision> const& particles);
+
+		/**
+		 * @brief Fill the lists from `gather(i, emit)`, which must call `emit(j)` for every
+		 * candidate `j` of the particle `i`, in the same order every time it is called
+		 */
+		template<typename Gather>
+		void build(std::size_t particle_count, Gather&& gather)
+		{
+			static constexpr std::size_t grain = 1024;
+
+			m_particle_count = particle_count;
+			m_offsets.assign(particle_count + 1, 0);
+
+			// Counting pass, the offsets then come from a scan of the counts
+			parallel_for(particle_count, grain, [&](std::size_t first, std::size_t last) {
+				for (auto i = first; i < last; ++i)
+				{
+					auto count = std::uint64_t{0};
+					gather(static_cast<particle_index>(i), [&](particle_index) { ++count; });
+					m_offsets[i] = count;
+				}
+			});
+
+			auto const total = parallel_exclusive_scan(std::span{m_offsets});
+			m_neighbors.resize(total);
+
+			parallel_for(particle_count, grain, [&](std::size_t first, std::size_t last) {
+				for (auto i = first; i < last; ++i)
+				{
+					auto slot = m_offsets[i];
+					gather(static_cast<particle_index>(i),
+						   [&](particle_index j) { m_neighbors[slot++] = j; });
+				}
+			});
+		}
+
+	private:
+		float m_support_radius;
+		float m_skin;
+
+		std::size_t m_particle_count = 0;
+		bool m_is_valid = false;
+
+		// The offsets of the lists into `m_neighbors`, with one past the end entry
+		aligned_vector<std::uint64_t> m_offsets = {0};
+		aligned_vector<particle_index> m_neighbors;
+		// Positions of the particles when the lists were last built
+		std::array<aligned_vector<float>, particle_set::dimension> m_reference = {};
+
+		statistics m_statistics = {};
+	};
+} // namespace physeng
@@ -0,0 +1,201 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <libphyseng/particles/morton_order.hpp>
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+#include <libphyseng/concurrency/parallel_reduce.hpp>
+#include <libphyseng/concurrency/parallel_sort.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <span>
+
+namespace
+{
+	constexpr std::size_t particle_grain = 4096;
+	constexpr std::uint32_t max_coordinate = (1U << 21U) - 1;
+
+	struct lower_corner
+	{
+		std::array<float, physeng::particle_set::dimension> min;
+	};
+
+	template<physeng::precision_policy Precision>
+	auto compute_lower_corner(physeng::basic_particle_set<Precision> const& particles)
+		-> lower_corner
+	{
+		static constexpr auto infinity = std::numeric_limits<float>::infinity();
+
+		auto const identity = lower_corner{{infinity, infinity, infinity}};
+
+		auto const reduce_block = [&](std::size_t begin, std::size_t end) {
+			auto result = identity;
+			for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+			{
+				result.min[axis] =
+					std::ranges::min(particles.position(axis).subspan(begin, end - begin));
+			}
+
+			return result;
+		};
+
+		auto const combine = [](lower_corner const& lhs, lower_corner const& rhs) {
+			auto result = lhs;
+			for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+			{
+				result.min[axis] = std::min(lhs.min[axis], rhs.min[axis]);
+			}
+
+			return result;
+		};
+
+		return physeng::parallel_reduce(particles.size(), identity, reduce_block, combine);
+	}
+} // namespace
+
+namespace physeng
+{
+	morton_reorder::morton_reorder(float cell_size, std::uint64_t interval, float degradation) :
+		m_inv_cell_size(1.0F / cell_size), m_interval(interval), m_degradation(degradation)
+	{
+		assert(cell_size > 0.0F);    // NOLINT
+		assert(degradation >= 0.0F); // NOLINT
+	}
+
+	auto morton_reorder::get_statistics() const noexcept -> statistics const&
+	{
+		return m_statistics;
+	}
+	auto morton_reorder::is_enabled() const noexcept -> bool
+	{
+		return m_interval != 0 || m_degradation > 0.0F;
+	}
+
+	template<precision_policy Precision>
+	auto morton_reorder::update(basic_particle_set<Precision>& particles) -> bool
+	{
+		++m_statistics.update_count;
+		++m_updates_since_reorder;
+
+		auto is_due = m_interval != 0 && m_updates_since_reorder >= m_interval;
+
+		if (!is_due && m_degradation > 0.0F)
+		{
+			m_statistics.locality = measure_locality(particles);
+			is_due = !m_has_reference
+				  || m_statistics.locality > m_degradation * m_statistics.reference_locality;
+		}
+
+		if (!is_due)
+		{
+			return false;
+		}
+
+		reorder(particles);
+
+		return true;
+	}
+
+	template<precision_policy Precision>
+	void morton_reorder::reorder(basic_particle_set<Precision>& particles)
+	{
+		auto const particle_count = particles.size();
+
+		m_entries.resize(particle_count);
+		m_permutation.resize(particle_count);
+
+		if (particle_count != 0)
+		{
+			auto const corner = compute_lower_corner(particles);
+			auto const to_cell = [&](std::size_t axis, std::size_t i) {
+				auto const cell = std::floor((particles.position(axis)[i] - corner.min[axis])
+											 * m_inv_cell_size);
+				// Particles past the last representable cell share it, which only costs locality
+				return static_cast<std::uint32_t>(
+					std::min(cell, static_cast<float>(max_coordinate)));
+			};
+
+			parallel_for(particle_count, particle_grain, [&](std::size_t first, std::size_t last) {
+				for (auto i = first; i < last; ++i)
+				{
+					auto const key = morton_encode(to_cell(0, i), to_cell(1, i), to_cell(2, i));
+					m_entries[i] = {.key = key, .index = static_cast<particle_index>(i)};
+				}
+			});
+
+			// Ties are broken by index, which keeps the order deterministic
+			parallel_sort(std::span{m_entries});
+
+			parallel_for(particle_count, particle_grain, [&](std::size_t first, std::size_t last) {
+				for (auto i = first; i < last; ++i)
+				{
+					m_permutation[i] = m_entries[i].index;
+				}
+			});
+
+			particles.reorder(m_permutation);
+		}
+
+		m_updates_since_reorder = 0;
+		m_has_reference = true;
+		m_statistics.reference_locality = measure_locality(particles);
+		m_statistics.locality = m_statistics.reference_locality;
+		++m_statistics.reorder_count;
+	}
+
+	template<precision_policy Precision>
+	auto morton_reorder::measure_locality(basic_particle_set<Precision> const& particles) const
+		-> float
+	{
+		if (particles.size() < 2)
+		{
+			return 0.0F;
+		}
+
+		auto const x = particles.position(0);
+		auto const y = particles.position(1);
+		auto const z = particles.position(2);
+
+		auto const distance = [&](std::size_t i) {
+			auto const dx = x[i + 1] - x[i];
+			auto const dy = y[i + 1] - y[i];
+			auto const dz = z[i + 1] - z[i];
+
+			return static_cast<double>(std::sqrt(dx * dx + dy * dy + dz * dz));
+		};
+
+		auto const total = parallel_transform_reduce(particles.size() - 1, 0.0, distance,
+													 [](double lhs, double rhs) {
+														 return lhs + rhs;
+													 });
+
+		return static_cast<float>(total / static_cast<double>(particles.size() - 1))
+			 * m_inv_cell_size;
+	}
+
+	template auto morton_reorder::update(particle_set& particles) -> bool;
+	template auto morton_reorder::update(compact_particle_set& particles) -> bool;
+	template void morton_reorder::reorder(particle_set& particles);
+	template void morton_reorder::reorder(compact_particle_set& particles);
+	template auto morton_reorder::measure_locality(particle_set const& particles) const -> float;
+	template auto morton_reorder::measure_locality(compact_particle_set const& particles) const
+		-> float;
+} // namespace physeng
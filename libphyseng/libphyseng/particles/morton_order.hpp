@@ -0,0 +1,129 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <libphyseng/export.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace physeng
+{
+	/**
+	 * @brief Spread the 21 low bits of `value` so that two zero bits separate each of them
+	 */
+	constexpr auto spread_bits(std::uint64_t value) noexcept -> std::uint64_t
+	{
+		value &= 0x1F'FFFFULL;
+		value = (value | value << 32U) & 0x1F'0000'0000'FFFFULL;
+		value = (value | value << 16U) & 0x1F'0000'FF00'00FFULL;
+		value = (value | value << 8U) & 0x100F'00F0'0F00'F00FULL;
+		value = (value | value << 4U) & 0x10C3'0C30'C30C'30C3ULL;
+		value = (value | value << 2U) & 0x1249'2492'4924'9249ULL;
+
+		return value;
+	}
+
+	/**
+	 * @brief Interleave the bits of three 21 bit cell coordinates into a Morton (Z-order) key.
+	 * Cells close in space are likely to have close keys
+	 */
+	constexpr auto morton_encode(std::uint32_t x, std::uint32_t y, std::uint32_t z) noexcept
+		-> std::uint64_t
+	{
+		return spread_bits(x) | spread_bits(y) << 1U | spread_bits(z) << 2U;
+	}
+
+	/**
+	 * @brief Periodically sorts the particles of a set along a Morton curve so that particles
+	 * close in space are also close in memory, which keeps the neighbor loops cache friendly
+	 *
+	 * A reorder is triggered every `interval` updates, or when the locality of the set degrades
+	 * past `degradation` times the locality measured right after the last reorder. The locality
+	 * is the average distance between consecutive particles, in cells. Either trigger is disabled
+	 * when set to zero
+	 *
+	 * Reordering changes the particle indices: neighbor lists and any per particle state kept
+	 * outside of the set have to be rebuilt afterwards
+	 */
+	class LIBPHYSENG_SYMEXPORT morton_reorder
+	{
+	public:
+		struct statistics
+		{
+			std::uint64_t update_count = 0;  //< Number of calls to `update`
+			std::uint64_t reorder_count = 0; //< Number of reorders
+			float locality = 0.0F;           //< Last measured locality
+			float reference_locality = 0.0F; //< Locality right after the last reorder
+		};
+
+	public:
+		morton_reorder(float cell_size, std::uint64_t interval, float degradation);
+
+		[[nodiscard]] auto get_statistics() const noexcept -> statistics const&;
+		/**
+		 * @brief Whether any trigger is enabled
+		 */
+		[[nodiscard]] auto is_enabled() const noexcept -> bool;
+
+		/**
+		 * @brief Reorder the particles if one of the triggers fires. Meant to be called once per
+		 * step, before the neighbor search is updated
+		 *
+		 * @return Whether the particles were reordered
+		 */
+		template<precision_policy Precision>
+		auto update(basic_particle_set<Precision>& particles) -> bool;
+
+		/**
+		 * @brief Unconditionally sort the particles along the Morton curve
+		 */
+		template<precision_policy Precision>
+		void reorder(basic_particle_set<Precision>& particles);
+
+		/**
+		 * @brief The average distance between consecutive particles of the set, in cells
+		 */
+		template<precision_policy Precision>
+		[[nodiscard]] auto measure_locality(basic_particle_set<Precision> const& particles) const
+			-> float;
+
+	private:
+		struct entry
+		{
+			std::uint64_t key;
+			particle_index index;
+
+			auto operator<=>(entry const&) const = default;
+		};
+
+	private:
+		float m_inv_cell_size;
+		std::uint64_t m_interval;
+		float m_degradation;
+
+		std::uint64_t m_updates_since_reorder = 0;
+		bool m_has_reference = false;
+
+		std::vector<entry> m_entries;
+		std::vector<particle_index> m_permutation;
+
+		statistics m_statistics = {};
+	};
+} // namespace physeng
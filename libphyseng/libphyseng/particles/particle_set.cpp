@@ -0,0 +1,256 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <libphyseng/particles/particle_set.hpp>
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <concepts>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+
+namespace
+{
+	namespace stdr = std::ranges;
+
+	constexpr std::size_t reorder_grain = 16384;
+
+	template<typename Type>
+	void compact(physeng::aligned_vector<Type>& column,
+				 std::span<physeng::particle_index const> indices)
+	{
+		auto write = std::begin(column) + indices.front();
+
+		for (std::size_t i = 0; i < indices.size(); ++i)
+		{
+			auto const first = std::begin(column) + indices[i] + 1;
+			auto const last = i + 1 < indices.size() ? std::begin(column) + indices[i + 1]
+													 : std::end(column);
+
+			write = std::copy(first, last, write);
+		}
+
+		column.erase(write, std::end(column));
+	}
+} // namespace
+
+namespace physeng
+{
+	template<precision_policy Precision>
+	template<typename Fn>
+	void basic_particle_set<Precision>::for_each_column(Fn&& fn)
+	{
+		for (auto& column : m_position)
+		{
+			fn(column);
+		}
+		for (auto& column : m_velocity)
+		{
+			fn(column);
+		}
+
+		fn(m_density);
+		fn(m_pressure);
+		fn(m_mass);
+	}
+
+	template<precision_policy Precision>
+	basic_particle_set<Precision>::basic_particle_set(std::size_t count)
+	{
+		resize(count);
+	}
+
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::size() const noexcept -> std::size_t
+	{
+		return m_mass.size();
+	}
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::empty() const noexcept -> bool
+	{
+		return m_mass.empty();
+	}
+
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::get_memory_usage() const noexcept -> std::size_t
+	{
+		auto const bytes_of = []<typename Type>(aligned_vector<Type> const& column) {
+			return column.capacity() * sizeof(Type);
+		};
+
+		auto bytes = bytes_of(m_density) + bytes_of(m_pressure) + bytes_of(m_mass)
+				   + bytes_of(m_scratch) + bytes_of(m_velocity_scratch);
+		for (std::size_t axis = 0; axis < dimension; ++axis)
+		{
+			bytes += bytes_of(m_position[axis]) + bytes_of(m_velocity[axis]);
+		}
+
+		return bytes;
+	}
+
+	template<precision_policy Precision>
+	void basic_particle_set<Precision>::reserve(std::size_t count)
+	{
+		for_each_column([=](auto& column) { column.reserve(count); });
+	}
+	template<precision_policy Precision>
+	void basic_particle_set<Precision>::resize(std::size_t count)
+	{
+		for_each_column([=](auto& column) { column.resize(count); });
+	}
+	template<precision_policy Precision>
+	void basic_particle_set<Precision>::clear() noexcept
+	{
+		for_each_column([](auto& column) { column.clear(); });
+	}
+
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::append(std::size_t count) -> particle_index
+	{
+		auto const first = static_cast<particle_index>(size());
+		resize(size() + count);
+
+		return first;
+	}
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::append(basic_particle_set const& other) -> particle_index
+	{
+		auto const first = static_cast<particle_index>(size());
+
+		for (std::size_t axis = 0; axis < dimension; ++axis)
+		{
+			stdr::copy(other.m_position[axis], std::back_inserter(m_position[axis]));
+			stdr::copy(other.m_velocity[axis], std::back_inserter(m_velocity[axis]));
+		}
+
+		stdr::copy(other.m_density, std::back_inserter(m_density));
+		stdr::copy(other.m_pressure, std::back_inserter(m_pressure));
+		stdr::copy(other.m_mass, std::back_inserter(m_mass));
+
+		return first;
+	}
+
+	template<precision_policy Precision>
+	void basic_particle_set<Precision>::erase(std::span<particle_index const> indices)
+	{
+		assert(stdr::adjacent_find(indices, std::greater_equal{}) == std::end(indices)); // NOLINT
+		assert(indices.empty() || indices.back() < size());                             // NOLINT
+
+		if (indices.empty())
+		{
+			return;
+		}
+
+		for_each_column([=](auto& column) { compact(column, indices); });
+	}
+
+	template<precision_policy Precision>
+	void basic_particle_set<Precision>::reorder(std::span<particle_index const> permutation)
+	{
+		assert(permutation.size() == size()); // NOLINT
+
+		for_each_column([&](auto& column) {
+			auto& scratch = get_scratch<typename std::decay_t<decltype(column)>::value_type>();
+			scratch.resize(size());
+
+			auto const gather = [&](std::size_t first, std::size_t last) {
+				for (auto i = first; i < last; ++i)
+				{
+					scratch[i] = column[permutation[i]];
+				}
+			};
+			parallel_for(permutation.size(), reorder_grain, gather);
+
+			// The old column becomes the scratch space of the next one of its type
+			column.swap(scratch);
+		});
+	}
+
+	template<precision_policy Precision>
+	template<typename Type>
+	auto basic_particle_set<Precision>::get_scratch() noexcept -> aligned_vector<Type>&
+	{
+		if constexpr (std::same_as<Type, value_type>)
+		{
+			return m_scratch;
+		}
+		else
+		{
+			return m_velocity_scratch;
+		}
+	}
+
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::position(std::size_t axis) noexcept
+		-> std::span<value_type>
+	{
+		return m_position[axis];
+	}
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::position(std::size_t axis) const noexcept
+		-> std::span<value_type const>
+	{
+		return m_position[axis];
+	}
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::velocity(std::size_t axis) noexcept
+		-> std::span<velocity_type>
+	{
+		return m_velocity[axis];
+	}
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::velocity(std::size_t axis) const noexcept
+		-> std::span<velocity_type const>
+	{
+		return m_velocity[axis];
+	}
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::density() noexcept -> std::span<value_type>
+	{
+		return m_density;
+	}
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::density() const noexcept -> std::span<value_type const>
+	{
+		return m_density;
+	}
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::pressure() noexcept -> std::span<value_type>
+	{
+		return m_pressure;
+	}
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::pressure() const noexcept -> std::span<value_type const>
+	{
+		return m_pressure;
+	}
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::mass() noexcept -> std::span<value_type>
+	{
+		return m_mass;
+	}
+	template<precision_policy Precision>
+	auto basic_particle_set<Precision>::mass() const noexcept -> std::span<value_type const>
+	{
+		return m_mass;
+	}
+
+	template class basic_particle_set<single_precision>;
+	template class basic_particle_set<compact_precision>;
+} // namespace physeng
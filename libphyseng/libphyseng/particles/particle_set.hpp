@@ -0,0 +1,169 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/export.hpp>
+#include <libphyseng/particles/precision.hpp>
+#include <libphyseng/util/aligned_allocator.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+namespace physeng
+{
+	/**
+	 * @brief Index of a particle inside of a particle_set
+	 */
+	using particle_index = std::uint32_t;
+
+	/**
+	 * @brief The number of axes a simulation moves its particles along. Particles always store
+	 * three coordinates, a two dimensional simulation keeps all of them in the plane z = 0 and
+	 * its hot loops skip the z axis entirely
+	 */
+	template<std::size_t Dimension>
+	concept spatial_dimension = Dimension == 2 || Dimension == 3;
+
+	/**
+	 * @brief Call `fn(axis)` for every axis of a `Dimension` dimensional simulation. The calls
+	 * are expanded at compile time rather than left to the unrolling heuristics of the compiler,
+	 * which keeps per axis accumulators of the hot loops in registers
+	 */
+	template<std::size_t Dimension, typename Fn>
+		requires spatial_dimension<Dimension>
+	constexpr void for_each_axis(Fn&& fn)
+	{
+		[&]<std::size_t... Axes>(std::index_sequence<Axes...> /*axes*/) {
+			(fn(Axes), ...);
+		}(std::make_index_sequence<Dimension>{});
+	}
+
+	/**
+	 * @brief Stores the state of a set of particles as a structure of arrays. Every attribute lives
+	 * in its own cache line aligned column so that the hot loops only pull in the attributes they
+	 * actually touch
+	 *
+	 * Vector attributes are split per axis, meaning `position(0)` holds the x coordinate of every
+	 * particle. The velocities are stored as the `velocity_type` of the precision policy, every
+	 * other attribute as a float
+	 */
+	template<precision_policy Precision>
+	class basic_particle_set
+	{
+	public:
+		using value_type = float;
+		using velocity_type = typename Precision::velocity_type;
+		using precision = Precision;
+
+		static constexpr std::size_t dimension = 3;
+
+	public:
+		basic_particle_set() = default;
+		/**
+		 * @brief Create a set of `count` zero initialized particles
+		 */
+		explicit basic_particle_set(std::size_t count);
+
+		[[nodiscard]] auto size() const noexcept -> std::size_t;
+		[[nodiscard]] auto empty() const noexcept -> bool;
+
+		/**
+		 * @brief The bytes reserved by the columns, including the scratch columns of `reorder`
+		 */
+		[[nodiscard]] auto get_memory_usage() const noexcept -> std::size_t;
+
+		/**
+		 * @brief Reserve memory in every column for at least `count` particles
+		 */
+		void reserve(std::size_t count);
+		/**
+		 * @brief Resize every column to hold `count` particles. New particles are zero initialized
+		 */
+		void resize(std::size_t count);
+		void clear() noexcept;
+
+		/**
+		 * @brief Append `count` zero initialized particles at the end of the set
+		 *
+		 * @return The index of the first appended particle
+		 */
+		auto append(std::size_t count) -> particle_index;
+		/**
+		 * @brief Append a copy of every particle of `other` at the end of the set
+		 *
+		 * @return The index of the first appended particle
+		 */
+		auto append(basic_particle_set const& other) -> particle_index;
+
+		/**
+		 * @brief Remove a batch of particles from the set while keeping the relative order of the
+		 * remaining ones
+		 *
+		 * @param[in] indices The particles to remove. Must be sorted in increasing order and be
+		 * free of duplicates
+		 */
+		void erase(std::span<particle_index const> indices);
+
+		/**
+		 * @brief Permute every column of the set so that the particle found at `permutation[i]`
+		 * ends up at index `i`
+		 *
+		 * @param[in] permutation A permutation of [0, size())
+		 */
+		void reorder(std::span<particle_index const> permutation);
+
+		[[nodiscard]] auto position(std::size_t axis) noexcept -> std::span<value_type>;
+		[[nodiscard]] auto position(std::size_t axis) const noexcept
+			-> std::span<value_type const>;
+		[[nodiscard]] auto velocity(std::size_t axis) noexcept -> std::span<velocity_type>;
+		[[nodiscard]] auto velocity(std::size_t axis) const noexcept
+			-> std::span<velocity_type const>;
+		[[nodiscard]] auto density() noexcept -> std::span<value_type>;
+		[[nodiscard]] auto density() const noexcept -> std::span<value_type const>;
+		[[nodiscard]] auto pressure() noexcept -> std::span<value_type>;
+		[[nodiscard]] auto pressure() const noexcept -> std::span<value_type const>;
+		[[nodiscard]] auto mass() noexcept -> std::span<value_type>;
+		[[nodiscard]] auto mass() const noexcept -> std::span<value_type const>;
+
+	private:
+		template<typename Fn>
+		void for_each_column(Fn&& fn);
+
+		template<typename Type>
+		auto get_scratch() noexcept -> aligned_vector<Type>&;
+
+	private:
+		std::array<aligned_vector<value_type>, dimension> m_position = {};
+		std::array<aligned_vector<velocity_type>, dimension> m_velocity = {};
+		aligned_vector<value_type> m_density = {};
+		aligned_vector<value_type> m_pressure = {};
+		aligned_vector<value_type> m_mass = {};
+
+		// Reused by `reorder` to avoid allocating a column on every call
+		aligned_vector<value_type> m_scratch = {};
+		aligned_vector<velocity_type> m_velocity_scratch = {};
+	};
+
+	extern template class LIBPHYSENG_SYMEXPORT basic_particle_set<single_precision>;
+	extern template class LIBPHYSENG_SYMEXPORT basic_particle_set<compact_precision>;
+
+	using particle_set = basic_particle_set<single_precision>;
+	using compact_particle_set = basic_particle_set<compact_precision>;
+} // namespace physeng
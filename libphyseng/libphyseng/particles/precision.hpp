@@ -0,0 +1,106 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/util/bfloat16.hpp>
+
+#include <concepts>
+#include <cstdint>
+#include <string_view>
+
+namespace physeng
+{
+	namespace detail
+	{
+		// Finalizer of splitmix64, consecutive seeds give unrelated bits
+		constexpr auto mix_seed(std::uint64_t seed) noexcept -> std::uint64_t
+		{
+			seed = (seed ^ (seed >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+			seed = (seed ^ (seed >> 27U)) * 0x94d049bb133111ebULL;
+			return seed ^ (seed >> 31U);
+		}
+	} // namespace detail
+
+	/**
+	 * @brief Every attribute of the particles is stored as a float
+	 */
+	struct single_precision
+	{
+		using velocity_type = float;
+		using accumulator_type = float;
+
+		static constexpr std::string_view name = "single";
+
+		/**
+		 * @brief Convert a velocity computed in float to its stored type
+		 */
+		[[nodiscard]] static constexpr auto narrow(float value, [[maybe_unused]] std::uint64_t seed)
+			-> velocity_type
+		{
+			return value;
+		}
+	};
+
+	/**
+	 * @brief Velocities are stored as bfloat16 to halve the bandwidth of the force and advection
+	 * passes. The sums over the neighbors are accumulated in double precision so that rounding
+	 * the stored values does not also bias the sums. Velocities are stored with stochastic
+	 * rounding, the change of a step is often below half an ulp and would be lost otherwise
+	 */
+	struct compact_precision
+	{
+		using velocity_type = bfloat16;
+		using accumulator_type = double;
+
+		static constexpr std::string_view name = "compact";
+
+		/**
+		 * @brief Convert a velocity computed in float to its stored type
+		 *
+		 * @param[in] value The velocity to store
+		 * @param[in] seed Distinct for every particle, axis and step, the rounding noise is
+		 * derived from it
+		 */
+		[[nodiscard]] static constexpr auto narrow(float value, std::uint64_t seed)
+			-> velocity_type
+		{
+			return bfloat16::round_stochastic(value,
+											  static_cast<std::uint16_t>(detail::mix_seed(seed)));
+		}
+	};
+
+	/**
+	 * @brief A compile time choice of the types the particles are stored and summed with
+	 *
+	 * Only the velocities change with the policy. Positions are floats in absolute coordinates
+	 * under every policy: the grids, Morton codes, kernels, Verlet lists, checkpoints, frames and
+	 * compute shaders all read them as such. Double positions, or floats relative to the origin
+	 * of their cell, are not implemented. Neither would make a particle smaller, they only matter
+	 * for the precision of very large domains
+	 */
+	template<typename Precision>
+	concept precision_policy =
+		std::convertible_to<typename Precision::velocity_type, float> && requires {
+			typename Precision::accumulator_type;
+			{
+				Precision::narrow(0.0F, std::uint64_t{0})
+			} -> std::same_as<typename Precision::velocity_type>;
+			{
+				Precision::name
+			} -> std::convertible_to<std::string_view>;
+		};
+} // namespace physeng
@@ -0,0 +1,206 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <libphyseng/profiling/hardware_counters.hpp>
+
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <utility>
+
+#if defined(__linux__)
+#	include <linux/perf_event.h>
+#	include <sys/ioctl.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+namespace
+{
+	constexpr std::size_t event_count = 4;
+
+#if defined(__linux__)
+	// In the order of the fields of `counter_sample`
+	constexpr std::array<std::uint64_t, event_count> events = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_REFERENCES,
+		PERF_COUNT_HW_CACHE_MISSES};
+
+	// The layout of a read of a group leader with the format below
+	struct group_read
+	{
+		std::uint64_t count;
+		std::uint64_t time_enabled;
+		std::uint64_t time_running;
+		std::array<std::uint64_t, event_count> values;
+	};
+
+	/**
+	 * @brief Open `event` on `thread`, in the group of `leader`, or as the leader of a new group
+	 * if `leader` is -1. Only the leader starts disabled, the group follows it
+	 */
+	auto open_event(std::uint64_t event, pid_t thread, int leader) -> int
+	{
+		auto attributes = perf_event_attr{};
+		std::memset(&attributes, 0, sizeof(attributes));
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.size = sizeof(attributes);
+		attributes.config = event;
+		attributes.disabled = leader == -1 ? 1 : 0;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED
+							   | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		return static_cast<int>(syscall(SYS_perf_event_open, &attributes, thread, -1, leader, 0));
+	}
+
+	auto list_threads() -> std::vector<pid_t>
+	{
+		auto threads = std::vector<pid_t>{};
+		auto error = std::error_code{};
+
+		for (auto const& entry : std::filesystem::directory_iterator{"/proc/self/task", error})
+		{
+			auto const name = entry.path().filename().string();
+			auto thread = pid_t{0};
+			auto const [end, parse_error] =
+				std::from_chars(name.data(), name.data() + name.size(), thread);
+
+			if (parse_error == std::errc{} && end == name.data() + name.size())
+			{
+				threads.push_back(thread);
+			}
+		}
+
+		return threads;
+	}
+#endif
+} // namespace
+
+namespace physeng
+{
+	hardware_counters::hardware_counters()
+	{
+#if defined(__linux__)
+		for (auto const thread : list_threads())
+		{
+			auto leader = -1;
+			for (auto const event : events)
+			{
+				auto const descriptor = open_event(event, thread, leader);
+				if (descriptor < 0)
+				{
+					// Partial counts would be misleading, give up on every counter
+					for (auto const opened : m_descriptors)
+					{
+						close(opened);
+					}
+					m_descriptors.clear();
+
+					return;
+				}
+
+				m_descriptors.push_back(descriptor);
+				if (leader == -1)
+				{
+					leader = descriptor;
+				}
+			}
+		}
+#endif
+	}
+
+	hardware_counters::hardware_counters(hardware_counters&& other) noexcept :
+		m_descriptors(std::exchange(other.m_descriptors, {}))
+	{}
+
+	hardware_counters::~hardware_counters()
+	{
+#if defined(__linux__)
+		for (auto const descriptor : m_descriptors)
+		{
+			close(descriptor);
+		}
+#endif
+	}
+
+	auto hardware_counters::operator=(hardware_counters&& other) noexcept -> hardware_counters&
+	{
+		if (this != &other)
+		{
+			std::swap(m_descriptors, other.m_descriptors);
+		}
+
+		return *this;
+	}
+
+	auto hardware_counters::is_available() const noexcept -> bool
+	{
+		return !m_descriptors.empty();
+	}
+
+	void hardware_counters::start()
+	{
+#if defined(__linux__)
+		for (std::size_t i = 0; i < m_descriptors.size(); i += event_count)
+		{
+			ioctl(m_descriptors[i], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);  // NOLINT
+			ioctl(m_descriptors[i], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP); // NOLINT
+		}
+#endif
+	}
+
+	auto hardware_counters::stop() -> counter_sample
+	{
+		auto totals = std::array<double, event_count>{};
+		auto is_multiplexed = false;
+
+#if defined(__linux__)
+		for (std::size_t i = 0; i < m_descriptors.size(); i += event_count)
+		{
+			ioctl(m_descriptors[i], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP); // NOLINT
+
+			auto group = group_read{};
+			if (read(m_descriptors[i], &group, sizeof(group)) != sizeof(group)
+				|| group.count != event_count || group.time_running == 0)
+			{
+				// A thread that never ran while the counters were enabled has nothing to add
+				continue;
+			}
+
+			// When other events compete for the hardware, the kernel rotates the groups and only
+			// counts a share of the time. Extrapolate the counts to the whole time
+			auto const scale = static_cast<double>(group.time_enabled)
+							 / static_cast<double>(group.time_running);
+			is_multiplexed = is_multiplexed || group.time_running < group.time_enabled;
+
+			for (std::size_t event = 0; event < event_count; ++event)
+			{
+				totals[event] += static_cast<double>(group.values[event]) * scale;
+			}
+		}
+#endif
+
+		return {.cycles = static_cast<std::uint64_t>(totals[0]),
+				.instructions = static_cast<std::uint64_t>(totals[1]),
+				.cache_references = static_cast<std::uint64_t>(totals[2]),
+				.cache_misses = static_cast<std::uint64_t>(totals[3]),
+				.is_multiplexed = is_multiplexed};
+	}
+} // namespace physeng
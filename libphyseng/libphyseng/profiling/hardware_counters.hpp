@@ -0,0 +1,81 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <libphyseng/export.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace physeng
+{
+	/**
+	 * @brief Values read from the hardware performance counters
+	 */
+	struct counter_sample
+	{
+		std::uint64_t cycles = 0;
+		std::uint64_t instructions = 0;
+		std::uint64_t cache_references = 0; //< Last level cache accesses
+		std::uint64_t cache_misses = 0;     //< Last level cache misses
+		/**
+		 * @brief Whether the kernel time shared the hardware counters with other events. The
+		 * counts are then scaled up from the time they were running, and are estimates
+		 */
+		bool is_multiplexed = false;
+	};
+
+	/**
+	 * @brief Counts hardware events over every thread of the process through `perf_event_open`
+	 *
+	 * The threads are enumerated when the counters are created, so the default thread pool has to
+	 * exist by then. The events of a thread are opened as one group led by the cycles, so they are
+	 * always scheduled together and their ratios stay meaningful. Counters are unavailable on
+	 * other platforms or when the kernel refuses access (see
+	 * `/proc/sys/kernel/perf_event_paranoid`), in which case every sample reads zero
+	 */
+	class LIBPHYSENG_SYMEXPORT hardware_counters
+	{
+	public:
+		hardware_counters();
+		hardware_counters(hardware_counters const&) = delete;
+		hardware_counters(hardware_counters&& other) noexcept;
+		~hardware_counters();
+
+		auto operator=(hardware_counters const&) -> hardware_counters& = delete;
+		auto operator=(hardware_counters&& other) noexcept -> hardware_counters&;
+
+		[[nodiscard]] auto is_available() const noexcept -> bool;
+
+		/**
+		 * @brief Reset the counters and start counting
+		 */
+		void start();
+		/**
+		 * @brief Stop counting
+		 *
+		 * @return The events counted since the last call to `start`
+		 */
+		auto stop() -> counter_sample;
+
+	private:
+		// One descriptor per event and per thread, laid out as consecutive groups of
+		// `event_count` descriptors. The first descriptor of each group is its leader
+		std::vector<int> m_descriptors;
+	};
+} // namespace physeng
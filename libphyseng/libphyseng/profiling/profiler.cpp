@@ -0,0 +1,342 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <libphyseng/profiling/profiler.hpp>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace
+{
+	enum struct event_kind : std::uint8_t
+	{
+		zone,
+		counter
+	};
+
+	struct profile_event
+	{
+		char const* name = nullptr;
+		std::uint64_t timestamp = 0;
+		std::uint64_t payload = 0; //< The end of a zone, or the bits of the value of a counter
+		event_kind kind = event_kind::zone;
+	};
+
+	struct file_closer
+	{
+		void operator()(std::FILE* file) const noexcept
+		{
+			std::fclose(file); // NOLINT
+		}
+	};
+
+	void append_json_string(fmt::memory_buffer& buffer, std::string_view value)
+	{
+		buffer.push_back('"');
+		for (auto const character : value)
+		{
+			if (character == '"' || character == '\\')
+			{
+				buffer.push_back('\\');
+				buffer.push_back(character);
+			}
+			else if (static_cast<unsigned char>(character) < 0x20U)
+			{
+				fmt::format_to(std::back_inserter(buffer), "\\u{:04x}",
+							   static_cast<unsigned>(character));
+			}
+			else
+			{
+				buffer.push_back(character);
+			}
+		}
+		buffer.push_back('"');
+	}
+
+	constinit std::atomic<std::uint64_t> g_next_profiler_id = 1;
+	constinit std::atomic<physeng::profiler*> g_default_profiler = nullptr;
+} // namespace
+
+namespace physeng
+{
+	/**
+	 * @brief The events of a single thread. The owning thread is the only writer, the count is
+	 * published with release semantics so that the events below it can be read from any thread
+	 */
+	class profiler::event_ring
+	{
+	public:
+		event_ring(std::size_t capacity, std::size_t thread_index) :
+			m_events(std::bit_ceil(std::max<std::size_t>(capacity, 1))),
+			m_mask(m_events.size() - 1), m_name(fmt::format("thread {}", thread_index))
+		{}
+
+		void push(profile_event const& event) noexcept
+		{
+			auto const count = m_count.load(std::memory_order_relaxed);
+			m_events[count & m_mask] = event;
+			m_count.store(count + 1, std::memory_order_release);
+		}
+
+		/**
+		 * @brief The number of events pushed so far, overwritten ones included
+		 */
+		[[nodiscard]] auto get_count() const noexcept -> std::uint64_t
+		{
+			return m_count.load(std::memory_order_acquire);
+		}
+		[[nodiscard]] auto capacity() const noexcept -> std::size_t
+		{
+			return m_events.size();
+		}
+		[[nodiscard]] auto at(std::uint64_t index) const noexcept -> profile_event const&
+		{
+			return m_events[index & m_mask];
+		}
+
+		[[nodiscard]] auto get_name() const -> std::string const&
+		{
+			return m_name;
+		}
+		void set_name(std::string name)
+		{
+			m_name = std::move(name);
+		}
+
+	private:
+		std::vector<profile_event> m_events;
+		std::uint64_t m_mask;
+		std::atomic<std::uint64_t> m_count = 0;
+
+		std::string m_name;
+	};
+} // namespace physeng
+
+namespace physeng
+{
+	auto to_string(profiler_error error) -> std::string_view
+	{
+		using namespace std::literals;
+
+		switch (error)
+		{
+			case profiler_error::io_error:
+				return "failed to write the trace"sv;
+		}
+
+		return {};
+	}
+
+	profiler::profiler(options const& config) :
+		m_id(g_next_profiler_id.fetch_add(1, std::memory_order_relaxed)), m_options(config),
+		m_start_timestamp(read_profile_timestamp()), m_start_time(std::chrono::steady_clock::now())
+	{}
+
+	profiler::~profiler() = default;
+
+	auto profiler::options_from_environment() -> options
+	{
+		auto config = options{};
+
+		if (auto const* const path = std::getenv("PHYSENG_TRACE"); path != nullptr) // NOLINT
+		{
+			config.trace_path = path;
+		}
+
+		if (auto const* const variable = std::getenv("PHYSENG_TRACE_EVENTS")) // NOLINT
+		{
+			auto const count = std::string_view{variable};
+			auto value = std::size_t{0};
+			auto const [ptr, error] =
+				std::from_chars(count.data(), count.data() + count.size(), value);
+
+			if (error == std::errc{} && ptr == count.data() + count.size() && value != 0)
+			{
+				config.events_per_thread = value;
+			}
+			else
+			{
+				fmt::print(stderr, "physeng: ignoring invalid PHYSENG_TRACE_EVENTS '{}'\n", count);
+			}
+		}
+
+		return config;
+	}
+
+	auto profiler::get_trace_path() const -> std::filesystem::path const&
+	{
+		return m_options.trace_path;
+	}
+
+	auto profiler::get_statistics() const -> statistics
+	{
+		auto const lock = std::scoped_lock{m_mutex};
+
+		auto result = statistics{.thread_count = m_rings.size()};
+		for (auto const& ring : m_rings)
+		{
+			auto const count = ring->get_count();
+
+			result.event_count += count;
+			result.dropped_count += count - std::min<std::uint64_t>(count, ring->capacity());
+		}
+
+		return result;
+	}
+
+	void profiler::set_thread_name(std::string name)
+	{
+		auto& ring = local();
+
+		auto const lock = std::scoped_lock{m_mutex};
+		ring.set_name(std::move(name));
+	}
+
+	void profiler::record_zone(char const* name, std::uint64_t begin, std::uint64_t end)
+	{
+		local().push({.name = name, .timestamp = begin, .payload = end, .kind = event_kind::zone});
+	}
+
+	void profiler::record_counter(char const* name, double value)
+	{
+		local().push({.name = name,
+					  .timestamp = read_profile_timestamp(),
+					  .payload = std::bit_cast<std::uint64_t>(value),
+					  .kind = event_kind::counter});
+	}
+
+	auto profiler::write_chrome_trace(std::filesystem::path const& path) const
+		-> tl::expected<void, profiler_error>
+	{
+		// The rate of the timestamps is measured over the whole run
+		auto const end_timestamp = read_profile_timestamp();
+		auto const elapsed =
+			std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now()
+													  - m_start_time)
+				.count();
+		auto const ticks = static_cast<double>(end_timestamp - m_start_timestamp);
+		auto const ticks_per_microsecond = elapsed > 0.0 && ticks > 0.0 ? ticks / elapsed : 1.0;
+
+		auto const to_microseconds = [&](std::uint64_t timestamp) {
+			auto const offset = static_cast<std::int64_t>(timestamp - m_start_timestamp);
+			return static_cast<double>(offset) / ticks_per_microsecond;
+		};
+
+		auto buffer = fmt::memory_buffer{};
+		auto out = std::back_inserter(buffer);
+
+		fmt::format_to(out, "{{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+		fmt::format_to(out, "{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,"
+							"\"args\":{{\"name\":\"physeng\"}}}}");
+
+		auto const lock = std::scoped_lock{m_mutex};
+
+		for (std::size_t tid = 0; tid < m_rings.size(); ++tid)
+		{
+			auto const& ring = *m_rings[tid];
+
+			fmt::format_to(out, ",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},"
+								"\"args\":{{\"name\":",
+						   tid);
+			append_json_string(buffer, ring.get_name());
+			fmt::format_to(out, "}}}}");
+
+			auto const count = ring.get_count();
+			auto const first = count - std::min<std::uint64_t>(count, ring.capacity());
+
+			for (auto i = first; i < count; ++i)
+			{
+				auto const& event = ring.at(i);
+
+				fmt::format_to(out, ",\n{{\"name\":");
+				append_json_string(buffer, event.name);
+
+				if (event.kind == event_kind::zone)
+				{
+					auto const begin = to_microseconds(event.timestamp);
+					fmt::format_to(out,
+								   ",\"cat\":\"physeng\",\"ph\":\"X\",\"pid\":0,\"tid\":{},"
+								   "\"ts\":{:.3f},\"dur\":{:.3f}}}",
+								   tid, begin, to_microseconds(event.payload) - begin);
+				}
+				else
+				{
+					fmt::format_to(out,
+								   ",\"ph\":\"C\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},"
+								   "\"args\":{{\"value\":{}}}}}",
+								   tid, to_microseconds(event.timestamp),
+								   std::bit_cast<double>(event.payload));
+				}
+			}
+		}
+
+		fmt::format_to(out, "\n]}}\n");
+
+		auto const file = std::unique_ptr<std::FILE, file_closer>{std::fopen(path.c_str(), "wb")};
+		if (!file || std::fwrite(buffer.data(), 1, buffer.size(), file.get()) != buffer.size())
+		{
+			return tl::unexpected(profiler_error::io_error);
+		}
+
+		return {};
+	}
+
+	auto profiler::local() -> event_ring&
+	{
+		struct cached_ring
+		{
+			std::uint64_t owner = 0;
+			event_ring* ring = nullptr;
+		};
+
+		constinit thread_local auto t_cached = cached_ring{};
+
+		if (t_cached.owner == m_id)
+		{
+			return *t_cached.ring;
+		}
+
+		auto const lock = std::scoped_lock{m_mutex};
+
+		auto const index = m_rings.size();
+		m_rings.push_back(std::make_unique<event_ring>(m_options.events_per_thread, index));
+		t_cached = {.owner = m_id, .ring = m_rings.back().get()};
+
+		return *t_cached.ring;
+	}
+
+	auto get_default_profiler() noexcept -> profiler*
+	{
+		return g_default_profiler.load(std::memory_order_acquire);
+	}
+
+	void set_default_profiler(profiler* instance) noexcept
+	{
+		g_default_profiler.store(instance, std::memory_order_release);
+	}
+} // namespace physeng
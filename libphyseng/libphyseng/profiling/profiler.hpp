@@ -0,0 +1,209 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <libphyseng/export.hpp>
+
+#include <tl/expected.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#	include <x86intrin.h>
+#endif
+
+// Zones and counters are compiled out unless the library is configured with
+// `config.libphyseng.profiling=true`, which defines this macro for the library and its users
+#if defined(PHYSENG_ENABLE_PROFILING)
+#	define PHYSENG_PROFILE_CONCAT_IMPL(lhs, rhs) lhs##rhs
+#	define PHYSENG_PROFILE_CONCAT(lhs, rhs) PHYSENG_PROFILE_CONCAT_IMPL(lhs, rhs)
+
+/**
+ * @brief Time the rest of the enclosing scope. `name` has to be a string literal
+ */
+#	define PHYSENG_PROFILE_ZONE(name) \
+		physeng::profile_zone const PHYSENG_PROFILE_CONCAT(physeng_profile_zone_, __LINE__){name}
+/**
+ * @brief Record the current value of a counter. `name` has to be a string literal
+ */
+#	define PHYSENG_PROFILE_COUNTER(name, value) \
+		physeng::record_profile_counter(name, static_cast<double>(value))
+#else
+#	define PHYSENG_PROFILE_ZONE(name) static_cast<void>(0)
+#	define PHYSENG_PROFILE_COUNTER(name, value) static_cast<void>(0)
+#endif
+
+namespace physeng
+{
+#if defined(PHYSENG_ENABLE_PROFILING)
+	inline constexpr bool is_profiling_enabled = true;
+#else
+	inline constexpr bool is_profiling_enabled = false;
+#endif
+
+	enum struct profiler_error
+	{
+		io_error //< The trace file could not be written
+	};
+
+	LIBPHYSENG_SYMEXPORT auto to_string(profiler_error error) -> std::string_view;
+
+	/**
+	 * @brief A raw timestamp: the time stamp counter on x86, the steady clock elsewhere. The
+	 * profiler converts them to time when the trace is written
+	 */
+	inline auto read_profile_timestamp() noexcept -> std::uint64_t
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return static_cast<std::uint64_t>(
+			std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	/**
+	 * @brief Records the zones and counters of every thread and writes them as a Chrome trace,
+	 * which `chrome://tracing` and Perfetto both open
+	 *
+	 * Every thread records into its own ring of events, created the first time the thread records
+	 * anything. Only the owning thread writes to a ring, so recording takes no lock. Once a ring is
+	 * full the oldest events are overwritten
+	 */
+	class LIBPHYSENG_SYMEXPORT profiler
+	{
+	public:
+		struct options
+		{
+			std::filesystem::path trace_path = {};     //< Empty when no trace is requested
+			std::size_t events_per_thread = 1U << 16U; //< Rounded up to a power of two
+		};
+
+		struct statistics
+		{
+			std::size_t thread_count = 0;
+			std::uint64_t event_count = 0;   //< Events recorded, overwritten ones included
+			std::uint64_t dropped_count = 0; //< Events overwritten before the trace was written
+		};
+
+	public:
+		explicit profiler(options const& config);
+		profiler(profiler const&) = delete;
+		profiler(profiler&&) = delete;
+		~profiler();
+
+		auto operator=(profiler const&) -> profiler& = delete;
+		auto operator=(profiler&&) -> profiler& = delete;
+
+		/**
+		 * @brief Read the options from the environment. `PHYSENG_TRACE` sets the path of the trace
+		 * and `PHYSENG_TRACE_EVENTS` the capacity of the ring of every thread
+		 */
+		[[nodiscard]] static auto options_from_environment() -> options;
+
+		[[nodiscard]] auto get_trace_path() const -> std::filesystem::path const&;
+		[[nodiscard]] auto get_statistics() const -> statistics;
+
+		/**
+		 * @brief Name the calling thread in the trace
+		 */
+		void set_thread_name(std::string name);
+
+		void record_zone(char const* name, std::uint64_t begin, std::uint64_t end);
+		void record_counter(char const* name, double value);
+
+		/**
+		 * @brief Write every recorded event to `path` as Chrome trace JSON. The threads may not
+		 * record anything meanwhile, so this is meant to run once the work is done
+		 */
+		auto write_chrome_trace(std::filesystem::path const& path) const
+			-> tl::expected<void, profiler_error>;
+
+	private:
+		class event_ring;
+
+		auto local() -> event_ring&;
+
+	private:
+		std::uint64_t m_id;
+		options m_options;
+
+		// Both clocks read at creation, to convert timestamps to microseconds
+		std::uint64_t m_start_timestamp;
+		std::chrono::steady_clock::time_point m_start_time;
+
+		mutable std::mutex m_mutex;
+		std::vector<std::unique_ptr<event_ring>> m_rings;
+	};
+
+	/**
+	 * @brief The profiler the zones record into. Like the default thread pool it is created by
+	 * `main`, and is null unless a trace was requested
+	 */
+	LIBPHYSENG_SYMEXPORT auto get_default_profiler() noexcept -> profiler*;
+	LIBPHYSENG_SYMEXPORT void set_default_profiler(profiler* instance) noexcept;
+
+	/**
+	 * @brief Record a counter in the default profiler, if any
+	 */
+	inline void record_profile_counter(char const* name, double value)
+	{
+		if (auto* const instance = get_default_profiler())
+		{
+			instance->record_counter(name, value);
+		}
+	}
+
+	/**
+	 * @brief Records the time between its creation and its destruction as a zone of the default
+	 * profiler. Use it through `PHYSENG_PROFILE_ZONE`
+	 */
+	class profile_zone
+	{
+	public:
+		explicit profile_zone(char const* name) noexcept :
+			m_profiler(get_default_profiler()), m_name(name),
+			m_begin(m_profiler != nullptr ? read_profile_timestamp() : 0)
+		{}
+		profile_zone(profile_zone const&) = delete;
+		profile_zone(profile_zone&&) = delete;
+		~profile_zone()
+		{
+			if (m_profiler != nullptr)
+			{
+				m_profiler->record_zone(m_name, m_begin, read_profile_timestamp());
+			}
+		}
+
+		auto operator=(profile_zone const&) -> profile_zone& = delete;
+		auto operator=(profile_zone&&) -> profile_zone& = delete;
+
+	private:
+		profiler* m_profiler;
+		char const* m_name;
+		std::uint64_t m_begin;
+	};
+} // namespace physeng
@@ -0,0 +1,78 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace physeng
+{
+	/**
+	 * @brief The size of a cache line on the platforms we target
+	 */
+	inline constexpr std::size_t cache_line_size = 64;
+
+	/**
+	 * @brief A standard allocator that hands out memory aligned on a given boundary. Used to make
+	 * sure contiguous columns of data start on a cache line (and therefore on a SIMD register
+	 * boundary)
+	 */
+	template<typename Type, std::size_t Alignment = cache_line_size>
+	struct aligned_allocator
+	{
+		static_assert(Alignment >= alignof(Type), "Alignment is weaker than the type's alignment");
+		static_assert((Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+
+		using value_type = Type;
+
+		template<typename Other>
+		struct rebind
+		{
+			using other = aligned_allocator<Other, Alignment>;
+		};
+
+		constexpr aligned_allocator() noexcept = default;
+		template<typename Other>
+		constexpr aligned_allocator(aligned_allocator<Other, Alignment> const& /*other*/) noexcept
+		{}
+
+		[[nodiscard]] auto allocate(std::size_t count) -> Type*
+		{
+			return static_cast<Type*>(
+				::operator new(count * sizeof(Type), std::align_val_t{Alignment}));
+		}
+
+		void deallocate(Type* ptr, std::size_t /*count*/) noexcept
+		{
+			::operator delete(ptr, std::align_val_t{Alignment});
+		}
+
+		template<typename Other>
+		constexpr auto operator==(aligned_allocator<Other, Alignment> const& /*other*/) const
+			noexcept -> bool
+		{
+			return true;
+		}
+	};
+
+	/**
+	 * @brief A contiguous, cache line aligned, array of values
+	 */
+	template<typename Type>
+	using aligned_vector = std::vector<Type, aligned_allocator<Type>>;
+} // namespace physeng
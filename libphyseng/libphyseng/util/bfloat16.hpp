@@ -0,0 +1,114 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+namespace physeng
+{
+	/**
+	 * @brief A 16 bit floating point number made of the upper half of a float: it keeps the
+	 * exponent range of a float with an 8 bit significand, a relative precision of about 0.4%
+	 *
+	 * Meant for storage only, arithmetic goes through float. Conversions from float round to the
+	 * nearest value, ties to even, `round_stochastic` is there for values updated in small steps
+	 */
+	class bfloat16
+	{
+	public:
+		bfloat16() = default;
+		constexpr bfloat16(float value) noexcept :
+			m_bits(round(std::bit_cast<std::uint32_t>(value)))
+		{}
+
+		[[nodiscard]] static constexpr auto from_bits(std::uint16_t bits) noexcept -> bfloat16
+		{
+			auto result = bfloat16{};
+			result.m_bits = bits;
+
+			return result;
+		}
+
+		constexpr operator float() const noexcept
+		{
+			return std::bit_cast<float>(static_cast<std::uint32_t>(m_bits) << 16U);
+		}
+
+		/**
+		 * @brief Round up with a probability proportional to the distance to the value below
+		 *
+		 * Increments smaller than half an ulp are lost with round to nearest, a quantity updated
+		 * by many of them never moves. Rounded stochastically, it moves by their expected value
+		 *
+		 * @param[in] value The float to round
+		 * @param[in] noise Uniformly distributed bits, added to the 16 bits that are dropped
+		 */
+		[[nodiscard]] static constexpr auto round_stochastic(float value,
+															 std::uint16_t noise) noexcept
+			-> bfloat16
+		{
+			auto const bits = std::bit_cast<std::uint32_t>(value);
+			if (is_nan(bits))
+			{
+				return from_bits(round(bits));
+			}
+
+			return from_bits(static_cast<std::uint16_t>((bits + noise) >> 16U));
+		}
+
+		[[nodiscard]] constexpr auto get_bits() const noexcept -> std::uint16_t
+		{
+			return m_bits;
+		}
+
+		constexpr auto operator+=(float rhs) noexcept -> bfloat16&
+		{
+			return *this = float{*this} + rhs;
+		}
+		constexpr auto operator-=(float rhs) noexcept -> bfloat16&
+		{
+			return *this = float{*this} - rhs;
+		}
+
+	private:
+		static constexpr auto is_nan(std::uint32_t bits) noexcept -> bool
+		{
+			constexpr std::uint32_t exponent_mask = 0x7F80'0000U;
+			constexpr std::uint32_t significand_mask = 0x007F'FFFFU;
+
+			return (bits & exponent_mask) == exponent_mask && (bits & significand_mask) != 0;
+		}
+
+		static constexpr auto round(std::uint32_t bits) noexcept -> std::uint16_t
+		{
+			constexpr std::uint32_t quiet_bit = 0x0040'0000U;
+
+			// Truncating a NaN could leave a significand of zero, which reads as an infinity
+			if (is_nan(bits))
+			{
+				return static_cast<std::uint16_t>((bits | quiet_bit) >> 16U);
+			}
+
+			auto const lsb = (bits >> 16U) & 1U;
+			return static_cast<std::uint16_t>((bits + 0x7FFFU + lsb) >> 16U);
+		}
+
+	private:
+		std::uint16_t m_bits = 0;
+	};
+} // namespace physeng
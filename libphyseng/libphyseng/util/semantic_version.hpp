@@ -33,7 +33,31 @@ namespace physeng
 		std::uint32_t major; //< The major number of the version
 		std::uint32_t minor; //< The minor version of the number
 		std::uint32_t patch; //< The patch version of the number
+
+		constexpr auto operator==(semantic_version const&) const -> bool = default;
 	};
+
+	/**
+	 * @brief Whether something produced by the version `provided` can be consumed by the version
+	 * `current`: the major versions have to match and `provided` may not come from a newer minor
+	 * version. Before 1.0.0 every minor version may break compatibility, so the minor versions
+	 * have to match exactly
+	 */
+	constexpr auto is_compatible(semantic_version const& provided,
+								 semantic_version const& current) noexcept -> bool
+	{
+		if (provided.major != current.major)
+		{
+			return false;
+		}
+
+		if (current.major == 0)
+		{
+			return provided.minor == current.minor;
+		}
+
+		return provided.minor <= current.minor;
+	}
 } // namespace physeng
 
 template<>
@@ -27,7 +27,7 @@ namespace physeng::inline v0::strong // NOLINT
 		{
 			return Type(this->underlying().get() + other.get());
 		}
-		auto operator+=(Type const& other) -> Type&
+		constexpr auto operator+=(Type const& other) -> Type&
 		{
 			this->underlying().get() += other.get();
 			return this->underlying();
@@ -1,3 +1,8 @@
 #include <libphyseng/main.hpp>
 
-void physeng_main(std::span<const std::string_view> /*args*/) {}
+#include <cstdlib>
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	return EXIT_SUCCESS;
+}
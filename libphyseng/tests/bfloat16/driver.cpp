@@ -0,0 +1,137 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <common/check.hpp>
+
+#include <libphyseng/main.hpp>
+#include <libphyseng/util/bfloat16.hpp>
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
+
+namespace
+{
+	using physeng::test::check;
+
+	static_assert(sizeof(physeng::bfloat16) == 2);
+	static_assert(std::is_trivially_copyable_v<physeng::bfloat16>);
+
+	// Values with at most 8 significant bits are represented exactly
+	static_assert(float{physeng::bfloat16{1.0F}} == 1.0F);
+	static_assert(float{physeng::bfloat16{-3.5F}} == -3.5F);
+	static_assert(float{physeng::bfloat16{255.0F}} == 255.0F);
+	static_assert(physeng::bfloat16{1.0F}.get_bits() == 0x3F80U);
+
+	auto from_bits(std::uint32_t bits) -> float
+	{
+		return std::bit_cast<float>(bits);
+	}
+
+	void check_rounding()
+	{
+		// Halfway between 1 and the next bfloat16, ties go to the even significand
+		check(physeng::bfloat16{from_bits(0x3F80'8000U)}.get_bits() == 0x3F80U,
+			  "ties round down to an even significand");
+		check(physeng::bfloat16{from_bits(0x3F81'8000U)}.get_bits() == 0x3F82U,
+			  "ties round up to an even significand");
+		check(physeng::bfloat16{from_bits(0x3F80'8001U)}.get_bits() == 0x3F81U,
+			  "values past the tie round up");
+		check(physeng::bfloat16{from_bits(0x3F80'7FFFU)}.get_bits() == 0x3F80U,
+			  "values before the tie round down");
+
+		// The relative error of a conversion is at most half a unit in the last place
+		for (auto value = 1.0e-3F; value < 1.0e3F; value *= 1.37F)
+		{
+			auto const error = std::abs(float{physeng::bfloat16{value}} - value) / value;
+			check(error <= 1.0F / 256.0F, "conversions are within half an ulp");
+		}
+	}
+
+	void check_special_values()
+	{
+		constexpr auto infinity = std::numeric_limits<float>::infinity();
+
+		check(float{physeng::bfloat16{infinity}} == infinity, "infinity is kept");
+		check(float{physeng::bfloat16{-infinity}} == -infinity, "negative infinity is kept");
+		check(physeng::bfloat16{-0.0F}.get_bits() == 0x8000U, "the sign of zero is kept");
+
+		// The largest float rounds past the largest bfloat16
+		check(float{physeng::bfloat16{std::numeric_limits<float>::max()}} == infinity,
+			  "overflows round to infinity");
+
+		// A NaN whose payload only lives in the lower half must not become an infinity
+		check(std::isnan(float{physeng::bfloat16{from_bits(0x7F80'0001U)}}),
+			  "NaNs stay NaNs");
+		check(std::isnan(float{physeng::bfloat16{std::numeric_limits<float>::quiet_NaN()}}),
+			  "quiet NaNs stay NaNs");
+	}
+
+	void check_arithmetic()
+	{
+		auto value = physeng::bfloat16{1.0F};
+		value += 0.5F;
+		check(float{value} == 1.5F, "addition goes through float");
+		value -= 2.0F;
+		check(float{value} == -0.5F, "subtraction goes through float");
+
+		// Increments below half an ulp are lost, sums are never accumulated in bfloat16
+		value = 256.0F;
+		value += 0.5F;
+		check(float{value} == 256.0F, "small increments are rounded away");
+
+		check(physeng::bfloat16::from_bits(0x4040U).get_bits() == 0x4040U
+				  && float{physeng::bfloat16::from_bits(0x4040U)} == 3.0F,
+			  "values are built from their bits");
+	}
+
+	void check_stochastic_rounding()
+	{
+		using physeng::bfloat16;
+
+		// A quarter of the way between 1 and the next bfloat16
+		auto const value = from_bits(0x3F80'4000U);
+		check(bfloat16::round_stochastic(value, 0x0000U).get_bits() == 0x3F80U,
+			  "no noise rounds down");
+		check(bfloat16::round_stochastic(value, 0xBFFFU).get_bits() == 0x3F80U,
+			  "noise below the remaining distance rounds down");
+		check(bfloat16::round_stochastic(value, 0xC000U).get_bits() == 0x3F81U,
+			  "noise past the remaining distance rounds up");
+		check(std::isnan(float{bfloat16::round_stochastic(from_bits(0x7F80'0001U), 0xFFFFU)}),
+			  "NaNs stay NaNs");
+
+		// Over every noise value, the increments below half an ulp add up to their exact sum
+		auto sum = 0.0;
+		for (std::uint32_t noise = 0; noise <= 0xFFFFU; ++noise)
+		{
+			sum += float{bfloat16::round_stochastic(value, static_cast<std::uint16_t>(noise))};
+		}
+		check(sum / 65536.0 == double{value}, "the rounding is unbiased");
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	check_rounding();
+	check_special_values();
+	check_arithmetic();
+	check_stochastic_rounding();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <common/check.hpp>
+
+#include <libphyseng/io/checkpoint.hpp>
+#include <libphyseng/main.hpp>
+#include <libphyseng/physeng-info.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+#include <unistd.h>
+
+namespace
+{
+	using physeng::test::check;
+
+	constexpr auto application_version =
+		physeng::semantic_version{.major = 1, .minor = 4, .patch = 2};
+
+	auto make_particles(std::size_t count) -> physeng::particle_set
+	{
+		auto particles = physeng::particle_set{count};
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			auto const value = static_cast<float>(i);
+			for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+			{
+				particles.position(axis)[i] = value + static_cast<float>(axis);
+				particles.velocity(axis)[i] = -value * static_cast<float>(axis);
+			}
+
+			particles.density()[i] = 1000.0F + value;
+			particles.pressure()[i] = 2.0F * value;
+			particles.mass()[i] = 0.5F * value;
+		}
+
+		return particles;
+	}
+
+	auto equal(std::span<float const> lhs, std::span<float const> rhs) -> bool
+	{
+		return std::ranges::equal(lhs, rhs);
+	}
+
+	auto error_of(std::filesystem::path const& path, physeng::semantic_version version)
+		-> physeng::checkpoint_error
+	{
+		auto const checkpoint = physeng::mapped_checkpoint::open(path, version);
+		check(!checkpoint.has_value(), "the checkpoint is rejected");
+
+		return checkpoint.error();
+	}
+
+	void overwrite(std::filesystem::path const& path, std::streamoff offset, std::string_view bytes)
+	{
+		auto file = std::fstream{path, std::ios::binary | std::ios::in | std::ios::out};
+		file.seekp(offset);
+		file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+	}
+
+	void check_round_trip(std::filesystem::path const& path)
+	{
+		// Not a multiple of the page size, so that the columns need padding
+		auto const particles = make_particles(5000);
+		auto const written = physeng::write_checkpoint(
+			path, particles, {.application_version = application_version, .step = 42, .time = 1.5});
+		check(written.has_value(), "the checkpoint is written");
+
+		// Files of older patch versions of the application are accepted
+		auto const checkpoint = physeng::mapped_checkpoint::open(
+			path, {.major = 1, .minor = 5, .patch = 0});
+		check(checkpoint.has_value(), "the checkpoint is opened");
+
+		check(checkpoint->size() == particles.size(), "the particle count is kept");
+		check(checkpoint->get_metadata().step == 42, "the step is kept");
+		check(checkpoint->get_metadata().time == 1.5, "the time is kept");
+		check(checkpoint->get_metadata().application_version == application_version,
+			  "the application version is kept");
+		check(checkpoint->get_engine_version() == physeng::get_engine_version(),
+			  "the engine version is recorded");
+
+		for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+		{
+			check(equal(checkpoint->position(axis), particles.position(axis)),
+				  "positions are read back");
+			check(equal(checkpoint->velocity(axis), particles.velocity(axis)),
+				  "velocities are read back");
+		}
+		check(equal(checkpoint->density(), particles.density()), "densities are read back");
+		check(equal(checkpoint->pressure(), particles.pressure()), "pressures are read back");
+		check(equal(checkpoint->mass(), particles.mass()), "masses are read back");
+
+		// Restoring replaces whatever the set held
+		auto restored = make_particles(10);
+		checkpoint->restore(restored);
+		check(restored.size() == particles.size(), "the restored set has every particle");
+		check(equal(restored.position(2), particles.position(2))
+				  && equal(restored.mass(), particles.mass()),
+			  "the restored set matches the checkpoint");
+	}
+
+	void check_compact_round_trip(std::filesystem::path const& path)
+	{
+		auto particles = physeng::compact_particle_set{1000};
+		for (std::size_t i = 0; i < particles.size(); ++i)
+		{
+			particles.position(0)[i] = static_cast<float>(i);
+			particles.velocity(1)[i] = 0.1F * static_cast<float>(i);
+		}
+
+		auto const written = physeng::write_checkpoint(
+			path, particles, {.application_version = application_version, .step = 7, .time = 0.5});
+		check(written.has_value(), "the compact checkpoint is written");
+
+		auto const checkpoint = physeng::mapped_checkpoint::open(path, application_version);
+		check(checkpoint.has_value(), "the compact checkpoint is opened");
+
+		// The file holds the widened velocities, exactly as the compact set stores them
+		auto const velocity = particles.velocity(1);
+		check(std::ranges::equal(checkpoint->velocity(1), velocity, {}, {},
+								 [](physeng::bfloat16 value) { return float{value}; }),
+			  "compact velocities are widened");
+
+		auto single = physeng::particle_set{};
+		checkpoint->restore(single);
+		check(equal(single.position(0), particles.position(0)), "a single set restores positions");
+
+		auto compact = physeng::compact_particle_set{};
+		checkpoint->restore(compact);
+		check(std::ranges::equal(compact.velocity(1), velocity, {},
+								 [](physeng::bfloat16 value) { return value.get_bits(); },
+								 [](physeng::bfloat16 value) { return value.get_bits(); }),
+			  "a compact set restores the same velocities");
+	}
+
+	void check_rejections(std::filesystem::path const& path)
+	{
+		check(error_of(path.string() + ".missing", application_version)
+				  == physeng::checkpoint_error::io_error,
+			  "missing files are reported");
+		check(error_of(path, {.major = 2, .minor = 0, .patch = 0})
+				  == physeng::checkpoint_error::incompatible_application,
+			  "another major version of the application is rejected");
+		check(error_of(path, {.major = 1, .minor = 3, .patch = 9})
+				  == physeng::checkpoint_error::incompatible_application,
+			  "files of a newer minor version of the application are rejected");
+
+		auto const copy = std::filesystem::path{path.string() + ".copy"};
+
+		std::filesystem::copy_file(path, copy, std::filesystem::copy_options::overwrite_existing);
+		overwrite(copy, 0, "NOTACKPT");
+		check(error_of(copy, application_version) == physeng::checkpoint_error::not_a_checkpoint,
+			  "files without the magic are rejected");
+
+		std::filesystem::copy_file(path, copy, std::filesystem::copy_options::overwrite_existing);
+		std::filesystem::resize_file(copy, std::filesystem::file_size(copy) / 2);
+		check(error_of(copy, application_version) == physeng::checkpoint_error::corrupted,
+			  "truncated files are rejected");
+
+		std::filesystem::remove(copy);
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	auto const path = std::filesystem::temp_directory_path()
+					/ fmt::format("physeng-checkpoint-{}.bin", ::getpid());
+
+	check_round_trip(path);
+	check_rejections(path);
+	check_compact_round_trip(path);
+
+	std::filesystem::remove(path);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,40 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <fmt/core.h>
+
+#include <cstdlib>
+#include <string_view>
+
+namespace physeng::test
+{
+	/**
+	 * @brief Stop the test driver with a failure status if the condition does not hold
+	 *
+	 * @param condition The result of the check
+	 * @param what A description of what was checked, printed on failure
+	 */
+	inline void check(bool condition, std::string_view what)
+	{
+		if (!condition)
+		{
+			fmt::print(stderr, "check failed: {}\n", what);
+			std::exit(EXIT_FAILURE); // NOLINT
+		}
+	}
+} // namespace physeng::test
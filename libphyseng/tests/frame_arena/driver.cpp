@@ -0,0 +1,131 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <common/check.hpp>
+
+#include <libphyseng/main.hpp>
+#include <libphyseng/memory/frame_arena.hpp>
+#include <libphyseng/util/aligned_allocator.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory_resource>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using physeng::test::check;
+
+	auto is_aligned(void const* ptr, std::size_t alignment) -> bool
+	{
+		return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0; // NOLINT
+	}
+
+	void check_arena()
+	{
+		static constexpr std::size_t capacity = 4096;
+
+		auto arena = physeng::frame_arena{capacity};
+		check(arena.get_statistics().capacity >= capacity, "the arena reserves its capacity");
+
+		auto* const first = arena.allocate(10, 4);
+		auto* const second = arena.allocate(10, 4);
+		check(is_aligned(first, physeng::cache_line_size)
+				  && is_aligned(second, physeng::cache_line_size),
+			  "allocations start on a cache line");
+		check(first != second, "allocations do not overlap");
+		check(arena.get_statistics().used == physeng::cache_line_size + 10,
+			  "the used size accounts for the padding");
+
+		arena.reset();
+		check(arena.get_statistics().used == 0, "a reset releases everything");
+		check(arena.allocate(10, 4) == first, "memory is reused after a reset");
+		arena.reset();
+
+		// A frame larger than the arena spills into overflow blocks
+		{
+			auto values = std::pmr::vector<int>(4 * capacity, &arena); // NOLINT
+			std::iota(std::begin(values), std::end(values), 0);
+			check(values.back() == 4 * capacity - 1, "overflowing allocations are usable");
+		}
+
+		auto const high_water_mark = arena.get_statistics().high_water_mark;
+		check(arena.get_statistics().overflow_count == 1, "the large frame overflows");
+		check(high_water_mark >= 4 * capacity * sizeof(int), "the high-water mark is tracked");
+
+		// The next frame fits in the grown block
+		arena.reset();
+		check(arena.get_statistics().capacity >= high_water_mark,
+			  "the arena grows to its high-water mark");
+
+		auto values = std::pmr::vector<int>(4 * capacity, &arena); // NOLINT
+		check(arena.get_statistics().overflow_count == 1, "a grown arena does not overflow");
+	}
+
+	void check_allocator()
+	{
+		auto frames = physeng::frame_allocator{{.arena_capacity = 1024}};
+
+		auto* const main_arena = &frames.local();
+		check(&frames.local() == main_arena, "a thread always gets the same arena");
+
+		auto* other_arena = static_cast<physeng::frame_arena*>(nullptr);
+		std::jthread{[&] {
+			other_arena = &frames.local();
+			static_cast<void>(other_arena->allocate(8192, 8)); // NOLINT
+		}}.join();
+		check(other_arena != main_arena, "every thread has its own arena");
+
+		static_cast<void>(frames.local().allocate(100, 8)); // NOLINT
+
+		auto const stats = frames.get_statistics();
+		check(stats.arena_count == 2, "one arena per thread");
+		check(stats.max_high_water_mark == 8192, "the largest high-water mark is reported");
+		check(stats.total_high_water_mark == 8292, "the high-water marks add up");
+		check(stats.overflow_count == 1, "overflows are counted across arenas");
+
+		frames.reset();
+		check(frames.local().get_statistics().used == 0, "the arenas are reset together");
+
+		frames.reserve(16384); // NOLINT
+		check(frames.local().get_statistics().capacity >= 16384, "reserve grows the arenas");
+	}
+
+	void check_default_resource()
+	{
+		// `main` installs the default allocator
+		auto* const frames = physeng::get_default_frame_allocator();
+		check(frames != nullptr, "a default frame allocator is installed");
+		check(physeng::get_frame_resource() == &frames->local(),
+			  "the frame resource is the arena of the calling thread");
+
+		physeng::set_default_frame_allocator(nullptr);
+		check(physeng::get_frame_resource() == std::pmr::new_delete_resource(),
+			  "the heap is used without a frame allocator");
+		physeng::set_default_frame_allocator(frames);
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	check_arena();
+	check_allocator();
+	check_default_resource();
+
+	return EXIT_SUCCESS;
+}
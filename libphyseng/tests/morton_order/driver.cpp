@@ -0,0 +1,159 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <common/check.hpp>
+
+#include <libphyseng/main.hpp>
+#include <libphyseng/particles/morton_order.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace
+{
+	using physeng::test::check;
+
+	constexpr float spacing = 0.1F;
+
+	/**
+	 * @brief A lattice of particles stored in a random order. Every particle carries its position
+	 * in its velocity as well, to check that the columns move together
+	 */
+	void shuffle(physeng::particle_set& particles, std::uint32_t seed)
+	{
+		auto permutation = std::vector<physeng::particle_index>(particles.size());
+		std::iota(std::begin(permutation), std::end(permutation), 0U);
+		std::ranges::shuffle(permutation, std::mt19937{seed});
+		particles.reorder(permutation);
+	}
+
+	auto make_shuffled_lattice(std::uint32_t side) -> physeng::particle_set
+	{
+		auto particles = physeng::particle_set{std::size_t{side} * side * side};
+
+		auto i = std::size_t{0};
+		for (std::uint32_t z = 0; z < side; ++z)
+		{
+			for (std::uint32_t y = 0; y < side; ++y)
+			{
+				for (std::uint32_t x = 0; x < side; ++x, ++i)
+				{
+					auto const position = std::array{static_cast<float>(x) * spacing,
+													 static_cast<float>(y) * spacing,
+													 static_cast<float>(z) * spacing};
+					for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+					{
+						particles.position(axis)[i] = position[axis];
+						particles.velocity(axis)[i] = position[axis];
+					}
+					particles.mass()[i] = static_cast<float>(i);
+				}
+			}
+		}
+
+		shuffle(particles, 42); // NOLINT
+
+		return particles;
+	}
+
+	void check_encoding()
+	{
+		check(physeng::morton_encode(1, 0, 0) == 0b001U, "x is the lowest bit");
+		check(physeng::morton_encode(0, 1, 0) == 0b010U, "y is the middle bit");
+		check(physeng::morton_encode(0, 0, 1) == 0b100U, "z is the highest bit");
+		check(physeng::morton_encode(3, 0, 0) == 0b001'001U, "bits are interleaved");
+
+		constexpr auto max = (1U << 21U) - 1;
+		check(physeng::morton_encode(max, max, max) == (std::uint64_t{1} << 63U) - 1,
+			  "21 bits per axis fill 63 bits");
+	}
+
+	void check_reorder()
+	{
+		auto particles = make_shuffled_lattice(24); // NOLINT
+		auto reorder = physeng::morton_reorder{spacing, 0, 0.0F};
+
+		auto const shuffled_locality = reorder.measure_locality(particles);
+		reorder.reorder(particles);
+		auto const sorted_locality = reorder.measure_locality(particles);
+
+		check(sorted_locality < 0.25F * shuffled_locality, "sorting improves the locality");
+		check(reorder.get_statistics().reorder_count == 1, "the reorder is counted");
+
+		auto masses = std::vector<float>(particles.mass().begin(), particles.mass().end());
+		std::ranges::sort(masses);
+		for (std::size_t i = 0; i < masses.size(); ++i)
+		{
+			check(masses[i] == static_cast<float>(i), "every particle is kept exactly once");
+		}
+
+		for (std::size_t i = 0; i < particles.size(); ++i)
+		{
+			for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+			{
+				check(particles.position(axis)[i] == particles.velocity(axis)[i],
+					  "every column follows the same permutation");
+			}
+		}
+
+		// Along a Morton curve, the first particles all sit in the same corner of the lattice
+		for (std::size_t i = 0; i < 8; ++i) // NOLINT
+		{
+			for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+			{
+				check(particles.position(axis)[i] <= spacing, "the curve starts in a corner");
+			}
+		}
+	}
+
+	void check_triggers()
+	{
+		auto particles = make_shuffled_lattice(8); // NOLINT
+
+		auto disabled = physeng::morton_reorder{spacing, 0, 0.0F};
+		check(!disabled.is_enabled() && !disabled.update(particles), "no trigger, no reorder");
+
+		auto periodic = physeng::morton_reorder{spacing, 3, 0.0F};
+		auto reorders = 0;
+		for (int step = 0; step < 9; ++step) // NOLINT
+		{
+			reorders += periodic.update(particles) ? 1 : 0;
+		}
+		check(reorders == 3, "the periodic trigger fires every interval");
+
+		auto adaptive = physeng::morton_reorder{spacing, 0, 2.0F};
+		check(adaptive.update(particles), "the first update sets the reference");
+		check(!adaptive.update(particles), "an unchanged set is not reordered");
+
+		shuffle(particles, 7); // NOLINT
+		check(adaptive.update(particles), "a degraded locality triggers a reorder");
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	check_encoding();
+	check_reorder();
+	check_triggers();
+
+	return EXIT_SUCCESS;
+}
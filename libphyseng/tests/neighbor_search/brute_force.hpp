@@ -0,0 +1,57 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/particles/particle_set.hpp>
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Reference neighbor search comparing every pair of particles. Only meant to validate the
+ * accelerated neighbor searches on small sets
+ */
+class brute_force_search
+{
+public:
+	explicit brute_force_search(float support_radius) : m_support_radius(support_radius) {}
+
+	template<std::size_t Dimension = physeng::particle_set::dimension, typename Fn>
+	void for_each_neighbor(physeng::particle_set const& particles, physeng::particle_index i,
+						   Fn&& fn) const
+	{
+		auto const x = particles.position(0);
+		auto const y = particles.position(1);
+		auto const z = particles.position(2);
+
+		for (physeng::particle_index j = 0; j < particles.size(); ++j)
+		{
+			auto const dx = x[i] - x[j];
+			auto const dy = y[i] - y[j];
+			auto const dz = Dimension == 3 ? z[i] - z[j] : 0.0F;
+			auto const distance_squared = dx * dx + dy * dy + dz * dz;
+
+			if (distance_squared < m_support_radius * m_support_radius)
+			{
+				fn(j, distance_squared);
+			}
+		}
+	}
+
+private:
+	float m_support_radius;
+};
@@ -0,0 +1,200 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "brute_force.hpp"
+
+#include <common/check.hpp>
+
+#include <libphyseng/main.hpp>
+#include <libphyseng/neighbor/neighbor_search.hpp>
+#include <libphyseng/neighbor/verlet_list.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+	using physeng::test::check;
+
+	constexpr auto support_radius = physeng::support_radius{0.1F};
+
+	template <typename Error>
+	auto rebuild_throws(physeng::uniform_grid& grid, physeng::particle_set const& particles)
+		-> bool
+	{
+		try
+		{
+			grid.rebuild(particles);
+		}
+		catch (Error const&)
+		{
+			return true;
+		}
+
+		return false;
+	}
+
+	auto make_random_set(std::size_t count, float extent) -> physeng::particle_set
+	{
+		auto engine = std::mt19937{42}; // NOLINT
+		auto distribution = std::uniform_real_distribution<float>{0.0F, extent};
+
+		auto particles = physeng::particle_set{count};
+		for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+		{
+			std::ranges::generate(particles.position(axis), [&] { return distribution(engine); });
+		}
+
+		return particles;
+	}
+
+	template<std::size_t Dimension = physeng::particle_set::dimension, typename Search>
+	auto collect_neighbors(Search const& search, physeng::particle_set const& particles,
+						   physeng::particle_index i) -> std::vector<physeng::particle_index>
+	{
+		auto neighbors = std::vector<physeng::particle_index>{};
+		search.template for_each_neighbor<Dimension>(
+			particles, i, [&](physeng::particle_index j, float /*r2*/) { neighbors.push_back(j); });
+		std::ranges::sort(neighbors);
+
+		return neighbors;
+	}
+
+	template<std::size_t Dimension = physeng::particle_set::dimension, typename Search>
+	void check_against_reference(Search const& search, physeng::particle_set const& particles,
+								 std::string_view name)
+	{
+		auto const reference = brute_force_search{support_radius.get()};
+
+		for (physeng::particle_index i = 0; i < particles.size(); ++i)
+		{
+			check(collect_neighbors<Dimension>(search, particles, i)
+					  == collect_neighbors(reference, particles, i),
+				  name);
+		}
+	}
+
+	/**
+	 * @brief The two dimensional searches only look at the layer of the particle, which must
+	 * find every neighbor of particles lying in the plane z = 0
+	 */
+	void check_planar()
+	{
+		auto particles = make_random_set(4000, 1.0F); // NOLINT
+		std::ranges::fill(particles.position(2), 0.0F);
+
+		auto grid = physeng::uniform_grid{support_radius};
+		grid.rebuild(particles);
+		check_against_reference<2>(grid, particles, "planar uniform grid matches");
+
+		auto hash = physeng::spatial_hash{support_radius};
+		hash.rebuild(particles);
+		check_against_reference<2>(hash, particles, "planar spatial hash matches");
+
+		auto verlet = physeng::verlet_list{support_radius, 0.02F}; // NOLINT
+		auto verlet_search = physeng::uniform_grid{verlet.get_search_radius()};
+		check(verlet.update<2>(verlet_search, particles), "planar verlet list first build");
+		check_against_reference<2>(verlet, particles, "planar verlet list matches");
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	auto particles = make_random_set(4000, 1.0F); // NOLINT
+
+	auto grid = physeng::uniform_grid{support_radius};
+	grid.rebuild(particles);
+	check_against_reference(grid, particles, "uniform grid matches the brute force search");
+
+	// Move the particles around and make sure the rebuild picks up the new layout
+	for (auto& x : particles.position(0))
+	{
+		x *= 2.5F; // NOLINT
+	}
+	grid.rebuild(particles);
+	check_against_reference(grid, particles, "uniform grid matches after a rebuild");
+
+	auto hash = physeng::spatial_hash{support_radius};
+	hash.rebuild(particles);
+	check_against_reference(hash, particles, "spatial hash matches the brute force search");
+
+	// A few particles splashing far away from the fluid must not blow up the number of cells
+	auto const splash = particles.append(3);
+	particles.position(0)[splash] = 1000.0F;    // NOLINT
+	particles.position(1)[splash + 1] = -500.0F; // NOLINT
+	particles.position(2)[splash + 2] = 2000.0F; // NOLINT
+
+	hash.rebuild(particles);
+	check_against_reference(hash, particles, "spatial hash matches with sparse particles");
+	check(hash.cell_count() <= particles.size(), "spatial hash only stores occupied cells");
+
+	// The same particles would need trillions of cells in a dense grid
+	check(rebuild_throws<std::length_error>(grid, particles),
+		  "uniform grid rejects sparse particles");
+
+	auto small_grid = physeng::uniform_grid{support_radius, 1024}; // NOLINT
+	check(small_grid.get_max_cell_count() == 128, "uniform grid cell limit from its memory");
+	check(rebuild_throws<std::length_error>(small_grid, make_random_set(100, 1.0F)),
+		  "uniform grid enforces its memory limit");
+
+	auto stray = make_random_set(100, 1.0F); // NOLINT
+	stray.position(1)[7] = std::numeric_limits<float>::quiet_NaN(); // NOLINT
+	check(rebuild_throws<std::domain_error>(grid, stray), "uniform grid rejects a NaN position");
+	stray.position(1)[7] = std::numeric_limits<float>::infinity(); // NOLINT
+	check(rebuild_throws<std::domain_error>(grid, stray), "uniform grid rejects an inf position");
+
+	// The verlet list must stay exact while particles move by less than half of the skin
+	auto verlet = physeng::verlet_list{support_radius, 0.02F}; // NOLINT
+	auto verlet_search = physeng::spatial_hash{verlet.get_search_radius()};
+	check(verlet.update(verlet_search, particles), "verlet list first build");
+	check_against_reference(verlet, particles, "verlet list matches the brute force search");
+
+	for (auto& y : particles.position(1))
+	{
+		y += 0.006F; // NOLINT
+	}
+	for (std::size_t i = 0; i < particles.size(); i += 2)
+	{
+		particles.position(2)[i] -= 0.006F; // NOLINT
+	}
+	check(!verlet.update(verlet_search, particles), "verlet list is reused for small moves");
+	check_against_reference(verlet, particles, "verlet list matches after small moves");
+
+	particles.position(0)[0] += 0.05F; // NOLINT
+	check(verlet.update(verlet_search, particles), "verlet list rebuilds after a large move");
+	check_against_reference(verlet, particles, "verlet list matches after a rebuild");
+	check(verlet.get_statistics().update_count == 3 && verlet.get_statistics().rebuild_count == 2,
+		  "verlet list statistics");
+
+	auto any = physeng::make_neighbor_search(physeng::neighbor_backend::spatial_hash,
+											 support_radius);
+	check(std::holds_alternative<physeng::spatial_hash>(any), "backend selection");
+
+	auto empty = physeng::particle_set{};
+	grid.rebuild(empty);
+	check(grid.cell_count() == 1, "grid rebuild on an empty set");
+	hash.rebuild(empty);
+	check(hash.cell_count() == 0, "hash rebuild on an empty set");
+
+	check_planar();
+
+	return EXIT_SUCCESS;
+}
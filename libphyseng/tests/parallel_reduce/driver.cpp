@@ -0,0 +1,126 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <common/check.hpp>
+
+#include <libphyseng/concurrency/parallel_reduce.hpp>
+#include <libphyseng/concurrency/thread_pool.hpp>
+#include <libphyseng/main.hpp>
+#include <libphyseng/memory/frame_arena.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+	using physeng::test::check;
+
+	auto make_values(std::size_t count) -> std::vector<float>
+	{
+		auto engine = std::mt19937{42}; // NOLINT
+		// Wide magnitudes make the sum very sensitive to the order of the additions
+		auto distribution = std::uniform_real_distribution<float>{-1.0e6F, 1.0e6F};
+
+		auto values = std::vector<float>(count);
+		for (auto& value : values)
+		{
+			value = distribution(engine) * std::pow(1.0e-3F, static_cast<float>(engine() % 4));
+		}
+
+		return values;
+	}
+
+	auto sum(physeng::thread_pool& pool, std::vector<float> const& values) -> float
+	{
+		return physeng::parallel_reduce(
+			pool, values.size(), 0.0F,
+			[&](std::size_t begin, std::size_t end) {
+				auto result = 0.0F;
+				for (auto i = begin; i < end; ++i)
+				{
+					result += values[i];
+				}
+
+				return result;
+			},
+			[](float lhs, float rhs) { return lhs + rhs; });
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	// Sizes below, at and above a block boundary, and a block count that is not a power of two
+	for (std::size_t const count : {std::size_t{1}, physeng::reduction_block_size,
+									physeng::reduction_block_size + 1, std::size_t{1'000'003}})
+	{
+		auto const values = make_values(count);
+
+		auto reference_pool = physeng::thread_pool{{.worker_count = 1}};
+		auto const reference = std::bit_cast<std::uint32_t>(sum(reference_pool, values));
+
+		for (std::size_t const worker_count : {2U, 3U, 8U})
+		{
+			auto pool = physeng::thread_pool{{.worker_count = worker_count}};
+			for (int run = 0; run < 4; ++run)
+			{
+				check(std::bit_cast<std::uint32_t>(sum(pool, values)) == reference,
+					  "the sum is bit identical for every worker count");
+			}
+		}
+
+		auto const max = physeng::parallel_transform_reduce(
+			values.size(), -std::numeric_limits<float>::infinity(),
+			[&](std::size_t i) { return values[i]; },
+			[](float lhs, float rhs) { return std::max(lhs, rhs); });
+		check(max == std::ranges::max(values), "the maximum matches a serial pass");
+	}
+
+	auto pool = physeng::thread_pool{{.worker_count = 2}};
+	check(physeng::parallel_reduce(
+			  pool, 0, 7, [](std::size_t, std::size_t) { return 0; },
+			  [](int lhs, int rhs) { return lhs + rhs; })
+			  == 7,
+		  "an empty range reduces to the identity");
+
+	// The partials only go to the frame arena of the calling thread when it is asked for, `main`
+	// installs the default frame allocator
+	auto* const frames = physeng::get_default_frame_allocator();
+	check(frames != nullptr, "a default frame allocator is installed");
+	frames->reset();
+
+	auto const values = make_values(8 * physeng::reduction_block_size);
+	auto const& arena = frames->local().get_statistics();
+	auto const add = [](float lhs, float rhs) { return lhs + rhs; };
+	auto const element = [&](std::size_t i) { return values[i]; };
+
+	std::ignore = physeng::parallel_transform_reduce(values.size(), 0.0F, element, add);
+	check(arena.used == 0, "the partials go to the heap by default");
+
+	std::ignore = physeng::parallel_transform_reduce(values.size(), 0.0F, element, add,
+													 physeng::get_frame_resource());
+	check(arena.used > 0, "the partials go to the given resource");
+
+	frames->reset();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <common/check.hpp>
+
+#include <libphyseng/main.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	using physeng::test::check;
+
+	auto is_aligned(void const* ptr) -> bool
+	{
+		return reinterpret_cast<std::uintptr_t>(ptr) % physeng::cache_line_size == 0; // NOLINT
+	}
+
+	auto make_numbered_set(std::size_t count) -> physeng::particle_set
+	{
+		auto particles = physeng::particle_set{count};
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			particles.position(0)[i] = static_cast<float>(i);
+			particles.velocity(2)[i] = static_cast<float>(i) * 2.0F;
+			particles.mass()[i] = static_cast<float>(i) * 3.0F;
+		}
+
+		return particles;
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	auto particles = make_numbered_set(100);
+
+	check(particles.size() == 100, "size after construction");
+	for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+	{
+		check(is_aligned(particles.position(axis).data()), "position column alignment");
+		check(is_aligned(particles.velocity(axis).data()), "velocity column alignment");
+	}
+	check(is_aligned(particles.density().data()), "density column alignment");
+	check(is_aligned(particles.pressure().data()), "pressure column alignment");
+	check(is_aligned(particles.mass().data()), "mass column alignment");
+
+	// Bulk append
+	auto const first = particles.append(make_numbered_set(10));
+	check(first == 100 && particles.size() == 110, "append of a particle set");
+	check(particles.position(0)[105] == 5.0F, "appended values are copied");
+	check(particles.append(5) == 110 && particles.mass()[114] == 0.0F, "append of new particles");
+
+	// Bulk erase keeps the relative order of the remaining particles
+	auto const removed = std::vector<physeng::particle_index>{0, 1, 50, 99, 114};
+	particles.erase(removed);
+	check(particles.size() == 110, "size after erase");
+	check(particles.position(0)[0] == 2.0F, "erase of a leading range");
+	check(particles.position(0)[48] == 51.0F, "erase in the middle");
+	check(particles.mass()[97] == 3.0F, "erase keeps columns in sync");
+
+	// Reorder through a reversing permutation
+	auto small = make_numbered_set(8);
+	auto permutation = std::vector<physeng::particle_index>{7, 6, 5, 4, 3, 2, 1, 0};
+	small.reorder(permutation);
+	for (std::size_t i = 0; i < small.size(); ++i)
+	{
+		check(small.position(0)[i] == static_cast<float>(7 - i), "reorder of positions");
+		check(small.velocity(2)[i] == static_cast<float>(7 - i) * 2.0F, "reorder of velocities");
+		check(small.mass()[i] == static_cast<float>(7 - i) * 3.0F, "reorder of masses");
+	}
+
+	// Compact velocities follow their particles as well
+	auto compact = physeng::compact_particle_set{8};
+	for (std::size_t i = 0; i < compact.size(); ++i)
+	{
+		compact.position(0)[i] = static_cast<float>(i);
+		compact.velocity(2)[i] = static_cast<float>(i) * 2.0F;
+	}
+	compact.reorder(permutation);
+	for (std::size_t i = 0; i < compact.size(); ++i)
+	{
+		check(compact.position(0)[i] == static_cast<float>(7 - i), "compact reorder of positions");
+		check(float{compact.velocity(2)[i]} == static_cast<float>(7 - i) * 2.0F,
+			  "compact reorder of velocities");
+	}
+	check(is_aligned(compact.velocity(0).data()), "compact velocity column alignment");
+
+	// Six float columns and three velocity columns, the reorder scratch is empty until used
+	auto const count = std::size_t{1000};
+	auto const single_bytes = physeng::particle_set{count}.get_memory_usage();
+	auto const compact_bytes = physeng::compact_particle_set{count}.get_memory_usage();
+	check(single_bytes >= 36 * count && single_bytes < 40 * count, "memory of a single set");
+	check(compact_bytes >= 30 * count && compact_bytes < 34 * count, "memory of a compact set");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <common/check.hpp>
+
+#include <libphyseng/main.hpp>
+#include <libphyseng/profiling/hardware_counters.hpp>
+#include <libphyseng/profiling/profiler.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using physeng::test::check;
+
+	auto read_file(std::filesystem::path const& path) -> std::string
+	{
+		auto file = std::ifstream{path};
+		return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+	}
+
+	auto count_occurrences(std::string_view text, std::string_view pattern) -> std::size_t
+	{
+		auto count = std::size_t{0};
+		for (auto at = text.find(pattern); at != std::string_view::npos;
+			 at = text.find(pattern, at + pattern.size()))
+		{
+			++count;
+		}
+
+		return count;
+	}
+
+	void check_recording()
+	{
+		static constexpr std::size_t thread_count = 4;
+		static constexpr std::size_t zones_per_thread = 100;
+
+		auto profiler = physeng::profiler{{.events_per_thread = 1024}};
+		physeng::set_default_profiler(&profiler);
+		profiler.set_thread_name("main \"thread\"");
+
+		{
+			auto const zone = physeng::profile_zone{"outer"};
+
+			auto threads = std::vector<std::jthread>{};
+			for (std::size_t t = 0; t < thread_count; ++t)
+			{
+				threads.emplace_back([] {
+					for (std::size_t i = 0; i < zones_per_thread; ++i)
+					{
+						auto const inner = physeng::profile_zone{"inner"};
+					}
+				});
+			}
+		}
+		physeng::record_profile_counter("particles", 42.0);
+
+		// Neither the macros nor the zones record anything once the default profiler is gone
+		physeng::set_default_profiler(nullptr);
+		{
+			PHYSENG_PROFILE_ZONE("ignored");
+			PHYSENG_PROFILE_COUNTER("ignored", 1);
+			auto const zone = physeng::profile_zone{"ignored"};
+		}
+
+		auto const stats = profiler.get_statistics();
+		check(stats.thread_count == thread_count + 1, "every recording thread gets a ring");
+		check(stats.event_count == thread_count * zones_per_thread + 2,
+			  "every zone and counter is recorded");
+		check(stats.dropped_count == 0, "nothing is dropped while the rings have room");
+
+		auto const path = std::filesystem::temp_directory_path() / "physeng-profiler-test.json";
+		check(profiler.write_chrome_trace(path).has_value(), "the trace is written");
+
+		auto const trace = read_file(path);
+		std::filesystem::remove(path);
+
+		check(trace.starts_with("{\"displayTimeUnit\""), "the trace is a JSON object");
+		check(trace.find("\"traceEvents\":[") != std::string::npos, "the trace lists its events");
+		check(count_occurrences(trace, "\"name\":\"inner\"") == thread_count * zones_per_thread,
+			  "every inner zone is written");
+		check(count_occurrences(trace, "\"name\":\"outer\",\"cat\":\"physeng\",\"ph\":\"X\"") == 1,
+			  "zones are complete events");
+		check(trace.find("\"ph\":\"C\"") != std::string::npos
+				  && trace.find("\"value\":42") != std::string::npos,
+			  "counters are written with their value");
+		check(trace.find("\"main \\\"thread\\\"\"") != std::string::npos,
+			  "thread names are escaped");
+		check(count_occurrences(trace, "\"thread_name\"") == thread_count + 1,
+			  "every thread is named");
+		check(trace.find("ignored") == std::string::npos, "nothing is recorded without a profiler");
+	}
+
+	void check_overwrite()
+	{
+		static constexpr std::size_t capacity = 16;
+		static constexpr std::size_t zone_count = 100;
+
+		auto profiler = physeng::profiler{{.events_per_thread = capacity}};
+		for (std::size_t i = 0; i < zone_count; ++i)
+		{
+			auto const timestamp = physeng::read_profile_timestamp();
+			profiler.record_zone(i + 1 == zone_count ? "last" : "zone", timestamp, timestamp);
+		}
+
+		auto const stats = profiler.get_statistics();
+		check(stats.event_count == zone_count, "overwritten events are still counted");
+		check(stats.dropped_count == zone_count - capacity, "the oldest events are dropped");
+
+		auto const path = std::filesystem::temp_directory_path() / "physeng-profiler-ring.json";
+		check(profiler.write_chrome_trace(path).has_value(), "the trace is written");
+
+		auto const trace = read_file(path);
+		std::filesystem::remove(path);
+
+		check(count_occurrences(trace, "\"ph\":\"X\"") == capacity, "only the last events remain");
+		check(trace.find("\"last\"") != std::string::npos, "the newest event is kept");
+	}
+
+	void check_hardware_counters()
+	{
+		auto counters = physeng::hardware_counters{};
+		counters.start();
+
+		auto volatile sum = std::uint64_t{0};
+		for (std::uint64_t i = 0; i < 1'000'000; ++i) // NOLINT
+		{
+			sum = sum + i;
+		}
+
+		auto const sample = counters.stop();
+		if (counters.is_available())
+		{
+			check(sample.cycles > 0 && sample.instructions > 0, "hardware counters count events");
+		}
+		else
+		{
+			check(sample.cycles == 0 && sample.instructions == 0 && !sample.is_multiplexed,
+				  "unavailable hardware counters read zero");
+		}
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	check_recording();
+	check_overwrite();
+	check_hardware_counters();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <common/check.hpp>
+
+#include <libphyseng/kernels/smoothing_kernel.hpp>
+#include <libphyseng/main.hpp>
+
+#include <fmt/core.h>
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <numbers>
+#include <type_traits>
+#include <vector>
+
+// Mixing up the two lengths must not compile, and must not cost anything either
+static_assert(!std::is_constructible_v<physeng::support_radius, physeng::smoothing_length>);
+static_assert(!std::is_constructible_v<physeng::smoothing_length, physeng::support_radius>);
+static_assert(sizeof(physeng::smoothing_length) == sizeof(float));
+static_assert(std::is_trivially_copyable_v<physeng::support_radius>);
+
+namespace
+{
+	constexpr auto h = physeng::smoothing_length{0.5F};
+
+	constexpr auto kernel_types =
+		std::array{physeng::kernel_type::cubic_spline, physeng::kernel_type::wendland_c2,
+				   physeng::kernel_type::wendland_c4};
+	constexpr auto simd_levels = std::array{physeng::simd_level::scalar,
+											physeng::simd_level::avx2,
+											physeng::simd_level::avx512};
+	constexpr auto dimensions = std::array<std::size_t, 2>{2, 3};
+
+	void check(bool condition, std::string_view what, physeng::kernel_type type)
+	{
+		physeng::test::check(condition, fmt::format("{} ({})", what, physeng::to_string(type)));
+	}
+
+	auto is_close(float lhs, float rhs, float tolerance) -> bool
+	{
+		return std::abs(lhs - rhs) <= tolerance * std::max(1.0F, std::abs(rhs));
+	}
+
+	void check_normalization(physeng::smoothing_kernel const& kernel)
+	{
+		static constexpr int steps = 20000;
+
+		auto const radius = static_cast<double>(kernel.get_support_radius().get());
+		auto const dr = radius / steps;
+
+		// The circumference of a circle, or the area of a sphere, of radius r
+		auto const shell = [&](double r) {
+			return kernel.get_dimension() == 2 ? 2.0 * std::numbers::pi * r
+											   : 4.0 * std::numbers::pi * r * r;
+		};
+
+		auto integral = 0.0;
+		for (int step = 0; step < steps; ++step)
+		{
+			auto const r = (step + 0.5) * dr;
+			integral +=
+				shell(r) * static_cast<double>(kernel.evaluate(static_cast<float>(r * r))) * dr;
+		}
+
+		check(std::abs(integral - 1.0) < 1e-3, "kernel integrates to one", kernel.get_type());
+	}
+
+	void check_gradient(physeng::smoothing_kernel const& kernel)
+	{
+		static constexpr float step = 1e-3F;
+
+		for (float r = 0.05F; r < 0.95F; r += 0.05F) // NOLINT
+		{
+			auto const forward = kernel.evaluate((r + step) * (r + step));
+			auto const backward = kernel.evaluate((r - step) * (r - step));
+			auto const derivative = (forward - backward) / (2.0F * step);
+
+			check(is_close(kernel.evaluate_gradient(r * r) * r, derivative, 1e-2F),
+				  "gradient matches finite differences", kernel.get_type());
+		}
+	}
+
+	void check_batches(physeng::kernel_type type, std::size_t dimension)
+	{
+		// An odd size makes sure the tail of the batches is handled
+		auto distances_squared = std::vector<float>(1003); // NOLINT
+		auto const count = static_cast<float>(distances_squared.size());
+		for (std::size_t i = 0; i < distances_squared.size(); ++i)
+		{
+			auto const r = 1.1F * static_cast<float>(i) / count;
+			distances_squared[i] = r * r;
+		}
+
+		auto const reference =
+			physeng::smoothing_kernel{type, h, dimension, physeng::simd_level::scalar};
+
+		for (auto const level : simd_levels)
+		{
+			auto const kernel = physeng::smoothing_kernel{type, h, dimension, level};
+
+			auto values = std::vector<float>(distances_squared.size());
+			auto factors = std::vector<float>(distances_squared.size());
+			kernel.evaluate(distances_squared, values);
+			kernel.evaluate_gradient(distances_squared, factors);
+
+			for (std::size_t i = 0; i < distances_squared.size(); ++i)
+			{
+				check(is_close(values[i], reference.evaluate(distances_squared[i]), 1e-5F),
+					  "batched values match the scalar ones", type);
+				check(is_close(factors[i], reference.evaluate_gradient(distances_squared[i]),
+							   1e-5F),
+					  "batched gradients match the scalar ones", type);
+			}
+		}
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	for (auto const type : kernel_types)
+	{
+		for (auto const dimension : dimensions)
+		{
+			auto const kernel = physeng::smoothing_kernel{type, h, dimension};
+
+			check(kernel.get_dimension() == dimension, "dimension", type);
+			check(kernel.get_support_radius().get() == 2.0F * h.get(), "support radius", type);
+			check(kernel.evaluate(1.01F * 1.01F) == 0.0F, "kernel vanishes past the support",
+				  type);
+
+			check_normalization(kernel);
+			check_gradient(kernel);
+			check_batches(type, dimension);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <common/check.hpp>
+
+#include <libphyseng/concurrency/spsc_ring.hpp>
+#include <libphyseng/main.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+namespace
+{
+	using physeng::test::check;
+
+	void check_bounds()
+	{
+		auto ring = physeng::spsc_ring<std::unique_ptr<int>>{3};
+		check(ring.capacity() == 4, "the capacity is rounded up to a power of two");
+		check(!ring.try_pop().has_value(), "a new ring is empty");
+
+		for (int i = 0; i < 4; ++i)
+		{
+			check(ring.try_push(std::make_unique<int>(i)), "pushing into a ring with room");
+		}
+
+		auto extra = std::make_unique<int>(4);
+		check(!ring.try_push(std::move(extra)), "pushing into a full ring fails");
+		check(extra != nullptr, "a rejected value is left untouched"); // NOLINT
+		check(ring.size() == 4, "the size counts the queued items");
+
+		for (int i = 0; i < 4; ++i)
+		{
+			auto const value = ring.try_pop();
+			check(value.has_value() && **value == i, "items come out in order");
+		}
+		check(!ring.try_pop().has_value(), "the ring is empty once drained");
+	}
+
+	void check_concurrent()
+	{
+		static constexpr std::uint64_t count = 1'000'000;
+
+		auto ring = physeng::spsc_ring<std::uint64_t>{64};
+
+		auto producer = std::jthread{[&] {
+			for (std::uint64_t i = 0; i < count; ++i)
+			{
+				while (!ring.try_push(std::uint64_t{i}))
+				{
+					std::this_thread::yield();
+				}
+			}
+		}};
+
+		auto expected = std::uint64_t{0};
+		while (expected < count)
+		{
+			if (auto const value = ring.try_pop())
+			{
+				check(*value == expected, "items cross threads in order");
+				++expected;
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	check_bounds();
+	check_concurrent();
+
+	return EXIT_SUCCESS;
+}
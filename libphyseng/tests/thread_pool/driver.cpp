@@ -0,0 +1,207 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <common/check.hpp>
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+#include <libphyseng/concurrency/thread_pool.hpp>
+#include <libphyseng/concurrency/work_stealing_deque.hpp>
+#include <libphyseng/main.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using physeng::test::check;
+
+	void check_deque_order()
+	{
+		auto values = std::vector<int>(1000); // NOLINT
+		auto deque = physeng::work_stealing_deque<int>{4};
+
+		// Pushing more than the initial capacity forces the storage to grow
+		for (auto& value : values)
+		{
+			deque.push(&value);
+		}
+		check(deque.size() == values.size(), "every pushed item is in the deque");
+
+		check(deque.steal() == &values.front(), "thieves take the oldest item");
+		check(deque.pop() == &values.back(), "the owner takes the newest item");
+
+		auto remaining = std::size_t{0};
+		while (deque.pop() != nullptr)
+		{
+			++remaining;
+		}
+		check(remaining == values.size() - 2, "every item is popped once");
+		check(deque.steal() == nullptr && deque.pop() == nullptr, "the deque ends up empty");
+	}
+
+	void check_concurrent_steals()
+	{
+		static constexpr std::size_t item_count = 200'000;
+		static constexpr std::size_t thief_count = 3;
+
+		auto items = std::vector<int>(item_count, 0);
+		auto taken = std::vector<std::atomic<int>>(item_count);
+		auto deque = physeng::work_stealing_deque<int>{};
+		auto done = std::atomic<bool>{false};
+
+		auto const take = [&](int* item) {
+			taken[static_cast<std::size_t>(item - items.data())].fetch_add(1);
+		};
+
+		{
+			auto thieves = std::vector<std::jthread>{};
+			for (std::size_t thief = 0; thief < thief_count; ++thief)
+			{
+				thieves.emplace_back([&] {
+					while (!done.load())
+					{
+						if (auto* item = deque.steal())
+						{
+							take(item);
+						}
+					}
+				});
+			}
+
+			for (std::size_t i = 0; i < item_count; ++i)
+			{
+				deque.push(&items[i]);
+				if (i % 3 == 0)
+				{
+					if (auto* item = deque.pop())
+					{
+						take(item);
+					}
+				}
+			}
+			while (auto* item = deque.pop())
+			{
+				take(item);
+			}
+
+			// A thief may still be racing for the last item, it either wins or gives up
+			done.store(true);
+		}
+
+		for (auto const& count : taken)
+		{
+			check(count.load() == 1, "every item is taken exactly once");
+		}
+	}
+
+	void check_parallel_for(physeng::thread_pool& pool)
+	{
+		static constexpr std::size_t count = 100'003;
+
+		auto visits = std::vector<std::atomic<int>>(count);
+		physeng::parallel_for(pool, count, 64, [&](std::size_t first, std::size_t last) {
+			for (auto i = first; i < last; ++i)
+			{
+				visits[i].fetch_add(1);
+			}
+		});
+
+		for (auto const& visit : visits)
+		{
+			check(visit.load() == 1, "parallel_for visits every index once");
+		}
+
+		// Nested loops run on the deques of the workers that reach them
+		auto total = std::atomic<std::size_t>{0};
+		physeng::parallel_for(pool, 64, 1, [&](std::size_t first, std::size_t last) {
+			for (auto i = first; i < last; ++i)
+			{
+				physeng::parallel_for(pool, 1000, 10, [&](std::size_t begin, std::size_t end) {
+					total.fetch_add(end - begin);
+				});
+			}
+		});
+		check(total.load() == 64 * 1000, "nested parallel_for visits every index once");
+	}
+
+	auto fibonacci(physeng::thread_pool& pool, int n) -> long
+	{
+		if (n < 12) // NOLINT
+		{
+			return n < 2 ? n : fibonacci(pool, n - 1) + fibonacci(pool, n - 2);
+		}
+
+		auto lhs = 0L;
+		auto group = physeng::task_group{pool};
+		group.run([&] { lhs = fibonacci(pool, n - 1); });
+		auto const rhs = fibonacci(pool, n - 2);
+		group.wait();
+
+		return lhs + rhs;
+	}
+
+	void check_task_group(physeng::thread_pool& pool)
+	{
+		check(fibonacci(pool, 25) == 75025, "recursive task groups compute fibonacci"); // NOLINT
+
+		auto group = physeng::task_group{pool};
+		auto ran = std::atomic<int>{0};
+		for (int i = 0; i < 16; ++i) // NOLINT
+		{
+			group.run([&, i] {
+				ran.fetch_add(1);
+				if (i == 7) // NOLINT
+				{
+					throw std::runtime_error{"task failure"};
+				}
+			});
+		}
+
+		auto threw = false;
+		try
+		{
+			group.wait();
+		}
+		catch (std::runtime_error const&)
+		{
+			threw = true;
+		}
+		check(threw, "wait rethrows the exception of a task");
+		check(ran.load() == 16, "a failing task does not cancel the others");
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	check(physeng::get_default_thread_pool() != nullptr, "main installs a default pool");
+
+	check_deque_order();
+	check_concurrent_steals();
+
+	for (std::size_t const worker_count : {1U, 2U, 4U})
+	{
+		auto pool = physeng::thread_pool{{.worker_count = worker_count}};
+		check(pool.get_worker_count() == worker_count, "the pool has the requested workers");
+
+		check_parallel_for(pool);
+		check_task_group(pool);
+	}
+
+	return EXIT_SUCCESS;
+}
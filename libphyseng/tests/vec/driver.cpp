@@ -0,0 +1,131 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <common/check.hpp>
+
+#include <libphyseng/main.hpp>
+#include <libphyseng/math/units.hpp>
+#include <libphyseng/math/vec.hpp>
+
+#include <array>
+#include <cstdlib>
+#include <numeric>
+#include <span>
+#include <type_traits>
+
+namespace
+{
+	using physeng::test::check;
+	using physeng::area;
+	using physeng::density;
+	using physeng::length;
+	using physeng::mass;
+	using physeng::pressure;
+	using physeng::time_interval;
+	using physeng::vec2;
+	using physeng::vec3;
+	using physeng::vec3_batch;
+	using physeng::vec4;
+	using physeng::velocity;
+	using physeng::volume;
+
+	template<typename Lhs, typename Rhs>
+	concept addable = requires(Lhs lhs, Rhs rhs) { lhs + rhs; };
+
+	template<typename Lhs, typename Rhs>
+	concept comparable = requires(Lhs lhs, Rhs rhs) { lhs < rhs; };
+
+	// Mistakes in the units do not compile
+	static_assert(std::is_same_v<decltype(length{} * velocity{}),
+								 physeng::quantity<physeng::dimension<2, 0, -1>>>);
+	static_assert(std::is_same_v<decltype(length{} / time_interval{}), velocity>);
+	static_assert(std::is_same_v<decltype(mass{} / volume{}), density>);
+	static_assert(addable<length, length>);
+	static_assert(!addable<length, velocity>);
+	static_assert(!addable<length, float>);
+	static_assert(comparable<pressure, pressure>);
+	static_assert(!comparable<pressure, density>);
+	static_assert(!addable<vec3<length>, vec3<velocity>>);
+	static_assert(std::is_same_v<decltype(vec3<velocity>{} * time_interval{}), vec3<length>>);
+	static_assert(std::is_same_v<decltype(physeng::dot(vec3<length>{}, vec3<length>{})), area>);
+
+	// The types cost nothing over the raw floats
+	static_assert(sizeof(length) == sizeof(float));
+	static_assert(sizeof(vec3<length>) == 3 * sizeof(float));
+	static_assert(sizeof(vec3_batch<length>) == 24 * sizeof(float));
+	static_assert(std::is_trivially_copyable_v<length>);
+	static_assert(std::is_trivially_copyable_v<vec4<velocity>>);
+	static_assert(std::is_trivially_copyable_v<vec3_batch<length, 16>>);
+	static_assert(noexcept(vec3<float>{} + vec3<float>{}));
+	static_assert(noexcept(physeng::dot(vec3_batch<length>{}, vec3_batch<length>{})));
+
+	// And are usable in constant expressions
+	static_assert(physeng::dot(vec3<float>{{1.0F, 2.0F, 3.0F}}, vec3<float>{{4.0F, 5.0F, 6.0F}})
+				  == 32.0F);
+	static_assert(physeng::cross(vec3<float>{{1.0F, 0.0F, 0.0F}}, vec3<float>{{0.0F, 1.0F, 0.0F}})
+				  == vec3<float>{{0.0F, 0.0F, 1.0F}});
+	static_assert([] {
+		auto position = vec2<length>{{length{1.0F}, length{2.0F}}};
+		position += vec2<velocity>{{velocity{2.0F}, velocity{-4.0F}}} * time_interval{0.5F};
+
+		return position == vec2<length>{{length{2.0F}, length{0.0F}}};
+	}());
+	static_assert(physeng::length_squared(-vec4<float>{{1.0F, 1.0F, 1.0F, 1.0F}} / 2.0F) == 1.0F);
+
+	void check_batch()
+	{
+		static constexpr std::size_t count = 16;
+
+		auto columns = std::array<std::array<float, count>, 3>{};
+		for (std::size_t axis = 0; axis < columns.size(); ++axis)
+		{
+			std::iota(std::begin(columns[axis]), std::end(columns[axis]),
+					  static_cast<float>(axis));
+		}
+
+		auto const inputs = std::array<std::span<float const>, 3>{columns[0], columns[1],
+																  columns[2]};
+		auto const batch = vec3_batch<length>::load(inputs, 8);
+		check(batch.get(0) == vec3<length>{{length{8.0F}, length{9.0F}, length{10.0F}}},
+			  "a batch loads its lanes from an offset in the columns");
+
+		auto const origin = vec3<length>{{length{8.0F}, length{9.0F}, length{10.0F}}};
+		auto const distances = physeng::length_squared(batch - origin);
+		for (std::size_t lane = 0; lane < vec3_batch<length>::width; ++lane)
+		{
+			auto const expected = 3.0F * static_cast<float>(lane * lane);
+			check(distances[lane] == area{expected}, "the lanes are independent");
+		}
+
+		auto moved = batch;
+		moved += vec3_batch<velocity>::load(inputs, 0) * time_interval{2.0F};
+		moved.set(7, origin);
+
+		auto outputs = std::array<std::span<float>, 3>{columns[0], columns[1], columns[2]};
+		moved.store(outputs, 0);
+		check(columns[0][0] == 8.0F && columns[1][1] == 14.0F,
+			  "a batch stores its lanes to the columns");
+		check(columns[2][7] == 10.0F, "a lane can be set on its own");
+		check(columns[0][8] == 8.0F, "the columns past the batch are left untouched");
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	check_batch();
+
+	return EXIT_SUCCESS;
+}
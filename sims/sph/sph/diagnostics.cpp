@@ -0,0 +1,138 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <sph/diagnostics.hpp>
+
+#include <sph/core.hpp>
+
+#include <libphyseng/concurrency/parallel_reduce.hpp>
+#include <libphyseng/memory/frame_arena.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	struct partial_diagnostics
+	{
+		double kinetic_energy = 0.0;
+		float max_speed_squared = 0.0F;
+		double density_error = 0.0;
+	};
+} // namespace
+
+namespace sph
+{
+	template<physeng::precision_policy Precision>
+	auto compute_diagnostics(physeng::basic_particle_set<Precision> const& particles,
+							 float rest_density) -> diagnostics
+	{
+		if (particles.empty())
+		{
+			return {};
+		}
+
+		let vx = particles.velocity(0);
+		let vy = particles.velocity(1);
+		let vz = particles.velocity(2);
+		let mass = particles.mass();
+		let density = particles.density();
+
+		let reduce_block = [&](std::size_t begin, std::size_t end) {
+			auto result = partial_diagnostics{};
+			for (auto i = begin; i < end; ++i)
+			{
+				let v = std::array<float, 3>{vx[i], vy[i], vz[i]};
+				let speed_squared = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+
+				result.kinetic_energy += 0.5 * double{mass[i]} * double{speed_squared};
+				result.max_speed_squared = std::max(result.max_speed_squared, speed_squared);
+				result.density_error += std::abs(double{density[i]} - double{rest_density});
+			}
+
+			return result;
+		};
+
+		let combine = [](partial_diagnostics const& lhs, partial_diagnostics const& rhs) {
+			return partial_diagnostics{
+				.kinetic_energy = lhs.kinetic_energy + rhs.kinetic_energy,
+				.max_speed_squared = std::max(lhs.max_speed_squared, rhs.max_speed_squared),
+				.density_error = lhs.density_error + rhs.density_error};
+		};
+
+		let total = physeng::parallel_reduce(particles.size(), partial_diagnostics{},
+											 reduce_block, combine);
+
+		return {.kinetic_energy = total.kinetic_energy,
+				.max_speed = std::sqrt(total.max_speed_squared),
+				.average_density_error =
+					total.density_error
+					/ (double{rest_density} * static_cast<double>(particles.size()))};
+	}
+
+	template<physeng::precision_policy Precision>
+	auto compute_deviation(physeng::basic_particle_set<Precision> const& lhs,
+						   physeng::basic_particle_set<Precision> const& rhs) -> deviation
+	{
+		assert(lhs.size() == rhs.size()); // NOLINT
+
+		let reduce_block = [&](std::size_t begin, std::size_t end) {
+			auto result = deviation{};
+			for (auto i = begin; i < end; ++i)
+			{
+				auto position_squared = 0.0F;
+				auto velocity_squared = 0.0F;
+				for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+				{
+					let dx = lhs.position(axis)[i] - rhs.position(axis)[i];
+					let dv = float{lhs.velocity(axis)[i]} - float{rhs.velocity(axis)[i]};
+					position_squared += dx * dx;
+					velocity_squared += dv * dv;
+				}
+
+				result.position = std::max(result.position, std::sqrt(position_squared));
+				result.velocity = std::max(result.velocity, std::sqrt(velocity_squared));
+				result.density =
+					std::max(result.density, std::abs(lhs.density()[i] - rhs.density()[i]));
+			}
+
+			return result;
+		};
+
+		let combine = [](deviation const& first, deviation const& second) {
+			return deviation{.position = std::max(first.position, second.position),
+							 .velocity = std::max(first.velocity, second.velocity),
+							 .density = std::max(first.density, second.density)};
+		};
+
+		// Compared after every step, the partials live in the frame of the step
+		return physeng::parallel_reduce(lhs.size(), deviation{}, reduce_block, combine,
+										physeng::get_frame_resource());
+	}
+
+	template auto compute_diagnostics(physeng::particle_set const& particles, float rest_density)
+		-> diagnostics;
+	template auto compute_diagnostics(physeng::compact_particle_set const& particles,
+									  float rest_density) -> diagnostics;
+
+	template auto compute_deviation(physeng::particle_set const& lhs,
+									physeng::particle_set const& rhs) -> deviation;
+	template auto compute_deviation(physeng::compact_particle_set const& lhs,
+									physeng::compact_particle_set const& rhs) -> deviation;
+} // namespace sph
@@ -0,0 +1,59 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <libphyseng/particles/particle_set.hpp>
+
+namespace sph
+{
+	/**
+	 * @brief Global quantities monitored at every step of a simulation
+	 */
+	struct diagnostics
+	{
+		double kinetic_energy = 0.0;        //< Sum of 1/2 m v^2 over every particle
+		float max_speed = 0.0F;             //< Largest particle speed, used for the CFL condition
+		double average_density_error = 0.0; //< Mean of |rho - rho_0| / rho_0
+	};
+
+	/**
+	 * @brief The largest differences between two states of the same particles
+	 */
+	struct deviation
+	{
+		float position = 0.0F; //< Largest distance between the positions of a particle
+		float velocity = 0.0F; //< Largest difference between the velocities of a particle
+		float density = 0.0F;  //< Largest difference between the densities of a particle
+	};
+
+	/**
+	 * @brief Compute the diagnostics of a particle set in parallel. The sums are reduced in a
+	 * fixed order, the result is therefore the same for any number of threads
+	 */
+	template<physeng::precision_policy Precision>
+	auto compute_diagnostics(physeng::basic_particle_set<Precision> const& particles,
+							 float rest_density) -> diagnostics;
+
+	/**
+	 * @brief Measure how far `lhs` is from `rhs`, for instance to check that two solvers agree.
+	 * Both sets must hold the same particles in the same order
+	 */
+	template<physeng::precision_policy Precision>
+	auto compute_deviation(physeng::basic_particle_set<Precision> const& lhs,
+						   physeng::basic_particle_set<Precision> const& rhs) -> deviation;
+} // namespace sph
@@ -0,0 +1,556 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <sph/options.hpp>
+
+#include <sph/core.hpp>
+#include <sph/output/compressed_stream.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+
+namespace
+{
+	using namespace std::literals;
+
+	auto parse_neighbor_backend(std::string_view value)
+		-> tl::expected<physeng::neighbor_backend, sph::options_error>
+	{
+		if (value == "grid"sv)
+		{
+			return physeng::neighbor_backend::uniform_grid;
+		}
+
+		if (value == "hash"sv)
+		{
+			return physeng::neighbor_backend::spatial_hash;
+		}
+
+		return tl::unexpected(sph::options_error::invalid_value);
+	}
+
+	auto parse_scenario(std::string_view value)
+		-> tl::expected<sph::scenario_type, sph::options_error>
+	{
+		if (value == "dam-break"sv)
+		{
+			return sph::scenario_type::dam_break;
+		}
+
+		if (value == "still-tank"sv)
+		{
+			return sph::scenario_type::still_tank;
+		}
+
+		if (value == "double-dam-break"sv)
+		{
+			return sph::scenario_type::double_dam_break;
+		}
+
+		return tl::unexpected(sph::options_error::invalid_value);
+	}
+
+	auto parse_backend(std::string_view value)
+		-> tl::expected<sph::backend_type, sph::options_error>
+	{
+		if (value == "cpu"sv)
+		{
+			return sph::backend_type::cpu;
+		}
+
+		if (value == "vulkan"sv)
+		{
+			return sph::backend_type::vulkan;
+		}
+
+		return tl::unexpected(sph::options_error::invalid_value);
+	}
+
+	auto parse_solver(std::string_view value) -> tl::expected<sph::solver_type, sph::options_error>
+	{
+		if (value == "wcsph"sv)
+		{
+			return sph::solver_type::wcsph;
+		}
+
+		if (value == "dfsph"sv)
+		{
+			return sph::solver_type::dfsph;
+		}
+
+		return tl::unexpected(sph::options_error::invalid_value);
+	}
+
+	auto parse_dimension(std::string_view value) -> tl::expected<std::size_t, sph::options_error>
+	{
+		if (value == "2"sv)
+		{
+			return 2;
+		}
+
+		if (value == "3"sv)
+		{
+			return 3;
+		}
+
+		return tl::unexpected(sph::options_error::invalid_value);
+	}
+
+	auto parse_kernel(std::string_view value)
+		-> tl::expected<physeng::kernel_type, sph::options_error>
+	{
+		if (value == "cubic-spline"sv)
+		{
+			return physeng::kernel_type::cubic_spline;
+		}
+
+		if (value == "wendland-c2"sv)
+		{
+			return physeng::kernel_type::wendland_c2;
+		}
+
+		if (value == "wendland-c4"sv)
+		{
+			return physeng::kernel_type::wendland_c4;
+		}
+
+		return tl::unexpected(sph::options_error::invalid_value);
+	}
+
+	auto parse_precision(std::string_view value)
+		-> tl::expected<sph::precision_type, sph::options_error>
+	{
+		if (value == "single"sv)
+		{
+			return sph::precision_type::single;
+		}
+
+		if (value == "compact"sv)
+		{
+			return sph::precision_type::compact;
+		}
+
+		return tl::unexpected(sph::options_error::invalid_value);
+	}
+
+	auto parse_non_negative(std::string_view value) -> tl::expected<float, sph::options_error>
+	{
+		auto result = 0.0F;
+		let [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+
+		if (error != std::errc{} || end != value.data() + value.size() || result < 0.0F)
+		{
+			return tl::unexpected(sph::options_error::invalid_value);
+		}
+
+		return result;
+	}
+
+	auto parse_count(std::string_view value) -> tl::expected<std::uint64_t, sph::options_error>
+	{
+		auto result = std::uint64_t{0};
+		let [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+
+		if (error != std::errc{} || end != value.data() + value.size())
+		{
+			return tl::unexpected(sph::options_error::invalid_value);
+		}
+
+		return result;
+	}
+
+	/**
+	 * @brief Parse a positive particle count, where a `k` or `M` suffix stands for a thousand or
+	 * a million particles
+	 */
+	auto parse_particle_count(std::string_view value)
+		-> tl::expected<std::size_t, sph::options_error>
+	{
+		auto multiplier = std::uint64_t{1};
+		if (value.ends_with('k'))
+		{
+			multiplier = 1'000;
+			value.remove_suffix(1);
+		}
+		else if (value.ends_with('M'))
+		{
+			multiplier = 1'000'000;
+			value.remove_suffix(1);
+		}
+
+		let count = parse_count(value);
+		if (!count || count.value() == 0
+			|| count.value() > std::numeric_limits<std::uint32_t>::max() / multiplier)
+		{
+			return tl::unexpected(sph::options_error::invalid_value);
+		}
+
+		return static_cast<std::size_t>(count.value() * multiplier);
+	}
+
+	auto parse_output_policy(std::string_view value)
+		-> tl::expected<sph::backpressure_policy, sph::options_error>
+	{
+		if (value == "skip"sv)
+		{
+			return sph::backpressure_policy::skip;
+		}
+
+		if (value == "block"sv)
+		{
+			return sph::backpressure_policy::block;
+		}
+
+		return tl::unexpected(sph::options_error::invalid_value);
+	}
+
+	auto parse_output_format(std::string_view value)
+		-> tl::expected<sph::output_format, sph::options_error>
+	{
+		if (value == "raw"sv)
+		{
+			return sph::output_format::raw;
+		}
+
+		if (value == "compressed"sv)
+		{
+			return sph::output_format::compressed;
+		}
+
+		return tl::unexpected(sph::options_error::invalid_value);
+	}
+
+	auto parse_output_columns(std::string_view value)
+		-> tl::expected<sph::output_columns, sph::options_error>
+	{
+		auto result = sph::output_columns{};
+
+		while (!value.empty())
+		{
+			let separator = value.find(',');
+			let column = value.substr(0, separator);
+			value = separator == std::string_view::npos ? ""sv : value.substr(separator + 1);
+
+			if (column == "velocity"sv)
+			{
+				result.velocity = true;
+			}
+			else if (column == "density"sv)
+			{
+				result.density = true;
+			}
+			else if (column == "pressure"sv)
+			{
+				result.pressure = true;
+			}
+			else
+			{
+				return tl::unexpected(sph::options_error::invalid_value);
+			}
+		}
+
+		return result;
+	}
+
+	auto parse_path(std::string_view value)
+		-> tl::expected<std::filesystem::path, sph::options_error>
+	{
+		if (value.empty())
+		{
+			return tl::unexpected(sph::options_error::invalid_value);
+		}
+
+		return std::filesystem::path{value};
+	}
+} // namespace
+
+namespace sph
+{
+	auto parse_options(std::span<std::string_view const> args)
+		-> tl::expected<options, options_error>
+	{
+		auto result = options{};
+
+		// The first argument is the name of the application
+		for (let arg : args.subspan(std::min<std::size_t>(1, args.size())))
+		{
+			let separator = arg.find('=');
+			let name = arg.substr(0, separator);
+			let value = separator == std::string_view::npos ? ""sv : arg.substr(separator + 1);
+
+			if (name == "--headless"sv)
+			{
+				if (!value.empty())
+				{
+					return tl::unexpected(options_error::invalid_value);
+				}
+
+				result.is_headless = true;
+			}
+			else if (name == "--scenario"sv)
+			{
+				let scenario = parse_scenario(value);
+				if (!scenario)
+				{
+					return tl::unexpected(scenario.error());
+				}
+
+				result.scenario = scenario.value();
+			}
+			else if (name == "--dimension"sv)
+			{
+				let dimension = parse_dimension(value);
+				if (!dimension)
+				{
+					return tl::unexpected(dimension.error());
+				}
+
+				result.dimension = dimension.value();
+			}
+			else if (name == "--particles"sv)
+			{
+				let count = parse_particle_count(value);
+				if (!count)
+				{
+					return tl::unexpected(count.error());
+				}
+
+				result.particle_count = count.value();
+			}
+			else if (name == "--backend"sv)
+			{
+				let backend = parse_backend(value);
+				if (!backend)
+				{
+					return tl::unexpected(backend.error());
+				}
+
+				result.backend = backend.value();
+			}
+			else if (name == "--compare-backends"sv)
+			{
+				if (!value.empty())
+				{
+					return tl::unexpected(options_error::invalid_value);
+				}
+
+				result.is_comparing_backends = true;
+			}
+			else if (name == "--pipeline-cache"sv)
+			{
+				let path = parse_path(value);
+				if (!path)
+				{
+					return tl::unexpected(path.error());
+				}
+
+				result.pipeline_cache_path = path.value();
+			}
+			else if (name == "--neighbor-search"sv)
+			{
+				let backend = parse_neighbor_backend(value);
+				if (!backend)
+				{
+					return tl::unexpected(backend.error());
+				}
+
+				result.neighbor_backend = backend.value();
+			}
+			else if (name == "--solver"sv)
+			{
+				let solver = parse_solver(value);
+				if (!solver)
+				{
+					return tl::unexpected(solver.error());
+				}
+
+				result.solver = solver.value();
+			}
+			else if (name == "--kernel"sv)
+			{
+				let kernel = parse_kernel(value);
+				if (!kernel)
+				{
+					return tl::unexpected(kernel.error());
+				}
+
+				result.kernel = kernel.value();
+			}
+			else if (name == "--precision"sv)
+			{
+				let precision = parse_precision(value);
+				if (!precision)
+				{
+					return tl::unexpected(precision.error());
+				}
+
+				result.precision = precision.value();
+			}
+			else if (name == "--verlet-skin"sv)
+			{
+				let skin = parse_non_negative(value);
+				if (!skin)
+				{
+					return tl::unexpected(skin.error());
+				}
+
+				result.verlet_skin = skin.value();
+			}
+			else if (name == "--steps"sv)
+			{
+				let count = parse_count(value);
+				if (!count)
+				{
+					return tl::unexpected(count.error());
+				}
+
+				result.step_count = count.value();
+			}
+			else if (name == "--reorder-interval"sv)
+			{
+				let count = parse_count(value);
+				if (!count)
+				{
+					return tl::unexpected(count.error());
+				}
+
+				result.reorder_interval = count.value();
+			}
+			else if (name == "--reorder-degradation"sv)
+			{
+				let ratio = parse_non_negative(value);
+				if (!ratio)
+				{
+					return tl::unexpected(ratio.error());
+				}
+
+				result.reorder_degradation = ratio.value();
+			}
+			else if (name == "--checkpoint"sv)
+			{
+				let path = parse_path(value);
+				if (!path)
+				{
+					return tl::unexpected(path.error());
+				}
+
+				result.checkpoint_path = path.value();
+			}
+			else if (name == "--checkpoint-interval"sv)
+			{
+				let count = parse_count(value);
+				if (!count)
+				{
+					return tl::unexpected(count.error());
+				}
+
+				result.checkpoint_interval = count.value();
+			}
+			else if (name == "--restart"sv)
+			{
+				let path = parse_path(value);
+				if (!path)
+				{
+					return tl::unexpected(path.error());
+				}
+
+				result.restart_path = path.value();
+			}
+			else if (name == "--output"sv)
+			{
+				let path = parse_path(value);
+				if (!path)
+				{
+					return tl::unexpected(path.error());
+				}
+
+				result.output_path = path.value();
+			}
+			else if (name == "--output-interval"sv)
+			{
+				let count = parse_count(value);
+				if (!count || count.value() == 0)
+				{
+					return tl::unexpected(options_error::invalid_value);
+				}
+
+				result.output_interval = count.value();
+			}
+			else if (name == "--output-policy"sv)
+			{
+				let policy = parse_output_policy(value);
+				if (!policy)
+				{
+					return tl::unexpected(policy.error());
+				}
+
+				result.output_policy = policy.value();
+			}
+			else if (name == "--output-columns"sv)
+			{
+				let columns = parse_output_columns(value);
+				if (!columns)
+				{
+					return tl::unexpected(columns.error());
+				}
+
+				result.output_columns = columns.value();
+			}
+			else if (name == "--output-format"sv)
+			{
+				let format = parse_output_format(value);
+				if (!format)
+				{
+					return tl::unexpected(format.error());
+				}
+
+				result.output_format = format.value();
+			}
+			else if (name == "--output-error"sv)
+			{
+				// The quantization of the compressed stream cannot go finer
+				let ratio = parse_non_negative(value);
+				if (!ratio || ratio.value() < compression_settings::min_relative_error)
+				{
+					return tl::unexpected(options_error::invalid_value);
+				}
+
+				result.output_relative_error = ratio.value();
+			}
+			else
+			{
+				return tl::unexpected(options_error::unknown_argument);
+			}
+		}
+
+		return result;
+	}
+
+	auto to_string(options_error error) -> std::string_view
+	{
+		switch (error)
+		{
+			case options_error::unknown_argument:
+				return "unknown argument"sv;
+			case options_error::invalid_value:
+				return "invalid argument value"sv;
+		}
+
+		return {};
+	}
+} // namespace sph
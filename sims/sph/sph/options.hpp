@@ -0,0 +1,151 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <sph/output/frame.hpp>
+#include <sph/output/frame_writer.hpp>
+#include <sph/scene.hpp>
+
+#include <libphyseng/kernels/smoothing_kernel.hpp>
+#include <libphyseng/neighbor/neighbor_search.hpp>
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+namespace sph
+{
+	enum struct options_error
+	{
+		unknown_argument,
+		invalid_value
+	};
+
+	/**
+	 * @brief The pressure solvers a run can use
+	 */
+	enum struct solver_type
+	{
+		wcsph, //< Weakly compressible SPH, cheap steps but a small time step
+		dfsph  //< Divergence free SPH, iterative solves allowing much larger time steps
+	};
+
+	/**
+	 * @brief Where the steps of the solver run
+	 */
+	enum struct backend_type
+	{
+		cpu,   //< On the thread pool
+		vulkan //< In compute shaders, only implemented for WCSPH
+	};
+
+	/**
+	 * @brief How the particles are stored, see libphyseng/particles/precision.hpp
+	 */
+	enum struct precision_type
+	{
+		single, //< Every attribute as a float
+		compact //< Velocities as bfloat16, neighbor sums in double precision
+	};
+
+	/**
+	 * @brief How frames are stored on disk
+	 */
+	enum struct output_format
+	{
+		raw,       //< One uncompressed file per frame
+		compressed //< A single lossy compressed stream of every frame
+	};
+
+	/**
+	 * @brief The settings of a run, chosen from the command line
+	 */
+	struct options
+	{
+		bool is_headless = false; //< Run on the CPU alone, without ever loading Vulkan
+		scenario_type scenario = scenario_type::dam_break;
+		std::size_t dimension = 3;          //< 2 to simulate the xy cross section of the scene
+		std::size_t particle_count = 32768; //< Approximate size of the scene, ignored on restart
+		backend_type backend = backend_type::cpu;
+		bool is_comparing_backends = false; //< Check every GPU step against the CPU solver
+		std::filesystem::path pipeline_cache_path = {}; //< Empty for the user's cache directory
+		physeng::neighbor_backend neighbor_backend = physeng::neighbor_backend::uniform_grid;
+		solver_type solver = solver_type::wcsph;
+		physeng::kernel_type kernel = physeng::kernel_type::cubic_spline;
+		precision_type precision = precision_type::single;
+		float verlet_skin = 0.1F;       //< Skin of the verlet lists, relative to the support radius
+		std::uint64_t step_count = 100; //< Number of solver steps to run
+
+		std::uint64_t reorder_interval = 0; //< Steps between two Morton reorders, 0 to disable
+		float reorder_degradation = 0.0F;   //< Locality loss that triggers a reorder, 0 to disable
+
+		std::filesystem::path checkpoint_path = {}; //< Where to checkpoint the run, empty for none
+		std::uint64_t checkpoint_interval = 0;      //< Steps between two checkpoints, 0 for the end
+		std::filesystem::path restart_path = {};    //< Checkpoint to start from, empty for none
+
+		std::filesystem::path output_path = {}; //< Directory the frames go to, empty for none
+		std::uint64_t output_interval = 1;      //< Steps between two frames
+		backpressure_policy output_policy = backpressure_policy::skip;
+		sph::output_columns output_columns = {};
+		sph::output_format output_format = output_format::raw;
+		float output_relative_error = 1.0e-3F; //< Error bound of the compressed format
+	};
+
+	/**
+	 * @brief Parse the command line arguments given to physeng_main
+	 *
+	 * Recognized arguments:
+	 *  - `--headless`: skip the GPU entirely, for machines without a Vulkan driver
+	 *  - `--scenario=dam-break|still-tank|double-dam-break`: the scene to simulate
+	 *  - `--dimension=2|3`: simulate the scene in three dimensions, or its xy cross section in two
+	 *  - `--particles=<count>`: about how many particles the scene holds, with an optional `k` or
+	 *    `M` suffix, as in `--particles=1M`
+	 *  - `--backend=cpu|vulkan`: run the steps on the CPU or on the GPU
+	 *  - `--compare-backends`: also run every step of the GPU on the CPU, and fail if they do not
+	 *    agree
+	 *  - `--pipeline-cache=<path>`: keep the compiled compute shaders in the directory `path`
+	 *  - `--neighbor-search=grid|hash`: the neighbor search backend
+	 *  - `--solver=wcsph|dfsph`: the pressure solver
+	 *  - `--kernel=cubic-spline|wendland-c2|wendland-c4`: the smoothing kernel
+	 *  - `--precision=single|compact`: store the velocities as floats or as bfloat16
+	 *  - `--verlet-skin=<ratio>`: the skin of the verlet lists as a fraction of the support radius
+	 *  - `--steps=<count>`: the number of solver steps to run
+	 *  - `--reorder-interval=<count>`: sort the particles along a Morton curve every `count` steps
+	 *  - `--reorder-degradation=<ratio>`: sort the particles along a Morton curve whenever their
+	 *    locality gets `ratio` times worse than right after the last sort
+	 *  - `--checkpoint=<path>`: write a checkpoint of the particles to `path` at the end of the run
+	 *  - `--checkpoint-interval=<count>`: also write the checkpoint every `count` steps
+	 *  - `--restart=<path>`: start from the checkpoint at `path` instead of the initial scene
+	 *  - `--output=<path>`: write frames to the directory `path`
+	 *  - `--output-interval=<count>`: write a frame every `count` steps
+	 *  - `--output-policy=skip|block`: drop frames or wait when the writer falls behind
+	 *  - `--output-columns=<list>`: comma separated columns written besides the positions, out
+	 *    of `velocity`, `density` and `pressure`
+	 *  - `--output-format=raw|compressed`: one file per frame, or a single compressed stream
+	 *  - `--output-error=<ratio>`: the largest error of the compressed values, relative to the
+	 *    range of their column, at least `compression_settings::min_relative_error`
+	 */
+	auto parse_options(std::span<std::string_view const> args)
+		-> tl::expected<options, options_error>;
+
+	auto to_string(options_error error) -> std::string_view;
+} // namespace sph
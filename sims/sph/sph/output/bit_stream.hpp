@@ -0,0 +1,160 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace sph
+{
+	/**
+	 * @brief Packs values of arbitrary bit widths into bytes, least significant bit first
+	 */
+	class bit_writer
+	{
+	public:
+		explicit bit_writer(std::vector<std::uint8_t>& bytes) : m_bytes(&bytes) {}
+
+		/**
+		 * @brief Append the `count` low bits of `value`, `count` being at most 32
+		 */
+		void write(std::uint64_t value, unsigned count)
+		{
+			assert(count <= 32); // NOLINT
+
+			m_buffer |= (value & ((std::uint64_t{1} << count) - 1)) << m_filled;
+			m_filled += count;
+
+			while (m_filled >= 8)
+			{
+				m_bytes->push_back(static_cast<std::uint8_t>(m_buffer));
+				m_buffer >>= 8U;
+				m_filled -= 8;
+			}
+		}
+
+		/**
+		 * @brief Append `count` one bits followed by a zero, `count` being below 32
+		 */
+		void write_unary(unsigned count)
+		{
+			assert(count < 32); // NOLINT
+
+			write((std::uint64_t{1} << count) - 1, count + 1);
+		}
+
+		/**
+		 * @brief Write out the last partial byte, padded with zeros
+		 */
+		void flush()
+		{
+			if (m_filled > 0)
+			{
+				m_bytes->push_back(static_cast<std::uint8_t>(m_buffer));
+				m_buffer = 0;
+				m_filled = 0;
+			}
+		}
+
+	private:
+		std::vector<std::uint8_t>* m_bytes;
+		std::uint64_t m_buffer = 0;
+		unsigned m_filled = 0;
+	};
+
+	/**
+	 * @brief Reads back what a `bit_writer` packed. Reading past the end yields zero bits, the
+	 * caller checks `is_overrun` once done
+	 */
+	class bit_reader
+	{
+	public:
+		explicit bit_reader(std::span<std::uint8_t const> bytes) :
+			m_bytes(bytes), m_bit_count(8 * bytes.size())
+		{}
+
+		/**
+		 * @brief Read a value of `count` bits, `count` being at most 32
+		 */
+		auto read(unsigned count) -> std::uint64_t
+		{
+			assert(count <= 32); // NOLINT
+
+			refill();
+
+			auto const value = m_buffer & ((std::uint64_t{1} << count) - 1);
+			consume(count);
+
+			return value;
+		}
+
+		/**
+		 * @brief Read the number of one bits before the next zero. A run of `limit` ones, at most
+		 * 32, is an escape: it is not followed by a zero
+		 */
+		auto read_unary(unsigned limit) -> unsigned
+		{
+			assert(limit <= 32); // NOLINT
+
+			refill();
+
+			auto const run = std::min(static_cast<unsigned>(std::countr_one(m_buffer)), limit);
+			consume(run == limit ? run : run + 1);
+
+			return run;
+		}
+
+		[[nodiscard]] auto is_overrun() const noexcept -> bool
+		{
+			return m_consumed > m_bit_count;
+		}
+
+	private:
+		void refill()
+		{
+			// Past the end the buffer is filled with zeros
+			for (; m_filled <= 56; m_filled += 8)
+			{
+				if (m_position < m_bytes.size())
+				{
+					m_buffer |= std::uint64_t{m_bytes[m_position++]} << m_filled;
+				}
+			}
+		}
+
+		void consume(unsigned count)
+		{
+			m_buffer >>= count;
+			m_filled -= count;
+			m_consumed += count;
+		}
+
+	private:
+		std::span<std::uint8_t const> m_bytes;
+		std::size_t m_position = 0;
+		std::size_t m_bit_count;
+		std::size_t m_consumed = 0;
+
+		std::uint64_t m_buffer = 0;
+		unsigned m_filled = 0;
+	};
+} // namespace sph
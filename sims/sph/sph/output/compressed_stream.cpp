@@ -0,0 +1,766 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sph/output/compressed_stream.hpp>
+
+#include <sph/core.hpp>
+#include <sph/output/bit_stream.hpp>
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace
+{
+	constexpr std::uint32_t stream_version = 1;
+	constexpr std::uint32_t block_size = 16384;
+	// At most three position and velocity axes, the density and the pressure
+	constexpr std::size_t max_channel_count = 8;
+
+	// A unary quotient this long is an escape, the value follows in `raw_bits` bits
+	constexpr unsigned escape_length = 32;
+	constexpr unsigned raw_bits = 33;
+	constexpr unsigned rice_parameter_bits = 5;
+
+	constexpr std::array<char, 8> stream_magic = {'P', 'H', 'Y', 'S', 'S', 'T', 'R', 'M'};
+	constexpr std::array<char, 8> frame_magic = {'P', 'H', 'Y', 'S', 'F', 'R', 'M', 'C'};
+	constexpr std::array<char, 8> index_magic = {'P', 'H', 'Y', 'S', 'I', 'N', 'D', 'X'};
+
+	struct stream_header
+	{
+		std::array<char, 8> magic;
+		std::uint32_t version;
+		std::uint32_t reserved;
+	};
+
+	struct frame_header
+	{
+		std::array<char, 8> magic;
+		std::uint64_t step;
+		double time;
+		std::uint64_t particle_count;
+		std::uint32_t columns;
+		std::uint32_t channel_count;
+		std::uint32_t block_size;
+		std::uint32_t block_count;
+		std::uint64_t payload_size;
+	};
+
+	/**
+	 * @brief How the values of a channel are quantized: `value = min + level * step`
+	 */
+	struct channel_descriptor
+	{
+		float min;
+		float step;
+	};
+
+	struct stream_trailer
+	{
+		std::uint64_t frame_count;
+		std::uint64_t index_offset;
+		std::array<char, 8> magic;
+	};
+
+	static_assert(std::is_trivially_copyable_v<frame_header> && sizeof(frame_header) == 56);
+	static_assert(sizeof(stream_header) == 16 && sizeof(stream_trailer) == 24);
+	static_assert(sizeof(sph::stream_index_entry) == 24 && sizeof(channel_descriptor) == 8);
+
+	template<typename Type>
+	void write_value(std::ofstream& file, Type const& value)
+	{
+		file.write(reinterpret_cast<char const*>(&value), sizeof(Type)); // NOLINT
+	}
+
+	template<typename Type>
+	void write_values(std::ofstream& file, std::span<Type const> values)
+	{
+		file.write(reinterpret_cast<char const*>(values.data()), // NOLINT
+				   static_cast<std::streamsize>(values.size_bytes()));
+	}
+
+	template<typename Type>
+	auto read_values(std::ifstream& file, std::span<Type> values) -> bool
+	{
+		file.read(reinterpret_cast<char*>(values.data()), // NOLINT
+				  static_cast<std::streamsize>(values.size_bytes()));
+
+		return static_cast<bool>(file);
+	}
+
+	template<typename Type>
+	auto read_value(std::ifstream& file, Type& value) -> bool
+	{
+		return read_values(file, std::span{&value, 1});
+	}
+
+	auto to_zigzag(std::int64_t value) noexcept -> std::uint64_t
+	{
+		return (static_cast<std::uint64_t>(value) << 1U) ^ static_cast<std::uint64_t>(value >> 63);
+	}
+
+	auto from_zigzag(std::uint64_t value) noexcept -> std::int64_t
+	{
+		return static_cast<std::int64_t>(value >> 1U) ^ -static_cast<std::int64_t>(value & 1U);
+	}
+
+	auto get_channels(sph::frame const& output) -> std::vector<std::span<float const>>
+	{
+		auto channels = std::vector<std::span<float const>>{};
+		channels.reserve(max_channel_count);
+
+		for (let& column : output.position)
+		{
+			channels.emplace_back(column);
+		}
+		for (let& column : output.velocity)
+		{
+			if (!column.empty())
+			{
+				channels.emplace_back(column);
+			}
+		}
+		if (!output.density.empty())
+		{
+			channels.emplace_back(output.density);
+		}
+		if (!output.pressure.empty())
+		{
+			channels.emplace_back(output.pressure);
+		}
+
+		return channels;
+	}
+
+	/**
+	 * @brief Size `output` for `count` particles with the given columns, and return the channels
+	 * to decode into in the order `get_channels` lists them
+	 */
+	auto prepare_channels(sph::frame& output, std::size_t count, sph::output_columns columns)
+		-> std::vector<std::span<float>>
+	{
+		auto channels = std::vector<std::span<float>>{};
+		let add = [&](std::vector<float>& column, bool is_present) {
+			column.resize(is_present ? count : 0);
+			if (is_present)
+			{
+				channels.emplace_back(column);
+			}
+		};
+
+		for (auto& column : output.position)
+		{
+			add(column, true);
+		}
+		for (auto& column : output.velocity)
+		{
+			add(column, columns.velocity);
+		}
+		add(output.density, columns.density);
+		add(output.pressure, columns.pressure);
+
+		return channels;
+	}
+
+	/**
+	 * @brief Whether every value is finite and every position lies within `bounds`, which the
+	 * quantization relies on to keep the levels in range
+	 */
+	auto is_encodable(std::span<std::span<float const> const> channels, sph::domain const& bounds,
+					  std::size_t count) -> bool
+	{
+		let block_count = (count + block_size - 1) / block_size;
+		auto is_valid = std::atomic<bool>{true};
+
+		physeng::parallel_for(block_count, 1, [&](std::size_t first, std::size_t last) {
+			for (auto block = first; block < last && is_valid.load(std::memory_order_relaxed);
+				 ++block)
+			{
+				let begin = block * block_size;
+				let end = std::min(count, begin + block_size);
+
+				for (std::size_t c = 0; c < channels.size(); ++c)
+				{
+					let is_position = c < physeng::particle_set::dimension;
+					let min = is_position ? bounds.min[c] : std::numeric_limits<float>::lowest();
+					let max = is_position ? bounds.max[c] : std::numeric_limits<float>::max();
+
+					// Written so that a NaN fails the comparisons
+					let is_in_range = std::all_of(std::begin(channels[c]) + begin,
+												  std::begin(channels[c]) + end,
+												  [&](float value) {
+													  return value >= min && value <= max;
+												  });
+					if (!is_in_range)
+					{
+						is_valid.store(false, std::memory_order_relaxed);
+					}
+				}
+			}
+		});
+
+		return is_valid.load();
+	}
+
+	auto make_descriptor(float min, float max, float relative_error) -> channel_descriptor
+	{
+		// The error is half a step, minus a margin for the rounding of the reconstructed values
+		let step = 1.99F * relative_error * (max - min);
+
+		return {.min = min, .step = step > 0.0F ? step : 1.0F};
+	}
+
+	/**
+	 * @brief The range of values of every channel past the positions, reduced over the blocks
+	 */
+	auto find_ranges(std::span<std::span<float const> const> channels, std::size_t count)
+		-> std::vector<std::pair<float, float>>
+	{
+		let block_count = (count + block_size - 1) / block_size;
+		let empty_range = std::pair{std::numeric_limits<float>::max(),
+									std::numeric_limits<float>::lowest()};
+
+		auto partials = std::vector<std::pair<float, float>>(block_count * channels.size(),
+															 empty_range);
+
+		physeng::parallel_for(block_count, 1, [&](std::size_t first, std::size_t last) {
+			for (auto block = first; block < last; ++block)
+			{
+				let begin = block * block_size;
+				let end = std::min(count, begin + block_size);
+
+				for (std::size_t c = 0; c < channels.size(); ++c)
+				{
+					let [min, max] = std::minmax_element(std::begin(channels[c]) + begin,
+														 std::begin(channels[c]) + end);
+					partials[block * channels.size() + c] = {*min, *max};
+				}
+			}
+		});
+
+		auto ranges = std::vector<std::pair<float, float>>(channels.size(), empty_range);
+		for (std::size_t block = 0; block < block_count; ++block)
+		{
+			for (std::size_t c = 0; c < channels.size(); ++c)
+			{
+				let& partial = partials[block * channels.size() + c];
+				ranges[c] = {std::min(ranges[c].first, partial.first),
+							 std::max(ranges[c].second, partial.second)};
+			}
+		}
+
+		return ranges;
+	}
+
+	/**
+	 * @brief The Rice parameter minimizing the size of `residuals`, searched around the one
+	 * given by their mean
+	 */
+	auto choose_rice_parameter(std::span<std::uint64_t const> residuals) -> unsigned
+	{
+		if (residuals.empty())
+		{
+			return 0;
+		}
+
+		auto sum = std::uint64_t{0};
+		for (let residual : residuals)
+		{
+			sum += residual;
+		}
+
+		let mean = sum / residuals.size();
+		let estimate = mean == 0 ? 0U : static_cast<unsigned>(std::bit_width(mean)) - 1;
+
+		let cost = [&](unsigned k) {
+			auto bits = std::uint64_t{0};
+			for (let residual : residuals)
+			{
+				let quotient = residual >> k;
+				bits += quotient < escape_length ? quotient + 1 + k : escape_length + raw_bits;
+			}
+
+			return bits;
+		};
+
+		auto best = estimate;
+		auto best_cost = cost(estimate);
+		for (let k : {estimate - 1, estimate + 1})
+		{
+			if (k < (1U << rice_parameter_bits) && k <= escape_length)
+			{
+				if (let k_cost = cost(k); k_cost < best_cost)
+				{
+					best = k;
+					best_cost = k_cost;
+				}
+			}
+		}
+
+		return best;
+	}
+
+	void encode_block(std::vector<std::uint8_t>& bytes,
+					  std::span<std::span<float const> const> channels,
+					  std::span<channel_descriptor const> descriptors, std::size_t begin,
+					  std::size_t end)
+	{
+		auto residuals = std::vector<std::uint64_t>(end - begin);
+		auto writer = sph::bit_writer{bytes};
+
+		for (std::size_t c = 0; c < channels.size(); ++c)
+		{
+			let& descriptor = descriptors[c];
+
+			// The values were checked against the range of the descriptor, and the relative error
+			// against the number of levels, so every level lies in [0, 2^31)
+			auto previous = std::int64_t{0};
+			for (auto i = begin; i < end; ++i)
+			{
+				let scaled = (channels[c][i] - descriptor.min) / descriptor.step;
+				let level = static_cast<std::int64_t>(std::nearbyint(scaled));
+
+				residuals[i - begin] = to_zigzag(level - previous);
+				previous = level;
+			}
+
+			let k = choose_rice_parameter(residuals);
+			writer.write(k, rice_parameter_bits);
+
+			for (let residual : residuals)
+			{
+				let quotient = residual >> k;
+				if (quotient < escape_length)
+				{
+					writer.write_unary(static_cast<unsigned>(quotient));
+					writer.write(residual, k);
+				}
+				else
+				{
+					writer.write(0xFFFF'FFFFU, escape_length);
+					writer.write(residual, 32);
+					writer.write(residual >> 32U, raw_bits - 32);
+				}
+			}
+		}
+
+		writer.flush();
+	}
+
+	auto decode_block(std::span<std::uint8_t const> bytes,
+					  std::span<std::span<float> const> channels,
+					  std::span<channel_descriptor const> descriptors, std::size_t begin,
+					  std::size_t end) -> bool
+	{
+		auto reader = sph::bit_reader{bytes};
+
+		for (std::size_t c = 0; c < channels.size(); ++c)
+		{
+			let& descriptor = descriptors[c];
+			let k = static_cast<unsigned>(reader.read(rice_parameter_bits));
+
+			auto level = std::int64_t{0};
+			for (auto i = begin; i < end; ++i)
+			{
+				let quotient = reader.read_unary(escape_length);
+
+				auto residual = std::uint64_t{0};
+				if (quotient < escape_length)
+				{
+					residual = (std::uint64_t{quotient} << k) | reader.read(k);
+				}
+				else
+				{
+					residual = reader.read(32);
+					residual |= reader.read(raw_bits - 32) << 32U;
+				}
+
+				level += from_zigzag(residual);
+				channels[c][i] = descriptor.min + static_cast<float>(level) * descriptor.step;
+			}
+		}
+
+		return !reader.is_overrun();
+	}
+
+	auto get_frame_size(frame_header const& header) -> std::uint64_t
+	{
+		return sizeof(frame_header) + header.channel_count * sizeof(channel_descriptor)
+			 + header.block_count * sizeof(std::uint64_t) + header.payload_size;
+	}
+
+	auto is_valid(frame_header const& header) -> bool
+	{
+		let expected_channels = 3U + (header.columns & 1U ? 3U : 0U)
+							  + (header.columns & 2U ? 1U : 0U) + (header.columns & 4U ? 1U : 0U);
+		let expected_blocks = (header.particle_count + header.block_size - 1)
+							/ std::max<std::uint64_t>(header.block_size, 1);
+
+		return header.magic == frame_magic && header.channel_count == expected_channels
+			&& header.block_size > 0 && header.block_count == expected_blocks;
+	}
+
+	/**
+	 * @brief Whether the frame of a valid `header` fits in the `available` bytes from its start.
+	 * Checked before anything is sized from the header, which may come from a damaged stream
+	 */
+	auto fits_in(frame_header const& header, std::uint64_t available) -> bool
+	{
+		let tables_size = std::uint64_t{header.channel_count} * sizeof(channel_descriptor)
+						+ std::uint64_t{header.block_count} * sizeof(std::uint64_t);
+		if (available < sizeof(frame_header) + tables_size)
+		{
+			return false;
+		}
+
+		// Every value takes at least one bit of the payload
+		let payload_room = available - sizeof(frame_header) - tables_size;
+		return header.payload_size <= payload_room
+			&& header.particle_count <= header.payload_size * 8 / header.channel_count;
+	}
+
+	/**
+	 * @brief Index a stream by hopping from one frame header to the next. A frame cut short at
+	 * the end of the stream is left out
+	 */
+	auto scan_frames(std::ifstream& file, std::uint64_t file_size)
+		-> std::vector<sph::stream_index_entry>
+	{
+		auto index = std::vector<sph::stream_index_entry>{};
+
+		auto offset = std::uint64_t{sizeof(stream_header)};
+		auto header = frame_header{};
+		while (offset + sizeof(frame_header) <= file_size)
+		{
+			file.seekg(static_cast<std::streamoff>(offset));
+			if (!read_value(file, header) || !is_valid(header)
+				|| !fits_in(header, file_size - offset))
+			{
+				break;
+			}
+
+			index.push_back({.offset = offset, .step = header.step, .time = header.time});
+			offset += get_frame_size(header);
+		}
+
+		file.clear();
+
+		return index;
+	}
+
+	auto read_index(std::ifstream& file, std::uint64_t file_size)
+		-> std::vector<sph::stream_index_entry>
+	{
+		if (file_size < sizeof(stream_header) + sizeof(stream_trailer))
+		{
+			return scan_frames(file, file_size);
+		}
+
+		auto trailer = stream_trailer{};
+		file.seekg(static_cast<std::streamoff>(file_size - sizeof(stream_trailer)));
+
+		let is_consistent = [&] {
+			if (trailer.frame_count > file_size / sizeof(sph::stream_index_entry))
+			{
+				return false;
+			}
+
+			let index_size = trailer.frame_count * sizeof(sph::stream_index_entry);
+			return trailer.magic == index_magic && trailer.index_offset >= sizeof(stream_header)
+				&& trailer.index_offset <= file_size
+				&& trailer.index_offset + index_size + sizeof(stream_trailer) == file_size;
+		};
+
+		if (!read_value(file, trailer) || !is_consistent())
+		{
+			file.clear();
+			return scan_frames(file, file_size);
+		}
+
+		auto index = std::vector<sph::stream_index_entry>(trailer.frame_count);
+		file.seekg(static_cast<std::streamoff>(trailer.index_offset));
+		if (!read_values(file, std::span{index}))
+		{
+			file.clear();
+			return scan_frames(file, file_size);
+		}
+
+		return index;
+	}
+} // namespace
+
+namespace sph
+{
+	auto compressed_frame_sink::open(std::filesystem::path const& path,
+									 compression_settings const& settings)
+		-> tl::expected<std::unique_ptr<compressed_frame_sink>, output_error>
+	{
+		// Also rejects a NaN error
+		if (!(settings.relative_error >= compression_settings::min_relative_error))
+		{
+			return tl::unexpected(output_error::invalid_settings);
+		}
+		for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+		{
+			let width = settings.bounds.max[axis] - settings.bounds.min[axis];
+			if (!std::isfinite(width) || width < 0.0F)
+			{
+				return tl::unexpected(output_error::invalid_settings);
+			}
+		}
+
+		auto file = std::ofstream{path, std::ios::binary | std::ios::trunc};
+		if (!file)
+		{
+			return tl::unexpected(output_error::io_error);
+		}
+
+		write_value(file, stream_header{.magic = stream_magic, .version = stream_version,
+										.reserved = 0});
+		if (!file)
+		{
+			return tl::unexpected(output_error::io_error);
+		}
+
+		// The constructor is private
+		return std::unique_ptr<compressed_frame_sink>(
+			new compressed_frame_sink(std::move(file), settings)); // NOLINT
+	}
+
+	compressed_frame_sink::compressed_frame_sink(std::ofstream&& file,
+												 compression_settings const& settings) :
+		m_file(std::move(file)), m_settings(settings), m_offset(sizeof(stream_header))
+	{}
+
+	compressed_frame_sink::~compressed_frame_sink()
+	{
+		write_values(m_file, std::span<stream_index_entry const>{m_index});
+		write_value(m_file, stream_trailer{.frame_count = m_index.size(),
+										   .index_offset = m_offset,
+										   .magic = index_magic});
+	}
+
+	auto compressed_frame_sink::write(frame const& output)
+		-> tl::expected<std::size_t, output_error>
+	{
+		let count = output.size();
+		let channels = get_channels(output);
+		let block_count = (count + block_size - 1) / block_size;
+
+		if (!is_encodable(channels, m_settings.bounds, count))
+		{
+			return tl::unexpected(output_error::invalid_value);
+		}
+
+		auto descriptors = std::vector<channel_descriptor>(channels.size());
+		for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+		{
+			descriptors[axis] = make_descriptor(m_settings.bounds.min[axis],
+												m_settings.bounds.max[axis],
+												m_settings.relative_error);
+		}
+
+		let other_channels = std::span{channels}.subspan(physeng::particle_set::dimension);
+		let ranges = find_ranges(other_channels, count);
+		for (std::size_t c = 0; c < ranges.size(); ++c)
+		{
+			// Finite values may still span more than a float can hold
+			if (!std::isfinite(ranges[c].second - ranges[c].first))
+			{
+				return tl::unexpected(output_error::invalid_value);
+			}
+
+			descriptors[physeng::particle_set::dimension + c] =
+				make_descriptor(ranges[c].first, ranges[c].second, m_settings.relative_error);
+		}
+
+		if (m_blocks.size() < block_count)
+		{
+			m_blocks.resize(block_count);
+		}
+
+		physeng::parallel_for(block_count, 1, [&](std::size_t first, std::size_t last) {
+			for (auto block = first; block < last; ++block)
+			{
+				m_blocks[block].clear();
+				encode_block(m_blocks[block], channels, descriptors, block * block_size,
+							 std::min(count, (block + 1) * block_size));
+			}
+		});
+
+		auto block_ends = std::vector<std::uint64_t>(block_count);
+		auto payload_size = std::uint64_t{0};
+		for (std::size_t block = 0; block < block_count; ++block)
+		{
+			payload_size += m_blocks[block].size();
+			block_ends[block] = payload_size;
+		}
+
+		let header = frame_header{.magic = frame_magic,
+								  .step = output.step,
+								  .time = output.time,
+								  .particle_count = count,
+								  .columns = to_bits(output.columns),
+								  .channel_count = static_cast<std::uint32_t>(channels.size()),
+								  .block_size = block_size,
+								  .block_count = static_cast<std::uint32_t>(block_count),
+								  .payload_size = payload_size};
+
+		write_value(m_file, header);
+		write_values(m_file, std::span<channel_descriptor const>{descriptors});
+		write_values(m_file, std::span<std::uint64_t const>{block_ends});
+		for (std::size_t block = 0; block < block_count; ++block)
+		{
+			write_values(m_file, std::span<std::uint8_t const>{m_blocks[block]});
+		}
+
+		// A stream cut short by a crash keeps every frame written so far
+		m_file.flush();
+		if (!m_file)
+		{
+			return tl::unexpected(output_error::io_error);
+		}
+
+		let size = get_frame_size(header);
+		m_index.push_back({.offset = m_offset, .step = output.step, .time = output.time});
+		m_offset += size;
+
+		return size;
+	}
+
+	auto compressed_frame_reader::open(std::filesystem::path const& path)
+		-> tl::expected<compressed_frame_reader, output_error>
+	{
+		auto file = std::ifstream{path, std::ios::binary};
+		if (!file)
+		{
+			return tl::unexpected(output_error::io_error);
+		}
+
+		auto header = stream_header{};
+		if (!read_value(file, header) || header.magic != stream_magic)
+		{
+			return tl::unexpected(output_error::not_a_stream);
+		}
+		if (header.version != stream_version)
+		{
+			return tl::unexpected(output_error::corrupted);
+		}
+
+		file.seekg(0, std::ios::end);
+		let file_size = static_cast<std::uint64_t>(file.tellg());
+
+		auto index = read_index(file, file_size);
+
+		return compressed_frame_reader{std::move(file), file_size, std::move(index)};
+	}
+
+	compressed_frame_reader::compressed_frame_reader(std::ifstream&& file, std::uint64_t file_size,
+													 std::vector<stream_index_entry>&& index) :
+		m_file(std::move(file)), m_file_size(file_size), m_index(std::move(index))
+	{}
+
+	auto compressed_frame_reader::get_index() const noexcept
+		-> std::vector<stream_index_entry> const&
+	{
+		return m_index;
+	}
+
+	auto compressed_frame_reader::read(std::size_t index, frame& output)
+		-> tl::expected<void, output_error>
+	{
+		if (index >= m_index.size())
+		{
+			return tl::unexpected(output_error::out_of_range);
+		}
+
+		let offset = m_index[index].offset;
+		if (offset > m_file_size)
+		{
+			return tl::unexpected(output_error::corrupted);
+		}
+
+		auto header = frame_header{};
+		m_file.seekg(static_cast<std::streamoff>(offset));
+		if (!read_value(m_file, header) || !is_valid(header)
+			|| !fits_in(header, m_file_size - offset))
+		{
+			m_file.clear();
+			return tl::unexpected(output_error::corrupted);
+		}
+
+		auto descriptors = std::vector<channel_descriptor>(header.channel_count);
+		auto block_ends = std::vector<std::uint64_t>(header.block_count);
+		if (!read_values(m_file, std::span{descriptors})
+			|| !read_values(m_file, std::span{block_ends}))
+		{
+			m_file.clear();
+			return tl::unexpected(output_error::corrupted);
+		}
+
+		let payload_end = block_ends.empty() ? std::uint64_t{0} : block_ends.back();
+		if (!std::is_sorted(std::begin(block_ends), std::end(block_ends))
+			|| payload_end != header.payload_size)
+		{
+			return tl::unexpected(output_error::corrupted);
+		}
+
+		m_bytes.resize(header.payload_size);
+		if (!read_values(m_file, std::span{m_bytes}))
+		{
+			m_file.clear();
+			return tl::unexpected(output_error::corrupted);
+		}
+
+		let count = header.particle_count;
+		output.step = header.step;
+		output.time = header.time;
+		output.columns = to_output_columns(header.columns);
+
+		let channels = prepare_channels(output, count, output.columns);
+		let bytes = std::span<std::uint8_t const>{m_bytes};
+
+		auto is_intact = std::atomic<bool>{true};
+		physeng::parallel_for(header.block_count, 1, [&](std::size_t first, std::size_t last) {
+			for (auto block = first; block < last; ++block)
+			{
+				let begin = block == 0 ? 0 : block_ends[block - 1];
+				let block_bytes = bytes.subspan(begin, block_ends[block] - begin);
+
+				if (!decode_block(block_bytes, channels, descriptors, block * header.block_size,
+								  std::min(count, (block + 1) * header.block_size)))
+				{
+					is_intact.store(false, std::memory_order_relaxed);
+				}
+			}
+		});
+
+		if (!is_intact.load(std::memory_order_relaxed))
+		{
+			return tl::unexpected(output_error::corrupted);
+		}
+
+		return {};
+	}
+} // namespace sph
@@ -0,0 +1,140 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sph/output/frame.hpp>
+#include <sph/output/frame_sink.hpp>
+#include <sph/scene.hpp>
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace sph
+{
+	struct compression_settings
+	{
+		/**
+		 * @brief The smallest relative error the quantization levels can reach: a column is
+		 * split in about `1 / (2 * relative_error)` levels, which must fit in 31 bits
+		 */
+		static constexpr float min_relative_error = 2.5e-10F;
+
+		/**
+		 * @brief The largest error on a value, relative to the range of its column: the size of
+		 * `bounds` along the axis for the positions, the range found in the frame for the others
+		 */
+		float relative_error = 1.0e-3F;
+		domain bounds = {}; //< The box the positions are quantized in
+	};
+
+	/**
+	 * @brief Where a frame starts in a compressed stream
+	 */
+	struct stream_index_entry
+	{
+		std::uint64_t offset;
+		std::uint64_t step;
+		double time;
+	};
+
+	/**
+	 * @brief Appends frames to a single lossy compressed stream
+	 *
+	 * Every column is quantized on a uniform grid fine enough to meet the error bound. Each value
+	 * is predicted by the one of the previous particle, which is a close neighbor when the
+	 * particles are kept in Morton order, and the residuals are Rice coded. Frames are split in
+	 * blocks of particles coded independently, in parallel
+	 *
+	 * Frames never refer to one another, and an index of the frames is appended to the stream when
+	 * the sink is destroyed, so a reader can jump straight to any frame
+	 */
+	class compressed_frame_sink final : public frame_sink
+	{
+	public:
+		/**
+		 * @return `output_error::invalid_settings` if the relative error is below
+		 * `compression_settings::min_relative_error` or the bounds are not a finite box
+		 */
+		static auto open(std::filesystem::path const& path, compression_settings const& settings)
+			-> tl::expected<std::unique_ptr<compressed_frame_sink>, output_error>;
+
+		compressed_frame_sink(compressed_frame_sink const&) = delete;
+		compressed_frame_sink(compressed_frame_sink&&) = delete;
+		/**
+		 * @brief Appends the index of the frames to the stream
+		 */
+		~compressed_frame_sink() override;
+
+		auto operator=(compressed_frame_sink const&) -> compressed_frame_sink& = delete;
+		auto operator=(compressed_frame_sink&&) -> compressed_frame_sink& = delete;
+
+		/**
+		 * @return `output_error::invalid_value` if a value is not finite or a position is outside
+		 * of the bounds, in which case nothing is written
+		 */
+		auto write(frame const& output) -> tl::expected<std::size_t, output_error> override;
+
+	private:
+		compressed_frame_sink(std::ofstream&& file, compression_settings const& settings);
+
+	private:
+		std::ofstream m_file;
+		compression_settings m_settings;
+
+		std::uint64_t m_offset;
+		std::vector<stream_index_entry> m_index;
+
+		// Reused from one frame to the next
+		std::vector<std::vector<std::uint8_t>> m_blocks;
+	};
+
+	/**
+	 * @brief Reads the frames of a stream written by a `compressed_frame_sink`, in any order.
+	 * Streams that were not closed properly, and therefore lack an index, are indexed by walking
+	 * over the headers of the frames
+	 */
+	class compressed_frame_reader
+	{
+	public:
+		static auto open(std::filesystem::path const& path)
+			-> tl::expected<compressed_frame_reader, output_error>;
+
+		[[nodiscard]] auto get_index() const noexcept -> std::vector<stream_index_entry> const&;
+
+		/**
+		 * @brief Decode the frame at `index` in the stream into `output`
+		 */
+		auto read(std::size_t index, frame& output) -> tl::expected<void, output_error>;
+
+	private:
+		compressed_frame_reader(std::ifstream&& file, std::uint64_t file_size,
+								std::vector<stream_index_entry>&& index);
+
+	private:
+		std::ifstream m_file;
+		std::uint64_t m_file_size;
+		std::vector<stream_index_entry> m_index;
+
+		std::vector<std::uint8_t> m_bytes;
+	};
+} // namespace sph
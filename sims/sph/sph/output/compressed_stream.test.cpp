@@ -0,0 +1,341 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sph/output/compressed_stream.hpp>
+
+#include <sph/core.hpp>
+
+#include <libphyseng/main.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+	constexpr float relative_error = 1.0e-3F;
+	constexpr std::size_t frame_count = 6;
+	// What the smooth fields of the test frames compress to at the least
+	constexpr double min_compression_ratio = 4.0;
+
+	// A lattice of 40000 particles, more than two blocks of the stream with a partial last one
+	constexpr std::array<std::size_t, 3> lattice = {50, 40, 20};
+
+	constexpr auto bounds = sph::domain{.min = {0.0F, 0.0F, 0.0F}, .max = {1.0F, 0.8F, 0.4F}};
+
+	// Where the fields of a frame header are, as laid out by the stream
+	constexpr std::uint64_t particle_count_offset = 24;
+	constexpr std::uint64_t block_count_offset = 44;
+	constexpr std::uint64_t payload_size_offset = 48;
+	constexpr std::uint64_t trailer_size = 24;
+
+	void check(bool condition, std::string_view what)
+	{
+		if (!condition)
+		{
+			fmt::print(stderr, "check failed: {}\n", what);
+			std::exit(EXIT_FAILURE); // NOLINT
+		}
+	}
+
+	/**
+	 * @brief A jittered lattice walked row by row, so that consecutive particles are neighbors as
+	 * they are in Morton order, with smooth velocity, density and pressure fields
+	 */
+	auto make_frame(std::uint64_t step) -> sph::frame
+	{
+		auto engine = std::mt19937{static_cast<std::uint32_t>(step)};
+		auto jitter = std::uniform_real_distribution<float>{-0.25F, 0.25F};
+
+		let time = 0.01 * static_cast<double>(step);
+		auto output = sph::frame{};
+		output.step = step;
+		output.time = time;
+		output.columns = {.velocity = true, .density = true, .pressure = true};
+
+		let count = lattice[0] * lattice[1] * lattice[2];
+		for (auto& column : output.position)
+		{
+			column.reserve(count);
+		}
+
+		for (std::size_t k = 0; k < lattice[2]; ++k)
+		{
+			for (std::size_t j = 0; j < lattice[1]; ++j)
+			{
+				for (std::size_t i = 0; i < lattice[0]; ++i)
+				{
+					let cell = std::array{i, j, k};
+					for (std::size_t axis = 0; axis < 3; ++axis)
+					{
+						let extent = bounds.max[axis] - bounds.min[axis];
+						let spacing = extent / static_cast<float>(lattice[axis]);
+						let offset = static_cast<float>(cell[axis]) + 0.5F + jitter(engine);
+						output.position[axis].push_back(bounds.min[axis] + offset * spacing);
+					}
+
+					let x = output.position[0].back();
+					let y = output.position[1].back();
+					let phase = static_cast<float>(time);
+					output.velocity[0].push_back(std::sin(6.0F * y + phase));
+					output.velocity[1].push_back(-0.5F * std::cos(4.0F * x - phase));
+					output.velocity[2].push_back(0.1F * std::sin(9.0F * (x + y)));
+
+					let density = 1000.0F + 20.0F * std::sin(5.0F * x) * std::cos(3.0F * y);
+					output.density.push_back(density);
+					output.pressure.push_back(2.0e4F * (density / 1000.0F - 1.0F));
+				}
+			}
+		}
+
+		return output;
+	}
+
+	/**
+	 * @brief Whether every value of `decoded` is within the error bound of `original`, relative
+	 * to `range`
+	 */
+	auto is_within_bound(std::span<float const> original, std::span<float const> decoded,
+						 float range) -> bool
+	{
+		if (original.size() != decoded.size())
+		{
+			return false;
+		}
+
+		for (std::size_t i = 0; i < original.size(); ++i)
+		{
+			if (std::abs(original[i] - decoded[i]) > relative_error * range)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	auto get_range(std::span<float const> values) -> float
+	{
+		let [min, max] = std::ranges::minmax(values);
+		return max - min;
+	}
+
+	void check_frame(sph::frame const& original, sph::frame const& decoded)
+	{
+		check(decoded.step == original.step && decoded.time == original.time,
+			  "the step and time of a frame are kept");
+		check(to_bits(decoded.columns) == to_bits(original.columns), "the columns are kept");
+
+		for (std::size_t axis = 0; axis < 3; ++axis)
+		{
+			let extent = bounds.max[axis] - bounds.min[axis];
+			check(is_within_bound(original.position[axis], decoded.position[axis], extent),
+				  "positions are within the error bound of the domain");
+			check(is_within_bound(original.velocity[axis], decoded.velocity[axis],
+								  get_range(original.velocity[axis])),
+				  "velocities are within the error bound of their range");
+		}
+
+		check(is_within_bound(original.density, decoded.density, get_range(original.density)),
+			  "densities are within the error bound of their range");
+		check(is_within_bound(original.pressure, decoded.pressure, get_range(original.pressure)),
+			  "pressures are within the error bound of their range");
+	}
+
+	auto write_stream(std::filesystem::path const& path, std::span<sph::frame const> frames)
+		-> std::size_t
+	{
+		auto sink = sph::compressed_frame_sink::open(
+			path, {.relative_error = relative_error, .bounds = bounds});
+		check(sink.has_value(), "the stream is created");
+
+		auto raw_size = std::size_t{0};
+		for (let& output : frames)
+		{
+			check((*sink)->write(output).has_value(), "a frame is written");
+			raw_size += output.size() * 8 * sizeof(float);
+		}
+
+		return raw_size;
+	}
+
+	void check_round_trip(std::filesystem::path const& path, std::span<sph::frame const> frames)
+	{
+		let raw_size = write_stream(path, frames);
+		let ratio = static_cast<double>(raw_size)
+				  / static_cast<double>(std::filesystem::file_size(path));
+		check(ratio >= min_compression_ratio, "the frames are compressed");
+
+		auto reader = sph::compressed_frame_reader::open(path);
+		check(reader.has_value(), "the stream is opened");
+		check(reader->get_index().size() == frames.size(), "the index lists every frame");
+
+		// Out of order, and into a recycled frame
+		auto decoded = sph::frame{};
+		for (let index : {3U, 0U, 5U, 1U, 4U, 2U, 5U, 0U})
+		{
+			check(reader->read(index, decoded).has_value(), "a frame is read");
+			check_frame(frames[index], decoded);
+		}
+
+		check(reader->read(frames.size(), decoded).error() == sph::output_error::out_of_range,
+			  "there is no frame past the end");
+	}
+
+	void copy_prefix(std::filesystem::path const& from, std::filesystem::path const& to,
+					 std::uint64_t size)
+	{
+		std::filesystem::copy_file(from, to, std::filesystem::copy_options::overwrite_existing);
+		std::filesystem::resize_file(to, size);
+	}
+
+	void check_truncated(std::filesystem::path const& path, std::filesystem::path const& copy,
+						 std::span<sph::frame const> frames)
+	{
+		let index = sph::compressed_frame_reader::open(path)->get_index();
+
+		// A stream cut in the middle of a frame, as left by a crash, has neither the trailer nor
+		// the end of the frame
+		let kept = std::size_t{4};
+		copy_prefix(path, copy, index[kept].offset + 100);
+
+		auto reader = sph::compressed_frame_reader::open(copy);
+		check(reader.has_value(), "a truncated stream is opened");
+		check(reader->get_index().size() == kept, "the frames before the cut are indexed");
+		for (std::size_t i = 0; i < kept; ++i)
+		{
+			check(reader->get_index()[i].offset == index[i].offset
+					  && reader->get_index()[i].step == index[i].step,
+				  "the recovered index matches the written one");
+		}
+
+		auto decoded = sph::frame{};
+		check(reader->read(kept - 1, decoded).has_value(), "the last whole frame is read");
+		check_frame(frames[kept - 1], decoded);
+		check(reader->read(kept, decoded).error() == sph::output_error::out_of_range,
+			  "the frame cut short is left out");
+
+		// Every frame is whole, only the index and the trailer are missing
+		let index_size = frames.size() * sizeof(sph::stream_index_entry) + trailer_size;
+		copy_prefix(path, copy, std::filesystem::file_size(path) - index_size);
+		check(sph::compressed_frame_reader::open(copy)->get_index().size() == frames.size(),
+			  "a stream without its index is indexed from its frames");
+	}
+
+	template<typename Type>
+	void overwrite(std::filesystem::path const& path, std::uint64_t offset, Type value)
+	{
+		auto file = std::fstream{path, std::ios::binary | std::ios::in | std::ios::out};
+		file.seekp(static_cast<std::streamoff>(offset));
+		file.write(reinterpret_cast<char const*>(&value), sizeof(Type)); // NOLINT
+	}
+
+	auto read_error(std::filesystem::path const& path) -> sph::output_error
+	{
+		auto reader = sph::compressed_frame_reader::open(path);
+		check(reader.has_value() && !reader->get_index().empty(), "the damaged stream is opened");
+
+		auto decoded = sph::frame{};
+		let result = reader->read(0, decoded);
+		check(!result.has_value(), "the damaged frame is rejected");
+
+		return result.error();
+	}
+
+	void check_damaged_headers(std::filesystem::path const& path,
+							   std::filesystem::path const& copy)
+	{
+		let size = std::filesystem::file_size(path);
+		let offset = sph::compressed_frame_reader::open(path)->get_index().front().offset;
+
+		// Sizes far past the end of the file must be rejected before anything is allocated
+		copy_prefix(path, copy, size);
+		overwrite(copy, offset + payload_size_offset, std::uint64_t{1} << 60U);
+		check(read_error(copy) == sph::output_error::corrupted,
+			  "a payload larger than the file is rejected");
+
+		copy_prefix(path, copy, size);
+		overwrite(copy, offset + particle_count_offset, std::uint64_t{16384} * 0xFFFF'FFFFU);
+		overwrite(copy, offset + block_count_offset, std::uint32_t{0xFFFF'FFFFU});
+		check(read_error(copy) == sph::output_error::corrupted,
+			  "a particle count larger than the file is rejected");
+	}
+
+	void check_invalid_input(std::filesystem::path const& path, sph::frame const& valid)
+	{
+		let tiny_error = sph::compression_settings{
+			.relative_error = sph::compression_settings::min_relative_error / 2.0F,
+			.bounds = bounds};
+		check(sph::compressed_frame_sink::open(path, tiny_error).error()
+				  == sph::output_error::invalid_settings,
+			  "an error finer than the quantization levels is rejected");
+
+		auto sink = sph::compressed_frame_sink::open(
+			path, {.relative_error = relative_error, .bounds = bounds});
+		check(sink.has_value(), "the stream is created");
+
+		auto not_a_number = valid;
+		not_a_number.density[7] = std::numeric_limits<float>::quiet_NaN();
+		check((*sink)->write(not_a_number).error() == sph::output_error::invalid_value,
+			  "a NaN is rejected");
+
+		auto infinite = valid;
+		infinite.pressure[7] = std::numeric_limits<float>::infinity();
+		check((*sink)->write(infinite).error() == sph::output_error::invalid_value,
+			  "an infinite value is rejected");
+
+		auto outside = valid;
+		outside.position[1][3] = bounds.max[1] + 0.1F;
+		check((*sink)->write(outside).error() == sph::output_error::invalid_value,
+			  "a position outside of the bounds is rejected");
+		check((*sink)->write(valid).has_value(), "a valid frame is still written");
+	}
+} // namespace
+
+auto physeng_main(std::span<const std::string_view> /*args*/) -> int
+{
+	let directory = std::filesystem::temp_directory_path();
+	let path = directory / fmt::format("sph-compressed-stream-{}.phys", ::getpid());
+	let copy = directory / fmt::format("sph-compressed-stream-{}-copy.phys", ::getpid());
+
+	auto frames = std::vector<sph::frame>{};
+	for (std::uint64_t step = 0; step < frame_count; ++step)
+	{
+		frames.push_back(make_frame(10 * step));
+	}
+
+	check_round_trip(path, frames);
+	check_truncated(path, copy, frames);
+	check_damaged_headers(path, copy);
+	check_invalid_input(path, frames.front());
+
+	std::filesystem::remove(path);
+	std::filesystem::remove(copy);
+
+	return EXIT_SUCCESS;
+}
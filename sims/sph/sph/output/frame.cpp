@@ -0,0 +1,98 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sph/output/frame.hpp>
+
+#include <sph/core.hpp>
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+#include <libphyseng/memory/frame_arena.hpp>
+
+#include <algorithm>
+#include <memory_resource>
+#include <span>
+
+namespace
+{
+	constexpr std::size_t capture_grain = 16384;
+
+	template<typename Type>
+	struct column_copy
+	{
+		std::span<Type const> source;
+		std::span<float> target;
+
+		void operator()(std::size_t first, std::size_t last) const
+		{
+			std::copy(std::begin(source) + static_cast<std::ptrdiff_t>(first),
+					  std::begin(source) + static_cast<std::ptrdiff_t>(last),
+					  std::begin(target) + static_cast<std::ptrdiff_t>(first));
+		}
+	};
+} // namespace
+
+namespace sph
+{
+	template<physeng::precision_policy Precision>
+	void capture(frame& output, physeng::basic_particle_set<Precision> const& particles,
+				 output_columns const& columns, std::uint64_t step, double time)
+	{
+		using velocity_type = typename Precision::velocity_type;
+
+		let count = particles.size();
+
+		output.step = step;
+		output.time = time;
+		output.columns = columns;
+
+		// Frames always hold floats, narrower velocities are widened by their copy
+		auto copies = std::pmr::vector<column_copy<float>>{physeng::get_frame_resource()};
+		auto velocity_copies =
+			std::pmr::vector<column_copy<velocity_type>>{physeng::get_frame_resource()};
+		let add = [&](auto& list, std::vector<float>& target, auto source, bool is_wanted) {
+			target.resize(is_wanted ? count : 0);
+			if (is_wanted)
+			{
+				list.push_back({.source = source, .target = target});
+			}
+		};
+
+		for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+		{
+			add(copies, output.position[axis], particles.position(axis), true);
+			add(velocity_copies, output.velocity[axis], particles.velocity(axis),
+				columns.velocity);
+		}
+		add(copies, output.density, particles.density(), columns.density);
+		add(copies, output.pressure, particles.pressure(), columns.pressure);
+
+		physeng::parallel_for(count, capture_grain, [&](std::size_t first, std::size_t last) {
+			for (let& copy : copies)
+			{
+				copy(first, last);
+			}
+			for (let& copy : velocity_copies)
+			{
+				copy(first, last);
+			}
+		});
+	}
+
+	template void capture(frame& output, physeng::particle_set const& particles,
+						  output_columns const& columns, std::uint64_t step, double time);
+	template void capture(frame& output, physeng::compact_particle_set const& particles,
+						  output_columns const& columns, std::uint64_t step, double time);
+} // namespace sph
@@ -0,0 +1,83 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <libphyseng/particles/particle_set.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sph
+{
+	/**
+	 * @brief The columns written out with every frame besides the positions
+	 */
+	struct output_columns
+	{
+		bool velocity = false;
+		bool density = false;
+		bool pressure = false;
+	};
+
+	/**
+	 * @brief Encode the columns as bit flags, as stored in the headers of the output files
+	 */
+	constexpr auto to_bits(output_columns const& columns) noexcept -> std::uint32_t
+	{
+		return (columns.velocity ? 1U : 0U) | (columns.density ? 2U : 0U)
+			 | (columns.pressure ? 4U : 0U);
+	}
+	constexpr auto to_output_columns(std::uint32_t bits) noexcept -> output_columns
+	{
+		return {.velocity = (bits & 1U) != 0,
+				.density = (bits & 2U) != 0,
+				.pressure = (bits & 4U) != 0};
+	}
+
+	/**
+	 * @brief A copy of the particle columns requested for output, taken at the end of a step.
+	 * Columns that were not requested are left empty
+	 *
+	 * Frames are recycled from one output to the next, so the columns only allocate the first
+	 * time they are filled
+	 */
+	struct frame
+	{
+		std::uint64_t step = 0;
+		double time = 0.0;
+		output_columns columns = {};
+
+		std::array<std::vector<float>, physeng::particle_set::dimension> position;
+		std::array<std::vector<float>, physeng::particle_set::dimension> velocity;
+		std::vector<float> density;
+		std::vector<float> pressure;
+
+		[[nodiscard]] auto size() const noexcept -> std::size_t
+		{
+			return position[0].size();
+		}
+	};
+
+	/**
+	 * @brief Copy the `columns` of `particles` into `output`, in parallel
+	 */
+	template<physeng::precision_policy Precision>
+	void capture(frame& output, physeng::basic_particle_set<Precision> const& particles,
+				 output_columns const& columns, std::uint64_t step, double time);
+} // namespace sph
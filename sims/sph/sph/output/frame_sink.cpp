@@ -0,0 +1,125 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sph/output/frame_sink.hpp>
+
+#include <sph/core.hpp>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace
+{
+	using namespace std::literals;
+
+	constexpr std::array<char, 8> raw_magic = {'P', 'H', 'Y', 'S', 'F', 'R', 'A', 'W'};
+
+	struct raw_header
+	{
+		std::array<char, 8> magic;
+		std::uint64_t step;
+		double time;
+		std::uint64_t particle_count;
+		std::uint32_t columns;
+		std::uint32_t reserved;
+	};
+
+	static_assert(std::is_trivially_copyable_v<raw_header> && sizeof(raw_header) == 40);
+
+	auto write_bytes(std::ofstream& file, std::span<std::byte const> bytes) -> std::size_t
+	{
+		file.write(reinterpret_cast<char const*>(bytes.data()), // NOLINT
+				   static_cast<std::streamsize>(bytes.size()));
+
+		return bytes.size();
+	}
+} // namespace
+
+namespace sph
+{
+	auto to_string(output_error error) -> std::string_view
+	{
+		switch (error)
+		{
+			case output_error::io_error:
+				return "io error"sv;
+			case output_error::not_a_stream:
+				return "not an output stream"sv;
+			case output_error::corrupted:
+				return "corrupted"sv;
+			case output_error::out_of_range:
+				return "no such frame"sv;
+			case output_error::invalid_settings:
+				return "invalid settings"sv;
+			case output_error::invalid_value:
+				return "a value is not finite or out of bounds"sv;
+		}
+
+		return {};
+	}
+
+	raw_frame_sink::raw_frame_sink(std::filesystem::path directory) :
+		m_directory(std::move(directory))
+	{}
+
+	auto raw_frame_sink::write(frame const& output) -> tl::expected<std::size_t, output_error>
+	{
+		let path = m_directory / fmt::format("frame_{:08}.bin", output.step);
+
+		auto file = std::ofstream{path, std::ios::binary | std::ios::trunc};
+		if (!file)
+		{
+			return tl::unexpected(output_error::io_error);
+		}
+
+		let header = raw_header{.magic = raw_magic,
+								.step = output.step,
+								.time = output.time,
+								.particle_count = output.size(),
+								.columns = to_bits(output.columns),
+								.reserved = 0};
+
+		auto written = write_bytes(file, std::as_bytes(std::span{&header, 1}));
+		let write_column = [&](std::vector<float> const& column) {
+			written += write_bytes(file, std::as_bytes(std::span{column}));
+		};
+
+		for (let& column : output.position)
+		{
+			write_column(column);
+		}
+		for (let& column : output.velocity)
+		{
+			write_column(column);
+		}
+		write_column(output.density);
+		write_column(output.pressure);
+
+		file.close();
+		if (!file)
+		{
+			return tl::unexpected(output_error::io_error);
+		}
+
+		return written;
+	}
+} // namespace sph
@@ -0,0 +1,81 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sph/output/frame.hpp>
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace sph
+{
+	enum struct output_error
+	{
+		io_error,         //< A file could not be created, read or written
+		not_a_stream,     //< The file is not an output stream
+		corrupted,        //< The content of the file does not match its headers
+		out_of_range,     //< There is no frame at the requested index
+		invalid_settings, //< The settings of a sink cannot be met
+		invalid_value     //< A value of a frame is not finite or outside the bounds of the sink
+	};
+
+	auto to_string(output_error error) -> std::string_view;
+
+	/**
+	 * @brief The destination of the frames of a run. Sinks are only ever called from the writer
+	 * thread, one frame at a time
+	 */
+	class frame_sink
+	{
+	public:
+		frame_sink() = default;
+		frame_sink(frame_sink const&) = delete;
+		frame_sink(frame_sink&&) = delete;
+		virtual ~frame_sink() = default;
+
+		auto operator=(frame_sink const&) -> frame_sink& = delete;
+		auto operator=(frame_sink&&) -> frame_sink& = delete;
+
+		/**
+		 * @brief Store a frame
+		 *
+		 * @return The number of bytes written
+		 */
+		virtual auto write(frame const& output) -> tl::expected<std::size_t, output_error> = 0;
+	};
+
+	/**
+	 * @brief Writes every frame uncompressed to its own file, `frame_<step>.bin`, in a directory
+	 *
+	 * A file holds a small header (magic, step, time, particle count and the columns present)
+	 * followed by the columns: the positions, then the velocities, density and pressure when
+	 * present
+	 */
+	class raw_frame_sink final : public frame_sink
+	{
+	public:
+		explicit raw_frame_sink(std::filesystem::path directory);
+
+		auto write(frame const& output) -> tl::expected<std::size_t, output_error> override;
+
+	private:
+		std::filesystem::path m_directory;
+	};
+} // namespace sph
@@ -0,0 +1,191 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sph/output/frame_writer.hpp>
+
+#include <sph/core.hpp>
+
+#include <libphyseng/profiling/profiler.hpp>
+
+#include <chrono>
+#include <utility>
+
+namespace sph
+{
+	frame_writer::frame_writer(std::unique_ptr<frame_sink> sink,
+							   frame_writer_settings const& settings, spdlog::logger& logger) :
+		m_sink(std::move(sink)), m_settings(settings), m_logger(&logger),
+		m_pending(settings.buffer_count), m_free(settings.buffer_count)
+	{
+		for (std::size_t i = 0; i < settings.buffer_count; ++i)
+		{
+			m_free.try_push(std::make_unique<frame>());
+		}
+
+		// Started last: the rings have a single producer each, the buffers above are pushed
+		// before the writer thread exists
+		m_thread = std::jthread{[this](std::stop_token const& stop) { run(stop); }};
+	}
+
+	frame_writer::~frame_writer()
+	{
+		m_thread.request_stop();
+		m_pending_epoch.fetch_add(1);
+		m_pending_epoch.notify_one();
+	}
+
+	template<physeng::precision_policy Precision>
+	auto frame_writer::submit(physeng::basic_particle_set<Precision> const& particles,
+							  std::uint64_t step, double time) -> bool
+	{
+		PHYSENG_PROFILE_ZONE("frame_writer::submit");
+
+		auto output = acquire_buffer();
+		if (!output)
+		{
+			++m_skipped_count;
+			return false;
+		}
+
+		capture(*output, particles, m_settings.columns, step, time);
+
+		// There are never more buffers than slots, the push cannot fail
+		m_pending.try_push(std::move(output));
+		m_pending_epoch.fetch_add(1);
+		m_pending_epoch.notify_one();
+
+		++m_submitted_count;
+
+		return true;
+	}
+
+	template auto frame_writer::submit(physeng::particle_set const& particles, std::uint64_t step,
+									   double time) -> bool;
+	template auto frame_writer::submit(physeng::compact_particle_set const& particles,
+									   std::uint64_t step, double time) -> bool;
+
+	void frame_writer::flush()
+	{
+		let is_done = [&] {
+			return m_written_count.load() + m_failed_count.load() == m_submitted_count;
+		};
+
+		while (!is_done())
+		{
+			let epoch = m_free_epoch.load();
+			if (!is_done())
+			{
+				m_free_epoch.wait(epoch);
+			}
+		}
+	}
+
+	auto frame_writer::get_statistics() const -> statistics
+	{
+		return {.submitted_count = m_submitted_count,
+				.skipped_count = m_skipped_count,
+				.written_count = m_written_count.load(),
+				.failed_count = m_failed_count.load(),
+				.written_bytes = m_written_bytes.load(),
+				.stall_time = m_stall_time};
+	}
+
+	void frame_writer::run(std::stop_token const& stop)
+	{
+		if (auto* const profiler = physeng::get_default_profiler())
+		{
+			profiler->set_thread_name("frame writer");
+		}
+
+		while (true)
+		{
+			let epoch = m_pending_epoch.load();
+
+			if (auto output = m_pending.try_pop())
+			{
+				write(std::move(*output));
+				continue;
+			}
+
+			// The last frames may have been queued after the pop above
+			if (stop.stop_requested())
+			{
+				while (auto output = m_pending.try_pop())
+				{
+					write(std::move(*output));
+				}
+
+				return;
+			}
+
+			m_pending_epoch.wait(epoch);
+		}
+	}
+
+	void frame_writer::write(buffer output)
+	{
+		PHYSENG_PROFILE_ZONE("frame_writer::write");
+
+		let result = m_sink->write(*output);
+		if (result)
+		{
+			m_written_bytes.fetch_add(result.value());
+			m_written_count.fetch_add(1);
+		}
+		else
+		{
+			m_logger->error("failed to write the frame of step {}: {}", output->step,
+							to_string(result.error()));
+			m_failed_count.fetch_add(1);
+		}
+
+		m_free.try_push(std::move(output));
+		m_free_epoch.fetch_add(1);
+		m_free_epoch.notify_one();
+	}
+
+	auto frame_writer::acquire_buffer() -> buffer
+	{
+		if (auto output = m_free.try_pop())
+		{
+			return std::move(*output);
+		}
+
+		if (m_settings.policy == backpressure_policy::skip)
+		{
+			return nullptr;
+		}
+
+		let start = std::chrono::steady_clock::now();
+
+		auto output = m_free.try_pop();
+		while (!output)
+		{
+			let epoch = m_free_epoch.load();
+
+			output = m_free.try_pop();
+			if (!output)
+			{
+				m_free_epoch.wait(epoch);
+			}
+		}
+
+		m_stall_time +=
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		return std::move(*output);
+	}
+} // namespace sph
@@ -0,0 +1,136 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sph/output/frame.hpp>
+#include <sph/output/frame_sink.hpp>
+
+#include <libphyseng/concurrency/spsc_ring.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+
+#include <spdlog/logger.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace sph
+{
+	/**
+	 * @brief What `frame_writer::submit` does when every buffer is still waiting to be written
+	 */
+	enum struct backpressure_policy
+	{
+		skip, //< Drop the frame, the solver never waits on the disk
+		block //< Wait for the writer to free a buffer, no frame is lost
+	};
+
+	struct frame_writer_settings
+	{
+		std::size_t buffer_count = 4; //< Frames that can be in flight at once
+		backpressure_policy policy = backpressure_policy::skip;
+		output_columns columns = {};
+	};
+
+	/**
+	 * @brief Writes frames on a dedicated thread so that the solver never waits on the disk
+	 *
+	 * The solver copies the columns it wants written into a free buffer and hands it to the
+	 * writer thread through a lock-free single producer, single consumer ring. Written buffers
+	 * come back to the solver through a second ring. Once every buffer is in flight, new frames
+	 * are skipped or delayed depending on the backpressure policy
+	 *
+	 * `submit` and `flush` must always be called from the same thread
+	 */
+	class frame_writer
+	{
+	public:
+		struct statistics
+		{
+			std::uint64_t submitted_count = 0; //< Frames handed to the writer thread
+			std::uint64_t skipped_count = 0;   //< Frames dropped because no buffer was free
+			std::uint64_t written_count = 0;   //< Frames stored by the sink
+			std::uint64_t failed_count = 0;    //< Frames the sink failed to store
+			std::uint64_t written_bytes = 0;
+			double stall_time = 0.0; //< Seconds `submit` spent waiting for a free buffer
+		};
+
+	public:
+		frame_writer(std::unique_ptr<frame_sink> sink, frame_writer_settings const& settings,
+					 spdlog::logger& logger);
+		frame_writer(frame_writer const&) = delete;
+		frame_writer(frame_writer&&) = delete;
+		/**
+		 * @brief Writes the frames still queued before returning
+		 */
+		~frame_writer();
+
+		auto operator=(frame_writer const&) -> frame_writer& = delete;
+		auto operator=(frame_writer&&) -> frame_writer& = delete;
+
+		/**
+		 * @brief Queue the current state of `particles` for output
+		 *
+		 * @return Whether the frame was queued, it is dropped when no buffer is free and the
+		 * policy is to skip
+		 */
+		template<physeng::precision_policy Precision>
+		auto submit(physeng::basic_particle_set<Precision> const& particles, std::uint64_t step,
+					double time) -> bool;
+
+		/**
+		 * @brief Wait until every queued frame has been written
+		 */
+		void flush();
+
+		[[nodiscard]] auto get_statistics() const -> statistics;
+
+	private:
+		using buffer = std::unique_ptr<frame>;
+
+		void run(std::stop_token const& stop);
+		void write(buffer output);
+		auto acquire_buffer() -> buffer;
+
+	private:
+		std::unique_ptr<frame_sink> m_sink;
+		frame_writer_settings m_settings;
+		spdlog::logger* m_logger;
+
+		// Solver to writer
+		physeng::spsc_ring<buffer> m_pending;
+		std::atomic<std::uint64_t> m_pending_epoch = 0;
+		// Writer to solver
+		physeng::spsc_ring<buffer> m_free;
+		std::atomic<std::uint64_t> m_free_epoch = 0;
+
+		// Only touched by the solver thread
+		std::uint64_t m_submitted_count = 0;
+		std::uint64_t m_skipped_count = 0;
+		double m_stall_time = 0.0;
+
+		// Only written by the writer thread
+		std::atomic<std::uint64_t> m_written_count = 0;
+		std::atomic<std::uint64_t> m_failed_count = 0;
+		std::atomic<std::uint64_t> m_written_bytes = 0;
+
+		// Last, the thread has to stop before anything it uses is destroyed
+		std::jthread m_thread;
+	};
+} // namespace sph
@@ -0,0 +1,53 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <sph/phase_timings.hpp>
+
+namespace
+{
+	using namespace std::literals;
+} // namespace
+
+namespace sph
+{
+	auto to_string(run_phase phase) -> std::string_view
+	{
+		switch (phase)
+		{
+			case run_phase::neighbor_search:
+				return "neighbor search"sv;
+			case run_phase::density:
+				return "density"sv;
+			case run_phase::forces:
+				return "forces"sv;
+			case run_phase::divergence_solve:
+				return "divergence solve"sv;
+			case run_phase::pressure_solve:
+				return "pressure solve"sv;
+			case run_phase::advection:
+				return "advection"sv;
+			case run_phase::gpu_step:
+				return "gpu step"sv;
+			case run_phase::output:
+				return "output"sv;
+			case run_phase::checkpoint:
+				return "checkpoint"sv;
+		}
+
+		return {};
+	}
+} // namespace sph
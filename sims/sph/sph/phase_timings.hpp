@@ -0,0 +1,104 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string_view>
+
+namespace sph
+{
+	/**
+	 * @brief The parts a run spends its time in
+	 */
+	enum struct run_phase : std::size_t
+	{
+		neighbor_search,  //< Morton reorders and verlet list updates
+		density,          //< Density, and pressure for WCSPH
+		forces,           //< Pressure and viscous forces for WCSPH, non-pressure forces for DFSPH
+		divergence_solve, //< The divergence free solve of DFSPH
+		pressure_solve,   //< The constant density solve of DFSPH
+		advection,        //< Moving the particles
+		gpu_step,         //< Whole steps of the vulkan backend, waiting included
+		output,           //< Handing frames over to the writer, or staging them on the GPU
+		checkpoint        //< Writing checkpoints
+	};
+
+	inline constexpr std::size_t run_phase_count = 9;
+
+	auto to_string(run_phase phase) -> std::string_view;
+
+	/**
+	 * @brief The wall time spent in every phase of a run
+	 */
+	class phase_timings
+	{
+	public:
+		using duration = std::chrono::steady_clock::duration;
+
+	public:
+		void add(run_phase phase, duration elapsed) noexcept
+		{
+			m_durations[static_cast<std::size_t>(phase)] += elapsed;
+		}
+
+		[[nodiscard]] auto get(run_phase phase) const noexcept -> duration
+		{
+			return m_durations[static_cast<std::size_t>(phase)];
+		}
+
+		auto operator+=(phase_timings const& other) noexcept -> phase_timings&
+		{
+			for (std::size_t i = 0; i < run_phase_count; ++i)
+			{
+				m_durations[i] += other.m_durations[i];
+			}
+
+			return *this;
+		}
+
+	private:
+		std::array<duration, run_phase_count> m_durations = {};
+	};
+
+	/**
+	 * @brief Adds the time between its creation and its destruction to a phase
+	 */
+	class scoped_phase_timer
+	{
+	public:
+		scoped_phase_timer(phase_timings& timings, run_phase phase) :
+			m_timings(&timings), m_phase(phase), m_start(std::chrono::steady_clock::now())
+		{}
+		scoped_phase_timer(scoped_phase_timer const&) = delete;
+		scoped_phase_timer(scoped_phase_timer&&) = delete;
+		~scoped_phase_timer()
+		{
+			m_timings->add(m_phase, std::chrono::steady_clock::now() - m_start);
+		}
+
+		auto operator=(scoped_phase_timer const&) -> scoped_phase_timer& = delete;
+		auto operator=(scoped_phase_timer&&) -> scoped_phase_timer& = delete;
+
+	private:
+		phase_timings* m_timings;
+		run_phase m_phase;
+		std::chrono::steady_clock::time_point m_start;
+	};
+} // namespace sph
@@ -0,0 +1,194 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <sph/scene.hpp>
+
+#include <sph/core.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	using namespace std::literals;
+
+	/**
+	 * @brief A fluid block of a reference scene, in particle spacings
+	 */
+	struct block_cells
+	{
+		std::array<float, 3> origin;
+		std::array<float, 3> count;
+	};
+
+	// Every reference scene shares the same tank, in particle spacings
+	constexpr std::array<float, 3> reference_tank = {80.0F, 50.0F, 33.0F};
+
+	auto get_reference_blocks(sph::scenario_type type) -> std::vector<block_cells>
+	{
+		switch (type)
+		{
+			case sph::scenario_type::dam_break:
+				return {{.origin = {0.0F, 0.0F, 0.0F}, .count = {32.0F, 32.0F, 32.0F}}};
+			case sph::scenario_type::still_tank:
+				return {{.origin = {0.0F, 0.0F, 0.0F}, .count = {80.0F, 25.0F, 33.0F}}};
+			case sph::scenario_type::double_dam_break:
+				return {{.origin = {0.0F, 0.0F, 0.0F}, .count = {24.0F, 32.0F, 33.0F}},
+						{.origin = {56.0F, 0.0F, 0.0F}, .count = {24.0F, 32.0F, 33.0F}}};
+		}
+
+		return {};
+	}
+
+	auto scale_cells(float cells, double scale) -> std::uint32_t
+	{
+		return static_cast<std::uint32_t>(std::lround(static_cast<double>(cells) * scale));
+	}
+} // namespace
+
+namespace sph
+{
+	template<std::size_t Dimension, physeng::precision_policy Precision>
+		requires physeng::spatial_dimension<Dimension>
+	void add_fluid_block(physeng::basic_particle_set<Precision>& particles,
+						 fluid_block const& block)
+	{
+		assert(Dimension == 3 || (block.count[2] == 1 && block.origin[2] == 0.0F)); // NOLINT
+
+		let count = std::size_t{block.count[0]} * block.count[1] * block.count[2];
+		let first = particles.append(count);
+
+		auto mass = block.rest_density;
+		for (std::size_t axis = 0; axis < Dimension; ++axis)
+		{
+			mass *= block.spacing;
+		}
+
+		auto x = particles.position(0);
+		auto y = particles.position(1);
+		auto z = particles.position(2);
+
+		auto i = std::size_t{first};
+		for (std::uint32_t k = 0; k < block.count[2]; ++k)
+		{
+			for (std::uint32_t j = 0; j < block.count[1]; ++j)
+			{
+				for (std::uint32_t l = 0; l < block.count[0]; ++l, ++i)
+				{
+					x[i] = block.origin[0] + static_cast<float>(l) * block.spacing;
+					y[i] = block.origin[1] + static_cast<float>(j) * block.spacing;
+					z[i] = block.origin[2] + static_cast<float>(k) * block.spacing;
+				}
+			}
+		}
+
+		std::ranges::fill(particles.mass().subspan(first), mass);
+		std::ranges::fill(particles.density().subspan(first), block.rest_density);
+	}
+
+	template void add_fluid_block<2>(physeng::particle_set& particles, fluid_block const& block);
+	template void add_fluid_block<3>(physeng::particle_set& particles, fluid_block const& block);
+	template void add_fluid_block<2>(physeng::compact_particle_set& particles,
+									 fluid_block const& block);
+	template void add_fluid_block<3>(physeng::compact_particle_set& particles,
+									 fluid_block const& block);
+
+	auto to_string(scenario_type type) -> std::string_view
+	{
+		switch (type)
+		{
+			case scenario_type::dam_break:
+				return "dam-break"sv;
+			case scenario_type::still_tank:
+				return "still-tank"sv;
+			case scenario_type::double_dam_break:
+				return "double-dam-break"sv;
+		}
+
+		return {};
+	}
+
+	template<std::size_t Dimension>
+		requires physeng::spatial_dimension<Dimension>
+	auto make_scene(scenario_type type, std::size_t particle_count, float spacing,
+					float rest_density) -> scene
+	{
+		let reference = get_reference_blocks(type);
+
+		auto reference_count = 0.0;
+		for (let& block : reference)
+		{
+			auto block_count = 1.0;
+			for (std::size_t axis = 0; axis < Dimension; ++axis)
+			{
+				block_count *= double{block.count[axis]};
+			}
+
+			reference_count += block_count;
+		}
+
+		// Lengths grow with the square or cube root of the number of particles
+		let ratio = static_cast<double>(particle_count) / reference_count;
+		let scale = Dimension == 2 ? std::sqrt(ratio) : std::cbrt(ratio);
+		let half_spacing = 0.5F * spacing;
+
+		// The z axis of a two dimensional scene is left at zero, a single layer of particles
+		auto tank = std::array<std::uint32_t, 3>{};
+		auto result = scene{.bounds = {.min = {0.0F, 0.0F, 0.0F}, .max = {}}, .blocks = {}};
+		for (std::size_t axis = 0; axis < Dimension; ++axis)
+		{
+			tank[axis] = std::max(scale_cells(reference_tank[axis], scale), 1U);
+			result.bounds.max[axis] = static_cast<float>(tank[axis]) * spacing;
+		}
+
+		for (let& block : reference)
+		{
+			auto& scaled = result.blocks.emplace_back(fluid_block{.origin = {},
+																  .count = {1, 1, 1},
+																  .spacing = spacing,
+																  .rest_density = rest_density});
+			for (std::size_t axis = 0; axis < Dimension; ++axis)
+			{
+				// Rounding may push a block one spacing past the wall
+				let origin = std::min(scale_cells(block.origin[axis], scale), tank[axis] - 1);
+				let count = std::max(scale_cells(block.count[axis], scale), 1U);
+
+				scaled.origin[axis] = half_spacing + static_cast<float>(origin) * spacing;
+				scaled.count[axis] = std::min(count, tank[axis] - origin);
+			}
+		}
+
+		return result;
+	}
+
+	template auto make_scene<2>(scenario_type type, std::size_t particle_count, float spacing,
+								float rest_density) -> scene;
+	template auto make_scene<3>(scenario_type type, std::size_t particle_count, float spacing,
+								float rest_density) -> scene;
+
+	auto get_fluid_height(scene const& layout) -> float
+	{
+		auto height = 0.0F;
+		for (let& block : layout.blocks)
+		{
+			height = std::max(height, static_cast<float>(block.count[1]) * block.spacing);
+		}
+
+		return height;
+	}
+} // namespace sph
@@ -0,0 +1,100 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <libphyseng/particles/particle_set.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace sph
+{
+	/**
+	 * @brief The axis aligned box the particles are confined to. Flat along z in two dimensions
+	 */
+	struct domain
+	{
+		std::array<float, 3> min;
+		std::array<float, 3> max;
+	};
+
+	/**
+	 * @brief Describes a box of fluid particles laid out on a regular lattice
+	 */
+	struct fluid_block
+	{
+		std::array<float, 3> origin;       //< Position of the first particle of the block
+		std::array<std::uint32_t, 3> count; //< Number of particles along every axis
+		float spacing;                      //< Distance between two neighboring particles
+		float rest_density;                 //< Density used to compute the particle masses
+	};
+
+	/**
+	 * @brief Append the particles of a fluid block at the end of a particle set. The mass of a
+	 * particle is the rest density times the area of a lattice cell in two dimensions, times its
+	 * volume in three
+	 */
+	template<std::size_t Dimension, physeng::precision_policy Precision>
+		requires physeng::spatial_dimension<Dimension>
+	void add_fluid_block(physeng::basic_particle_set<Precision>& particles,
+						 fluid_block const& block);
+
+	/**
+	 * @brief The standard scenes, used to compare runs and machines
+	 */
+	enum struct scenario_type
+	{
+		dam_break,       //< A column of fluid at one end of the tank collapses
+		still_tank,      //< A layer of fluid covers the floor of the tank and stays at rest
+		double_dam_break //< Columns at both ends of the tank collapse and collide in the middle
+	};
+
+	auto to_string(scenario_type type) -> std::string_view;
+
+	/**
+	 * @brief The tank and the fluid blocks of a scenario
+	 */
+	struct scene
+	{
+		domain bounds;
+		std::vector<fluid_block> blocks;
+	};
+
+	/**
+	 * @brief Lay out a scenario with about `particle_count` particles
+	 *
+	 * Every scenario is defined at a reference size. The tank and the blocks are scaled together,
+	 * keeping the spacing of the particles, so the shape of the flow does not depend on the
+	 * particle count. A dam break of 32768 particles is the reference scene itself
+	 *
+	 * The two dimensional scenes are the xy cross section of the three dimensional ones, their
+	 * particles all lie in the plane z = 0
+	 */
+	template<std::size_t Dimension>
+		requires physeng::spatial_dimension<Dimension>
+	auto make_scene(scenario_type type, std::size_t particle_count, float spacing,
+					float rest_density) -> scene;
+
+	/**
+	 * @brief The height of the tallest fluid block, which sets the largest speed of the flow
+	 */
+	auto get_fluid_height(scene const& layout) -> float;
+} // namespace sph
@@ -0,0 +1,105 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <sph/solver/advection.hpp>
+
+#include <sph/core.hpp>
+
+#include <libphyseng/concurrency/parallel_reduce.hpp>
+#include <libphyseng/memory/frame_arena.hpp>
+#include <libphyseng/profiling/profiler.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace sph
+{
+	template<std::size_t Dimension, physeng::precision_policy Precision>
+		requires physeng::spatial_dimension<Dimension>
+	auto advect(physeng::basic_particle_set<Precision>& particles,
+				velocity_columns<typename Precision::velocity_type const, Dimension> velocity,
+				domain const& bounds, float dt) -> float
+	{
+		PHYSENG_PROFILE_ZONE("advect");
+
+		let advect_block = [&](std::size_t begin, std::size_t end) {
+			auto max_speed_squared = 0.0F;
+
+			for (std::size_t axis = 0; axis < Dimension; ++axis)
+			{
+				auto position = particles.position(axis);
+				auto out_velocity = particles.velocity(axis);
+				let in_velocity = velocity[axis];
+				let min = bounds.min[axis];
+				let max = bounds.max[axis];
+
+				for (auto i = begin; i < end; ++i)
+				{
+					auto v = float{in_velocity[i]};
+					auto x = position[i] + dt * v;
+
+					if (x < min)
+					{
+						x = min;
+						v = std::max(v, 0.0F);
+					}
+					else if (x > max)
+					{
+						x = max;
+						v = std::min(v, 0.0F);
+					}
+
+					position[i] = x;
+					out_velocity[i] = v;
+				}
+			}
+
+			for (auto i = begin; i < end; ++i)
+			{
+				auto speed_squared = 0.0F;
+				for (std::size_t axis = 0; axis < Dimension; ++axis)
+				{
+					let v = float{particles.velocity(axis)[i]};
+					speed_squared += v * v;
+				}
+
+				max_speed_squared = std::max(max_speed_squared, speed_squared);
+			}
+
+			return max_speed_squared;
+		};
+
+		let max_speed_squared = physeng::parallel_reduce(
+			particles.size(), 0.0F, advect_block,
+			[](float lhs, float rhs) { return std::max(lhs, rhs); }, physeng::get_frame_resource());
+
+		return std::sqrt(max_speed_squared);
+	}
+
+	template auto advect<2>(physeng::particle_set& particles,
+							velocity_columns<float const, 2> velocity, domain const& bounds,
+							float dt) -> float;
+	template auto advect<3>(physeng::particle_set& particles,
+							velocity_columns<float const, 3> velocity, domain const& bounds,
+							float dt) -> float;
+	template auto advect<2>(physeng::compact_particle_set& particles,
+							velocity_columns<physeng::bfloat16 const, 2> velocity,
+							domain const& bounds, float dt) -> float;
+	template auto advect<3>(physeng::compact_particle_set& particles,
+							velocity_columns<physeng::bfloat16 const, 3> velocity,
+							domain const& bounds, float dt) -> float;
+} // namespace sph
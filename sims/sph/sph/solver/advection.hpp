@@ -0,0 +1,51 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <sph/scene.hpp>
+
+#include <libphyseng/particles/particle_set.hpp>
+
+#include <array>
+#include <cstddef>
+#include <span>
+
+namespace sph
+{
+	/**
+	 * @brief The velocity of every particle, one span per axis the simulation moves along
+	 */
+	template<typename Type, std::size_t Dimension = physeng::particle_set::dimension>
+	using velocity_columns = std::array<std::span<Type>, Dimension>;
+
+	/**
+	 * @brief Set the velocity of every particle to `velocity` and move the particles over `dt`
+	 * in the same sweep. Particles leaving the domain are put back on its walls and lose the
+	 * velocity component that carried them out
+	 *
+	 * `velocity` may alias the velocity columns of `particles`. In two dimensions the z axis of
+	 * the particles is left untouched
+	 *
+	 * @return The largest particle speed after the move
+	 */
+	template<std::size_t Dimension, physeng::precision_policy Precision>
+		requires physeng::spatial_dimension<Dimension>
+	auto advect(physeng::basic_particle_set<Precision>& particles,
+				velocity_columns<typename Precision::velocity_type const, Dimension> velocity,
+				domain const& bounds, float dt) -> float;
+} // namespace sph
@@ -0,0 +1,421 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <sph/solver/dfsph.hpp>
+
+#include <sph/core.hpp>
+#include <sph/solver/advection.hpp>
+#include <sph/solver/neighbor_batch.hpp>
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+#include <libphyseng/concurrency/parallel_reduce.hpp>
+#include <libphyseng/memory/frame_arena.hpp>
+#include <libphyseng/profiling/profiler.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	constexpr std::size_t particle_grain = 1024;
+
+	// Viscosity term of Monaghan (2005), 2 * (d + 2) in three dimensions
+	constexpr float viscosity_scale = 10.0F;
+	// Keeps the viscosity term bounded when two particles get very close
+	constexpr float viscosity_epsilon = 0.01F;
+	// Below this denominator a particle has no neighbors to push against
+	constexpr float factor_epsilon = 1.0e-9F;
+	// Particles with fewer neighbors sit at the free surface and are left out of the divergence
+	// solve, their deficient density would make them stick to the fluid
+	constexpr std::size_t divergence_min_neighbors = 20;
+} // namespace
+
+namespace sph
+{
+	dfsph_solver::dfsph_solver(physeng::smoothing_kernel const& kernel,
+							   dfsph_parameters const& parameters) :
+		m_kernel(kernel), m_parameters(parameters), m_time_step(parameters.max_time_step)
+	{
+		assert(kernel.get_dimension() == physeng::particle_set::dimension); // NOLINT
+	}
+
+	auto dfsph_solver::get_time_step() const noexcept -> float
+	{
+		return m_time_step;
+	}
+	auto dfsph_solver::get_statistics() const noexcept -> statistics const&
+	{
+		return m_statistics;
+	}
+	auto dfsph_solver::get_timings() const noexcept -> phase_timings const&
+	{
+		return m_timings;
+	}
+
+	auto dfsph_solver::step(physeng::particle_set& particles, physeng::verlet_list const& neighbors)
+		-> float
+	{
+		PHYSENG_PROFILE_ZONE("dfsph_solver::step");
+
+		let rebuild_count = neighbors.get_statistics().rebuild_count;
+		let update_factors =
+			rebuild_count != m_factor_rebuild || m_factor.size() != particles.size();
+		m_factor_rebuild = rebuild_count;
+
+		{
+			let timer = scoped_phase_timer{m_timings, run_phase::density};
+			compute_density(particles, neighbors, update_factors);
+		}
+		{
+			let timer = scoped_phase_timer{m_timings, run_phase::divergence_solve};
+			m_statistics.divergence_iterations +=
+				solve(solve_kind::divergence, particles, neighbors, m_time_step);
+		}
+
+		// CFL condition, from the speeds left by the last move
+		let h = m_kernel.get_smoothing_length().get();
+		m_time_step = m_parameters.max_time_step;
+		if (m_max_speed > 0.0F)
+		{
+			m_time_step = std::min(m_time_step, m_parameters.cfl_factor * h / m_max_speed);
+		}
+		let dt = m_time_step;
+
+		{
+			let timer = scoped_phase_timer{m_timings, run_phase::forces};
+			apply_non_pressure_forces(particles, neighbors, dt);
+		}
+		{
+			let timer = scoped_phase_timer{m_timings, run_phase::pressure_solve};
+			m_statistics.density_iterations +=
+				solve(solve_kind::density, particles, neighbors, dt);
+		}
+		{
+			let timer = scoped_phase_timer{m_timings, run_phase::advection};
+			m_max_speed = advect<physeng::particle_set::dimension>(
+				particles, {particles.velocity(0), particles.velocity(1), particles.velocity(2)},
+				m_parameters.bounds, dt);
+		}
+
+		++m_statistics.step_count;
+		if (update_factors)
+		{
+			++m_statistics.factor_updates;
+		}
+
+		return dt;
+	}
+
+	void dfsph_solver::compute_density(physeng::particle_set& particles,
+									   physeng::verlet_list const& neighbors, bool update_factors)
+	{
+		PHYSENG_PROFILE_ZONE("dfsph_solver::compute_density");
+
+		m_factor.resize(particles.size());
+		m_stiffness.resize(particles.size());
+
+		let mass = particles.mass();
+		auto density = particles.density();
+
+		physeng::parallel_for(particles.size(), particle_grain, [&](std::size_t first,
+																	 std::size_t last) {
+			auto batch = neighbor_batch<physeng::particle_set::dimension>{};
+
+			for (auto i = first; i < last; ++i)
+			{
+				let index = static_cast<physeng::particle_index>(i);
+				batch.gather(particles, neighbors, index);
+				m_kernel.evaluate(batch.distance_squared(), batch.kernel());
+
+				let indices = batch.indices();
+				let values = batch.kernel();
+
+				auto sum = 0.0F;
+				for (std::size_t k = 0; k < batch.size(); ++k)
+				{
+					sum += mass[indices[k]] * values[k];
+				}
+				density[i] = sum;
+
+				if (!update_factors)
+				{
+					continue;
+				}
+
+				// alpha_i = rho_i / (|sum_j m_j grad W_ij|^2 + sum_j |m_j grad W_ij|^2)
+				m_kernel.evaluate_gradient(batch.distance_squared(), batch.kernel());
+
+				let factors = batch.kernel();
+				let dx = batch.offset(0);
+				let dy = batch.offset(1);
+				let dz = batch.offset(2);
+
+				auto gx = 0.0F;
+				auto gy = 0.0F;
+				auto gz = 0.0F;
+				auto sum_squared = 0.0F;
+				for (std::size_t k = 0; k < batch.size(); ++k)
+				{
+					let scale = mass[indices[k]] * factors[k];
+					gx += scale * dx[k];
+					gy += scale * dy[k];
+					gz += scale * dz[k];
+					sum_squared += scale * scale * batch.distance_squared()[k];
+				}
+
+				let denominator = gx * gx + gy * gy + gz * gz + sum_squared;
+				m_factor[i] = denominator > factor_epsilon ? sum / denominator : 0.0F;
+			}
+		});
+	}
+
+	void dfsph_solver::apply_non_pressure_forces(physeng::particle_set& particles,
+												 physeng::verlet_list const& neighbors, float dt)
+	{
+		PHYSENG_PROFILE_ZONE("dfsph_solver::apply_non_pressure_forces");
+
+		for (auto& column : m_acceleration)
+		{
+			column.resize(particles.size());
+		}
+
+		let h = m_kernel.get_smoothing_length().get();
+		let epsilon = viscosity_epsilon * h * h;
+		let viscosity = viscosity_scale * m_parameters.viscosity;
+
+		let mass = particles.mass();
+		let density = particles.density();
+		let vx = particles.velocity(0);
+		let vy = particles.velocity(1);
+		let vz = particles.velocity(2);
+
+		physeng::parallel_for(particles.size(), particle_grain, [&](std::size_t first,
+																	 std::size_t last) {
+			auto batch = neighbor_batch<physeng::particle_set::dimension>{};
+
+			for (auto i = first; i < last; ++i)
+			{
+				let index = static_cast<physeng::particle_index>(i);
+				batch.gather(particles, neighbors, index);
+				m_kernel.evaluate_gradient(batch.distance_squared(), batch.kernel());
+
+				let indices = batch.indices();
+				let factors = batch.kernel();
+				let dx = batch.offset(0);
+				let dy = batch.offset(1);
+				let dz = batch.offset(2);
+				let r2 = batch.distance_squared();
+
+				auto ax = 0.0F;
+				auto ay = 0.0F;
+				auto az = 0.0F;
+				for (std::size_t k = 0; k < batch.size(); ++k)
+				{
+					let j = indices[k];
+					let v_dot_x =
+						(vx[i] - vx[j]) * dx[k] + (vy[i] - vy[j]) * dy[k] + (vz[i] - vz[j]) * dz[k];
+					let scale = viscosity * mass[j] / density[j] * v_dot_x / (r2[k] + epsilon)
+							  * factors[k];
+
+					ax += scale * dx[k];
+					ay += scale * dy[k];
+					az += scale * dz[k];
+				}
+
+				m_acceleration[0][i] = ax;
+				m_acceleration[1][i] = ay;
+				m_acceleration[2][i] = az;
+			}
+		});
+
+		// The viscosity reads the velocity of the neighbors, it can only be applied once every
+		// particle is done
+		physeng::parallel_for(particles.size(), particle_grain, [&](std::size_t first,
+																	 std::size_t last) {
+			for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+			{
+				auto velocity = particles.velocity(axis);
+				let acceleration = std::span{m_acceleration[axis]};
+				let gravity = m_parameters.gravity[axis];
+
+				for (auto i = first; i < last; ++i)
+				{
+					velocity[i] += dt * (acceleration[i] + gravity);
+				}
+			}
+		});
+	}
+
+	auto dfsph_solver::solve(solve_kind kind, physeng::particle_set& particles,
+							 physeng::verlet_list const& neighbors, float dt) -> std::uint32_t
+	{
+		PHYSENG_PROFILE_ZONE("dfsph_solver::solve");
+
+		let tolerance = kind == solve_kind::density ? m_parameters.max_density_error
+													: m_parameters.max_divergence_error;
+
+		auto iteration = std::uint32_t{0};
+		while (iteration < m_parameters.max_iterations)
+		{
+			let error = compute_stiffness(kind, particles, neighbors, dt);
+			if (iteration >= m_parameters.min_iterations && error <= double{tolerance})
+			{
+				break;
+			}
+
+			apply_stiffness(particles, neighbors, dt);
+			++iteration;
+		}
+
+		PHYSENG_PROFILE_COUNTER(kind == solve_kind::density ? "dfsph density iterations"
+															: "dfsph divergence iterations",
+								iteration);
+
+		return iteration;
+	}
+
+	auto dfsph_solver::compute_stiffness(solve_kind kind, physeng::particle_set const& particles,
+										 physeng::verlet_list const& neighbors, float dt)
+		-> double
+	{
+		PHYSENG_PROFILE_ZONE("dfsph_solver::compute_stiffness");
+
+		if (particles.empty())
+		{
+			return 0.0;
+		}
+
+		let radius = m_kernel.get_support_radius().get();
+		let radius_squared = radius * radius;
+		let rest_density = m_parameters.rest_density;
+
+		let mass = particles.mass();
+		let density = particles.density();
+		let vx = particles.velocity(0);
+		let vy = particles.velocity(1);
+		let vz = particles.velocity(2);
+
+		let reduce_block = [&](std::size_t begin, std::size_t end) {
+			auto batch = neighbor_batch<physeng::particle_set::dimension>{};
+			auto error_sum = 0.0;
+
+			for (auto i = begin; i < end; ++i)
+			{
+				let index = static_cast<physeng::particle_index>(i);
+				batch.gather(particles, neighbors, index);
+				m_kernel.evaluate_gradient(batch.distance_squared(), batch.kernel());
+
+				let indices = batch.indices();
+				let factors = batch.kernel();
+				let dx = batch.offset(0);
+				let dy = batch.offset(1);
+				let dz = batch.offset(2);
+				let r2 = batch.distance_squared();
+
+				// The rate of change of the density, D rho / Dt = sum_j m_j (v_i - v_j) . grad W_ij
+				auto density_change = 0.0F;
+				auto neighbor_count = std::size_t{0};
+				for (std::size_t k = 0; k < batch.size(); ++k)
+				{
+					let j = indices[k];
+					let v_dot_x =
+						(vx[i] - vx[j]) * dx[k] + (vy[i] - vy[j]) * dy[k] + (vz[i] - vz[j]) * dz[k];
+
+					density_change += mass[j] * factors[k] * v_dot_x;
+					neighbor_count += r2[k] < radius_squared ? 1 : 0;
+				}
+
+				auto error = 0.0F;
+				if (kind == solve_kind::density)
+				{
+					// Only compression is corrected, the free surface is allowed to expand
+					error = std::max(0.0F, density[i] + dt * density_change - rest_density);
+					m_stiffness[i] = error / (dt * dt) * m_factor[i];
+				}
+				else
+				{
+					error = neighbor_count < divergence_min_neighbors
+							  ? 0.0F
+							  : std::max(0.0F, density_change);
+					m_stiffness[i] = error / dt * m_factor[i];
+					error *= dt;
+				}
+
+				error_sum += double{error};
+			}
+
+			return error_sum;
+		};
+
+		let error_sum = physeng::parallel_reduce(
+			particles.size(), 0.0, reduce_block, [](double lhs, double rhs) { return lhs + rhs; },
+			physeng::get_frame_resource());
+
+		return error_sum / (double{rest_density} * static_cast<double>(particles.size()));
+	}
+
+	void dfsph_solver::apply_stiffness(physeng::particle_set& particles,
+									   physeng::verlet_list const& neighbors, float dt) const
+	{
+		PHYSENG_PROFILE_ZONE("dfsph_solver::apply_stiffness");
+
+		let mass = particles.mass();
+		let density = particles.density();
+		auto vx = particles.velocity(0);
+		auto vy = particles.velocity(1);
+		auto vz = particles.velocity(2);
+
+		// Every particle only writes its own velocity and reads the stiffness of its neighbors,
+		// which is what makes the update a Jacobi iteration
+		physeng::parallel_for(particles.size(), particle_grain, [&](std::size_t first,
+																	 std::size_t last) {
+			auto batch = neighbor_batch<physeng::particle_set::dimension>{};
+
+			for (auto i = first; i < last; ++i)
+			{
+				let index = static_cast<physeng::particle_index>(i);
+				batch.gather(particles, neighbors, index);
+				m_kernel.evaluate_gradient(batch.distance_squared(), batch.kernel());
+
+				let indices = batch.indices();
+				let factors = batch.kernel();
+				let dx = batch.offset(0);
+				let dy = batch.offset(1);
+				let dz = batch.offset(2);
+
+				let stiffness_i = m_stiffness[i] / density[i];
+
+				auto ax = 0.0F;
+				auto ay = 0.0F;
+				auto az = 0.0F;
+				for (std::size_t k = 0; k < batch.size(); ++k)
+				{
+					let j = indices[k];
+					let scale = mass[j] * (stiffness_i + m_stiffness[j] / density[j]) * factors[k];
+
+					ax += scale * dx[k];
+					ay += scale * dy[k];
+					az += scale * dz[k];
+				}
+
+				vx[i] -= dt * ax;
+				vy[i] -= dt * ay;
+				vz[i] -= dt * az;
+			}
+		});
+	}
+} // namespace sph
@@ -0,0 +1,137 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <sph/phase_timings.hpp>
+#include <sph/scene.hpp>
+
+#include <libphyseng/kernels/smoothing_kernel.hpp>
+#include <libphyseng/neighbor/verlet_list.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+#include <libphyseng/util/aligned_allocator.hpp>
+
+#include <array>
+#include <cstdint>
+
+namespace sph
+{
+	struct dfsph_parameters
+	{
+		float rest_density;
+		float viscosity;     //< Kinematic viscosity
+		float cfl_factor;    //< Fraction of a particle diameter a particle may travel per step
+		float max_time_step; //< Upper bound of the time step, used while the fluid is at rest
+		float max_density_error;    //< Average relative compression the density solve accepts
+		float max_divergence_error; //< Average relative density change per step accepted by the
+									//< divergence solve
+		std::uint32_t min_iterations;
+		std::uint32_t max_iterations;
+		std::array<float, 3> gravity;
+		domain bounds;
+	};
+
+	/**
+	 * @brief Divergence free SPH (Bender and Koschier, 2015). Two pressure solves keep the fluid
+	 * incompressible: the divergence solve removes the velocity divergence left after the last
+	 * move and the density solve corrects the compression the next move would cause. Together
+	 * they allow time steps an order of magnitude larger than the ones of WCSPH
+	 *
+	 * Both solves are Jacobi iterations made of two passes over the neighbor lists: one computes
+	 * the stiffness of every particle from the current velocities, the other updates the
+	 * velocities from the stiffness of the neighbors. The DFSPH factor of every particle is only
+	 * computed when the neighbor lists are rebuilt, within the density pass
+	 *
+	 * Only runs in three dimensions, the free surface detection of the divergence solve counts
+	 * neighbors against a three dimensional threshold
+	 */
+	class dfsph_solver
+	{
+	public:
+		struct statistics
+		{
+			std::uint64_t step_count = 0;
+			std::uint64_t density_iterations = 0;    //< Summed over every step
+			std::uint64_t divergence_iterations = 0; //< Summed over every step
+			std::uint64_t factor_updates = 0;        //< Number of steps that refreshed the factors
+		};
+
+	public:
+		dfsph_solver(physeng::smoothing_kernel const& kernel, dfsph_parameters const& parameters);
+
+		/**
+		 * @brief The time step the next call to `step` will take
+		 */
+		[[nodiscard]] auto get_time_step() const noexcept -> float;
+		[[nodiscard]] auto get_statistics() const noexcept -> statistics const&;
+		/**
+		 * @brief The time spent in every phase of the steps taken so far
+		 */
+		[[nodiscard]] auto get_timings() const noexcept -> phase_timings const&;
+
+		/**
+		 * @brief Advance the particles by one time step
+		 *
+		 * @param[in,out] particles The particles to move
+		 * @param[in] neighbors Verlet lists up to date with the current positions of the particles
+		 *
+		 * @return The time step that was taken
+		 */
+		auto step(physeng::particle_set& particles, physeng::verlet_list const& neighbors)
+			-> float;
+
+	private:
+		enum struct solve_kind
+		{
+			density,
+			divergence
+		};
+
+		void compute_density(physeng::particle_set& particles,
+							 physeng::verlet_list const& neighbors, bool update_factors);
+		void apply_non_pressure_forces(physeng::particle_set& particles,
+									   physeng::verlet_list const& neighbors, float dt);
+
+		auto solve(solve_kind kind, physeng::particle_set& particles,
+				   physeng::verlet_list const& neighbors, float dt) -> std::uint32_t;
+		/**
+		 * @brief Compute the stiffness of every particle from the current velocities
+		 *
+		 * @return The average relative error left, per the criterion of the solve
+		 */
+		auto compute_stiffness(solve_kind kind, physeng::particle_set const& particles,
+							   physeng::verlet_list const& neighbors, float dt) -> double;
+		void apply_stiffness(physeng::particle_set& particles,
+							 physeng::verlet_list const& neighbors, float dt) const;
+
+	private:
+		physeng::smoothing_kernel m_kernel;
+		dfsph_parameters m_parameters;
+
+		float m_time_step;
+		float m_max_speed = 0.0F;
+		std::uint64_t m_factor_rebuild = 0;
+
+		physeng::aligned_vector<float> m_factor;
+		physeng::aligned_vector<float> m_stiffness;
+		std::array<physeng::aligned_vector<float>, physeng::particle_set::dimension>
+			m_acceleration;
+
+		statistics m_statistics = {};
+		phase_timings m_timings = {};
+	};
+} // namespace sph
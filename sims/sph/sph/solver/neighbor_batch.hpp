@@ -0,0 +1,145 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <libphyseng/memory/frame_arena.hpp>
+#include <libphyseng/neighbor/verlet_list.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace sph
+{
+	/**
+	 * @brief The candidate neighbors of a single particle laid out contiguously, so that the
+	 * smoothing kernel can be evaluated over all of them in one batch
+	 *
+	 * Meant to be created once per chunk of particles and reused for every particle of the chunk.
+	 * The buffers live in the frame arena of the thread processing the chunk
+	 *
+	 * @tparam Dimension The number of offsets gathered per pair, the z axis is skipped in two
+	 * dimensions
+	 */
+	template<std::size_t Dimension>
+		requires physeng::spatial_dimension<Dimension>
+	class neighbor_batch
+	{
+	public:
+		neighbor_batch() : neighbor_batch(physeng::get_frame_resource()) {}
+		explicit neighbor_batch(std::pmr::memory_resource* resource) :
+			m_offset(make_offsets(resource, std::make_index_sequence<Dimension>{})),
+			m_distance_squared(resource), m_kernel(resource)
+		{}
+
+		/**
+		 * @brief Gather the offsets and squared distances from the particle `i` to every one of
+		 * its candidates. Candidates outside of the support radius are kept: the kernel vanishes
+		 * there, which is cheaper than branching on every pair
+		 */
+		template<physeng::precision_policy Precision>
+		void gather(physeng::basic_particle_set<Precision> const& particles,
+					physeng::verlet_list const& neighbors, physeng::particle_index i)
+		{
+			m_indices = neighbors.candidates(i);
+			if (m_distance_squared.size() < m_indices.size())
+			{
+				// The arena never reuses what a vector gives back, grow by large steps
+				auto const capacity = std::max(m_indices.size(), 2 * m_distance_squared.size());
+
+				m_distance_squared.resize(capacity);
+				m_kernel.resize(capacity);
+				for (auto& offsets : m_offset)
+				{
+					offsets.resize(capacity);
+				}
+			}
+
+			auto const x = particles.position(0);
+			auto const y = particles.position(1);
+			auto const z = particles.position(2);
+
+			for (std::size_t k = 0; k < m_indices.size(); ++k)
+			{
+				auto const j = m_indices[k];
+				auto const dx = x[i] - x[j];
+				auto const dy = y[i] - y[j];
+
+				m_offset[0][k] = dx;
+				m_offset[1][k] = dy;
+				m_distance_squared[k] = dx * dx + dy * dy;
+
+				if constexpr (Dimension == 3)
+				{
+					auto const dz = z[i] - z[j];
+
+					m_offset[2][k] = dz;
+					m_distance_squared[k] += dz * dz;
+				}
+			}
+		}
+
+		[[nodiscard]] auto size() const noexcept -> std::size_t
+		{
+			return m_indices.size();
+		}
+		[[nodiscard]] auto indices() const noexcept -> std::span<physeng::particle_index const>
+		{
+			return m_indices;
+		}
+		/**
+		 * @brief The component `axis` of `x_i - x_j` for every candidate `j`
+		 */
+		[[nodiscard]] auto offset(std::size_t axis) const noexcept -> std::span<float const>
+		{
+			return std::span{m_offset[axis]}.first(size());
+		}
+		[[nodiscard]] auto distance_squared() const noexcept -> std::span<float const>
+		{
+			return std::span{m_distance_squared}.first(size());
+		}
+		/**
+		 * @brief Storage for the kernel values or gradient factors of the batch
+		 */
+		[[nodiscard]] auto kernel() noexcept -> std::span<float>
+		{
+			return std::span{m_kernel}.first(size());
+		}
+
+	private:
+		template<std::size_t... Axes>
+		static auto make_offsets(std::pmr::memory_resource* resource,
+								 std::index_sequence<Axes...> /*axes*/)
+			-> std::array<std::pmr::vector<float>, Dimension>
+		{
+			return {(static_cast<void>(Axes), std::pmr::vector<float>{resource})...};
+		}
+
+	private:
+		std::span<physeng::particle_index const> m_indices;
+
+		std::array<std::pmr::vector<float>, Dimension> m_offset;
+		std::pmr::vector<float> m_distance_squared;
+		std::pmr::vector<float> m_kernel;
+	};
+} // namespace sph
@@ -0,0 +1,238 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <sph/solver/wcsph.hpp>
+
+#include <sph/core.hpp>
+#include <sph/solver/advection.hpp>
+#include <sph/solver/neighbor_batch.hpp>
+
+#include <libphyseng/concurrency/parallel_for.hpp>
+#include <libphyseng/profiling/profiler.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <span>
+
+namespace
+{
+	constexpr std::size_t particle_grain = 1024;
+
+	// Viscosity term of Monaghan (2005), 2 * (d + 2) in d dimensions
+	template<std::size_t Dimension>
+	constexpr float viscosity_scale = 2.0F * static_cast<float>(Dimension + 2);
+	// Keeps the viscosity term bounded when two particles get very close
+	constexpr float viscosity_epsilon = 0.01F;
+
+	/**
+	 * @brief The Tait equation of state with an exponent of 7. Negative pressures are clamped to
+	 * avoid particles clumping at the free surface
+	 */
+	auto tait_pressure(float density, float rest_density, float stiffness) -> float
+	{
+		let ratio = density / rest_density;
+		let ratio_squared = ratio * ratio;
+		let ratio_7 = ratio_squared * ratio_squared * ratio_squared * ratio;
+
+		return std::max(0.0F, stiffness * (ratio_7 - 1.0F));
+	}
+
+	template<std::size_t Dimension, typename Particles>
+	auto get_velocity(Particles const& particles)
+		-> sph::velocity_columns<typename Particles::velocity_type const, Dimension>
+	{
+		auto result = sph::velocity_columns<typename Particles::velocity_type const, Dimension>{};
+		for (std::size_t axis = 0; axis < Dimension; ++axis)
+		{
+			result[axis] = particles.velocity(axis);
+		}
+
+		return result;
+	}
+} // namespace
+
+namespace sph
+{
+	template<physeng::precision_policy Precision, std::size_t Dimension>
+	basic_wcsph_solver<Precision, Dimension>::basic_wcsph_solver(
+		physeng::smoothing_kernel const& kernel, wcsph_parameters const& parameters) :
+		m_kernel(kernel), m_parameters(parameters),
+		m_stiffness(parameters.rest_density * parameters.speed_of_sound
+					* parameters.speed_of_sound / 7.0F)
+	{
+		assert(kernel.get_dimension() == Dimension); // NOLINT
+	}
+
+	template<physeng::precision_policy Precision, std::size_t Dimension>
+	auto basic_wcsph_solver<Precision, Dimension>::get_time_step() const noexcept -> float
+	{
+		let h = m_kernel.get_smoothing_length().get();
+		return m_parameters.cfl_factor * h / (m_parameters.speed_of_sound + m_max_speed);
+	}
+	template<physeng::precision_policy Precision, std::size_t Dimension>
+	auto basic_wcsph_solver<Precision, Dimension>::get_timings() const noexcept
+		-> phase_timings const&
+	{
+		return m_timings;
+	}
+
+	template<physeng::precision_policy Precision, std::size_t Dimension>
+	auto basic_wcsph_solver<Precision, Dimension>::step(particle_set& particles,
+														physeng::verlet_list const& neighbors)
+		-> float
+	{
+		PHYSENG_PROFILE_ZONE("wcsph_solver::step");
+
+		let dt = get_time_step();
+
+		{
+			let timer = scoped_phase_timer{m_timings, run_phase::density};
+			compute_density_and_pressure(particles, neighbors);
+		}
+		{
+			let timer = scoped_phase_timer{m_timings, run_phase::forces};
+			compute_velocity(particles, neighbors, dt);
+		}
+
+		auto next_velocity = velocity_columns<velocity_type const, Dimension>{};
+		for (std::size_t axis = 0; axis < Dimension; ++axis)
+		{
+			next_velocity[axis] = m_next_velocity[axis];
+		}
+
+		let timer = scoped_phase_timer{m_timings, run_phase::advection};
+		m_max_speed = advect<Dimension>(particles, next_velocity, m_parameters.bounds, dt);
+		++m_step_count;
+
+		return dt;
+	}
+
+	template<physeng::precision_policy Precision, std::size_t Dimension>
+	void basic_wcsph_solver<Precision, Dimension>::compute_density_and_pressure(
+		particle_set& particles, physeng::verlet_list const& neighbors) const
+	{
+		PHYSENG_PROFILE_ZONE("wcsph_solver::compute_density_and_pressure");
+
+		let mass = particles.mass();
+		auto density = particles.density();
+		auto pressure = particles.pressure();
+
+		physeng::parallel_for(particles.size(), particle_grain, [&](std::size_t first,
+																	 std::size_t last) {
+			auto batch = neighbor_batch<Dimension>{};
+
+			for (auto i = first; i < last; ++i)
+			{
+				let index = static_cast<physeng::particle_index>(i);
+				batch.gather(particles, neighbors, index);
+				m_kernel.evaluate(batch.distance_squared(), batch.kernel());
+
+				let indices = batch.indices();
+				let values = batch.kernel();
+
+				auto sum = accumulator_type{0};
+				for (std::size_t k = 0; k < batch.size(); ++k)
+				{
+					sum += mass[indices[k]] * values[k];
+				}
+
+				density[i] = static_cast<float>(sum);
+				pressure[i] = tait_pressure(density[i], m_parameters.rest_density, m_stiffness);
+			}
+		});
+	}
+
+	template<physeng::precision_policy Precision, std::size_t Dimension>
+	void basic_wcsph_solver<Precision, Dimension>::compute_velocity(
+		particle_set const& particles, physeng::verlet_list const& neighbors, float dt)
+	{
+		PHYSENG_PROFILE_ZONE("wcsph_solver::compute_velocity");
+
+		for (auto& column : m_next_velocity)
+		{
+			column.resize(particles.size());
+		}
+
+		let h = m_kernel.get_smoothing_length().get();
+		let epsilon = viscosity_epsilon * h * h;
+		let viscosity = viscosity_scale<Dimension> * m_parameters.viscosity;
+
+		let mass = particles.mass();
+		let density = particles.density();
+		let pressure = particles.pressure();
+		let velocity = get_velocity<Dimension>(particles);
+
+		physeng::parallel_for(particles.size(), particle_grain, [&](std::size_t first,
+																	 std::size_t last) {
+			auto batch = neighbor_batch<Dimension>{};
+
+			for (auto i = first; i < last; ++i)
+			{
+				let index = static_cast<physeng::particle_index>(i);
+				batch.gather(particles, neighbors, index);
+				m_kernel.evaluate_gradient(batch.distance_squared(), batch.kernel());
+
+				let indices = batch.indices();
+				let factors = batch.kernel();
+				let r2 = batch.distance_squared();
+
+				auto offset = std::array<std::span<float const>, Dimension>{};
+				auto velocity_i = std::array<float, Dimension>{};
+				physeng::for_each_axis<Dimension>([&](std::size_t axis) {
+					offset[axis] = batch.offset(axis);
+					velocity_i[axis] = float{velocity[axis][i]};
+				});
+
+				let pressure_i = pressure[i] / (density[i] * density[i]);
+
+				auto acceleration = std::array<accumulator_type, Dimension>{};
+				for (std::size_t k = 0; k < batch.size(); ++k)
+				{
+					let j = indices[k];
+
+					let pressure_term =
+						mass[j] * (pressure_i + pressure[j] / (density[j] * density[j]));
+
+					auto v_dot_x = 0.0F;
+					physeng::for_each_axis<Dimension>([&](std::size_t axis) {
+						v_dot_x += (velocity_i[axis] - float{velocity[axis][j]}) * offset[axis][k];
+					});
+					let viscous_term =
+						viscosity * mass[j] / density[j] * v_dot_x / (r2[k] + epsilon);
+
+					let scale = (viscous_term - pressure_term) * factors[k];
+					physeng::for_each_axis<Dimension>(
+						[&](std::size_t axis) { acceleration[axis] += scale * offset[axis][k]; });
+				}
+
+				physeng::for_each_axis<Dimension>([&](std::size_t axis) {
+					let seed = (m_step_count * particles.size() + i) * Dimension + axis;
+					let change =
+						dt * (static_cast<float>(acceleration[axis]) + m_parameters.gravity[axis]);
+
+					m_next_velocity[axis][i] = Precision::narrow(velocity_i[axis] + change, seed);
+				});
+			}
+		});
+	}
+
+	template class basic_wcsph_solver<physeng::single_precision, 2>;
+	template class basic_wcsph_solver<physeng::single_precision, 3>;
+	template class basic_wcsph_solver<physeng::compact_precision, 2>;
+	template class basic_wcsph_solver<physeng::compact_precision, 3>;
+} // namespace sph
@@ -0,0 +1,116 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <sph/phase_timings.hpp>
+#include <sph/scene.hpp>
+
+#include <libphyseng/kernels/smoothing_kernel.hpp>
+#include <libphyseng/neighbor/verlet_list.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+#include <libphyseng/util/aligned_allocator.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace sph
+{
+	struct wcsph_parameters
+	{
+		float rest_density;
+		float speed_of_sound; //< Numerical speed of sound, about 10 times the largest flow speed
+		float viscosity;      //< Kinematic viscosity
+		float cfl_factor;     //< Fraction of a smoothing length a particle may travel per step
+		std::array<float, 3> gravity;
+		domain bounds;
+	};
+
+	/**
+	 * @brief Weakly compressible SPH with a Tait equation of state
+	 *
+	 * A step makes two passes over the neighbor lists: the first computes the density of every
+	 * particle along with its pressure, the second accumulates the pressure and viscous forces
+	 * and integrates the velocity. A last streaming pass moves the particles and measures the
+	 * largest speed, which drives the CFL condition of the next step
+	 *
+	 * The sums over the neighbors are accumulated in the `accumulator_type` of the precision
+	 * policy, the integrated velocities are stored in its `velocity_type`. In two dimensions the
+	 * z axis is left out of every pass, the kernel must be normalized in two dimensions as well
+	 */
+	template<physeng::precision_policy Precision, std::size_t Dimension>
+	class basic_wcsph_solver
+	{
+		static_assert(physeng::spatial_dimension<Dimension>);
+
+	public:
+		using particle_set = physeng::basic_particle_set<Precision>;
+
+	public:
+		basic_wcsph_solver(physeng::smoothing_kernel const& kernel,
+						   wcsph_parameters const& parameters);
+
+		/**
+		 * @brief The time step the next call to `step` will take
+		 */
+		[[nodiscard]] auto get_time_step() const noexcept -> float;
+		/**
+		 * @brief The time spent in every phase of the steps taken so far
+		 */
+		[[nodiscard]] auto get_timings() const noexcept -> phase_timings const&;
+
+		/**
+		 * @brief Advance the particles by one time step
+		 *
+		 * @param[in,out] particles The particles to move
+		 * @param[in] neighbors Verlet lists up to date with the current positions of the particles
+		 *
+		 * @return The time step that was taken
+		 */
+		auto step(particle_set& particles, physeng::verlet_list const& neighbors) -> float;
+
+	private:
+		using accumulator_type = typename Precision::accumulator_type;
+		using velocity_type = typename Precision::velocity_type;
+
+		void compute_density_and_pressure(particle_set& particles,
+										  physeng::verlet_list const& neighbors) const;
+		void compute_velocity(particle_set const& particles, physeng::verlet_list const& neighbors,
+							  float dt);
+
+	private:
+		physeng::smoothing_kernel m_kernel;
+		wcsph_parameters m_parameters;
+		float m_stiffness;
+		float m_max_speed = 0.0F;
+		std::uint64_t m_step_count = 0;
+
+		// Velocities at the end of the step, kept apart since the force pass reads the current ones
+		std::array<physeng::aligned_vector<velocity_type>, Dimension> m_next_velocity;
+
+		phase_timings m_timings = {};
+	};
+
+	extern template class basic_wcsph_solver<physeng::single_precision, 2>;
+	extern template class basic_wcsph_solver<physeng::single_precision, 3>;
+	extern template class basic_wcsph_solver<physeng::compact_precision, 2>;
+	extern template class basic_wcsph_solver<physeng::compact_precision, 3>;
+
+	using wcsph_solver =
+		basic_wcsph_solver<physeng::single_precision, physeng::particle_set::dimension>;
+} // namespace sph
@@ -15,54 +15,1009 @@
  */
 
 #include <sph/core.hpp>
+#include <sph/diagnostics.hpp>
+#include <sph/options.hpp>
+#include <sph/output/compressed_stream.hpp>
+#include <sph/output/frame_sink.hpp>
+#include <sph/output/frame_writer.hpp>
+#include <sph/phase_timings.hpp>
+#include <sph/scene.hpp>
+#include <sph/solver/dfsph.hpp>
+#include <sph/solver/wcsph.hpp>
 #include <sph/vulkan/details/vulkan.hpp>
 #include <sph/vulkan/instance.hpp>
-#include <sph/vulkan/physical_device.hpp>
+#include <sph/vulkan/compute_backend.hpp>
+#include <sph/vulkan/device.hpp>
+#include <sph/vulkan/memory_allocator.hpp>
+#include <sph/vulkan/pipeline_cache.hpp>
 
+#include <libphyseng/io/checkpoint.hpp>
+#include <libphyseng/kernels/smoothing_kernel.hpp>
 #include <libphyseng/main.hpp>
+#include <libphyseng/memory/frame_arena.hpp>
+#include <libphyseng/neighbor/neighbor_search.hpp>
+#include <libphyseng/neighbor/verlet_list.hpp>
+#include <libphyseng/particles/morton_order.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+#include <libphyseng/physeng-info.hpp>
+#include <libphyseng/profiling/hardware_counters.hpp>
+#include <libphyseng/profiling/profiler.hpp>
 #include <libphyseng/util/semantic_version.hpp>
 
+#include <spdlog/async.h>
+#include <spdlog/async_logger.h>
 #include <spdlog/logger.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
 
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iterator>
 #include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <variant>
 
 namespace
 {
-	auto create_logger(std::string_view name) -> spdlog::logger
+	constexpr float particle_spacing = 0.02F;
+	constexpr auto smoothing_length = physeng::smoothing_length{1.2F * particle_spacing};
+	constexpr float rest_density = 1000.0F;
+
+	// The speed of sound is this many times the speed a particle reaches after falling the height
+	// of the fluid, which keeps density variations around 1%
+	constexpr float speed_of_sound_factor = 10.0F;
+	// Artificial viscosity, well above the one of water to keep the flow stable
+	constexpr float viscosity = 1.0e-3F;
+	constexpr float cfl_factor = 0.4F;
+	constexpr float dfsph_max_time_step = 5.0e-3F;
+	constexpr float dfsph_max_density_error = 1.0e-3F;
+	constexpr float dfsph_max_divergence_error = 1.0e-3F;
+	constexpr std::array<float, 3> gravity = {0.0F, -9.81F, 0.0F};
+
+	// Frames the solver may get ahead of the disk by
+	constexpr std::size_t output_buffer_count = 4;
+
+	// Largest deviation allowed between the CPU and GPU steps, relative to the smoothing length
+	// for the positions, to the speed of sound for the velocities and to the rest density
+	constexpr float backend_tolerance = 1.0e-4F;
+
+	// Messages waiting for the logging thread, the queue is allocated once when the thread starts
+	constexpr std::size_t log_queue_size = 8192;
+	// Warnings and errors are flushed right away, everything else at least this often
+	constexpr auto log_flush_period = std::chrono::seconds{1};
+	// Shortest wall time between two messages with the statistics of a step
+	constexpr auto step_log_period = std::chrono::seconds{1};
+
+	/**
+	 * @brief A logger whose messages are written by a background thread. The callers only format
+	 * the message and push it on a queue, the sinks are only ever touched by the logging thread
+	 * and need no locking
+	 *
+	 * When the queue is full the oldest messages are dropped, a burst of messages never stalls
+	 * the solver
+	 */
+	auto create_logger(std::string_view name) -> std::shared_ptr<spdlog::logger>
 	{
-		auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+		spdlog::init_thread_pool(log_queue_size, 1);
+
+		auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
 		console_sink->set_level(spdlog::level::trace);
 		console_sink->set_pattern("[%n] [%^%l%$] %v");
 
 		auto file_sink =
-			std::make_shared<spdlog::sinks::basic_file_sink_mt>(std::string{name} + ".logs", true);
+			std::make_shared<spdlog::sinks::basic_file_sink_st>(std::string{name} + ".logs", true);
 		file_sink->set_pattern("[%H:%M:%S.%f] [%n] [%^%l%$] %v");
 		file_sink->set_level(spdlog::level::trace);
 
-		auto logger = spdlog::logger(std::string(name), {console_sink, file_sink});
-		logger.set_level(spdlog::level::trace);
+		auto logger = std::make_shared<spdlog::async_logger>(
+			std::string(name), spdlog::sinks_init_list{console_sink, file_sink},
+			spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
+		logger->set_level(spdlog::level::trace);
+		logger->flush_on(spdlog::level::warn);
+
+		// The registry owns the logging thread, and drains its queue when the program exits
+		spdlog::register_logger(logger);
+		spdlog::flush_every(log_flush_period);
 
 		return logger;
 	}
+
+	/**
+	 * @brief Lets a message through at most once per period of wall time, the calls in between
+	 * only cost a read of the clock
+	 */
+	class log_throttle
+	{
+	public:
+		explicit log_throttle(std::chrono::steady_clock::duration period) : m_period(period) {}
+
+		auto should_log() -> bool
+		{
+			let now = std::chrono::steady_clock::now();
+			if (now - m_last < m_period)
+			{
+				return false;
+			}
+
+			m_last = now;
+			return true;
+		}
+
+	private:
+		std::chrono::steady_clock::duration m_period;
+		std::chrono::steady_clock::time_point m_last = {};
+	};
+
+	auto make_wcsph_parameters(sph::scene const& layout) -> sph::wcsph_parameters
+	{
+		let fall_speed = std::sqrt(2.0F * std::abs(gravity[1]) * sph::get_fluid_height(layout));
+
+		return {.rest_density = rest_density,
+				.speed_of_sound = speed_of_sound_factor * fall_speed,
+				.viscosity = viscosity,
+				.cfl_factor = cfl_factor,
+				.gravity = gravity,
+				.bounds = layout.bounds};
+	}
+
+	/**
+	 * @brief Whether DFSPH can run on particles stored with `Precision` in `Dimension`. Its
+	 * solves correct the velocities in place by amounts far below the resolution of a bfloat16,
+	 * and it only runs in three dimensions
+	 */
+	template<typename Precision, std::size_t Dimension>
+	constexpr bool has_dfsph =
+		std::is_same_v<typename Precision::velocity_type, float> && Dimension == 3;
+
+	template<typename Precision, std::size_t Dimension>
+	using any_solver = std::conditional_t<
+		has_dfsph<Precision, Dimension>,
+		std::variant<sph::basic_wcsph_solver<Precision, Dimension>, sph::dfsph_solver>,
+		std::variant<sph::basic_wcsph_solver<Precision, Dimension>>>;
+
+	template<physeng::precision_policy Precision, std::size_t Dimension>
+	auto make_solver(sph::solver_type type, physeng::smoothing_kernel const& kernel,
+					 sph::wcsph_parameters const& parameters) -> any_solver<Precision, Dimension>
+	{
+		if constexpr (has_dfsph<Precision, Dimension>)
+		{
+			if (type == sph::solver_type::dfsph)
+			{
+				return sph::dfsph_solver{
+					kernel, {.rest_density = rest_density,
+							 .viscosity = viscosity,
+							 .cfl_factor = cfl_factor,
+							 .max_time_step = dfsph_max_time_step,
+							 .max_density_error = dfsph_max_density_error,
+							 .max_divergence_error = dfsph_max_divergence_error,
+							 .min_iterations = 2,
+							 .max_iterations = 100,
+							 .gravity = gravity,
+							 .bounds = parameters.bounds}};
+			}
+		}
+
+		return sph::basic_wcsph_solver<Precision, Dimension>{kernel, parameters};
+	}
+
+	void log_solver_statistics(spdlog::logger& logger, sph::dfsph_solver const& solver)
+	{
+		let& stats = solver.get_statistics();
+		let per_step = [&](std::uint64_t count) {
+			return stats.step_count == 0
+					 ? 0.0
+					 : static_cast<double>(count) / static_cast<double>(stats.step_count);
+		};
+
+		logger.info("dfsph: {:.2f} density and {:.2f} divergence iterations per step, factors "
+					"updated on {} of {} steps",
+					per_step(stats.density_iterations), per_step(stats.divergence_iterations),
+					stats.factor_updates, stats.step_count);
+	}
+
+	template<physeng::precision_policy Precision>
+	auto save_checkpoint(spdlog::logger& logger, std::filesystem::path const& path,
+						 physeng::basic_particle_set<Precision> const& particles,
+						 physeng::checkpoint_metadata const& metadata) -> bool
+	{
+		PHYSENG_PROFILE_ZONE("save_checkpoint");
+
+		let start = std::chrono::steady_clock::now();
+		let result = physeng::write_checkpoint(path, particles, metadata);
+		let elapsed =
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (!result)
+		{
+			logger.error("failed to write the checkpoint {}: {}", path.string(),
+						 physeng::to_string(result.error()));
+			return false;
+		}
+
+		logger.info("checkpoint of step {} written to {} in {:.3f}s", metadata.step, path.string(),
+					elapsed);
+
+		return true;
+	}
+
+	/**
+	 * @brief Load Vulkan and report the GPU the simulation would run on
+	 *
+	 * @return The instance, if a GPU was found
+	 */
+	auto open_gpu(std::string_view app_name, spdlog::logger& logger)
+		-> std::optional<vulkan::instance>
+	{
+		auto instance = vulkan::instance::make(app_name, logger);
+		if (!instance)
+		{
+			logger.error("failed to create the vulkan instance: {}, run with --headless on "
+						 "machines without a GPU",
+						 vulkan::to_string(instance.error()));
+			return std::nullopt;
+		}
+
+		let devices = instance->get_devices();
+		if (devices.empty())
+		{
+			logger.error("no GPU found, run with --headless on machines without a GPU");
+			return std::nullopt;
+		}
+
+		logger.info("GPU name: {}\n", devices.front().properties.deviceName);
+		logger.info("GPU driver version: {}\n", devices.front().driver_version);
+
+		return std::move(instance).value();
+	}
+
+	/**
+	 * @brief Check that the options do not ask for something the backends cannot do
+	 */
+	auto validate_backend(sph::options const& options, spdlog::logger& logger) -> bool
+	{
+		if (options.dimension == 2)
+		{
+			if (options.solver != sph::solver_type::wcsph)
+			{
+				logger.error("--dimension=2 only implements the wcsph solver");
+				return false;
+			}
+			if (options.backend != sph::backend_type::cpu)
+			{
+				logger.error("--dimension=2 only runs on the cpu backend, the compute shaders "
+							 "are three dimensional");
+				return false;
+			}
+		}
+
+		if (options.precision == sph::precision_type::compact)
+		{
+			if (options.solver != sph::solver_type::wcsph)
+			{
+				logger.error("--precision=compact only implements the wcsph solver");
+				return false;
+			}
+			if (options.is_comparing_backends)
+			{
+				logger.error("--compare-backends needs --precision=single, the GPU steps are "
+							 "checked against single precision ones");
+				return false;
+			}
+		}
+
+		if (options.backend == sph::backend_type::cpu)
+		{
+			if (options.is_comparing_backends)
+			{
+				logger.error("--compare-backends needs --backend=vulkan");
+				return false;
+			}
+
+			return true;
+		}
+
+		if (options.is_headless)
+		{
+			logger.error("the vulkan backend cannot run headless");
+			return false;
+		}
+		if (options.solver != sph::solver_type::wcsph)
+		{
+			logger.error("the vulkan backend only implements the wcsph solver");
+			return false;
+		}
+		if (options.reorder_interval != 0 || options.reorder_degradation != 0.0F)
+		{
+			logger.warn("the vulkan backend sorts the particles itself, reordering is disabled");
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief The directory the compiled shaders are kept in: the one given on the command line,
+	 * or the cache directory of the user
+	 */
+	auto get_pipeline_cache_directory(sph::options const& options) -> std::filesystem::path
+	{
+		if (!options.pipeline_cache_path.empty())
+		{
+			return options.pipeline_cache_path;
+		}
+
+		if (let* xdg_cache = std::getenv("XDG_CACHE_HOME"); xdg_cache != nullptr) // NOLINT
+		{
+			return std::filesystem::path{xdg_cache} / "sph";
+		}
+		if (let* home = std::getenv("HOME"); home != nullptr) // NOLINT
+		{
+			return std::filesystem::path{home} / ".cache" / "sph";
+		}
+
+		auto error = std::error_code{};
+		return std::filesystem::temp_directory_path(error) / "sph";
+	}
+
+	/**
+	 * @brief Create the GPU backend and upload the particles to it. The compute pipelines come
+	 * from the pipeline cache on disk, which is updated with the ones that had to be compiled
+	 */
+	template<physeng::precision_policy Precision>
+	auto make_compute_backend(vulkan::memory_allocator& allocator, sph::options const& options,
+							  physeng::smoothing_kernel const& kernel,
+							  sph::wcsph_parameters const& parameters,
+							  physeng::basic_particle_set<Precision> const& particles,
+							  spdlog::logger& logger)
+		-> std::optional<vulkan::compute_backend>
+	{
+		let& device = allocator.get_device();
+		let cache = vulkan::pipeline_cache::load(device, get_pipeline_cache_directory(options),
+												 logger);
+		if (!cache)
+		{
+			logger.error("failed to load the pipeline cache: {}", vulkan::to_string(cache.error()));
+			return std::nullopt;
+		}
+
+		auto backend = vulkan::compute_backend::make(device, allocator, cache->get(), kernel,
+													 parameters);
+		if (!backend)
+		{
+			logger.error("failed to create the compute backend: {}",
+						 vulkan::to_string(backend.error()));
+			return std::nullopt;
+		}
+
+		// Losing the cache only costs the next run some compilation time
+		if (let saved = cache->save(); !saved)
+		{
+			logger.warn("{} to {}", vulkan::to_string(saved.error()), cache->get_path().string());
+		}
+
+		if (let uploaded = backend->upload(particles); !uploaded)
+		{
+			logger.error("failed to upload the particles: {}", vulkan::to_string(uploaded.error()));
+			return std::nullopt;
+		}
+
+		return std::move(backend).value();
+	}
+
+	/**
+	 * @brief A frame on its way back from the GPU, read while the next step computes
+	 */
+	struct pending_frame
+	{
+		vulkan::compute_backend::download_ticket ticket;
+		std::uint64_t step;
+		double time;
+	};
+
+	/**
+	 * @brief Report how far the GPU steps were from the CPU ones
+	 *
+	 * @return Whether they agree within `backend_tolerance`
+	 */
+	auto check_deviation(spdlog::logger& logger, sph::deviation const& worst, std::uint64_t steps,
+						 float speed_of_sound) -> bool
+	{
+		let position = worst.position / smoothing_length.get();
+		let velocity = worst.velocity / speed_of_sound;
+		let density = worst.density / rest_density;
+
+		logger.info("backend comparison over {} steps, largest deviations: position {:.2e} h, "
+					"velocity {:.2e} c, density {:.2e} rho_0",
+					steps, position, velocity, density);
+
+		if (std::max({position, velocity, density}) > backend_tolerance)
+		{
+			logger.error("the vulkan backend does not match the cpu solver, tolerance: {:.2e}",
+						 backend_tolerance);
+			return false;
+		}
+
+		return true;
+	}
+
+	auto make_frame_sink(sph::options const& options, sph::domain const& bounds)
+		-> tl::expected<std::unique_ptr<sph::frame_sink>, sph::output_error>
+	{
+		if (options.output_format == sph::output_format::compressed)
+		{
+			return sph::compressed_frame_sink::open(
+				options.output_path / "frames.phys",
+				{.relative_error = options.output_relative_error, .bounds = bounds});
+		}
+
+		return std::make_unique<sph::raw_frame_sink>(options.output_path);
+	}
+
+	void log_output_statistics(spdlog::logger& logger, sph::frame_writer const& writer)
+	{
+		let stats = writer.get_statistics();
+		let mebibytes = static_cast<double>(stats.written_bytes) / (1024.0 * 1024.0);
+
+		logger.info("frames: {} written ({:.1f} MiB), {} skipped, {} failed, solver stalled for "
+					"{:.3f}s",
+					stats.written_count, mebibytes, stats.skipped_count, stats.failed_count,
+					stats.stall_time);
+	}
+
+	void log_neighbor_statistics(spdlog::logger& logger, physeng::verlet_list const& neighbors)
+	{
+		let& stats = neighbors.get_statistics();
+		let rebuild_rate = stats.update_count == 0 ? 0.0
+												   : static_cast<double>(stats.rebuild_count)
+														 / static_cast<double>(stats.update_count);
+
+		logger.info("verlet lists: {} rebuilds over {} updates ({:.1f}%), skin: {}, last max "
+					"displacement: {}",
+					stats.rebuild_count, stats.update_count, 100.0 * rebuild_rate,
+					neighbors.get_skin(), stats.max_displacement);
+	}
+
+	template<physeng::precision_policy Precision>
+	void log_memory_usage(spdlog::logger& logger,
+						  physeng::basic_particle_set<Precision> const& particles,
+						  physeng::verlet_list const& neighbors)
+	{
+		let count = static_cast<double>(std::max<std::size_t>(particles.size(), 1));
+		let particle_bytes = static_cast<double>(particles.get_memory_usage()) / count;
+		let list_bytes = static_cast<double>(neighbors.get_memory_usage()) / count;
+
+		logger.info("memory per particle: {:.1f} bytes, {:.1f} in the particle set and {:.1f} in "
+					"the verlet lists",
+					particle_bytes + list_bytes, particle_bytes, list_bytes);
+	}
+
+	/**
+	 * @brief What a run achieved, compared from one machine or one commit to the next
+	 */
+	struct run_summary
+	{
+		sph::scenario_type scenario;
+		std::size_t dimension;
+		physeng::kernel_type kernel;
+		std::string_view precision;
+		std::size_t particle_count;
+		std::uint64_t step_count;
+		double wall_time;      //< In seconds, from the first step to the last checkpoint
+		double simulated_time; //< In seconds
+		sph::phase_timings timings;
+		std::optional<physeng::counter_sample> counters; //< Empty if the counters are unavailable
+	};
+
+	/**
+	 * @brief Log the summary of a run as a single table. The time the phases do not account for,
+	 * such as logging and releasing the scratch memory, is reported as `other`
+	 */
+	void log_run_summary(spdlog::logger& logger, run_summary const& summary)
+	{
+		let updates =
+			static_cast<double>(summary.particle_count) * static_cast<double>(summary.step_count);
+		let steps = std::max(1.0, static_cast<double>(summary.step_count));
+		let per_update = [&](std::uint64_t count) {
+			return updates > 0.0 ? static_cast<double>(count) / updates : 0.0;
+		};
+		let share = [&](double seconds) {
+			return summary.wall_time > 0.0 ? 100.0 * seconds / summary.wall_time : 0.0;
+		};
+
+		auto text = std::string{};
+		auto out = std::back_inserter(text);
+
+		fmt::format_to(out, "run summary\n");
+		fmt::format_to(out, "  {:<20} {}\n", "scenario", sph::to_string(summary.scenario));
+		fmt::format_to(out, "  {:<20} {}\n", "dimension", summary.dimension);
+		fmt::format_to(out, "  {:<20} {}\n", "kernel", physeng::to_string(summary.kernel));
+		fmt::format_to(out, "  {:<20} {}\n", "precision", summary.precision);
+		fmt::format_to(out, "  {:<20} {}\n", "particles", summary.particle_count);
+		fmt::format_to(out, "  {:<20} {}\n", "steps", summary.step_count);
+		fmt::format_to(out, "  {:<20} {:.3f} s ({:.4f} s simulated)\n", "wall time",
+					   summary.wall_time, summary.simulated_time);
+		fmt::format_to(out, "  {:<20} {:.3e}\n", "particle updates/s",
+					   summary.wall_time > 0.0 ? updates / summary.wall_time : 0.0);
+
+		fmt::format_to(out, "  {:<20} {:>12} {:>8}\n", "phase", "ms/step", "share");
+		auto accounted = 0.0;
+		for (std::size_t index = 0; index < sph::run_phase_count; ++index)
+		{
+			let phase = static_cast<sph::run_phase>(index);
+			let seconds = std::chrono::duration<double>(summary.timings.get(phase)).count();
+			if (seconds > 0.0)
+			{
+				fmt::format_to(out, "  {:<20} {:>12.3f} {:>7.1f}%\n", sph::to_string(phase),
+							   1000.0 * seconds / steps, share(seconds));
+				accounted += seconds;
+			}
+		}
+		let other = std::max(0.0, summary.wall_time - accounted);
+		fmt::format_to(out, "  {:<20} {:>12.3f} {:>7.1f}%\n", "other", 1000.0 * other / steps,
+					   share(other));
+
+		if (summary.counters)
+		{
+			let& sample = *summary.counters;
+			let ipc = sample.cycles == 0 ? 0.0
+										 : static_cast<double>(sample.instructions)
+											   / static_cast<double>(sample.cycles);
+
+			fmt::format_to(out, "  {:<20} {:>12} {:>12}{}\n", "counter", "total", "per update",
+						   sample.is_multiplexed ? " (multiplexed, scaled estimates)" : "");
+			fmt::format_to(out, "  {:<20} {:>12.3e} {:>12.1f}\n", "cycles",
+						   static_cast<double>(sample.cycles), per_update(sample.cycles));
+			fmt::format_to(out, "  {:<20} {:>12.3e} {:>12.1f} (IPC {:.2f})\n", "instructions",
+						   static_cast<double>(sample.instructions),
+						   per_update(sample.instructions), ipc);
+			fmt::format_to(out, "  {:<20} {:>12.3e} {:>12.3f}", "LLC misses",
+						   static_cast<double>(sample.cache_misses),
+						   per_update(sample.cache_misses));
+		}
+		else
+		{
+			fmt::format_to(out, "  hardware counters unavailable, see perf_event_paranoid");
+		}
+
+		logger.info("{}", text);
+	}
+
+	/**
+	 * @brief Whether every particle lies in the plane z = 0, as a two dimensional run expects
+	 */
+	template<physeng::precision_policy Precision>
+	auto is_planar(physeng::basic_particle_set<Precision> const& particles) -> bool
+	{
+		return std::ranges::all_of(particles.position(2), [](float z) { return z == 0.0F; });
+	}
+
+	/**
+	 * @brief Set up the scene and run it in `Dimension` with the particles stored as asked by
+	 * `Precision`
+	 */
+	template<physeng::precision_policy Precision, std::size_t Dimension>
+	auto run(sph::options const& options, std::optional<vulkan::instance> const& gpu,
+			 spdlog::logger& app_logger) -> int
+	{
+		let layout = sph::make_scene<Dimension>(options.scenario, options.particle_count,
+												particle_spacing, rest_density);
+		let wcsph_parameters = make_wcsph_parameters(layout);
+
+		auto particles = physeng::basic_particle_set<Precision>{};
+		auto first_step = std::uint64_t{0};
+		auto simulated_time = 0.0;
+
+		if (!options.restart_path.empty())
+		{
+			let checkpoint = physeng::mapped_checkpoint::open(options.restart_path, get_version());
+			if (!checkpoint)
+			{
+				app_logger.error("failed to open the checkpoint {}: {}",
+								 options.restart_path.string(),
+								 physeng::to_string(checkpoint.error()));
+				return EXIT_FAILURE;
+			}
+
+			checkpoint->restore(particles);
+			if (Dimension == 2 && !is_planar(particles))
+			{
+				app_logger.error("the checkpoint {} is not two dimensional, its particles leave "
+								 "the plane z = 0",
+								 options.restart_path.string());
+				return EXIT_FAILURE;
+			}
+
+			first_step = checkpoint->get_metadata().step;
+			simulated_time = checkpoint->get_metadata().time;
+
+			app_logger.info("restarting from {} at step {} ({:.4f}s simulated), written by {} {}\n",
+							options.restart_path.string(), first_step, simulated_time,
+							physeng::get_engine_name(), checkpoint->get_engine_version());
+		}
+		else
+		{
+			for (let& block : layout.blocks)
+			{
+				sph::add_fluid_block<Dimension>(particles, block);
+			}
+		}
+
+		let kernel = physeng::smoothing_kernel{options.kernel, smoothing_length, Dimension};
+		let support_radius = kernel.get_support_radius();
+
+		app_logger.info("smoothing kernel: {} in {} dimensions, simd level: {}\n",
+						physeng::to_string(kernel.get_type()), kernel.get_dimension(),
+						physeng::to_string(kernel.get_simd_level()));
+
+		auto neighbors =
+			physeng::verlet_list{support_radius, options.verlet_skin * support_radius.get()};
+		auto search =
+			physeng::make_neighbor_search(options.neighbor_backend, neighbors.get_search_radius());
+
+		auto solver = make_solver<Precision, Dimension>(options.solver, kernel, wcsph_parameters);
+		auto reorder = physeng::morton_reorder{support_radius.get(), options.reorder_interval,
+											   options.reorder_degradation};
+
+		auto writer = std::unique_ptr<sph::frame_writer>{};
+		if (!options.output_path.empty())
+		{
+			auto error = std::error_code{};
+			std::filesystem::create_directories(options.output_path, error);
+			if (error)
+			{
+				app_logger.error("failed to create the output directory {}: {}",
+								 options.output_path.string(), error.message());
+				return EXIT_FAILURE;
+			}
+
+			auto sink = make_frame_sink(options, layout.bounds);
+			if (!sink)
+			{
+				app_logger.error("failed to open the output stream in {}: {}",
+								 options.output_path.string(), sph::to_string(sink.error()));
+				return EXIT_FAILURE;
+			}
+
+			writer = std::make_unique<sph::frame_writer>(
+				std::move(sink).value(),
+				sph::frame_writer_settings{.buffer_count = output_buffer_count,
+										   .policy = options.output_policy,
+										   .columns = options.output_columns},
+				app_logger);
+		}
+
+		// On the GPU the particles live on the device, and are only read back when needed on the
+		// host
+		auto device = std::optional<vulkan::device>{};
+		auto allocator = std::optional<vulkan::memory_allocator>{};
+		auto compute = std::optional<vulkan::compute_backend>{};
+		if (options.backend == sph::backend_type::vulkan)
+		{
+			auto result = vulkan::device::make(*gpu, app_logger);
+			if (!result)
+			{
+				app_logger.error("failed to create the vulkan device: {}",
+								 vulkan::to_string(result.error()));
+				return EXIT_FAILURE;
+			}
+
+			device = std::move(result).value();
+			allocator.emplace(*device);
+			compute = make_compute_backend(*allocator, options, kernel, wcsph_parameters, particles,
+										   app_logger);
+			if (!compute)
+			{
+				return EXIT_FAILURE;
+			}
+		}
+
+		// The CPU steps the GPU ones are compared against
+		auto reference = physeng::basic_particle_set<Precision>{};
+		auto worst_deviation = sph::deviation{};
+
+		// The scratch memory of a step is released all at once when the step is over
+		let frames = physeng::get_default_frame_allocator();
+
+		let checkpoint_at = [&](std::uint64_t step) {
+			return physeng::checkpoint_metadata{
+				.application_version = get_version(), .step = step, .time = simulated_time};
+		};
+
+		auto pending = std::optional<pending_frame>{};
+		auto step_log = log_throttle{step_log_period};
+
+		// Errors that do not stop the run still fail it
+		auto has_failed = false;
+
+		// The phases outside of the solver, which times its own
+		auto timings = sph::phase_timings{};
+
+		// Created last, the counters only follow the threads that exist when they are created
+		auto counters = physeng::hardware_counters{};
+		counters.start();
+
+		let start = std::chrono::steady_clock::now();
+
+		// Visit once, the whole run works on the concrete neighbor search and solver
+		std::visit(
+			[&](physeng::neighbor_search auto& backend, auto& concrete_solver) {
+				for (std::uint64_t step = 0; step < options.step_count; ++step)
+				{
+					if (compute && options.is_comparing_backends)
+					{
+						// Both start from the state the GPU reached, the runs would drift apart
+						// otherwise
+						reference = particles;
+						neighbors.update<Dimension>(backend, reference);
+						concrete_solver.step(reference, neighbors);
+
+						let timer = sph::scoped_phase_timer{timings, sph::run_phase::gpu_step};
+						simulated_time += double{compute->step()};
+						compute->download(particles);
+
+						let deviation = sph::compute_deviation(particles, reference);
+						worst_deviation = {
+							.position = std::max(worst_deviation.position, deviation.position),
+							.velocity = std::max(worst_deviation.velocity, deviation.velocity),
+							.density = std::max(worst_deviation.density, deviation.density)};
+					}
+					else if (compute)
+					{
+						let timer = sph::scoped_phase_timer{timings, sph::run_phase::gpu_step};
+						compute->begin_step();
+
+						// The frame staged after the previous step is read while this one computes,
+						// its time is counted with the step it overlaps
+						if (pending)
+						{
+							compute->download(pending->ticket, particles);
+							writer->submit(particles, pending->step, pending->time);
+							pending.reset();
+						}
+
+						simulated_time += double{compute->end_step()};
+					}
+					else
+					{
+						{
+							PHYSENG_PROFILE_ZONE("neighbor update");
+							let timer =
+								sph::scoped_phase_timer{timings, sph::run_phase::neighbor_search};
+
+							// The indices change, the lists have to be rebuilt from scratch
+							if (reorder.update(particles))
+							{
+								neighbors.invalidate();
+							}
+
+							neighbors.update<Dimension>(backend, particles);
+						}
+
+						simulated_time += double{concrete_solver.step(particles, neighbors)};
+					}
+
+					let interval = options.checkpoint_interval;
+					let is_checkpoint_due = interval != 0 && (step + 1) % interval == 0
+										 && !options.checkpoint_path.empty();
+					let is_output_due = writer && (step + 1) % options.output_interval == 0;
+
+					if (compute && !options.is_comparing_backends && is_checkpoint_due)
+					{
+						let timer = sph::scoped_phase_timer{timings, sph::run_phase::checkpoint};
+						compute->download(particles);
+					}
+					else if (compute && !options.is_comparing_backends && is_output_due)
+					{
+						let timer = sph::scoped_phase_timer{timings, sph::run_phase::output};
+						pending = pending_frame{.ticket = compute->stage_download(),
+												.step = first_step + step + 1,
+												.time = simulated_time};
+					}
+
+					if (is_output_due && !pending)
+					{
+						let timer = sph::scoped_phase_timer{timings, sph::run_phase::output};
+						writer->submit(particles, first_step + step + 1, simulated_time);
+					}
+
+					if (frames != nullptr)
+					{
+						frames->reset();
+					}
+
+					// Compiled out with the debug messages, release builds do not even read the
+					// clock
+					if constexpr (SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG)
+					{
+						if (step_log.should_log())
+						{
+							SPDLOG_LOGGER_DEBUG(&app_logger, "step {}: {:.4f}s simulated",
+												first_step + step + 1, simulated_time);
+						}
+					}
+
+					if (is_checkpoint_due)
+					{
+						let timer = sph::scoped_phase_timer{timings, sph::run_phase::checkpoint};
+						has_failed |= !save_checkpoint(app_logger, options.checkpoint_path,
+													   particles,
+													   checkpoint_at(first_step + step + 1));
+					}
+				}
+			},
+			search, solver);
+
+		if (pending)
+		{
+			let timer = sph::scoped_phase_timer{timings, sph::run_phase::output};
+			compute->download(pending->ticket, particles);
+			writer->submit(particles, pending->step, pending->time);
+		}
+		if (compute)
+		{
+			let timer = sph::scoped_phase_timer{timings, sph::run_phase::gpu_step};
+			compute->download(particles);
+		}
+
+		if (!options.checkpoint_path.empty())
+		{
+			let timer = sph::scoped_phase_timer{timings, sph::run_phase::checkpoint};
+			has_failed |= !save_checkpoint(app_logger, options.checkpoint_path, particles,
+										   checkpoint_at(first_step + options.step_count));
+		}
+
+		let elapsed =
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		let counter_sample = counters.stop();
+
+		// The CPU steps of a backend comparison are not part of the run
+		if (!compute)
+		{
+			std::visit(
+				[&](auto const& concrete_solver) { timings += concrete_solver.get_timings(); },
+				solver);
+		}
+
+		if (!compute || options.is_comparing_backends)
+		{
+			log_neighbor_statistics(app_logger, neighbors);
+			log_memory_usage(app_logger, particles, neighbors);
+		}
+		if (allocator)
+		{
+			let memory_stats = allocator->get_statistics();
+			app_logger.info("device memory: {} blocks, {} of {} bytes in use\n",
+							memory_stats.block_count, memory_stats.used_size,
+							memory_stats.reserved_size);
+		}
+		if (writer)
+		{
+			writer->flush();
+			log_output_statistics(app_logger, *writer);
+			has_failed |= writer->get_statistics().failed_count != 0;
+		}
+		if (reorder.is_enabled())
+		{
+			let& stats = reorder.get_statistics();
+			app_logger.info("morton reorders: {}, locality: {:.2f} cells (best {:.2f})",
+							stats.reorder_count, stats.locality, stats.reference_locality);
+		}
+		if (frames != nullptr)
+		{
+			let frame_stats = frames->get_statistics();
+			app_logger.info("frame arenas: {}, high-water mark: {} bytes per thread ({} in total), "
+							"{} overflowing allocations",
+							frame_stats.arena_count, frame_stats.max_high_water_mark,
+							frame_stats.total_high_water_mark, frame_stats.overflow_count);
+		}
+		if constexpr (has_dfsph<Precision, Dimension>)
+		{
+			if (let* dfsph = std::get_if<sph::dfsph_solver>(&solver))
+			{
+				log_solver_statistics(app_logger, *dfsph);
+			}
+		}
+
+		let state = sph::compute_diagnostics(particles, rest_density);
+		app_logger.info("kinetic energy: {}, max speed: {}, average density error: {:.3e}\n",
+						state.kinetic_energy, state.max_speed, state.average_density_error);
+
+		log_run_summary(app_logger,
+						{.scenario = options.scenario,
+						 .dimension = Dimension,
+						 .kernel = kernel.get_type(),
+						 .precision = Precision::name,
+						 .particle_count = particles.size(),
+						 .step_count = options.step_count,
+						 .wall_time = elapsed,
+						 .simulated_time = simulated_time,
+						 .timings = timings,
+						 .counters = counters.is_available() ? std::optional{counter_sample}
+															 : std::nullopt});
+
+		// The comparison runs in CI, which only looks at the exit status
+		if (compute && options.is_comparing_backends)
+		{
+			has_failed |= !check_deviation(app_logger, worst_deviation, options.step_count,
+										   wcsph_parameters.speed_of_sound);
+		}
+
+		return has_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	template<physeng::precision_policy Precision>
+	auto run_in_dimension(sph::options const& options, std::optional<vulkan::instance> const& gpu,
+						  spdlog::logger& app_logger) -> int
+	{
+		if (options.dimension == 2)
+		{
+			return run<Precision, 2>(options, gpu, app_logger);
+		}
+
+		return run<Precision, 3>(options, gpu, app_logger);
+	}
 } // namespace
 
-void physeng_main(std::span<const std::string_view> args)
+auto physeng_main(std::span<const std::string_view> args) -> int
 {
+	PHYSENG_PROFILE_ZONE("physeng_main");
+
 	let app_name = args[0];
 
-	auto app_logger = create_logger(app_name);
-	// TODO: do actual error checking
-	let instance = vulkan::instance::make(app_name, app_logger).value();
-	let physical_device = instance.get().enumeratePhysicalDevices()[0];
+	let logger = create_logger(app_name);
+	auto& app_logger = *logger;
+
+	let options = sph::parse_options(args);
+	if (!options)
+	{
+		app_logger.error("failed to parse the command line: {}", sph::to_string(options.error()));
+		return EXIT_FAILURE;
+	}
+
+	if (!validate_backend(*options, app_logger))
+	{
+		return EXIT_FAILURE;
+	}
 
-	let gpu_properties = physical_device.getProperties();
+	auto gpu = std::optional<vulkan::instance>{};
+	if (options->is_headless)
+	{
+		app_logger.info("running headless, the GPU is not used\n");
+	}
+	else
+	{
+		gpu = open_gpu(app_name, app_logger);
+		if (!gpu)
+		{
+			return EXIT_FAILURE;
+		}
+	}
 
-	let driver_version =
-		vulkan::get_driver_version(vulkan::vendor_id{gpu_properties.vendorID},
-								   vulkan::driver_version{gpu_properties.driverVersion});
+	// Every combination of precision and dimension is its own instantiation of the run, picked
+	// here once. The kernel type is resolved when the kernel is created. The library throws when
+	// the particles leave what a neighbor search can hold, such as a grid too large for memory
+	try
+	{
+		if (options->precision == sph::precision_type::compact)
+		{
+			return run_in_dimension<physeng::compact_precision>(*options, gpu, app_logger);
+		}
 
-	app_logger.info("GPU name: {}\n", gpu_properties.deviceName);
-	app_logger.info("GPU driver version: {}\n", driver_version);
+		return run_in_dimension<physeng::single_precision>(*options, gpu, app_logger);
+	}
+	catch (std::exception const& error)
+	{
+		app_logger.error("the simulation stopped: {}", error.what());
+		return EXIT_FAILURE;
+	}
 }
@@ -0,0 +1,123 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sph/vulkan/buffer.hpp>
+
+#include <sph/core.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace vulkan
+{
+	auto buffer::make(memory_allocator& allocator, vk::DeviceSize size,
+					  vk::BufferUsageFlags usage, memory_usage memory)
+		-> tl::expected<buffer, memory_error>
+	{
+		// Empty buffers are not allowed, a particle set may be
+		let allocated_size = std::max<vk::DeviceSize>(size, sizeof(std::uint32_t));
+		let logical_device = allocator.get_device().get();
+
+		auto handle = vk::UniqueBuffer{};
+		try
+		{
+			handle = logical_device.createBufferUnique(
+				vk::BufferCreateInfo{}.setSize(allocated_size).setUsage(usage));
+		}
+		catch (vk::SystemError const& /*error*/)
+		{
+			return tl::unexpected(memory_error::out_of_memory);
+		}
+
+		let requirements = logical_device.getBufferMemoryRequirements(handle.get());
+
+		auto allocation = allocator.allocate(requirements, memory);
+		if (!allocation)
+		{
+			return tl::unexpected(allocation.error());
+		}
+
+		try
+		{
+			logical_device.bindBufferMemory(handle.get(), allocation->memory, allocation->offset);
+		}
+		catch (vk::SystemError const& /*error*/)
+		{
+			allocator.free(*allocation);
+			return tl::unexpected(memory_error::out_of_memory);
+		}
+
+		return buffer{allocator, std::move(handle), *allocation, allocated_size};
+	}
+
+	buffer::buffer(memory_allocator& allocator, vk::UniqueBuffer&& buffer,
+				   allocation const& allocation, vk::DeviceSize size) :
+		m_allocator(&allocator),
+		m_buffer(std::move(buffer)), m_allocation(allocation), m_size(size)
+	{}
+
+	buffer::buffer(buffer&& other) noexcept :
+		m_allocator(std::exchange(other.m_allocator, nullptr)),
+		m_buffer(std::move(other.m_buffer)), m_allocation(other.m_allocation),
+		m_size(other.m_size)
+	{}
+
+	buffer::~buffer()
+	{
+		release();
+	}
+
+	auto buffer::operator=(buffer&& rhs) noexcept -> buffer&
+	{
+		if (this != &rhs)
+		{
+			release();
+
+			m_allocator = std::exchange(rhs.m_allocator, nullptr);
+			m_buffer = std::move(rhs.m_buffer);
+			m_allocation = rhs.m_allocation;
+			m_size = rhs.m_size;
+		}
+
+		return *this;
+	}
+
+	auto buffer::get() const -> vk::Buffer
+	{
+		return m_buffer.get();
+	}
+	auto buffer::size() const noexcept -> vk::DeviceSize
+	{
+		return m_size;
+	}
+	auto buffer::is_mapped() const noexcept -> bool
+	{
+		return m_allocation.mapped != nullptr;
+	}
+
+	void buffer::release() noexcept
+	{
+		// The buffer has to go before the memory it is bound to
+		m_buffer.reset();
+
+		if (m_allocator != nullptr)
+		{
+			m_allocator->free(m_allocation);
+			m_allocator = nullptr;
+		}
+	}
+} // namespace vulkan
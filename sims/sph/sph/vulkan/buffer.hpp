@@ -0,0 +1,81 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sph/vulkan/details/vulkan.hpp>
+#include <sph/vulkan/memory_allocator.hpp>
+
+#include <tl/expected.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <span>
+
+namespace vulkan
+{
+	/**
+	 * @brief A buffer bound to a range of a block of `memory_allocator`, which it gives back when
+	 * it is destroyed. Buffers in memory visible to the host stay mapped for as long as they live
+	 */
+	class buffer
+	{
+	public:
+		/**
+		 * @param[in] allocator Where the memory comes from, which must outlive the buffer
+		 */
+		static auto make(memory_allocator& allocator, vk::DeviceSize size,
+						 vk::BufferUsageFlags usage, memory_usage memory)
+			-> tl::expected<buffer, memory_error>;
+
+		buffer(buffer const&) = delete;
+		buffer(buffer&& other) noexcept;
+		~buffer();
+
+		auto operator=(buffer const&) -> buffer& = delete;
+		auto operator=(buffer&& rhs) noexcept -> buffer&;
+
+		[[nodiscard]] auto get() const -> vk::Buffer;
+		[[nodiscard]] auto size() const noexcept -> vk::DeviceSize;
+		[[nodiscard]] auto is_mapped() const noexcept -> bool;
+
+		/**
+		 * @brief The contents of the buffer, as seen by the host. Writes are visible to the
+		 * commands submitted afterwards, and the writes of the commands once they completed. Only
+		 * available for buffers in memory visible to the host
+		 */
+		template<typename Type>
+		[[nodiscard]] auto mapped() const noexcept -> std::span<Type>
+		{
+			assert(is_mapped()); // NOLINT
+
+			return {reinterpret_cast<Type*>(m_allocation.mapped), // NOLINT
+					m_size / sizeof(Type)};
+		}
+
+	private:
+		buffer(memory_allocator& allocator, vk::UniqueBuffer&& buffer,
+			   allocation const& allocation, vk::DeviceSize size);
+
+		void release() noexcept;
+
+	private:
+		memory_allocator* m_allocator;
+		vk::UniqueBuffer m_buffer;
+		allocation m_allocation;
+		vk::DeviceSize m_size;
+	};
+} // namespace vulkan
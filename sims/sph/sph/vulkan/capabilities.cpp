@@ -0,0 +1,146 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sph/vulkan/capabilities.hpp>
+
+#include <sph/core.hpp>
+#include <sph/vulkan/physical_device.hpp>
+
+#include <algorithm>
+#include <string_view>
+
+namespace
+{
+	using namespace std::literals;
+	namespace stdr = std::ranges;
+
+	auto is_khr_validation_layer(vk::LayerProperties const& property) -> bool
+	{
+		return std::string_view{property.layerName} == "VK_LAYER_KHRONOS_validation"sv;
+	}
+
+	auto is_debug_utils_ext(vk::ExtensionProperties const& property) -> bool
+	{
+		return std::string_view{property.extensionName} == "VK_EXT_debug_utils"sv;
+	}
+
+	/**
+	 * @brief Higher is better
+	 */
+	auto get_device_rank(vk::PhysicalDeviceType type) -> int
+	{
+		switch (type)
+		{
+			case vk::PhysicalDeviceType::eDiscreteGpu:
+				return 3;
+			case vk::PhysicalDeviceType::eIntegratedGpu:
+				return 2;
+			case vk::PhysicalDeviceType::eVirtualGpu:
+				return 1;
+			default:
+				return 0;
+		}
+	}
+
+	auto find_compute_queue_family(vk::PhysicalDevice physical_device)
+		-> std::optional<std::uint32_t>
+	{
+		let families = physical_device.getQueueFamilyProperties();
+
+		// A queue dedicated to compute does not share its time with graphics work
+		auto result = std::optional<std::uint32_t>{};
+		for (std::uint32_t index = 0; index < families.size(); ++index)
+		{
+			let flags = families[index].queueFlags;
+			if (!(flags & vk::QueueFlagBits::eCompute))
+			{
+				continue;
+			}
+
+			if (!(flags & vk::QueueFlagBits::eGraphics))
+			{
+				return index;
+			}
+
+			if (!result)
+			{
+				result = index;
+			}
+		}
+
+		return result;
+	}
+
+	auto supports_timeline_semaphores(vk::PhysicalDevice physical_device,
+									  vk::PhysicalDeviceProperties const& properties) -> bool
+	{
+		// Core since Vulkan 1.2, which is also when the feature structure appeared
+		if (properties.apiVersion < VK_API_VERSION_1_2)
+		{
+			return false;
+		}
+
+		let features = physical_device.getFeatures2<vk::PhysicalDeviceFeatures2,
+													vk::PhysicalDeviceTimelineSemaphoreFeatures>();
+		return features.get<vk::PhysicalDeviceTimelineSemaphoreFeatures>().timelineSemaphore
+			== VK_TRUE;
+	}
+} // namespace
+
+namespace vulkan
+{
+	auto probe_instance_capabilities() -> instance_capabilities
+	{
+		auto result = instance_capabilities{};
+
+		if constexpr (should_enable_validation_layers)
+		{
+			let layer_props = vk::enumerateInstanceLayerProperties();
+			result.has_validation_layer = stdr::any_of(layer_props, is_khr_validation_layer);
+
+			let ext_props = vk::enumerateInstanceExtensionProperties();
+			result.has_debug_utils = stdr::any_of(ext_props, is_debug_utils_ext);
+		}
+
+		return result;
+	}
+
+	auto probe_device_capabilities(vk::Instance instance) -> std::vector<device_capabilities>
+	{
+		auto result = std::vector<device_capabilities>{};
+
+		for (let physical_device : instance.enumeratePhysicalDevices())
+		{
+			let properties = physical_device.getProperties();
+			let has_timeline_semaphores = supports_timeline_semaphores(physical_device, properties);
+
+			result.push_back(
+				{.physical_device = physical_device,
+				 .properties = properties,
+				 .memory_properties = physical_device.getMemoryProperties(),
+				 .compute_queue_family = find_compute_queue_family(physical_device),
+				 .has_timeline_semaphores = has_timeline_semaphores,
+				 .driver_version = get_driver_version(vendor_id{properties.vendorID},
+													  driver_version{properties.driverVersion})});
+		}
+
+		stdr::stable_sort(result, stdr::greater{}, [](device_capabilities const& capabilities) {
+			return get_device_rank(capabilities.properties.deviceType);
+		});
+
+		return result;
+	}
+} // namespace vulkan
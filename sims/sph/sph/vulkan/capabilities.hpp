@@ -0,0 +1,59 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sph/vulkan/details/vulkan.hpp>
+
+#include <libphyseng/util/semantic_version.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace vulkan
+{
+	/**
+	 * @brief What the loader offers, probed once before the instance is created
+	 */
+	struct instance_capabilities
+	{
+		bool has_validation_layer = false; //< Only probed when validation is enabled
+		bool has_debug_utils = false;      //< Only probed when validation is enabled
+	};
+
+	/**
+	 * @brief What a physical device offers, probed once when the instance is created
+	 */
+	struct device_capabilities
+	{
+		vk::PhysicalDevice physical_device;
+		vk::PhysicalDeviceProperties properties;
+		vk::PhysicalDeviceMemoryProperties memory_properties;
+		std::optional<std::uint32_t> compute_queue_family; //< Preferably without graphics
+		bool has_timeline_semaphores = false;
+		physeng::semantic_version driver_version;           //< Decoded from the vendor's scheme
+	};
+
+	auto probe_instance_capabilities() -> instance_capabilities;
+
+	/**
+	 * @brief The capabilities of every physical device of `instance`, from the best suited to
+	 * compute to the least. Discrete GPUs come first, then integrated ones, then software
+	 * implementations such as lavapipe
+	 */
+	auto probe_device_capabilities(vk::Instance instance) -> std::vector<device_capabilities>;
+} // namespace vulkan
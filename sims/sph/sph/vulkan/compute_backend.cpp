@@ -0,0 +1,629 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sph/vulkan/compute_backend.hpp>
+
+#include <sph/core.hpp>
+#include <sph/vulkan/shaders.hpp>
+
+#include <libphyseng/profiling/profiler.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+namespace
+{
+	using namespace std::literals;
+
+	// Matches WORKGROUP_SIZE in shaders/common.glsl
+	constexpr std::uint32_t workgroup_size = 256;
+	// The scan of the cell offsets handles two cells per invocation
+	constexpr std::uint32_t scan_block_size = 2 * workgroup_size;
+	// A download can be read while the next one is being copied
+	constexpr std::uint32_t staging_slot_count = 2;
+	// Positions and velocities, then masses, densities and pressures, see get_staging_offset
+	constexpr std::size_t staged_column_count = 9;
+
+	/**
+	 * @brief The push constants shared by every shader, see shaders/common.glsl
+	 */
+	struct push_constants
+	{
+		std::array<float, 4> domain_min;
+		std::array<float, 4> domain_max;
+		std::array<float, 4> gravity;
+		std::array<std::uint32_t, 4> grid;
+		std::array<float, 4> kernel;
+		std::array<float, 4> fluid;
+		std::uint32_t particle_count;
+		std::uint32_t block_count;
+	};
+
+	// Vulkan guarantees at least 128 bytes of push constants
+	static_assert(std::is_trivially_copyable_v<push_constants> && sizeof(push_constants) <= 128);
+
+	// Viscosity term of Monaghan (2005) and its regularization, as in wcsph.cpp
+	constexpr float viscosity_scale = 10.0F;
+	constexpr float viscosity_epsilon = 0.01F;
+
+	auto get_shader_code(std::uint32_t pass) -> std::span<std::uint32_t const>
+	{
+		// In the order of the passes
+		static auto const codes = std::array{vulkan::shaders::grid_count(),
+											 vulkan::shaders::scan_blocks(),
+											 vulkan::shaders::scan_block_sums(),
+											 vulkan::shaders::scan_add(),
+											 vulkan::shaders::grid_scatter(),
+											 vulkan::shaders::density(),
+											 vulkan::shaders::force(),
+											 vulkan::shaders::advect()};
+
+		return codes.at(pass);
+	}
+
+	auto create_pipeline(vk::Device device, vk::PipelineCache cache, vk::PipelineLayout layout,
+						 std::span<std::uint32_t const> code,
+						 vk::SpecializationInfo const& specialization) -> vk::UniquePipeline
+	{
+		let shader = device.createShaderModuleUnique(
+			vk::ShaderModuleCreateInfo{}.setCodeSize(code.size_bytes()).setPCode(code.data()));
+
+		let stage = vk::PipelineShaderStageCreateInfo{}
+						.setStage(vk::ShaderStageFlagBits::eCompute)
+						.setModule(shader.get())
+						.setPName("main")
+						.setPSpecializationInfo(&specialization);
+
+		auto pipeline = device.createComputePipelineUnique(
+			cache, vk::ComputePipelineCreateInfo{}.setStage(stage).setLayout(layout));
+
+		return std::move(pipeline.value);
+	}
+
+	/**
+	 * @brief Make the writes of the commands recorded so far visible to the ones that follow
+	 */
+	void add_barrier(vk::CommandBuffer commands, vk::PipelineStageFlags source_stage,
+					 vk::AccessFlags source_access, vk::PipelineStageFlags destination_stage,
+					 vk::AccessFlags destination_access)
+	{
+		commands.pipelineBarrier(source_stage, destination_stage, {},
+								 vk::MemoryBarrier{source_access, destination_access}, {}, {});
+	}
+
+	void add_compute_barrier(vk::CommandBuffer commands)
+	{
+		add_barrier(commands, vk::PipelineStageFlagBits::eComputeShader,
+					vk::AccessFlagBits::eShaderWrite, vk::PipelineStageFlagBits::eComputeShader,
+					vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+	}
+
+	/**
+	 * @brief Order the commands that follow after every command submitted before, be they compute
+	 * passes or copies to and from the staging ring
+	 */
+	void add_submission_barrier(vk::CommandBuffer commands)
+	{
+		let stages =
+			vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer;
+		add_barrier(commands, stages,
+					vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite, stages,
+					vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+						| vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite);
+	}
+
+	auto to_compute_error(vulkan::memory_error error) -> vulkan::compute_error
+	{
+		if (error == vulkan::memory_error::no_host_visible_memory)
+		{
+			return vulkan::compute_error::no_host_visible_memory;
+		}
+
+		return vulkan::compute_error::out_of_memory;
+	}
+
+	auto get_workgroup_count(std::uint32_t invocations) -> std::uint32_t
+	{
+		return (invocations + workgroup_size - 1) / workgroup_size;
+	}
+
+	/**
+	 * @brief Copy a column into the staging memory. The device always works on floats, narrower
+	 * columns are widened on the way
+	 */
+	template<typename Type>
+	void store_floats(std::span<Type const> column, std::byte* destination)
+	{
+		if constexpr (std::is_same_v<Type, float>)
+		{
+			std::memcpy(destination, column.data(), column.size_bytes());
+		}
+		else
+		{
+			for (std::size_t i = 0; i < column.size(); ++i)
+			{
+				let value = float{column[i]};
+				std::memcpy(destination + i * sizeof(float), &value, sizeof(float));
+			}
+		}
+	}
+
+	/**
+	 * @brief Copy a column out of the staging memory, rounding the floats of the device to the
+	 * type of the column
+	 */
+	template<typename Type>
+	void load_floats(std::byte const* source, std::span<Type> column)
+	{
+		if constexpr (std::is_same_v<Type, float>)
+		{
+			std::memcpy(column.data(), source, column.size_bytes());
+		}
+		else
+		{
+			for (std::size_t i = 0; i < column.size(); ++i)
+			{
+				auto value = 0.0F;
+				std::memcpy(&value, source + i * sizeof(float), sizeof(float));
+				column[i] = value;
+			}
+		}
+	}
+} // namespace
+
+namespace vulkan
+{
+	auto to_string(compute_error error) -> std::string_view
+	{
+		switch (error)
+		{
+			case compute_error::no_host_visible_memory:
+				return "no memory visible to the host"sv;
+			case compute_error::out_of_memory:
+				return "out of device memory"sv;
+			case compute_error::pipeline_creation_failed:
+				return "failed to create the compute pipelines"sv;
+		}
+
+		return {};
+	}
+
+	auto compute_backend::make(device const& device, memory_allocator& allocator,
+							   vk::PipelineCache cache, physeng::smoothing_kernel const& kernel,
+							   sph::wcsph_parameters const& parameters)
+		-> tl::expected<compute_backend, compute_error>
+	{
+		try
+		{
+			return compute_backend{device, allocator, cache, kernel, parameters};
+		}
+		catch (vk::SystemError const& /*error*/)
+		{
+			return tl::unexpected(compute_error::pipeline_creation_failed);
+		}
+	}
+
+	compute_backend::compute_backend(device const& device, memory_allocator& allocator,
+									 vk::PipelineCache cache,
+									 physeng::smoothing_kernel const& kernel,
+									 sph::wcsph_parameters const& parameters) :
+		m_device(&device),
+		m_allocator(&allocator), m_kernel(kernel), m_parameters(parameters),
+		m_stiffness(parameters.rest_density * parameters.speed_of_sound
+					* parameters.speed_of_sound / 7.0F),
+		m_cell_size(kernel.get_support_radius().get()), m_grid()
+	{
+		for (std::size_t axis = 0; axis < m_grid.size(); ++axis)
+		{
+			let extent = parameters.bounds.max[axis] - parameters.bounds.min[axis];
+			let cells = static_cast<std::uint32_t>(std::ceil(extent / m_cell_size));
+			m_grid[axis] = std::max(1U, cells);
+		}
+
+		let binding_count = static_cast<std::uint32_t>(binding::count);
+
+		auto bindings = std::vector<vk::DescriptorSetLayoutBinding>{};
+		for (std::uint32_t index = 0; index < binding_count; ++index)
+		{
+			bindings.push_back(vk::DescriptorSetLayoutBinding{}
+								   .setBinding(index)
+								   .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+								   .setDescriptorCount(1)
+								   .setStageFlags(vk::ShaderStageFlagBits::eCompute));
+		}
+
+		let logical_device = device.get();
+
+		m_set_layout = logical_device.createDescriptorSetLayoutUnique(
+			vk::DescriptorSetLayoutCreateInfo{}.setBindings(bindings));
+
+		let push_range = vk::PushConstantRange{vk::ShaderStageFlagBits::eCompute, 0,
+											   sizeof(push_constants)};
+		m_pipeline_layout = logical_device.createPipelineLayoutUnique(
+			vk::PipelineLayoutCreateInfo{}.setSetLayouts(m_set_layout.get())
+				.setPushConstantRanges(push_range));
+
+		// The kernel is picked when the shaders are compiled to machine code
+		let kernel_type = static_cast<std::uint32_t>(kernel.get_type());
+		let specialization_entry = vk::SpecializationMapEntry{0, 0, sizeof(kernel_type)};
+		let specialization = vk::SpecializationInfo{}
+								 .setMapEntries(specialization_entry)
+								 .setDataSize(sizeof(kernel_type))
+								 .setPData(&kernel_type);
+
+		for (std::uint32_t index = 0; index < static_cast<std::uint32_t>(pass::count); ++index)
+		{
+			m_pipelines.push_back(create_pipeline(logical_device, cache, m_pipeline_layout.get(),
+												  get_shader_code(index), specialization));
+		}
+
+		let pool_size = vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, binding_count};
+		m_descriptor_pool = logical_device.createDescriptorPoolUnique(
+			vk::DescriptorPoolCreateInfo{}.setMaxSets(1).setPoolSizes(pool_size));
+		let set_info = vk::DescriptorSetAllocateInfo{}
+						   .setDescriptorPool(m_descriptor_pool.get())
+						   .setSetLayouts(m_set_layout.get());
+		m_descriptor_set = logical_device.allocateDescriptorSets(set_info).front();
+	}
+
+	compute_backend::~compute_backend()
+	{
+		// The buffers may still be in use by a step or a copy
+		if (!m_buffers.empty())
+		{
+			m_device->wait_idle();
+		}
+	}
+
+	auto compute_backend::get_time_step() const noexcept -> float
+	{
+		let h = m_kernel.get_smoothing_length().get();
+		return m_parameters.cfl_factor * h / (m_parameters.speed_of_sound + m_max_speed);
+	}
+
+	template<physeng::precision_policy Precision>
+	auto compute_backend::upload(physeng::basic_particle_set<Precision> const& particles)
+		-> tl::expected<void, compute_error>
+	{
+		PHYSENG_PROFILE_ZONE("compute_backend::upload");
+
+		let count = particles.size();
+		let column_size = count * sizeof(float);
+		let index_size = count * sizeof(std::uint32_t);
+
+		let sizes = std::array<vk::DeviceSize, static_cast<std::size_t>(binding::count)>{
+			3 * column_size,
+			3 * column_size,
+			3 * column_size,
+			column_size,
+			column_size,
+			column_size,
+			index_size,
+			index_size,
+			(get_cell_count() + 1) * sizeof(std::uint32_t),
+			index_size,
+			get_scan_block_count() * sizeof(std::uint32_t),
+			sizeof(std::uint32_t)};
+
+		if (!m_buffers.empty())
+		{
+			m_device->wait_idle();
+		}
+
+		m_buffers.clear();
+		m_staging.reset();
+		m_particle_count = 0;
+
+		let usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc
+				  | vk::BufferUsageFlagBits::eTransferDst;
+
+		for (std::size_t index = 0; index < sizes.size(); ++index)
+		{
+			// The host only ever reads the largest speed directly, everything else is staged
+			let memory = index == static_cast<std::size_t>(binding::reduction)
+						   ? memory_usage::host_visible
+						   : memory_usage::device_local;
+
+			auto result = buffer::make(*m_allocator, sizes[index], usage, memory);
+			if (!result)
+			{
+				m_buffers.clear();
+				return tl::unexpected(to_compute_error(result.error()));
+			}
+
+			m_buffers.push_back(std::move(result).value());
+		}
+
+		auto staging = staging_ring::make(*m_allocator, staged_column_count * column_size,
+										  staging_slot_count);
+		if (!staging)
+		{
+			m_buffers.clear();
+			return tl::unexpected(to_compute_error(staging.error()));
+		}
+
+		m_staging = std::move(staging).value();
+		m_particle_count = static_cast<std::uint32_t>(count);
+
+		let slot = m_staging->acquire();
+		let store_column = [&](binding index, std::size_t axis, auto column) {
+			store_floats(column, slot.memory.data() + get_staging_offset(index, axis));
+		};
+
+		for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+		{
+			store_column(binding::positions, axis, particles.position(axis));
+			store_column(binding::velocities, axis, particles.velocity(axis));
+		}
+		store_column(binding::masses, 0, particles.mass());
+		store_column(binding::densities, 0, particles.density());
+		store_column(binding::pressures, 0, particles.pressure());
+
+		// The writes of the host are visible to the commands submitted after them, and the next
+		// step waits for the copies with its first barrier
+		let value = m_device->submit([&](vk::CommandBuffer commands) {
+			let copy = [&](binding index, std::size_t column_count) {
+				let region = vk::BufferCopy{slot.offset + get_staging_offset(index, 0), 0,
+											column_count * column_size};
+				commands.copyBuffer(m_staging->get(), get_buffer(index).get(), region);
+			};
+
+			if (column_size != 0)
+			{
+				copy(binding::positions, physeng::particle_set::dimension);
+				copy(binding::velocities, physeng::particle_set::dimension);
+				copy(binding::masses, 1);
+				copy(binding::densities, 1);
+				copy(binding::pressures, 1);
+			}
+		});
+		m_staging->release(slot, value);
+
+		auto infos = std::vector<vk::DescriptorBufferInfo>{};
+		for (let& buffer : m_buffers)
+		{
+			infos.emplace_back(buffer.get(), 0, VK_WHOLE_SIZE);
+		}
+
+		auto writes = std::vector<vk::WriteDescriptorSet>{};
+		for (std::uint32_t index = 0; index < infos.size(); ++index)
+		{
+			writes.push_back(vk::WriteDescriptorSet{}
+								 .setDstSet(m_descriptor_set)
+								 .setDstBinding(index)
+								 .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+								 .setBufferInfo(infos[index]));
+		}
+
+		m_device->get().updateDescriptorSets(writes, {});
+
+		return {};
+	}
+
+	auto compute_backend::step() -> float
+	{
+		begin_step();
+		return end_step();
+	}
+
+	void compute_backend::begin_step()
+	{
+		PHYSENG_PROFILE_ZONE("compute_backend::begin_step");
+
+		assert(!m_buffers.empty()); // NOLINT
+
+		let dt = get_time_step();
+
+		m_step_value =
+			m_device->submit([&](vk::CommandBuffer commands) { record_step(commands, dt); });
+		m_pending_time_step = dt;
+	}
+
+	auto compute_backend::end_step() -> float
+	{
+		PHYSENG_PROFILE_ZONE("compute_backend::end_step");
+
+		m_device->wait(m_step_value);
+
+		let max_speed_squared =
+			std::bit_cast<float>(get_buffer(binding::reduction).mapped<std::uint32_t>()[0]);
+		m_max_speed = std::sqrt(max_speed_squared);
+
+		return m_pending_time_step;
+	}
+
+	auto compute_backend::stage_download() -> download_ticket
+	{
+		PHYSENG_PROFILE_ZONE("compute_backend::stage_download");
+
+		assert(m_staging.has_value()); // NOLINT
+
+		let slot = m_staging->acquire();
+		let column_size = vk::DeviceSize{m_particle_count} * sizeof(float);
+
+		let value = m_device->submit([&](vk::CommandBuffer commands) {
+			add_submission_barrier(commands);
+
+			let copy = [&](binding index, std::size_t column_count) {
+				let region = vk::BufferCopy{0, slot.offset + get_staging_offset(index, 0),
+											column_count * column_size};
+				commands.copyBuffer(get_buffer(index).get(), m_staging->get(), region);
+			};
+
+			if (column_size != 0)
+			{
+				copy(binding::positions, physeng::particle_set::dimension);
+				copy(binding::velocities, physeng::particle_set::dimension);
+				copy(binding::densities, 1);
+				copy(binding::pressures, 1);
+			}
+
+			add_barrier(commands, vk::PipelineStageFlagBits::eTransfer,
+						vk::AccessFlagBits::eTransferWrite, vk::PipelineStageFlagBits::eHost,
+						vk::AccessFlagBits::eHostRead);
+		});
+		m_staging->release(slot, value);
+
+		return {.slot = slot, .value = value};
+	}
+
+	template<physeng::precision_policy Precision>
+	void compute_backend::download(download_ticket const& ticket,
+								   physeng::basic_particle_set<Precision>& particles) const
+	{
+		PHYSENG_PROFILE_ZONE("compute_backend::download");
+
+		assert(particles.size() == m_particle_count); // NOLINT
+
+		m_device->wait(ticket.value);
+
+		let load_column = [&](binding index, std::size_t axis, auto destination) {
+			load_floats(ticket.slot.memory.data() + get_staging_offset(index, axis), destination);
+		};
+
+		for (std::size_t axis = 0; axis < physeng::particle_set::dimension; ++axis)
+		{
+			load_column(binding::positions, axis, particles.position(axis));
+			load_column(binding::velocities, axis, particles.velocity(axis));
+		}
+		load_column(binding::densities, 0, particles.density());
+		load_column(binding::pressures, 0, particles.pressure());
+	}
+
+	template<physeng::precision_policy Precision>
+	void compute_backend::download(physeng::basic_particle_set<Precision>& particles)
+	{
+		download(stage_download(), particles);
+	}
+
+	template auto compute_backend::upload(physeng::particle_set const& particles)
+		-> tl::expected<void, compute_error>;
+	template auto compute_backend::upload(physeng::compact_particle_set const& particles)
+		-> tl::expected<void, compute_error>;
+	template void compute_backend::download(download_ticket const& ticket,
+											physeng::particle_set& particles) const;
+	template void compute_backend::download(download_ticket const& ticket,
+											physeng::compact_particle_set& particles) const;
+	template void compute_backend::download(physeng::particle_set& particles);
+	template void compute_backend::download(physeng::compact_particle_set& particles);
+
+	auto compute_backend::get_buffer(binding index) const -> buffer const&
+	{
+		return m_buffers[static_cast<std::size_t>(index)];
+	}
+
+	auto compute_backend::get_cell_count() const noexcept -> std::uint32_t
+	{
+		return m_grid[0] * m_grid[1] * m_grid[2];
+	}
+
+	auto compute_backend::get_scan_block_count() const noexcept -> std::uint32_t
+	{
+		return (get_cell_count() + 1 + scan_block_size - 1) / scan_block_size;
+	}
+
+	auto compute_backend::get_staging_offset(binding index, std::size_t axis) const noexcept
+		-> vk::DeviceSize
+	{
+		// The columns of the particles that are staged, one after the other
+		let first_column = [&]() -> std::size_t {
+			switch (index)
+			{
+				case binding::positions:
+					return 0;
+				case binding::velocities:
+					return 3;
+				case binding::masses:
+					return 6;
+				case binding::densities:
+					return 7;
+				case binding::pressures:
+					return 8;
+				default:
+					assert(false && "the binding is not staged"); // NOLINT
+					return 0;
+			}
+		}();
+
+		return (first_column + axis) * m_particle_count * sizeof(float);
+	}
+
+	void compute_backend::record_step(vk::CommandBuffer commands, float dt) const
+	{
+		let& bounds = m_parameters.bounds;
+		let& kernel = m_kernel.get_parameters();
+		let h = m_kernel.get_smoothing_length().get();
+
+		let constants = push_constants{
+			.domain_min = {bounds.min[0], bounds.min[1], bounds.min[2], m_cell_size},
+			.domain_max = {bounds.max[0], bounds.max[1], bounds.max[2], dt},
+			.gravity = {m_parameters.gravity[0], m_parameters.gravity[1], m_parameters.gravity[2],
+						m_cell_size * m_cell_size},
+			.grid = {m_grid[0], m_grid[1], m_grid[2], get_cell_count()},
+			.kernel = {kernel.inv_smoothing_length, kernel.value_normalization,
+					   kernel.gradient_normalization, viscosity_epsilon * h * h},
+			.fluid = {m_parameters.rest_density, m_stiffness,
+					  viscosity_scale * m_parameters.viscosity, 0.0F},
+			.particle_count = m_particle_count,
+			.block_count = get_scan_block_count()};
+
+		add_submission_barrier(commands);
+
+		// The cell counts are accumulated with atomics, as is the largest speed
+		commands.fillBuffer(get_buffer(binding::cell_offsets).get(), 0, VK_WHOLE_SIZE, 0);
+		commands.fillBuffer(get_buffer(binding::reduction).get(), 0, VK_WHOLE_SIZE, 0);
+		add_barrier(commands, vk::PipelineStageFlagBits::eTransfer,
+					vk::AccessFlagBits::eTransferWrite, vk::PipelineStageFlagBits::eComputeShader,
+					vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+		commands.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_pipeline_layout.get(), 0,
+									m_descriptor_set, {});
+		commands.pushConstants<push_constants>(m_pipeline_layout.get(),
+											   vk::ShaderStageFlagBits::eCompute, 0, constants);
+
+		let particle_groups = get_workgroup_count(m_particle_count);
+		let dispatch = [&](pass index, std::uint32_t group_count) {
+			commands.bindPipeline(vk::PipelineBindPoint::eCompute,
+								  m_pipelines[static_cast<std::size_t>(index)].get());
+			commands.dispatch(group_count, 1, 1);
+		};
+
+		dispatch(pass::grid_count, particle_groups);
+		add_compute_barrier(commands);
+		dispatch(pass::scan_blocks, get_scan_block_count());
+		add_compute_barrier(commands);
+		dispatch(pass::scan_block_sums, 1);
+		add_compute_barrier(commands);
+		dispatch(pass::scan_add, get_scan_block_count());
+		add_compute_barrier(commands);
+		dispatch(pass::grid_scatter, particle_groups);
+		add_compute_barrier(commands);
+		dispatch(pass::density, particle_groups);
+		add_compute_barrier(commands);
+		dispatch(pass::force, particle_groups);
+		add_compute_barrier(commands);
+		dispatch(pass::advect, particle_groups);
+
+		add_barrier(commands, vk::PipelineStageFlagBits::eComputeShader,
+					vk::AccessFlagBits::eShaderWrite, vk::PipelineStageFlagBits::eHost,
+					vk::AccessFlagBits::eHostRead);
+	}
+} // namespace vulkan
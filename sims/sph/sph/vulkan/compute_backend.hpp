@@ -0,0 +1,215 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sph/solver/wcsph.hpp>
+#include <sph/vulkan/buffer.hpp>
+#include <sph/vulkan/details/vulkan.hpp>
+#include <sph/vulkan/device.hpp>
+#include <sph/vulkan/memory_allocator.hpp>
+#include <sph/vulkan/staging_ring.hpp>
+
+#include <libphyseng/kernels/smoothing_kernel.hpp>
+#include <libphyseng/particles/particle_set.hpp>
+
+#include <tl/expected.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace vulkan
+{
+	enum struct compute_error
+	{
+		no_host_visible_memory,  //< The device has no memory the host can map
+		out_of_memory,           //< The particles do not fit on the device
+		pipeline_creation_failed //< The driver rejected one of the compute shaders
+	};
+
+	auto to_string(compute_error error) -> std::string_view;
+
+	/**
+	 * @brief Runs the steps of `sph::wcsph_solver` on the GPU
+	 *
+	 * The particles stay in device local memory from one step to the next. Every step sorts them
+	 * in a uniform grid whose cells are as large as the support radius, then computes their
+	 * density, their forces, and moves them, each in its own compute pass. The only data read back
+	 * by a step is the largest speed of the particles, which the next time step depends on
+	 *
+	 * The particles go to and from the device through a staging ring. A download is staged by a
+	 * copy submitted after a step, the host then reads it while the following step computes
+	 */
+	class compute_backend
+	{
+	public:
+		/**
+		 * @brief A download staged by `stage_download`, readable once the device reached `value`
+		 */
+		struct download_ticket
+		{
+			staging_ring::slot slot;
+			std::uint64_t value;
+		};
+
+	public:
+		/**
+		 * @param[in] device The device to run on, which must outlive the backend
+		 * @param[in] allocator Where the buffers of the particles come from, which must outlive
+		 * the backend
+		 * @param[in] cache Where the compute pipelines are looked up before being compiled, and
+		 * added to once they are
+		 */
+		static auto make(device const& device, memory_allocator& allocator,
+						 vk::PipelineCache cache, physeng::smoothing_kernel const& kernel,
+						 sph::wcsph_parameters const& parameters)
+			-> tl::expected<compute_backend, compute_error>;
+
+		compute_backend(compute_backend const&) = delete;
+		compute_backend(compute_backend&&) noexcept = default;
+		~compute_backend();
+
+		auto operator=(compute_backend const&) -> compute_backend& = delete;
+		auto operator=(compute_backend&&) noexcept -> compute_backend& = default;
+
+		/**
+		 * @brief The time step the next call to `step` will take
+		 */
+		[[nodiscard]] auto get_time_step() const noexcept -> float;
+
+		/**
+		 * @brief Replace the particles on the device by `particles`
+		 */
+		template<physeng::precision_policy Precision>
+		auto upload(physeng::basic_particle_set<Precision> const& particles)
+			-> tl::expected<void, compute_error>;
+
+		/**
+		 * @brief Advance the particles on the device by one time step
+		 *
+		 * @return The time step that was taken
+		 */
+		auto step() -> float;
+
+		/**
+		 * @brief Submit the next time step without waiting for it, the host is free to do
+		 * something else until `end_step`
+		 */
+		void begin_step();
+		/**
+		 * @brief Wait for the time step submitted by `begin_step`
+		 *
+		 * @return The time step that was taken
+		 */
+		auto end_step() -> float;
+
+		/**
+		 * @brief Submit a copy of the particles, as they are after every step submitted so far,
+		 * to the staging ring
+		 */
+		[[nodiscard]] auto stage_download() -> download_ticket;
+
+		/**
+		 * @brief Copy the particles staged by `ticket` into `particles`, which must hold as many
+		 * particles as were uploaded. Waits for the copy to complete
+		 */
+		template<physeng::precision_policy Precision>
+		void download(download_ticket const& ticket,
+					  physeng::basic_particle_set<Precision>& particles) const;
+		/**
+		 * @brief Copy the current state of the particles on the device into `particles`
+		 */
+		template<physeng::precision_policy Precision>
+		void download(physeng::basic_particle_set<Precision>& particles);
+
+	private:
+		// The buffers, in the order of their bindings in the shaders
+		enum struct binding : std::uint32_t
+		{
+			positions,
+			velocities,
+			next_velocities,
+			masses,
+			densities,
+			pressures,
+			particle_cells,
+			particle_ranks,
+			cell_offsets,
+			sorted_particles,
+			block_sums,
+			reduction,
+			count
+		};
+
+		// The compute passes of a step, in the order they run
+		enum struct pass : std::uint32_t
+		{
+			grid_count,
+			scan_blocks,
+			scan_block_sums,
+			scan_add,
+			grid_scatter,
+			density,
+			force,
+			advect,
+			count
+		};
+
+		compute_backend(device const& device, memory_allocator& allocator,
+						vk::PipelineCache cache, physeng::smoothing_kernel const& kernel,
+						sph::wcsph_parameters const& parameters);
+
+		[[nodiscard]] auto get_buffer(binding index) const -> buffer const&;
+		[[nodiscard]] auto get_cell_count() const noexcept -> std::uint32_t;
+		[[nodiscard]] auto get_scan_block_count() const noexcept -> std::uint32_t;
+		/**
+		 * @brief Where the column `axis` of the buffer `index` lives in a slot of the staging ring
+		 */
+		[[nodiscard]] auto get_staging_offset(binding index, std::size_t axis) const noexcept
+			-> vk::DeviceSize;
+
+		void record_step(vk::CommandBuffer commands, float dt) const;
+
+	private:
+		device const* m_device;
+		memory_allocator* m_allocator;
+
+		physeng::smoothing_kernel m_kernel;
+		sph::wcsph_parameters m_parameters;
+		float m_stiffness;
+		float m_max_speed = 0.0F;
+		float m_pending_time_step = 0.0F; //< Of the step submitted by `begin_step`
+		std::uint64_t m_step_value = 0;   //< Timeline value the last step completes at
+
+		float m_cell_size;
+		std::array<std::uint32_t, 3> m_grid;
+		std::uint32_t m_particle_count = 0;
+
+		vk::UniqueDescriptorSetLayout m_set_layout;
+		vk::UniquePipelineLayout m_pipeline_layout;
+		std::vector<vk::UniquePipeline> m_pipelines;
+
+		vk::UniqueDescriptorPool m_descriptor_pool;
+		vk::DescriptorSet m_descriptor_set;
+
+		std::vector<buffer> m_buffers;
+		std::optional<staging_ring> m_staging;
+	};
+} // namespace vulkan
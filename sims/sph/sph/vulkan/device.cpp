@@ -0,0 +1,206 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sph/vulkan/device.hpp>
+
+#include <sph/core.hpp>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace
+{
+	using namespace std::literals;
+	namespace stdr = std::ranges;
+} // namespace
+
+namespace vulkan
+{
+	auto to_string(device_error error) -> std::string_view
+	{
+		switch (error)
+		{
+			case device_error::no_compute_queue:
+				return "no device with a compute queue"sv;
+			case device_error::no_timeline_semaphores:
+				return "no device with both a compute queue and timeline semaphores"sv;
+			case device_error::creation_failed:
+				return "failed to create the logical device"sv;
+		}
+
+		return {};
+	}
+
+	auto device::make(instance const& instance, spdlog::logger& logger)
+		-> tl::expected<device, device_error>
+	{
+		let devices = instance.get_devices();
+		let has_compute_queue = [](device_capabilities const& capabilities) {
+			return capabilities.compute_queue_family.has_value();
+		};
+		let best = stdr::find_if(devices, [&](device_capabilities const& capabilities) {
+			return has_compute_queue(capabilities) && capabilities.has_timeline_semaphores;
+		});
+
+		if (best == stdr::end(devices))
+		{
+			return tl::unexpected(stdr::any_of(devices, has_compute_queue)
+									  ? device_error::no_timeline_semaphores
+									  : device_error::no_compute_queue);
+		}
+
+		let priorities = std::array{1.0F};
+		let queue_info = vk::DeviceQueueCreateInfo{}
+							 .setQueueFamilyIndex(*best->compute_queue_family)
+							 .setQueuePriorities(priorities);
+		let create_info = vk::StructureChain<vk::DeviceCreateInfo,
+											 vk::PhysicalDeviceTimelineSemaphoreFeatures>{
+			vk::DeviceCreateInfo{}.setQueueCreateInfos(queue_info),
+			vk::PhysicalDeviceTimelineSemaphoreFeatures{}.setTimelineSemaphore(VK_TRUE)};
+
+		try
+		{
+			auto logical_device =
+				best->physical_device.createDeviceUnique(create_info.get<vk::DeviceCreateInfo>());
+
+			VULKAN_HPP_DEFAULT_DISPATCHER.init(logical_device.get());
+
+			auto result = vulkan::device{*best, std::move(logical_device)};
+			logger.info("compute device: {}, driver {}\n", best->properties.deviceName,
+						best->driver_version);
+
+			return result;
+		}
+		catch (vk::SystemError const& /*error*/)
+		{
+			return tl::unexpected(device_error::creation_failed);
+		}
+	}
+
+	device::device(device_capabilities const& capabilities, vk::UniqueDevice&& device) :
+		m_capabilities(capabilities), m_device(std::move(device)),
+		m_queue(m_device->getQueue(*capabilities.compute_queue_family, 0))
+	{
+		let queue_family = *capabilities.compute_queue_family;
+
+		m_command_pool = m_device->createCommandPoolUnique(
+			vk::CommandPoolCreateInfo{}
+				.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+				.setQueueFamilyIndex(queue_family));
+
+		m_command_buffers = m_device->allocateCommandBuffersUnique(
+			vk::CommandBufferAllocateInfo{}
+				.setCommandPool(m_command_pool.get())
+				.setLevel(vk::CommandBufferLevel::ePrimary)
+				.setCommandBufferCount(static_cast<std::uint32_t>(command_buffer_count)));
+
+		using timeline_chain =
+			vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo>;
+		let timeline_info = timeline_chain{
+			vk::SemaphoreCreateInfo{},
+			vk::SemaphoreTypeCreateInfo{}.setSemaphoreType(vk::SemaphoreType::eTimeline)};
+		m_timeline =
+			m_device->createSemaphoreUnique(timeline_info.get<vk::SemaphoreCreateInfo>());
+	}
+
+	device::~device()
+	{
+		// Nothing the device owns may be destroyed while the queue still uses it
+		if (m_device)
+		{
+			m_device->waitIdle();
+		}
+	}
+
+	device::operator vk::Device() const
+	{
+		return m_device.get();
+	}
+
+	auto device::get() const -> vk::Device
+	{
+		return m_device.get();
+	}
+	auto device::get_physical_device() const -> vk::PhysicalDevice
+	{
+		return m_capabilities.physical_device;
+	}
+	auto device::get_properties() const -> vk::PhysicalDeviceProperties const&
+	{
+		return m_capabilities.properties;
+	}
+	auto device::get_capabilities() const -> device_capabilities const&
+	{
+		return m_capabilities;
+	}
+
+	void device::wait(std::uint64_t value) const
+	{
+		let timeline = m_timeline.get();
+		let result = m_device->waitSemaphores(
+			vk::SemaphoreWaitInfo{}.setSemaphores(timeline).setValues(value),
+			std::numeric_limits<std::uint64_t>::max());
+		if (result != vk::Result::eSuccess)
+		{
+			throw vk::SystemError(vk::make_error_code(result), "waiting on the compute queue");
+		}
+	}
+
+	void device::wait_idle() const
+	{
+		wait(m_submitted_value);
+	}
+
+	auto device::is_complete(std::uint64_t value) const -> bool
+	{
+		return m_device->getSemaphoreCounterValue(m_timeline.get()) >= value;
+	}
+
+	auto device::begin_commands() const -> vk::CommandBuffer
+	{
+		// The command buffer may still be running the commands it was last submitted with
+		wait(m_command_values[m_next_command]);
+
+		let command_buffer = m_command_buffers[m_next_command].get();
+
+		command_buffer.reset();
+		command_buffer.begin(
+			vk::CommandBufferBeginInfo{}.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+		return command_buffer;
+	}
+
+	auto device::end_commands(vk::CommandBuffer command_buffer) const -> std::uint64_t
+	{
+		command_buffer.end();
+
+		let value = m_submitted_value + 1;
+		let timeline = m_timeline.get();
+		let timeline_info = vk::TimelineSemaphoreSubmitInfo{}.setSignalSemaphoreValues(value);
+
+		m_queue.submit(vk::SubmitInfo{}
+						   .setPNext(&timeline_info)
+						   .setCommandBuffers(command_buffer)
+						   .setSignalSemaphores(timeline));
+
+		m_submitted_value = value;
+		m_command_values[m_next_command] = value;
+		m_next_command = (m_next_command + 1) % command_buffer_count;
+
+		return value;
+	}
+} // namespace vulkan
@@ -0,0 +1,136 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sph/vulkan/capabilities.hpp>
+#include <sph/vulkan/details/vulkan.hpp>
+#include <sph/vulkan/instance.hpp>
+
+#include <spdlog/logger.h>
+
+#include <tl/expected.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace vulkan
+{
+	enum struct device_error
+	{
+		no_compute_queue,       //< No physical device has a queue able to run compute shaders
+		no_timeline_semaphores, //< The devices with a compute queue predate Vulkan 1.2
+		creation_failed         //< The driver failed to create the logical device
+	};
+
+	auto to_string(device_error error) -> std::string_view;
+
+	/**
+	 * @brief A logical device with a single compute queue, along with the command buffers used to
+	 * submit work to it
+	 *
+	 * Every submission signals the next value of a timeline semaphore, which the host waits on to
+	 * know when the work it submitted completed. The first physical device of
+	 * `instance::get_devices` with a compute queue and timeline semaphores is picked
+	 */
+	class device
+	{
+	public:
+		static auto make(instance const& instance, spdlog::logger& logger)
+			-> tl::expected<device, device_error>;
+
+		device(device const&) = delete;
+		device(device&&) noexcept = default;
+		~device();
+
+		auto operator=(device const&) -> device& = delete;
+		auto operator=(device&&) noexcept -> device& = default;
+
+		/**
+		 * Allow implicit conversion to a vulkan vk::Device
+		 */
+		operator vk::Device() const;
+
+		[[nodiscard]] auto get() const -> vk::Device;
+		[[nodiscard]] auto get_physical_device() const -> vk::PhysicalDevice;
+		[[nodiscard]] auto get_properties() const -> vk::PhysicalDeviceProperties const&;
+		[[nodiscard]] auto get_capabilities() const -> device_capabilities const&;
+
+		/**
+		 * @brief Record commands with `record(command_buffer)` and run them on the compute queue,
+		 * without waiting for them
+		 *
+		 * The commands run after every command submitted before them, but their memory accesses
+		 * are only ordered with the previous ones by the barriers they record
+		 *
+		 * @return The value the timeline reaches once the commands completed
+		 */
+		template<typename Fn>
+		auto submit(Fn&& record) const -> std::uint64_t
+		{
+			auto const command_buffer = begin_commands();
+			record(command_buffer);
+			return end_commands(command_buffer);
+		}
+
+		/**
+		 * @brief Record commands with `record(command_buffer)`, run them on the compute queue and
+		 * wait for them to complete
+		 */
+		template<typename Fn>
+		void submit_and_wait(Fn&& record) const
+		{
+			wait(submit(std::forward<Fn>(record)));
+		}
+
+		/**
+		 * @brief Block until the timeline reached `value`
+		 */
+		void wait(std::uint64_t value) const;
+		/**
+		 * @brief Block until everything submitted so far completed
+		 */
+		void wait_idle() const;
+		[[nodiscard]] auto is_complete(std::uint64_t value) const -> bool;
+
+	private:
+		static constexpr std::size_t command_buffer_count = 4;
+
+		device(device_capabilities const& capabilities, vk::UniqueDevice&& device);
+
+		[[nodiscard]] auto begin_commands() const -> vk::CommandBuffer;
+		auto end_commands(vk::CommandBuffer command_buffer) const -> std::uint64_t;
+
+	private:
+		device_capabilities m_capabilities;
+
+		vk::UniqueDevice m_device;
+		vk::Queue m_queue;
+		vk::UniqueCommandPool m_command_pool;
+		std::vector<vk::UniqueCommandBuffer> m_command_buffers;
+		vk::UniqueSemaphore m_timeline;
+
+		// Submitting does not change the device as seen from the outside, only which command
+		// buffer is recorded next and the value the timeline is heading to
+		mutable std::array<std::uint64_t, command_buffer_count> m_command_values = {};
+		mutable std::size_t m_next_command = 0;
+		mutable std::uint64_t m_submitted_value = 0;
+	};
+} // namespace vulkan
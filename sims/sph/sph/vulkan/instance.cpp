@@ -21,20 +21,21 @@
 #include <sph/vulkan/details/vulkan.hpp>
 
 #include <libphyseng/physeng-info.hpp>
+#include <libphyseng/profiling/profiler.hpp>
 
 #include <tl/expected.hpp>
 
 #include <spdlog/logger.h>
 
-#include <algorithm>
+#include <stdexcept>
 #include <string_view>
+#include <vector>
 
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE; // NOLINT
 
 namespace
 {
 	using namespace std::literals;
-	namespace stdr = std::ranges;
 
 	auto get_validation_message_type(VkDebugUtilsMessageTypeFlagsEXT messageType) -> std::string
 	{
@@ -103,34 +104,19 @@ namespace
 		return loader;
 	}
 
-	auto is_khr_validation_layer(vk::LayerProperties const& property) -> bool
-	{
-		return std::string_view{property.layerName} == "VK_LAYER_KHRONOS_validation"sv;
-	}
-
-	auto is_debug_utils_ext(vk::ExtensionProperties const& property) -> bool
-	{
-		return std::string_view{property.extensionName} == "VK_EXT_debug_utils"sv;
-	}
-
-	auto create_vk_instance(std::string_view app_name) -> vk::UniqueInstance
+	auto create_vk_instance(std::string_view app_name,
+							vulkan::instance_capabilities const& capabilities) -> vk::UniqueInstance
 	{
 		auto enabled_layers = std::vector<char const*>{};
 		auto enabled_exts = std::vector<char const*>{};
 
-		if constexpr (vulkan::should_enable_validation_layers)
+		if (capabilities.has_validation_layer)
 		{
-			let layer_props = vk::enumerateInstanceLayerProperties();
-			if (stdr::find_if(layer_props, is_khr_validation_layer) != stdr::end(layer_props))
-			{
-				enabled_layers.push_back("VK_LAYER_KHRONOS_validation");
-			}
-
-			let ext_props = vk::enumerateInstanceExtensionProperties();
-			if (stdr::find_if(ext_props, is_debug_utils_ext) != stdr::end(ext_props))
-			{
-				enabled_exts.push_back("VK_EXT_debug_utils");
-			}
+			enabled_layers.push_back("VK_LAYER_KHRONOS_validation");
+		}
+		if (capabilities.has_debug_utils)
+		{
+			enabled_exts.push_back("VK_EXT_debug_utils");
 		}
 
 		let app_info =
@@ -151,9 +137,15 @@ namespace
 		return instance;
 	}
 
-	auto create_vk_debug_utils(vk::Instance instance, spdlog::logger& logger)
-		-> vk::UniqueDebugUtilsMessengerEXT
+	auto create_vk_debug_utils(vk::Instance instance,
+							   vulkan::instance_capabilities const& capabilities,
+							   spdlog::logger& logger) -> vk::UniqueDebugUtilsMessengerEXT
 	{
+		if (!capabilities.has_debug_utils)
+		{
+			return {};
+		}
+
 		let create_info =
 			vk::DebugUtilsMessengerCreateInfoEXT()
 				.setMessageSeverity(vk::DebugUtilsMessageSeverityFlagBitsEXT::eInfo
@@ -165,36 +157,57 @@ namespace
 				.setPfnUserCallback(debug_callback)
 				.setPUserData(static_cast<void*>(&logger));
 
-		if constexpr (vulkan::should_enable_validation_layers)
+		return instance.createDebugUtilsMessengerEXTUnique(create_info, nullptr,
+														   VULKAN_HPP_DEFAULT_DISPATCHER);
+	}
+} // namespace
+
+namespace vulkan
+{
+	auto to_string(instance_error error) -> std::string_view
+	{
+		switch (error)
 		{
-			let ext_props = vk::enumerateInstanceExtensionProperties();
-			if (stdr::find_if(ext_props, is_debug_utils_ext) != stdr::end(ext_props))
-			{
-				return instance.createDebugUtilsMessengerEXTUnique(create_info, nullptr,
-																   VULKAN_HPP_DEFAULT_DISPATCHER);
-			}
+			case instance_error::loader_unavailable:
+				return "the vulkan loader is not installed"sv;
+			case instance_error::creation_failed:
+				return "no vulkan driver could create an instance"sv;
 		}
 
 		return {};
 	}
-} // namespace
 
-namespace vulkan
-{
 	auto instance::make(std::string_view app_name, spdlog::logger& logger)
 		-> tl::expected<instance, instance_error>
 	{
-		auto loader = load_vulkan_symbols();
-		auto instance = create_vk_instance(app_name);
-		auto debug_utils = create_vk_debug_utils(instance.get(), logger);
+		PHYSENG_PROFILE_ZONE("instance::make");
+
+		// Both the loader and vulkan-hpp report their failures through exceptions
+		try
+		{
+			auto loader = load_vulkan_symbols();
+			let capabilities = probe_instance_capabilities();
+			auto instance = create_vk_instance(app_name, capabilities);
+			auto debug_utils = create_vk_debug_utils(instance.get(), capabilities, logger);
 
-		return vulkan::instance{std::move(loader), std::move(instance), std::move(debug_utils)};
+			return vulkan::instance{std::move(loader), capabilities, std::move(instance),
+									std::move(debug_utils)};
+		}
+		catch (vk::SystemError const& /*error*/)
+		{
+			return tl::unexpected(instance_error::creation_failed);
+		}
+		catch (std::runtime_error const& /*error*/)
+		{
+			return tl::unexpected(instance_error::loader_unavailable);
+		}
 	}
 
-	instance::instance(vk::DynamicLoader&& loader, vk::UniqueInstance&& instance,
-					   vk::UniqueDebugUtilsMessengerEXT&& debug) :
+	instance::instance(vk::DynamicLoader&& loader, instance_capabilities const& capabilities,
+					   vk::UniqueInstance&& instance, vk::UniqueDebugUtilsMessengerEXT&& debug) :
 		m_loader{std::move(loader)},
-		m_instance{std::move(instance)}, m_debug_utils(std::move(debug))
+		m_capabilities(capabilities), m_instance{std::move(instance)},
+		m_debug_utils(std::move(debug)), m_devices(probe_device_capabilities(m_instance.get()))
 	{}
 
 	instance::operator vk::Instance() const
@@ -206,4 +219,12 @@ namespace vulkan
 	{
 		return m_instance.get();
 	}
+	auto instance::get_capabilities() const -> instance_capabilities const&
+	{
+		return m_capabilities;
+	}
+	auto instance::get_devices() const -> std::span<device_capabilities const>
+	{
+		return m_devices;
+	}
 } // namespace vulkan
@@ -17,19 +17,34 @@
 
 #pragma once
 
+#include <sph/vulkan/capabilities.hpp>
 #include <sph/vulkan/details/vulkan.hpp>
 
 #include <spdlog/logger.h>
 
 #include <tl/expected.hpp>
 
+#include <span>
+#include <string_view>
+#include <vector>
+
 namespace vulkan
 {
 	enum struct instance_error
 	{
-
+		loader_unavailable, //< The Vulkan loader library could not be found
+		creation_failed     //< The loader found no driver able to create the instance
 	};
 
+	auto to_string(instance_error error) -> std::string_view;
+
+	/**
+	 * @brief Owns the Vulkan loader and an instance created from it. The loader library is only
+	 * opened by `make`, a program that never creates an instance never loads it
+	 *
+	 * The capabilities of the loader and of every physical device are probed once by `make`, the
+	 * rest of the program reads them from here instead of querying the driver again
+	 */
 	class instance
 	{
 	public:
@@ -42,14 +57,21 @@ namespace vulkan
 		operator vk::Instance() const;
 
 		[[nodiscard]] auto get() const -> vk::Instance;
+		[[nodiscard]] auto get_capabilities() const -> instance_capabilities const&;
+		/**
+		 * @brief The physical devices, from the best suited to compute to the least
+		 */
+		[[nodiscard]] auto get_devices() const -> std::span<device_capabilities const>;
 
 	private:
-		instance(vk::DynamicLoader&& loader, vk::UniqueInstance&& instance,
-				 vk::UniqueDebugUtilsMessengerEXT&& debug);
+		instance(vk::DynamicLoader&& loader, instance_capabilities const& capabilities,
+				 vk::UniqueInstance&& instance, vk::UniqueDebugUtilsMessengerEXT&& debug);
 
 	private:
 		vk::DynamicLoader m_loader = {};
+		instance_capabilities m_capabilities = {};
 		vk::UniqueInstance m_instance = {};
 		vk::UniqueDebugUtilsMessengerEXT m_debug_utils = {};
+		std::vector<device_capabilities> m_devices = {};
 	};
 } // namespace vulkan
@@ -0,0 +1,253 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sph/vulkan/memory_allocator.hpp>
+
+#include <sph/core.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <iterator>
+
+namespace
+{
+	using namespace std::literals;
+	namespace stdr = std::ranges;
+
+	auto align_up(vk::DeviceSize value, vk::DeviceSize alignment) -> vk::DeviceSize
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+} // namespace
+
+namespace vulkan
+{
+	auto to_string(memory_error error) -> std::string_view
+	{
+		switch (error)
+		{
+			case memory_error::no_host_visible_memory:
+				return "no memory visible to the host"sv;
+			case memory_error::out_of_memory:
+				return "out of device memory"sv;
+		}
+
+		return {};
+	}
+
+	memory_allocator::memory_allocator(device const& device, vk::DeviceSize block_size) :
+		m_device(&device), m_block_size(block_size)
+	{}
+
+	auto memory_allocator::allocate(vk::MemoryRequirements const& requirements,
+									memory_usage usage) -> tl::expected<allocation, memory_error>
+	{
+		let memory_type = find_memory_type(requirements.memoryTypeBits, usage);
+		if (!memory_type)
+		{
+			return tl::unexpected(memory_error::no_host_visible_memory);
+		}
+
+		let alignment = std::max<vk::DeviceSize>(requirements.alignment, 1);
+		let make_allocation = [&](std::uint32_t index, vk::DeviceSize offset) {
+			let& block = m_blocks[index];
+			m_used_size += requirements.size;
+
+			return allocation{.memory = block.memory.get(),
+							  .offset = offset,
+							  .size = requirements.size,
+							  .mapped = block.mapped != nullptr ? block.mapped + offset : nullptr,
+							  .block = index};
+		};
+
+		for (std::uint32_t index = 0; index < m_blocks.size(); ++index)
+		{
+			auto& block = m_blocks[index];
+			if (block.memory_type != *memory_type)
+			{
+				continue;
+			}
+
+			if (let offset = carve(block, requirements.size, alignment))
+			{
+				return make_allocation(index, *offset);
+			}
+		}
+
+		try
+		{
+			auto& block = add_block(*memory_type, std::max(m_block_size, requirements.size));
+			let offset = carve(block, requirements.size, alignment);
+			assert(offset.has_value()); // NOLINT
+
+			return make_allocation(static_cast<std::uint32_t>(m_blocks.size() - 1), *offset);
+		}
+		catch (vk::SystemError const& /*error*/)
+		{
+			return tl::unexpected(memory_error::out_of_memory);
+		}
+	}
+
+	void memory_allocator::free(allocation const& allocation) noexcept
+	{
+		assert(allocation.block < m_blocks.size()); // NOLINT
+
+		auto& ranges = m_blocks[allocation.block].free_ranges;
+
+		let next = stdr::upper_bound(ranges, allocation.offset, stdr::less{}, &range::offset);
+		auto freed = ranges.insert(next, range{allocation.offset, allocation.size});
+
+		let is_adjacent = [](range const& lhs, range const& rhs) {
+			return lhs.offset + lhs.size == rhs.offset;
+		};
+
+		if (let after = std::next(freed); after != ranges.end() && is_adjacent(*freed, *after))
+		{
+			freed->size += after->size;
+			freed = std::prev(ranges.erase(after));
+		}
+		if (freed != ranges.begin())
+		{
+			if (let before = std::prev(freed); is_adjacent(*before, *freed))
+			{
+				before->size += freed->size;
+				ranges.erase(freed);
+			}
+		}
+
+		m_used_size -= allocation.size;
+	}
+
+	auto memory_allocator::get_device() const noexcept -> device const&
+	{
+		return *m_device;
+	}
+
+	auto memory_allocator::get_statistics() const noexcept -> statistics
+	{
+		auto result = statistics{.block_count = m_blocks.size(), .used_size = m_used_size};
+		for (let& block : m_blocks)
+		{
+			result.reserved_size += block.size;
+		}
+
+		return result;
+	}
+
+	auto memory_allocator::carve(block& block, vk::DeviceSize size, vk::DeviceSize alignment)
+		-> std::optional<vk::DeviceSize>
+	{
+		auto& ranges = block.free_ranges;
+		for (auto it = ranges.begin(); it != ranges.end(); ++it)
+		{
+			let offset = align_up(it->offset, alignment);
+			let end = it->offset + it->size;
+			if (offset + size > end)
+			{
+				continue;
+			}
+
+			// The padding in front stays free, and joins the range again once it is freed
+			let before = range{it->offset, offset - it->offset};
+			let after = range{offset + size, end - offset - size};
+
+			if (before.size == 0 && after.size == 0)
+			{
+				ranges.erase(it);
+			}
+			else if (before.size == 0)
+			{
+				*it = after;
+			}
+			else if (after.size == 0)
+			{
+				*it = before;
+			}
+			else
+			{
+				*it = before;
+				ranges.insert(std::next(it), after);
+			}
+
+			return offset;
+		}
+
+		return std::nullopt;
+	}
+
+	auto memory_allocator::find_memory_type(std::uint32_t allowed_types, memory_usage usage) const
+		-> std::optional<std::uint32_t>
+	{
+		using flags = vk::MemoryPropertyFlagBits;
+
+		let& properties = m_device->get_capabilities().memory_properties;
+		let find = [&](vk::MemoryPropertyFlags required) -> std::optional<std::uint32_t> {
+			for (std::uint32_t index = 0; index < properties.memoryTypeCount; ++index)
+			{
+				let is_allowed = (allowed_types & (1U << index)) != 0;
+				let type_flags = properties.memoryTypes[index].propertyFlags;
+				if (is_allowed && (type_flags & required) == required)
+				{
+					return index;
+				}
+			}
+
+			return std::nullopt;
+		};
+
+		// From the preferred flags to the ones we can live with. Coherent memory saves flushing
+		// the writes of the host, and invalidating before reading
+		let candidates =
+			usage == memory_usage::device_local
+				? std::array<vk::MemoryPropertyFlags, 2>{flags::eDeviceLocal, {}}
+				: std::array<vk::MemoryPropertyFlags, 2>{
+					flags::eHostVisible | flags::eHostCoherent | flags::eHostCached,
+					flags::eHostVisible | flags::eHostCoherent};
+
+		for (let required : candidates)
+		{
+			if (let index = find(required))
+			{
+				return index;
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	auto memory_allocator::add_block(std::uint32_t memory_type, vk::DeviceSize size) -> block&
+	{
+		let logical_device = m_device->get();
+
+		auto memory = logical_device.allocateMemoryUnique(
+			vk::MemoryAllocateInfo{}.setAllocationSize(size).setMemoryTypeIndex(memory_type));
+
+		let& properties = m_device->get_capabilities().memory_properties;
+		let is_host_visible = static_cast<bool>(properties.memoryTypes[memory_type].propertyFlags
+												 & vk::MemoryPropertyFlagBits::eHostVisible);
+
+		auto* mapped = is_host_visible
+						 ? static_cast<std::byte*>(logical_device.mapMemory(memory.get(), 0, size))
+						 : nullptr;
+
+		return m_blocks.emplace_back(block{.memory = std::move(memory),
+										   .memory_type = memory_type,
+										   .size = size,
+										   .mapped = mapped,
+										   .free_ranges = {range{0, size}}});
+	}
+} // namespace vulkan
@@ -0,0 +1,141 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sph/vulkan/details/vulkan.hpp>
+#include <sph/vulkan/device.hpp>
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace vulkan
+{
+	enum struct memory_error
+	{
+		no_host_visible_memory, //< The device has no memory the host can map
+		out_of_memory
+	};
+
+	auto to_string(memory_error error) -> std::string_view;
+
+	/**
+	 * @brief The kind of memory an allocation lives in
+	 */
+	enum struct memory_usage
+	{
+		device_local, //< Only accessed by the GPU, falls back to any memory when there is none
+		host_visible  //< Mapped for the whole life of the allocator, cached by the host if possible
+	};
+
+	/**
+	 * @brief A range of a memory block handed out by `memory_allocator`
+	 */
+	struct allocation
+	{
+		vk::DeviceMemory memory;
+		vk::DeviceSize offset = 0;
+		vk::DeviceSize size = 0;
+		std::byte* mapped = nullptr; //< Null unless the memory is visible to the host
+		std::uint32_t block = 0;
+	};
+
+	/**
+	 * @brief Carves buffers out of a few large blocks of device memory, instead of allocating
+	 * memory for each of them. Drivers may only hand out a few thousand allocations in total, and
+	 * every one of them is slow to make
+	 *
+	 * Every block holds a single memory type and keeps its free ranges sorted by offset, a freed
+	 * range is merged with its free neighbors. Blocks are only released with the allocator, which
+	 * must outlive every allocation made from it
+	 */
+	class memory_allocator
+	{
+	public:
+		static constexpr vk::DeviceSize default_block_size = vk::DeviceSize{64} << 20U;
+
+		struct statistics
+		{
+			std::size_t block_count = 0;
+			vk::DeviceSize reserved_size = 0; //< The total size of the blocks
+			vk::DeviceSize used_size = 0;     //< The total size of the live allocations
+		};
+
+	public:
+		/**
+		 * @param[in] device The device the memory is allocated on, which must outlive the
+		 * allocator
+		 * @param[in] block_size The size of the blocks, larger allocations get a block of their
+		 * own
+		 */
+		explicit memory_allocator(device const& device,
+								  vk::DeviceSize block_size = default_block_size);
+
+		memory_allocator(memory_allocator const&) = delete;
+		memory_allocator(memory_allocator&&) noexcept = default;
+		~memory_allocator() = default;
+
+		auto operator=(memory_allocator const&) -> memory_allocator& = delete;
+		auto operator=(memory_allocator&&) noexcept -> memory_allocator& = default;
+
+		[[nodiscard]] auto allocate(vk::MemoryRequirements const& requirements, memory_usage usage)
+			-> tl::expected<allocation, memory_error>;
+		void free(allocation const& allocation) noexcept;
+
+		[[nodiscard]] auto get_device() const noexcept -> device const&;
+		[[nodiscard]] auto get_statistics() const noexcept -> statistics;
+
+	private:
+		struct range
+		{
+			vk::DeviceSize offset;
+			vk::DeviceSize size;
+		};
+
+		struct block
+		{
+			vk::UniqueDeviceMemory memory;
+			std::uint32_t memory_type;
+			vk::DeviceSize size;
+			std::byte* mapped;
+			std::vector<range> free_ranges; //< Sorted by offset, never adjacent to one another
+		};
+
+		/**
+		 * @brief Take `size` bytes aligned on `alignment` from the free ranges of `block`
+		 *
+		 * @return The offset of the range, if one was large enough
+		 */
+		static auto carve(block& block, vk::DeviceSize size, vk::DeviceSize alignment)
+			-> std::optional<vk::DeviceSize>;
+
+		[[nodiscard]] auto find_memory_type(std::uint32_t allowed_types, memory_usage usage) const
+			-> std::optional<std::uint32_t>;
+		auto add_block(std::uint32_t memory_type, vk::DeviceSize size) -> block&;
+
+	private:
+		device const* m_device;
+		vk::DeviceSize m_block_size;
+
+		std::vector<block> m_blocks;
+		vk::DeviceSize m_used_size = 0;
+	};
+} // namespace vulkan
@@ -0,0 +1,233 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sph/vulkan/pipeline_cache.hpp>
+
+#include <sph/core.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+	using namespace std::literals;
+	namespace stdr = std::ranges;
+
+	/**
+	 * @brief The header every driver starts the data of its caches with, see
+	 * VkPipelineCacheHeaderVersionOne
+	 */
+	struct cache_header
+	{
+		std::uint32_t header_size;
+		std::uint32_t header_version;
+		std::uint32_t vendor_id;
+		std::uint32_t device_id;
+		std::array<std::uint8_t, VK_UUID_SIZE> cache_uuid;
+	};
+
+	static_assert(std::is_trivially_copyable_v<cache_header> && sizeof(cache_header) == 32);
+
+	auto get_file_name(vulkan::device_capabilities const& capabilities) -> std::string
+	{
+		return fmt::format("{:04x}-{:04x}-{}.bin", capabilities.properties.vendorID,
+						   capabilities.properties.deviceID, capabilities.driver_version);
+	}
+
+	auto read_file(std::filesystem::path const& path) -> std::vector<std::byte>
+	{
+		auto file = std::ifstream{path, std::ios::binary};
+		if (!file)
+		{
+			return {};
+		}
+
+		auto data = std::vector<std::byte>{};
+		std::transform(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{},
+					   std::back_inserter(data), [](char c) { return std::byte(c); });
+
+		return file.bad() ? std::vector<std::byte>{} : data;
+	}
+
+	/**
+	 * @brief Whether `data` was written by the device described by `capabilities`. Drivers are
+	 * required to reject the data of other devices, not all of them do so gracefully
+	 */
+	auto is_compatible(std::span<std::byte const> data,
+					   vulkan::device_capabilities const& capabilities) -> bool
+	{
+		if (data.size() < sizeof(cache_header))
+		{
+			return false;
+		}
+
+		auto header = cache_header{};
+		std::memcpy(&header, data.data(), sizeof(header));
+
+		let& properties = capabilities.properties;
+		return header.header_size >= sizeof(cache_header)
+			&& header.header_version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+			&& header.vendor_id == properties.vendorID && header.device_id == properties.deviceID
+			&& stdr::equal(header.cache_uuid, properties.pipelineCacheUUID);
+	}
+} // namespace
+
+namespace vulkan
+{
+	auto to_string(pipeline_cache_error error) -> std::string_view
+	{
+		switch (error)
+		{
+			case pipeline_cache_error::creation_failed:
+				return "failed to create the pipeline cache"sv;
+			case pipeline_cache_error::write_failed:
+				return "failed to write the pipeline cache"sv;
+		}
+
+		return {};
+	}
+
+	auto pipeline_cache::load(device const& device, std::filesystem::path const& directory,
+							  spdlog::logger& logger)
+		-> tl::expected<pipeline_cache, pipeline_cache_error>
+	{
+		let& capabilities = device.get_capabilities();
+
+		auto path = directory / get_file_name(capabilities);
+		auto data = read_file(path);
+
+		if (!data.empty() && !is_compatible(data, capabilities))
+		{
+			logger.warn("ignoring the pipeline cache {}, it was written by another device",
+						path.string());
+			data.clear();
+		}
+
+		try
+		{
+			auto cache = device.get().createPipelineCacheUnique(
+				vk::PipelineCacheCreateInfo{}.setInitialDataSize(data.size()).setPInitialData(
+					data.data()));
+
+			if (data.empty())
+			{
+				logger.info("no pipeline cache at {}, the shaders will be compiled\n",
+							path.string());
+			}
+			else
+			{
+				logger.info("loaded {} bytes of pipeline cache from {}\n", data.size(),
+							path.string());
+			}
+
+			return pipeline_cache{device, std::move(path), std::move(cache)};
+		}
+		catch (vk::SystemError const& /*error*/)
+		{
+			// Only the data is suspicious when a driver refuses a cache it claims to have written
+			if (data.empty())
+			{
+				return tl::unexpected(pipeline_cache_error::creation_failed);
+			}
+		}
+
+		logger.warn("the driver rejected the pipeline cache {}, starting from an empty one",
+					path.string());
+
+		try
+		{
+			auto cache = device.get().createPipelineCacheUnique(vk::PipelineCacheCreateInfo{});
+			return pipeline_cache{device, std::move(path), std::move(cache)};
+		}
+		catch (vk::SystemError const& /*error*/)
+		{
+			return tl::unexpected(pipeline_cache_error::creation_failed);
+		}
+	}
+
+	pipeline_cache::pipeline_cache(device const& device, std::filesystem::path&& path,
+								   vk::UniquePipelineCache&& cache) :
+		m_device(&device),
+		m_path(std::move(path)), m_cache(std::move(cache))
+	{}
+
+	pipeline_cache::operator vk::PipelineCache() const
+	{
+		return m_cache.get();
+	}
+
+	auto pipeline_cache::get() const -> vk::PipelineCache
+	{
+		return m_cache.get();
+	}
+	auto pipeline_cache::get_path() const -> std::filesystem::path const&
+	{
+		return m_path;
+	}
+
+	auto pipeline_cache::save() const -> tl::expected<void, pipeline_cache_error>
+	{
+		auto data = std::vector<std::uint8_t>{};
+		try
+		{
+			data = m_device->get().getPipelineCacheData(m_cache.get());
+		}
+		catch (vk::SystemError const& /*error*/)
+		{
+			return tl::unexpected(pipeline_cache_error::write_failed);
+		}
+
+		auto error = std::error_code{};
+		std::filesystem::create_directories(m_path.parent_path(), error);
+		if (error)
+		{
+			return tl::unexpected(pipeline_cache_error::write_failed);
+		}
+
+		// Written aside then renamed, a run killed while saving never leaves half a cache behind
+		auto temporary = m_path;
+		temporary += ".tmp";
+
+		{
+			auto file = std::ofstream{temporary, std::ios::binary | std::ios::trunc};
+			file.write(reinterpret_cast<char const*>(data.data()), // NOLINT
+					   static_cast<std::streamsize>(data.size()));
+			if (!file)
+			{
+				return tl::unexpected(pipeline_cache_error::write_failed);
+			}
+		}
+
+		std::filesystem::rename(temporary, m_path, error);
+		if (error)
+		{
+			return tl::unexpected(pipeline_cache_error::write_failed);
+		}
+
+		return {};
+	}
+} // namespace vulkan
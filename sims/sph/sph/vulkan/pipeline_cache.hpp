@@ -0,0 +1,83 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sph/vulkan/details/vulkan.hpp>
+#include <sph/vulkan/device.hpp>
+
+#include <spdlog/logger.h>
+
+#include <tl/expected.hpp>
+
+#include <filesystem>
+#include <string_view>
+
+namespace vulkan
+{
+	enum struct pipeline_cache_error
+	{
+		creation_failed, //< The driver failed to create even an empty cache
+		write_failed     //< The cache could not be written back to disk
+	};
+
+	auto to_string(pipeline_cache_error error) -> std::string_view;
+
+	/**
+	 * @brief A `vk::PipelineCache` kept on disk between runs, so that the shaders are only
+	 * compiled to machine code the first time a driver sees them
+	 *
+	 * Every device and driver version gets its own file, named after the vendor, the device and
+	 * the driver version reported by `get_driver_version`. Updating the driver thus starts from an
+	 * empty cache rather than handing it data it would have to reject
+	 */
+	class pipeline_cache
+	{
+	public:
+		/**
+		 * @brief Load the cache of `device` from `directory`. A missing or stale file is not an
+		 * error, the cache then starts empty
+		 *
+		 * @param[in] device The device the pipelines are created on, which must outlive the cache
+		 */
+		static auto load(device const& device, std::filesystem::path const& directory,
+						 spdlog::logger& logger)
+			-> tl::expected<pipeline_cache, pipeline_cache_error>;
+
+		/**
+		 * Allow implicit conversion to a vulkan vk::PipelineCache
+		 */
+		operator vk::PipelineCache() const;
+
+		[[nodiscard]] auto get() const -> vk::PipelineCache;
+		[[nodiscard]] auto get_path() const -> std::filesystem::path const&;
+
+		/**
+		 * @brief Write the cache, with every pipeline created from it since it was loaded, back to
+		 * the file it was loaded from
+		 */
+		[[nodiscard]] auto save() const -> tl::expected<void, pipeline_cache_error>;
+
+	private:
+		pipeline_cache(device const& device, std::filesystem::path&& path,
+					   vk::UniquePipelineCache&& cache);
+
+	private:
+		device const* m_device;
+		std::filesystem::path m_path;
+		vk::UniquePipelineCache m_cache;
+	};
+} // namespace vulkan
@@ -0,0 +1,84 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sph/vulkan/shaders.hpp>
+
+#include <array>
+
+namespace
+{
+	// The build compiles every shader to a list of comma separated words
+	constexpr auto grid_count_code = std::to_array<std::uint32_t>({
+#include <sph/vulkan/shaders/grid_count.spv>
+	});
+	constexpr auto scan_blocks_code = std::to_array<std::uint32_t>({
+#include <sph/vulkan/shaders/scan_blocks.spv>
+	});
+	constexpr auto scan_block_sums_code = std::to_array<std::uint32_t>({
+#include <sph/vulkan/shaders/scan_block_sums.spv>
+	});
+	constexpr auto scan_add_code = std::to_array<std::uint32_t>({
+#include <sph/vulkan/shaders/scan_add.spv>
+	});
+	constexpr auto grid_scatter_code = std::to_array<std::uint32_t>({
+#include <sph/vulkan/shaders/grid_scatter.spv>
+	});
+	constexpr auto density_code = std::to_array<std::uint32_t>({
+#include <sph/vulkan/shaders/density.spv>
+	});
+	constexpr auto force_code = std::to_array<std::uint32_t>({
+#include <sph/vulkan/shaders/force.spv>
+	});
+	constexpr auto advect_code = std::to_array<std::uint32_t>({
+#include <sph/vulkan/shaders/advect.spv>
+	});
+} // namespace
+
+namespace vulkan::shaders
+{
+	auto grid_count() noexcept -> std::span<std::uint32_t const>
+	{
+		return grid_count_code;
+	}
+	auto scan_blocks() noexcept -> std::span<std::uint32_t const>
+	{
+		return scan_blocks_code;
+	}
+	auto scan_block_sums() noexcept -> std::span<std::uint32_t const>
+	{
+		return scan_block_sums_code;
+	}
+	auto scan_add() noexcept -> std::span<std::uint32_t const>
+	{
+		return scan_add_code;
+	}
+	auto grid_scatter() noexcept -> std::span<std::uint32_t const>
+	{
+		return grid_scatter_code;
+	}
+	auto density() noexcept -> std::span<std::uint32_t const>
+	{
+		return density_code;
+	}
+	auto force() noexcept -> std::span<std::uint32_t const>
+	{
+		return force_code;
+	}
+	auto advect() noexcept -> std::span<std::uint32_t const>
+	{
+		return advect_code;
+	}
+} // namespace vulkan::shaders
@@ -0,0 +1,36 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+/**
+ * @brief The SPIR-V of the compute shaders found in `shaders/`, compiled by the build and
+ * embedded in the executable
+ */
+namespace vulkan::shaders
+{
+	auto grid_count() noexcept -> std::span<std::uint32_t const>;
+	auto scan_blocks() noexcept -> std::span<std::uint32_t const>;
+	auto scan_block_sums() noexcept -> std::span<std::uint32_t const>;
+	auto scan_add() noexcept -> std::span<std::uint32_t const>;
+	auto grid_scatter() noexcept -> std::span<std::uint32_t const>;
+	auto density() noexcept -> std::span<std::uint32_t const>;
+	auto force() noexcept -> std::span<std::uint32_t const>;
+	auto advect() noexcept -> std::span<std::uint32_t const>;
+} // namespace vulkan::shaders
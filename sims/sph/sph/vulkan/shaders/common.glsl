@@ -0,0 +1,174 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Declarations shared by every compute shader of the WCSPH backend. They all use the same
+// pipeline layout, see compute_backend.cpp: the buffers below and the push constants
+
+#define WORKGROUP_SIZE 256
+
+// Matches physeng::kernel_type
+layout(constant_id = 0) const uint kernel_type = 0;
+
+const uint cubic_spline = 0;
+const uint wendland_c2 = 1;
+const uint wendland_c4 = 2;
+
+layout(push_constant, std430) uniform parameters_block
+{
+	vec4 domain_min; // w: size of a grid cell
+	vec4 domain_max; // w: time step
+	vec4 gravity;    // w: squared support radius
+	uvec4 grid;      // xyz: cells along every axis, w: number of cells
+	vec4 kernel;     // x: 1 / h, y: sigma / h^3, z: sigma / h^5, w: viscosity epsilon
+	vec4 fluid;      // x: rest density, y: stiffness of the Tait equation, z: viscosity
+	uint particle_count;
+	uint block_count; // Number of blocks the cell offsets are scanned in
+}
+parameters;
+
+// Columns of `particle_count` floats, one after the other
+layout(std430, binding = 0) restrict buffer positions_block
+{
+	float positions[];
+};
+layout(std430, binding = 1) restrict buffer velocities_block
+{
+	float velocities[];
+};
+layout(std430, binding = 2) restrict buffer next_velocities_block
+{
+	float next_velocities[];
+};
+layout(std430, binding = 3) restrict readonly buffer masses_block
+{
+	float masses[];
+};
+layout(std430, binding = 4) restrict buffer densities_block
+{
+	float densities[];
+};
+layout(std430, binding = 5) restrict buffer pressures_block
+{
+	float pressures[];
+};
+
+// The uniform grid: the cell of every particle and its rank within the cell, the offsets of the
+// cells in the particles sorted by cell, with one past the end entry, and the sorted particles
+layout(std430, binding = 6) restrict buffer particle_cells_block
+{
+	uint particle_cells[];
+};
+layout(std430, binding = 7) restrict buffer particle_ranks_block
+{
+	uint particle_ranks[];
+};
+layout(std430, binding = 8) restrict buffer cell_offsets_block
+{
+	uint cell_offsets[];
+};
+layout(std430, binding = 9) restrict buffer sorted_particles_block
+{
+	uint sorted_particles[];
+};
+layout(std430, binding = 10) restrict buffer block_sums_block
+{
+	uint block_sums[];
+};
+
+// The largest squared speed after the step, as the bits of a float
+layout(std430, binding = 11) restrict buffer reduction_block
+{
+	uint max_speed_squared;
+};
+
+vec3 load_position(uint i)
+{
+	uint n = parameters.particle_count;
+	return vec3(positions[i], positions[n + i], positions[2 * n + i]);
+}
+
+vec3 load_velocity(uint i)
+{
+	uint n = parameters.particle_count;
+	return vec3(velocities[i], velocities[n + i], velocities[2 * n + i]);
+}
+
+ivec3 get_cell_coordinates(vec3 position)
+{
+	ivec3 cell = ivec3(floor((position - parameters.domain_min.xyz) / parameters.domain_min.w));
+	return clamp(cell, ivec3(0), ivec3(parameters.grid.xyz) - 1);
+}
+
+uint get_cell_index(ivec3 cell)
+{
+	uvec3 grid = parameters.grid.xyz;
+	return (uint(cell.z) * grid.y + uint(cell.y)) * grid.x + uint(cell.x);
+}
+
+bool is_in_grid(ivec3 cell)
+{
+	return all(greaterThanEqual(cell, ivec3(0))) && all(lessThan(cell, ivec3(parameters.grid.xyz)));
+}
+
+// The same shapes as libphyseng/kernels/detail/kernel_batch.ipp
+float kernel_shape(float q)
+{
+	if (kernel_type == cubic_spline)
+	{
+		float two_minus_q = max(2.0 - q, 0.0);
+		return q < 1.0 ? 1.0 - 1.5 * q * q + 0.75 * q * q * q
+					   : 0.25 * two_minus_q * two_minus_q * two_minus_q;
+	}
+
+	float t = max(1.0 - 0.5 * q, 0.0);
+	float t2 = t * t;
+	if (kernel_type == wendland_c2)
+	{
+		return t2 * t2 * (2.0 * q + 1.0);
+	}
+
+	return t2 * t2 * t2 * (35.0 / 12.0 * q * q + 3.0 * q + 1.0);
+}
+
+// Derivative of the shape with respect to q, divided by q
+float kernel_shape_gradient(float q)
+{
+	if (kernel_type == cubic_spline)
+	{
+		float two_minus_q = max(2.0 - q, 0.0);
+		return q < 1.0 ? -3.0 + 2.25 * q : -0.75 * two_minus_q * two_minus_q / max(q, 1.0);
+	}
+
+	float t = max(1.0 - 0.5 * q, 0.0);
+	if (kernel_type == wendland_c2)
+	{
+		return -5.0 * t * t * t;
+	}
+
+	float t2 = t * t;
+	return -14.0 / 3.0 * t2 * t2 * t * (2.5 * q + 1.0);
+}
+
+float evaluate_kernel(float distance_squared)
+{
+	return parameters.kernel.y * kernel_shape(sqrt(distance_squared) * parameters.kernel.x);
+}
+
+// Such that grad W(x_i - x_j) = factor * (x_i - x_j)
+float evaluate_kernel_gradient(float distance_squared)
+{
+	return parameters.kernel.z * kernel_shape_gradient(sqrt(distance_squared) * parameters.kernel.x);
+}
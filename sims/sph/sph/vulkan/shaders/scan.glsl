@@ -0,0 +1,37 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Scans of a value per invocation over a whole workgroup, in shared memory
+
+shared uint scan_values[WORKGROUP_SIZE];
+
+uint workgroup_inclusive_scan(uint value)
+{
+	uint index = gl_LocalInvocationID.x;
+
+	scan_values[index] = value;
+	barrier();
+
+	for (uint offset = 1; offset < WORKGROUP_SIZE; offset <<= 1)
+	{
+		uint addend = index >= offset ? scan_values[index - offset] : 0u;
+		barrier();
+		scan_values[index] += addend;
+		barrier();
+	}
+
+	return scan_values[index];
+}
@@ -0,0 +1,88 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sph/vulkan/staging_ring.hpp>
+
+#include <sph/core.hpp>
+
+#include <cassert>
+#include <utility>
+
+namespace
+{
+	// Keeps every slot aligned for the copies, whatever the size of the particle columns
+	constexpr vk::DeviceSize slot_alignment = 256;
+} // namespace
+
+namespace vulkan
+{
+	auto staging_ring::make(memory_allocator& allocator, vk::DeviceSize slot_size,
+							std::uint32_t slot_count) -> tl::expected<staging_ring, memory_error>
+	{
+		assert(slot_count > 0); // NOLINT
+
+		let aligned_size = (slot_size + slot_alignment - 1) / slot_alignment * slot_alignment;
+
+		auto result = buffer::make(allocator, aligned_size * slot_count,
+								   vk::BufferUsageFlagBits::eTransferSrc
+									   | vk::BufferUsageFlagBits::eTransferDst,
+								   memory_usage::host_visible);
+		if (!result)
+		{
+			return tl::unexpected(result.error());
+		}
+
+		return staging_ring{allocator.get_device(), std::move(result).value(), aligned_size,
+							slot_count};
+	}
+
+	staging_ring::staging_ring(device const& device, buffer&& buffer, vk::DeviceSize slot_size,
+							   std::uint32_t slot_count) :
+		m_device(&device),
+		m_buffer(std::move(buffer)), m_slot_size(slot_size), m_values(slot_count, 0)
+	{}
+
+	auto staging_ring::get() const -> vk::Buffer
+	{
+		return m_buffer.get();
+	}
+	auto staging_ring::get_slot_size() const noexcept -> vk::DeviceSize
+	{
+		return m_slot_size;
+	}
+	auto staging_ring::get_slot_count() const noexcept -> std::uint32_t
+	{
+		return static_cast<std::uint32_t>(m_values.size());
+	}
+
+	auto staging_ring::acquire() -> slot
+	{
+		let index = m_next;
+		m_next = (m_next + 1) % get_slot_count();
+
+		m_device->wait(m_values[index]);
+
+		let offset = m_slot_size * index;
+		return {.index = index,
+				.offset = offset,
+				.memory = m_buffer.mapped<std::byte>().subspan(offset, m_slot_size)};
+	}
+
+	void staging_ring::release(slot const& slot, std::uint64_t value)
+	{
+		m_values[slot.index] = value;
+	}
+} // namespace vulkan
@@ -0,0 +1,84 @@
+/**
+ * Copyright 2023 wmbat
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sph/vulkan/buffer.hpp>
+#include <sph/vulkan/details/vulkan.hpp>
+#include <sph/vulkan/device.hpp>
+#include <sph/vulkan/memory_allocator.hpp>
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace vulkan
+{
+	/**
+	 * @brief A buffer in memory visible to the host, split in slots that data goes through on
+	 * its way to or from the device. The buffer stays mapped for as long as the ring lives
+	 *
+	 * Every slot remembers the timeline value of the last submission that used it, and acquiring
+	 * the slot waits for that submission to complete. A slot the device copied data into must be
+	 * read before `get_slot_count()` more slots are acquired
+	 */
+	class staging_ring
+	{
+	public:
+		struct slot
+		{
+			std::uint32_t index;
+			vk::DeviceSize offset;       //< Offset of the slot within the buffer
+			std::span<std::byte> memory; //< The slot as seen by the host
+		};
+
+	public:
+		/**
+		 * @param[in] allocator Where the memory comes from, which must outlive the ring
+		 */
+		static auto make(memory_allocator& allocator, vk::DeviceSize slot_size,
+						 std::uint32_t slot_count) -> tl::expected<staging_ring, memory_error>;
+
+		[[nodiscard]] auto get() const -> vk::Buffer;
+		[[nodiscard]] auto get_slot_size() const noexcept -> vk::DeviceSize;
+		[[nodiscard]] auto get_slot_count() const noexcept -> std::uint32_t;
+
+		/**
+		 * @brief The next slot of the ring, once the device is done with it
+		 */
+		[[nodiscard]] auto acquire() -> slot;
+		/**
+		 * @brief Record that the submission reaching `value` on the timeline of the device uses
+		 * `slot`
+		 */
+		void release(slot const& slot, std::uint64_t value);
+
+	private:
+		staging_ring(device const& device, buffer&& buffer, vk::DeviceSize slot_size,
+					 std::uint32_t slot_count);
+
+	private:
+		device const* m_device;
+		buffer m_buffer;
+		vk::DeviceSize m_slot_size;
+
+		std::vector<std::uint64_t> m_values; //< The last value every slot was released with
+		std::uint32_t m_next = 0;
+	};
+} // namespace vulkan